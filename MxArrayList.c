@@ -6,9 +6,23 @@
 //  Copyright 2011 __MyCompanyName__. All rights reserved.
 //
 
+// For mremap
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <stdlib.h>
 #include <memory.h>
 #include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define MxArrayListHasSIMDSearch (1)
+#endif
 
 #include "MxStatus.h"
 #include "MxFunctions.h"
@@ -16,26 +30,198 @@
 #include "MxArrayList.h"
 
 
-// expand the internal array
-static inline MxStatus ExpandIfNeeded(MxArrayListRef list)
+// -- Item storage ------------------------------------------------------------
+
+
+#define HugePageSize ((size_t)2 << 20)
+
+static size_t MappingGranularity(MxArrayListStorage storage)
 {
-	/* The "if needed" bit... */
-	if (list->count < list->capacity)
-		return MxStatusOK;
-    
-	size_t newSize = (list->capacity * MxArrayListExpansionFactor) * sizeof(void *);	
-	void **newItems;
-    
-	newItems = (void **) realloc((void *)(list->items), newSize);
+	if (storage == MxArrayListHugePageStorage)
+		return HugePageSize;
+	
+	return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// Round *capacity up so the mapping ends on a page (or huge page) boundary
+static size_t MappingBytes(MxArrayListStorage storage, size_t *capacity)
+{
+	size_t granularity = MappingGranularity(storage);
+	size_t bytes = ((*capacity * sizeof(void *) + granularity - 1) / granularity) * granularity;
+	
+	*capacity = bytes / sizeof(void *);
+	
+	return bytes;
+}
+
+static void AdviseHugePages(MxArrayListStorage storage, void *items, size_t bytes)
+{
+#ifdef MADV_HUGEPAGE
+	// Only a hint - without THP support the mapping just uses normal pages
+	if (storage == MxArrayListHugePageStorage)
+		madvise(items, bytes, MADV_HUGEPAGE);
+#endif
+}
+
+// Allocate room for at least *capacity items, updating it to what was actually allocated
+static void **AllocateItems(MxArrayListStorage storage, size_t *capacity)
+{
+	if (storage == MxArrayListHeapStorage)
+		return (void **)calloc(*capacity, sizeof(void *));
+	
+	size_t bytes = MappingBytes(storage, capacity);
+	
+	// Anonymous mappings are zero-filled and only take memory as pages are touched
+	void *items = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (items == MAP_FAILED)
+		return NULL;
+	
+	AdviseHugePages(storage, items, bytes);
+	
+	return (void **)items;
+}
+
+static void **ReallocateItems(MxArrayListRef list, size_t *newCapacity)
+{
+	if (list->storage == MxArrayListHeapStorage)
+		return (void **)realloc((void *)(list->items), *newCapacity * sizeof(void *));
+	
+	size_t oldBytes = list->capacity * sizeof(void *);
+	size_t newBytes = MappingBytes(list->storage, newCapacity);
+	void *newItems;
+	
+#ifdef MREMAP_MAYMOVE
+	// Grows in place if the address space after the mapping is free, otherwise
+	// the kernel moves the page table entries - the items are never copied
+	newItems = mremap(list->items, oldBytes, newBytes, MREMAP_MAYMOVE);
+	if (newItems == MAP_FAILED)
+		return NULL;
+#else
+	size_t capacity = *newCapacity;
+	
+	if ((newItems = AllocateItems(list->storage, &capacity)) == NULL)
+		return NULL;
+	
+	memcpy(newItems, list->items, list->count * sizeof(void *));
+	munmap(list->items, oldBytes);
+#endif
+	
+	AdviseHugePages(list->storage, newItems, newBytes);
+	
+	return (void **)newItems;
+}
+
+static void FreeItems(MxArrayListRef list)
+{
+	if (list->storage == MxArrayListHeapStorage)
+		free(list->items);
+	else if (list->items != NULL)
+		munmap(list->items, list->capacity * sizeof(void *));
+	
+	list->items = NULL;
+}
+
+
+
+// Round a capacity up so the array fills a whole allocator size class. Like most
+// mallocs, assume four classes per power of two - 1, 1.25, 1.5 and 1.75 times it.
+static size_t RoundToSizeClass(size_t capacity)
+{
+	size_t bytes = capacity * sizeof(void *);
+	if (bytes <= 16)
+		return 16 / sizeof(void *);
+	
+	size_t power = (size_t)1 << (sizeof(size_t) * 8 - 1 - __builtin_clzl(bytes));
+	size_t step = power / 4;
+	
+	bytes = ((bytes + step - 1) / step) * step;
+	
+	return bytes / sizeof(void *);
+}
+
+static size_t GrownCapacity(MxArrayListRef list, size_t needed)
+{
+	size_t capacity = list->capacity;
+	size_t newCapacity;
+	
+	switch (list->growthPolicy)
+	{
+		case MxArrayListGrowByHalf:
+			newCapacity = capacity + capacity / 2 + 1;
+			break;
+		
+		case MxArrayListGrowByIncrement:
+			newCapacity = capacity + list->growthIncrement;
+			break;
+		
+		case MxArrayListGrowToSizeClass:
+			newCapacity = capacity + capacity / 2 + 1;
+			break;
+		
+		default:
+			newCapacity = capacity * MxArrayListExpansionFactor;
+			break;
+	}
+	
+	if (newCapacity < needed)
+		newCapacity = needed;
+	
+	if (list->growthPolicy == MxArrayListGrowToSizeClass)
+		newCapacity = RoundToSizeClass(newCapacity);
+	
+	return newCapacity;
+}
+
+// resize the internal array to exactly 'newCapacity' items (or more, for mapped storage)
+static MxStatus ResizeItems(MxArrayListRef list, size_t newCapacity)
+{
+	void **newItems = ReallocateItems(list, &newCapacity);
 	if (newItems == NULL)
 		return MxStatusNoMemory;
 	
 	list->items = newItems;
-	list->capacity *= MxArrayListExpansionFactor;
+	list->capacity = newCapacity;
 	
 	return MxStatusOK;
 }
 
+// expand the internal array so it can hold at least 'needed' items - one realloc at most
+static inline MxStatus ExpandToFit(MxArrayListRef list, size_t needed)
+{
+	if (needed <= list->capacity)
+		return MxStatusOK;
+	
+	return ResizeItems(list, GrownCapacity(list, needed));
+}
+
+// With auto-shrink on, give memory back once the list is down to a quarter of its
+// capacity. Shrinking only to twice the count leaves room to grow again before
+// the next realloc, so a list hovering around one size doesn't thrash.
+static void ShrinkIfSparse(MxArrayListRef list)
+{
+	if (!list->autoShrink || list->capacity <= MxArrayListDefaultCapacity)
+		return;
+	
+	if (list->count > list->capacity / MxArrayListShrinkDivisor)
+		return;
+	
+	size_t newCapacity = list->count * 2;
+	if (newCapacity < MxArrayListDefaultCapacity)
+		newCapacity = MxArrayListDefaultCapacity;
+	
+	// A failed shrink leaves the list as it was, which is fine
+	ResizeItems(list, newCapacity);
+}
+
+// expand the internal array
+static inline MxStatus ExpandIfNeeded(MxArrayListRef list)
+{
+	/* The "if needed" bit... */
+	return ExpandToFit(list, list->count + 1);
+}
+
+static void ClearItems(MxArrayListRef list);
+
 
 
 MxArrayListRef MxArrayListCreate(void)
@@ -87,6 +273,21 @@ MxArrayListRef	MxArrayListCreateWithFunctions(MxFreeFunction itemFree, MxEqualsF
 	return result;
 }
 
+MxArrayListRef MxArrayListCreateWithStorage(size_t capacity, MxArrayListStorage storage, MxFreeFunction itemFree, MxEqualsFunction itemEquals)
+{
+	MxArrayListRef result = malloc(sizeof(MxArrayList));
+	if (result)
+	{
+		if (MxArrayListInitWithStorage(result, capacity, storage, itemFree, itemEquals) != MxStatusOK)
+		{
+			free(result);
+			result = NULL;
+		}
+	}
+	
+	return result;
+}
+
 MxArrayListRef MxArrayListCreateWithCapacityAndFunctions(size_t capacity, MxFreeFunction itemFree, MxEqualsFunction itemEquals){
 	MxArrayListRef result = malloc(sizeof(MxArrayList));
 	if (result)
@@ -124,6 +325,11 @@ MxStatus MxArrayListInitWithCapacity(MxArrayListRef	list, size_t capacity)
 }
 
 MxStatus MxArrayListInitWithCapacityAndFunctions(MxArrayListRef list, size_t capacity, MxFreeFunction itemFree, MxEqualsFunction itemEquals)
+{
+	return MxArrayListInitWithStorage(list, capacity, MxArrayListHeapStorage, itemFree, itemEquals);
+}
+
+MxStatus MxArrayListInitWithStorage(MxArrayListRef list, size_t capacity, MxArrayListStorage storage, MxFreeFunction itemFree, MxEqualsFunction itemEquals)
 {
 	if (list == NULL)
 		return MxStatusNullArgument;
@@ -131,12 +337,17 @@ MxStatus MxArrayListInitWithCapacityAndFunctions(MxArrayListRef list, size_t cap
 	if (capacity == 0)
 		return MxStatusIllegalArgument;
 	
+	if (storage != MxArrayListHeapStorage && storage != MxArrayListMappedStorage && storage != MxArrayListHugePageStorage)
+		return MxStatusIllegalArgument;
 	
-    
-	list->items = (void **)calloc(capacity, sizeof(void *));
+	list->items = AllocateItems(storage, &capacity);
 	if (list->items == NULL)
 		return MxStatusNoMemory;
 	
+	list->storage = storage;
+	list->growthPolicy = MxArrayListGrowByDoubling;
+	list->growthIncrement = 0;
+	list->autoShrink = 0;
 	list->capacity = capacity;
 	list->count = 0;
 	list->itemEquals = itemEquals;
@@ -151,9 +362,8 @@ MxStatus MxArrayListWipe(MxArrayListRef list)
 	if (list == NULL)
 		return MxStatusNullArgument;
 	
-	MxStatus result = MxArrayListClear(list);
-	if (result == MxStatusOK)
-		free(list->items);
+	ClearItems(list);
+	FreeItems(list);
 	
 	return MxStatusOK;
 }
@@ -171,6 +381,59 @@ MxStatus MxArrayListDelete(MxArrayListRef list)
 	return result;
 }
 
+MxStatus MxArrayListSetGrowthPolicy(MxArrayListRef list, MxArrayListGrowthPolicy policy, size_t increment)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	if (policy < MxArrayListGrowByDoubling || policy > MxArrayListGrowToSizeClass)
+		return MxStatusIllegalArgument;
+	
+	if (policy == MxArrayListGrowByIncrement && increment == 0)
+		return MxStatusIllegalArgument;
+	
+	list->growthPolicy = policy;
+	list->growthIncrement = increment;
+	
+	return MxStatusOK;
+}
+
+MxStatus MxArrayListSetAutoShrink(MxArrayListRef list, int autoShrink)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	list->autoShrink = autoShrink;
+	
+	return MxStatusOK;
+}
+
+MxStatus MxArrayListReserve(MxArrayListRef list, size_t capacity)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	if (capacity <= list->capacity)
+		return MxStatusOK;
+	
+	return ResizeItems(list, capacity);
+}
+
+MxStatus MxArrayListShrinkToFit(MxArrayListRef list)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	// Keep at least one slot so the array is never a zero-byte allocation
+	size_t newCapacity = (list->count > 0) ? list->count : 1;
+	if (newCapacity >= list->capacity)
+		return MxStatusOK;
+	
+	return ResizeItems(list, newCapacity);
+}
+
+
+
 MxStatus MxArrayListAppend(MxArrayListRef list, const void *item)
 {
 	if (list == NULL)
@@ -201,6 +464,7 @@ MxStatus MxArrayListPush(MxArrayListRef list, const void *item)
 	memmove(list->items + 1, list->items, (sizeof(void *) * list->count));
 	
 	list->items[0] = (void *)item;
+	list->count += 1;
 	
 	return MxStatusOK;
 }
@@ -237,6 +501,107 @@ MxStatus MxArrayListInsertAt(MxArrayListRef list, const void *item, int index)
 
 
 
+MxStatus MxArrayListAppendMany(MxArrayListRef list, const void **items, size_t count)
+{
+	if (list == NULL || (items == NULL && count > 0))
+		return MxStatusNullArgument;
+	
+	// 'items' may be NULL, which memcpy doesn't allow even for no bytes
+	if (count == 0)
+		return MxStatusOK;
+	
+	MxStatus result = ExpandToFit(list, list->count + count);
+	if (result != MxStatusOK)
+		return result;
+	
+	memcpy(list->items + list->count, items, count * sizeof(void *));
+	list->count += count;
+	
+	return MxStatusOK;
+}
+
+
+
+MxStatus MxArrayListInsertManyAt(MxArrayListRef list, const void **items, size_t count, int index)
+{
+	if (list == NULL || (items == NULL && count > 0))
+		return MxStatusNullArgument;
+	
+	if (index < 0)
+		return MxStatusIllegalArgument;
+	
+	if (index > list->count)
+		return MxStatusIndexOutOfRange;
+	
+	if (count == 0)
+		return MxStatusOK;
+	
+	MxStatus result = ExpandToFit(list, list->count + count);
+	if (result != MxStatusOK)
+		return result;
+	
+	memmove(list->items + index + count, list->items + index, (list->count - index) * sizeof(void *));
+	memcpy(list->items + index, items, count * sizeof(void *));
+	list->count += count;
+	
+	return MxStatusOK;
+}
+
+
+
+MxStatus MxArrayListExtend(MxArrayListRef list, MxArrayListRef other)
+{
+	if (list == NULL || other == NULL)
+		return MxStatusNullArgument;
+	
+	// Read before growing - 'other' may be 'list' itself
+	size_t count = other->count;
+	
+	MxStatus result = ExpandToFit(list, list->count + count);
+	if (result != MxStatusOK)
+		return result;
+	
+	memcpy(list->items + list->count, other->items, count * sizeof(void *));
+	list->count += count;
+	
+	return MxStatusOK;
+}
+
+
+
+MxStatus MxArrayListRemoveRange(MxArrayListRef list, int index, size_t count, void **removed)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	if (index < 0)
+		return MxStatusIllegalArgument;
+	
+	if (index > list->count || count > list->count - index)
+		return MxStatusIndexOutOfRange;
+	
+	if (removed != NULL)
+	{
+		memcpy(removed, list->items + index, count * sizeof(void *));
+	}
+	else if (list->itemFree)
+	{
+		for (size_t ctr = 0; ctr < count; ++ctr)
+			list->itemFree(list->items[index + ctr]);
+	}
+	
+	size_t tail = list->count - index - count;
+	memmove(list->items + index, list->items + index + count, tail * sizeof(void *));
+	memset(list->items + index + tail, 0, count * sizeof(void *));
+	list->count -= count;
+	
+	ShrinkIfSparse(list);
+	
+	return MxStatusOK;
+}
+
+
+
 MxStatus MxArrayListReplaceAt(MxArrayListRef list, const void *item, int index)
 {
 	if (list == NULL)
@@ -291,6 +656,7 @@ MxStatus MxArrayListPop(MxArrayListRef list, void **result)
 		list->count -= 1;
 		
 		// Dont't free the item - transfers responsibility for memory management
+		ShrinkIfSparse(list);
 	}
 	
 	return MxStatusOK;
@@ -314,7 +680,7 @@ MxStatus MxArrayListRemoveAt(MxArrayListRef list, int index, void **removed)
 	
 	void *moveSource = list->items + (index + 1);
 	void *moveDest = list->items + index;
-	size_t moveAmt = (list->count + (index + 1)) * sizeof(void *);
+	size_t moveAmt = (list->count - index - 1) * sizeof(void *);
 	
 	
 	memmove(moveDest, moveSource, moveAmt);
@@ -323,73 +689,214 @@ MxStatus MxArrayListRemoveAt(MxArrayListRef list, int index, void **removed)
 	
 	list->count -= 1;
 	
+	ShrinkIfSparse(list);
+	
 	return MxStatusOK;
 }
 
 
 
-MxStatus MxArrayListClear(MxArrayListRef list)
+MxStatus MxArrayListSwapRemove(MxArrayListRef list, int index, void **removed)
 {
-	if (list == NULL)
+	if (list == NULL || removed == NULL)
 		return MxStatusNullArgument;
 	
-	if (list->itemFree)
+	if (index < 0)
+		return MxStatusIllegalArgument;
+	
+	if (index >= list->count)
+		return MxStatusIndexOutOfRange;
+	
+	*removed = list->items[index];
+	
+	// Fill the hole with the last item rather than shifting everything after it
+	list->items[index] = list->items[list->count - 1];
+	list->items[list->count - 1] = NULL;
+	list->count -= 1;
+	
+	ShrinkIfSparse(list);
+	
+	return MxStatusOK;
+}
+
+
+
+MxStatus MxArrayListRemoveIf(MxArrayListRef list, MxPredicateFunction predicate, void *state)
+{
+	if (list == NULL || predicate == NULL)
+		return MxStatusNullArgument;
+	
+	// One pass, sliding each kept item down over the removed ones
+	size_t kept = 0;
+	for (size_t ctr = 0; ctr < list->count; ++ctr)
 	{
-		for (int ctr = 0; ctr < list->count; ++ctr)
+		void *item = list->items[ctr];
+		
+		if (predicate(item, state))
 		{
-			list->itemFree(list->items[ctr]);
+			if (list->itemFree)
+				list->itemFree(item);
+		}
+		else
+		{
+			list->items[kept++] = item;
 		}
 	}
 	
+	memset(list->items + kept, 0, (list->count - kept) * sizeof(void *));
+	list->count = kept;
 	
-	memset(list->items, 0, (list->count * sizeof(void *)));
-	
-	list->count = 0;
+	ShrinkIfSparse(list);
 	
 	return MxStatusOK;
 }
 
 
 
-MxStatus MxArrayListIterate(MxArrayListRef list, MxIteratorCallback callback, void *state)
+MxStatus MxArrayListPartition(MxArrayListRef list, MxPredicateFunction predicate, void *state, size_t *split)
 {
-	if (list == NULL || callback == NULL)
+	if (list == NULL || predicate == NULL || split == NULL)
 		return MxStatusNullArgument;
 	
-    MxStatus result = MxStatusOK;
-	for (int ctr = 0; ctr < list->count; ++ctr)
-		if ((result = callback(list->items[ctr], state)) != MxStatusOK)
+	// Close in from both ends, swapping each misplaced pair. Everything below
+	// 'low' matches and everything from 'high' up doesn't.
+	size_t low = 0, high = list->count;
+	while (1)
+	{
+		while (low < high && predicate(list->items[low], state))
+			low += 1;
+		
+		if (low == high)
+			break;
+		
+		// items[low] doesn't match - find a match above it to swap with
+		do {
+			high -= 1;
+		} while (high > low && !predicate(list->items[high], state));
+		
+		if (high == low)
 			break;
+		
+		void *item = list->items[low];
+		list->items[low] = list->items[high];
+		list->items[high] = item;
+		low += 1;
+	}
 	
-	return result;
+	*split = low;
+	
+	return MxStatusOK;
 }
 
 
 
-MxStatus MxArrayListIterateBackward(MxArrayListRef list, MxIteratorCallback callback, void *state)
+MxStatus MxArrayListStablePartition(MxArrayListRef list, MxPredicateFunction predicate, void *state, size_t *split)
+{
+	if (list == NULL || predicate == NULL || split == NULL)
+		return MxStatusNullArgument;
+	
+	*split = 0;
+	if (list->count == 0)
+		return MxStatusOK;
+	
+	void **rejected = (void **)malloc(list->count * sizeof(void *));
+	if (rejected == NULL)
+		return MxStatusNoMemory;
+	
+	// Matches slide down in place, the rest queue up in order and go back after them
+	size_t matched = 0, rejectedCount = 0;
+	for (size_t ctr = 0; ctr < list->count; ++ctr)
+	{
+		void *item = list->items[ctr];
+		
+		if (predicate(item, state))
+			list->items[matched++] = item;
+		else
+			rejected[rejectedCount++] = item;
+	}
+	
+	memcpy(list->items + matched, rejected, rejectedCount * sizeof(void *));
+	free(rejected);
+	
+	*split = matched;
+	
+	return MxStatusOK;
+}
+
+
+
+static void ClearItems(MxArrayListRef list)
+{
+	if (list->itemFree)
+	{
+		for (int ctr = 0; ctr < list->count; ++ctr)
+		{
+			list->itemFree(list->items[ctr]);
+		}
+	}
+	
+	
+	if (list->storage == MxArrayListHeapStorage)
+		memset(list->items, 0, (list->count * sizeof(void *)));
+	else
+		// Hand the pages back - they come back zero-filled if the list grows again
+		madvise(list->items, list->capacity * sizeof(void *), MADV_DONTNEED);
+	
+	list->count = 0;
+}
+
+MxStatus MxArrayListClear(MxArrayListRef list)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	ClearItems(list);
+	ShrinkIfSparse(list);
+	
+	return MxStatusOK;
+}
+
+
+
+MxStatus MxArrayListIterate(MxArrayListRef list, MxIteratorCallback callback, void *state)
 {
 	if (list == NULL || callback == NULL)
 		return MxStatusNullArgument;
 	
-	MxStatus result = MxStatusOK;
-    size_t ctr = list->count - 1;
-    do {
-        if ((result = callback(list->items[ctr], state)) != MxStatusOK)
-            break;
-    } while (ctr > 0);
+    MxStatus result = MxStatusOK;
+	for (int ctr = 0; ctr < list->count; ++ctr)
+		if ((result = callback(list->items[ctr], state)) != MxStatusOK)
+			break;
+	
+	return result;
+}
 
+
+
+MxStatus MxArrayListIterateBackward(MxArrayListRef list, MxIteratorCallback callback, void *state)
+{
+	if (list == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = MxStatusOK;
+	for (size_t ctr = list->count; ctr > 0; --ctr)
+		if ((result = callback(list->items[ctr - 1], state)) != MxStatusOK)
+			break;
 	
 	return result;
 }
 
 
 
-inline void *MxArrayListGetItem(MxArrayListRef list, int idx)
+MxStatus MxArrayListGetSpan(MxArrayListRef list, void ***items, size_t *count)
 {
-	if (list && idx > 0 && idx < list->count)
-		return list->items[idx];
-    
-	return NULL;
+	if (list == NULL || items == NULL || count == NULL)
+		return MxStatusNullArgument;
+	
+	*items = list->items;
+	*count = list->count;
+	
+	return MxStatusOK;
 }
 
 
@@ -401,3 +908,1061 @@ inline size_t MxArrayListGetCount(MxArrayListRef list)
 	
 	return 0;
 }
+
+
+
+// -- Searching ---------------------------------------------------------------
+
+
+// Identity search over items[start, end). The SIMD versions compare a whole
+// vector of pointers against 'item' at once and only look at individual lanes
+// once a block has a hit.
+static size_t FindPointerScalar(void **items, size_t start, size_t end, const void *item)
+{
+	size_t ctr = start;
+	
+	for (; ctr + 4 <= end; ctr += 4)
+	{
+		if ((items[ctr] == item) | (items[ctr + 1] == item) | (items[ctr + 2] == item) | (items[ctr + 3] == item))
+			break;
+	}
+	
+	for (; ctr < end; ++ctr)
+		if (items[ctr] == item)
+			return ctr;
+	
+	return end;
+}
+
+#ifdef MxArrayListHasSIMDSearch
+
+// SSE2 is part of x86-64, but has no 64-bit compare - two pointers per vector
+// match when both of their 32-bit halves do
+static size_t FindPointerSSE2(void **items, size_t start, size_t end, const void *item)
+{
+	const __m128i key = _mm_set1_epi64x((long long)(uintptr_t)item);
+	size_t ctr = start;
+	
+	for (; ctr + 4 <= end; ctr += 4)
+	{
+		__m128i a = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(items + ctr)), key);
+		__m128i b = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(items + ctr + 2)), key);
+		a = _mm_and_si128(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1)));
+		b = _mm_and_si128(b, _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 3, 0, 1)));
+		
+		int mask = _mm_movemask_pd(_mm_castsi128_pd(a)) | (_mm_movemask_pd(_mm_castsi128_pd(b)) << 2);
+		if (mask != 0)
+			return ctr + __builtin_ctz(mask);
+	}
+	
+	return FindPointerScalar(items, ctr, end, item);
+}
+
+__attribute__((target("avx2")))
+static size_t FindPointerAVX2(void **items, size_t start, size_t end, const void *item)
+{
+	const __m256i key = _mm256_set1_epi64x((long long)(uintptr_t)item);
+	size_t ctr = start;
+	
+	for (; ctr + 8 <= end; ctr += 8)
+	{
+		__m256i a = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(items + ctr)), key);
+		__m256i b = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(items + ctr + 4)), key);
+		
+		int mask = _mm256_movemask_pd(_mm256_castsi256_pd(a)) | (_mm256_movemask_pd(_mm256_castsi256_pd(b)) << 4);
+		if (mask != 0)
+			return ctr + __builtin_ctz(mask);
+	}
+	
+	return FindPointerSSE2(items, ctr, end, item);
+}
+
+#endif
+
+
+static size_t FindPointer(void **items, size_t start, size_t end, const void *item)
+{
+#ifdef MxArrayListHasSIMDSearch
+	if (__builtin_cpu_supports("avx2"))
+		return FindPointerAVX2(items, start, end, item);
+	
+	return FindPointerSSE2(items, start, end, item);
+#else
+	return FindPointerScalar(items, start, end, item);
+#endif
+}
+
+// Index of the first item in [start, end) matching 'item', or 'end'
+static size_t FindItem(MxArrayListRef list, size_t start, size_t end, const void *item)
+{
+	if (list->itemEquals == NULL)
+		return FindPointer(list->items, start, end, item);
+	
+	for (size_t ctr = start; ctr < end; ++ctr)
+		if (list->itemEquals(list->items[ctr], item))
+			return ctr;
+	
+	return end;
+}
+
+
+int MxArrayListIndexOf(MxArrayListRef list, void *item)
+{
+	if (list == NULL)
+		return -1;
+	
+	size_t idx = FindItem(list, 0, list->count, item);
+	
+	return (idx < list->count) ? (int)idx : -1;
+}
+
+
+typedef struct _ParallelSearch {
+	MxArrayListRef list;
+	const void *item;
+	
+	size_t start;
+	size_t end;
+	
+	// Lowest match found by any worker so far (the list's count if none)
+	size_t *found;
+} ParallelSearch;
+
+static void *ParallelSearchWorker(void *vsearch)
+{
+	ParallelSearch *search = (ParallelSearch *)vsearch;
+	
+	for (size_t block = search->start; block < search->end; block += MxArrayListParallelSearchBlock)
+	{
+		// Give up once another worker has a match earlier in the list than anything left here
+		if (__atomic_load_n(search->found, __ATOMIC_RELAXED) < block)
+			break;
+		
+		size_t blockEnd = block + MxArrayListParallelSearchBlock;
+		if (blockEnd > search->end)
+			blockEnd = search->end;
+		
+		size_t idx = FindItem(search->list, block, blockEnd, search->item);
+		if (idx < blockEnd)
+		{
+			size_t current = __atomic_load_n(search->found, __ATOMIC_RELAXED);
+			while (idx < current && !__atomic_compare_exchange_n(search->found, &current, idx, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				;
+			break;
+		}
+	}
+	
+	return NULL;
+}
+
+int MxArrayListIndexOfParallel(MxArrayListRef list, void *item, int threadCount)
+{
+	if (list == NULL)
+		return -1;
+	
+	if (threadCount <= 0)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threadCount = (cpus > 0) ? (int)cpus : 1;
+	}
+	
+	if (threadCount > MxArrayListParallelMaxThreads)
+		threadCount = MxArrayListParallelMaxThreads;
+	
+	if (list->count < MxArrayListParallelSearchThreshold || threadCount == 1)
+		return MxArrayListIndexOf(list, item);
+	
+	pthread_t threads[MxArrayListParallelMaxThreads];
+	ParallelSearch searches[MxArrayListParallelMaxThreads];
+	size_t found = list->count;
+	size_t share = (list->count + threadCount - 1) / threadCount;
+	uint64_t started = 0;
+	
+	for (int ctr = 0; ctr < threadCount; ++ctr)
+	{
+		ParallelSearch *search = searches + ctr;
+		search->list = list;
+		search->item = item;
+		search->found = &found;
+		search->start = ctr * share;
+		search->end = (search->start + share < list->count) ? search->start + share : list->count;
+		
+		// The calling thread takes the first share itself
+		if (ctr > 0 && pthread_create(threads + ctr, NULL, ParallelSearchWorker, search) == 0)
+			started |= (uint64_t)1 << ctr;
+	}
+	
+	ParallelSearchWorker(searches);
+	
+	// Any share a thread couldn't be started for is searched here instead
+	for (int ctr = 1; ctr < threadCount; ++ctr)
+	{
+		if (started & ((uint64_t)1 << ctr))
+			pthread_join(threads[ctr], NULL);
+		else
+			ParallelSearchWorker(searches + ctr);
+	}
+	
+	return (found < list->count) ? (int)found : -1;
+}
+
+
+
+// -- Parallel operations -----------------------------------------------------
+
+
+// Never split a list into chunks smaller than this
+#define ParallelMinChunk (4096)
+
+typedef struct _ParallelJob {
+	MxArrayListRef list;
+	MxArrayListRef dest;
+	
+	size_t chunkCount;
+	void *state;
+	
+	MxIteratorCallback iterate;
+	MxMapFunction map;
+	MxPredicateFunction predicate;
+	MxReduceFunction reduce;
+	
+	// Filter: one flag per item, then matches and output offset per chunk
+	unsigned char *keep;
+	size_t *offsets;
+	
+	// Reduce: one accumulator per chunk
+	unsigned char *accumulators;
+	size_t accumulatorSize;
+} ParallelJob;
+
+
+// A few chunks per thread so one slow chunk doesn't hold up the whole job
+static size_t ParallelChunkCount(MxThreadPoolRef pool, size_t count)
+{
+	size_t chunks = MxThreadPoolGetConcurrency(pool) * 4;
+	size_t maxChunks = (count + ParallelMinChunk - 1) / ParallelMinChunk;
+	
+	return (chunks < maxChunks) ? chunks : maxChunks;
+}
+
+static inline void ParallelChunkBounds(ParallelJob *job, size_t chunk, size_t *start, size_t *end)
+{
+	size_t count = job->list->count;
+	
+	*start = (count * chunk) / job->chunkCount;
+	*end = (count * (chunk + 1)) / job->chunkCount;
+}
+
+static MxThreadPoolRef ParallelPool(MxThreadPoolRef pool)
+{
+	return (pool != NULL) ? pool : MxThreadPoolGetDefault();
+}
+
+
+static MxStatus ForEachChunk(size_t chunk, void *vjob)
+{
+	ParallelJob *job = (ParallelJob *)vjob;
+	size_t start, end;
+	ParallelChunkBounds(job, chunk, &start, &end);
+	
+	MxStatus result = MxStatusOK;
+	for (size_t ctr = start; ctr < end; ++ctr)
+		if ((result = job->iterate(job->list->items[ctr], job->state)) != MxStatusOK)
+			break;
+	
+	return result;
+}
+
+MxStatus MxArrayListParallelForEach(MxThreadPoolRef pool, MxArrayListRef list, MxIteratorCallback callback, void *state)
+{
+	if (list == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	if ((pool = ParallelPool(pool)) == NULL)
+		return MxStatusNoMemory;
+	
+	ParallelJob job = { .list = list, .state = state, .iterate = callback };
+	job.chunkCount = ParallelChunkCount(pool, list->count);
+	
+	return MxThreadPoolRun(pool, job.chunkCount, ForEachChunk, &job);
+}
+
+
+static MxStatus MapChunk(size_t chunk, void *vjob)
+{
+	ParallelJob *job = (ParallelJob *)vjob;
+	size_t start, end;
+	ParallelChunkBounds(job, chunk, &start, &end);
+	
+	void **results = job->dest->items + job->dest->count;
+	
+	MxStatus result = MxStatusOK;
+	for (size_t ctr = start; ctr < end; ++ctr)
+		if ((result = job->map(job->list->items[ctr], results + ctr, job->state)) != MxStatusOK)
+			break;
+	
+	return result;
+}
+
+MxStatus MxArrayListParallelMap(MxThreadPoolRef pool, MxArrayListRef list, MxArrayListRef dest, MxMapFunction map, void *state)
+{
+	if (list == NULL || dest == NULL || map == NULL)
+		return MxStatusNullArgument;
+	
+	if ((pool = ParallelPool(pool)) == NULL)
+		return MxStatusNoMemory;
+	
+	size_t count = list->count;
+	MxStatus result = ExpandToFit(dest, dest->count + count);
+	MxStatusCheck(result);
+	
+	// NULL results mark the slots no map call has filled, in case the job fails
+	void **results = dest->items + dest->count;
+	memset(results, 0, count * sizeof(void *));
+	
+	ParallelJob job = { .list = list, .dest = dest, .state = state, .map = map };
+	job.chunkCount = ParallelChunkCount(pool, count);
+	
+	result = MxThreadPoolRun(pool, job.chunkCount, MapChunk, &job);
+	if (result != MxStatusOK)
+	{
+		for (size_t ctr = 0; ctr < count; ++ctr)
+		{
+			if (results[ctr] != NULL && dest->itemFree)
+				dest->itemFree(results[ctr]);
+			results[ctr] = NULL;
+		}
+		
+		return result;
+	}
+	
+	dest->count += count;
+	
+	return MxStatusOK;
+}
+
+
+static MxStatus FilterMarkChunk(size_t chunk, void *vjob)
+{
+	ParallelJob *job = (ParallelJob *)vjob;
+	size_t start, end;
+	ParallelChunkBounds(job, chunk, &start, &end);
+	
+	size_t matches = 0;
+	for (size_t ctr = start; ctr < end; ++ctr)
+	{
+		job->keep[ctr] = (job->predicate(job->list->items[ctr], job->state) != 0);
+		matches += job->keep[ctr];
+	}
+	
+	job->offsets[chunk] = matches;
+	
+	return MxStatusOK;
+}
+
+static MxStatus FilterCopyChunk(size_t chunk, void *vjob)
+{
+	ParallelJob *job = (ParallelJob *)vjob;
+	size_t start, end;
+	ParallelChunkBounds(job, chunk, &start, &end);
+	
+	void **out = job->dest->items + job->dest->count + job->offsets[chunk];
+	for (size_t ctr = start; ctr < end; ++ctr)
+		if (job->keep[ctr])
+			*out++ = job->list->items[ctr];
+	
+	return MxStatusOK;
+}
+
+MxStatus MxArrayListParallelFilter(MxThreadPoolRef pool, MxArrayListRef list, MxArrayListRef dest, MxPredicateFunction predicate, void *state)
+{
+	if (list == NULL || dest == NULL || predicate == NULL)
+		return MxStatusNullArgument;
+	
+	if (list == dest)
+		return MxStatusIllegalArgument;
+	
+	if ((pool = ParallelPool(pool)) == NULL)
+		return MxStatusNoMemory;
+	
+	size_t count = list->count;
+	if (count == 0)
+		return MxStatusOK;
+	
+	ParallelJob job = { .list = list, .dest = dest, .state = state, .predicate = predicate };
+	job.chunkCount = ParallelChunkCount(pool, count);
+	job.keep = (unsigned char *)malloc(count);
+	job.offsets = (size_t *)malloc(job.chunkCount * sizeof(size_t));
+	
+	MxStatus result = MxStatusNoMemory;
+	if (job.keep == NULL || job.offsets == NULL)
+		goto done;
+	
+	if ((result = MxThreadPoolRun(pool, job.chunkCount, FilterMarkChunk, &job)) != MxStatusOK)
+		goto done;
+	
+	// Exclusive prefix sum turns each chunk's match count into its output offset
+	size_t total = 0;
+	for (size_t chunk = 0; chunk < job.chunkCount; ++chunk)
+	{
+		size_t matches = job.offsets[chunk];
+		job.offsets[chunk] = total;
+		total += matches;
+	}
+	
+	if ((result = ExpandToFit(dest, dest->count + total)) != MxStatusOK)
+		goto done;
+	
+	if ((result = MxThreadPoolRun(pool, job.chunkCount, FilterCopyChunk, &job)) != MxStatusOK)
+		goto done;
+	
+	dest->count += total;
+	
+done:
+	free(job.keep);
+	free(job.offsets);
+	
+	return result;
+}
+
+
+static MxStatus ReduceChunk(size_t chunk, void *vjob)
+{
+	ParallelJob *job = (ParallelJob *)vjob;
+	size_t start, end;
+	ParallelChunkBounds(job, chunk, &start, &end);
+	
+	void *accumulator = job->accumulators + chunk * job->accumulatorSize;
+	
+	MxStatus result = MxStatusOK;
+	for (size_t ctr = start; ctr < end; ++ctr)
+		if ((result = job->reduce(accumulator, job->list->items[ctr], job->state)) != MxStatusOK)
+			break;
+	
+	return result;
+}
+
+MxStatus MxArrayListParallelReduce(MxThreadPoolRef pool, MxArrayListRef list, void *result, size_t resultSize,
+                                   MxReduceFunction reduce, MxCombineFunction combine, void *state)
+{
+	if (list == NULL || result == NULL || reduce == NULL || combine == NULL)
+		return MxStatusNullArgument;
+	
+	if (resultSize == 0)
+		return MxStatusIllegalArgument;
+	
+	if ((pool = ParallelPool(pool)) == NULL)
+		return MxStatusNoMemory;
+	
+	if (list->count == 0)
+		return MxStatusOK;
+	
+	ParallelJob job = { .list = list, .state = state, .reduce = reduce, .accumulatorSize = resultSize };
+	job.chunkCount = ParallelChunkCount(pool, list->count);
+	
+	// Every chunk starts from the identity value the caller left in *result
+	job.accumulators = (unsigned char *)malloc(job.chunkCount * resultSize);
+	if (job.accumulators == NULL)
+		return MxStatusNoMemory;
+	
+	for (size_t chunk = 0; chunk < job.chunkCount; ++chunk)
+		memcpy(job.accumulators + chunk * resultSize, result, resultSize);
+	
+	MxStatus status = MxThreadPoolRun(pool, job.chunkCount, ReduceChunk, &job);
+	
+	// Chunks are combined in list order, so 'combine' need not be commutative
+	for (size_t chunk = 0; status == MxStatusOK && chunk < job.chunkCount; ++chunk)
+		status = combine(result, job.accumulators + chunk * resultSize, state);
+	
+	free(job.accumulators);
+	
+	return status;
+}
+
+
+
+// -- Sorting -----------------------------------------------------------------
+
+
+#define SortInsertionThreshold (16)
+
+static void InsertionSort(void **items, size_t count, MxCompareFunction compare)
+{
+	void *item;
+	size_t hole;
+	
+	for (size_t ctr = 1; ctr < count; ++ctr)
+	{
+		item = items[ctr];
+		hole = ctr;
+		while (hole > 0 && compare(items[hole - 1], item) > 0)
+		{
+			items[hole] = items[hole - 1];
+			hole--;
+		}
+		items[hole] = item;
+	}
+}
+
+static inline void Swap(void **items, size_t a, size_t b)
+{
+	void *tmp = items[a];
+	items[a] = items[b];
+	items[b] = tmp;
+}
+
+static void SiftDown(void **items, size_t root, size_t count, MxCompareFunction compare)
+{
+	size_t child;
+	while ((child = (root * 2) + 1) < count)
+	{
+		if (child + 1 < count && compare(items[child], items[child + 1]) < 0)
+			child++;
+		
+		if (compare(items[root], items[child]) >= 0)
+			break;
+		
+		Swap(items, root, child);
+		root = child;
+	}
+}
+
+static void HeapSort(void **items, size_t count, MxCompareFunction compare)
+{
+	for (size_t ctr = count / 2; ctr > 0; --ctr)
+		SiftDown(items, ctr - 1, count, compare);
+	
+	for (size_t end = count - 1; end > 0; --end)
+	{
+		Swap(items, 0, end);
+		SiftDown(items, 0, end, compare);
+	}
+}
+
+// Quicksort with a median-of-three pivot, falling back to heapsort once 'depth'
+// runs out so a bad pivot sequence can't go quadratic
+static void IntroSort(void **items, size_t count, size_t depth, MxCompareFunction compare)
+{
+	while (count > SortInsertionThreshold)
+	{
+		if (depth == 0)
+		{
+			HeapSort(items, count, compare);
+			return;
+		}
+		depth--;
+		
+		size_t mid = count / 2;
+		size_t last = count - 1;
+		
+		// Order first, middle and last - the middle becomes the pivot and the ends sentinels
+		if (compare(items[mid], items[0]) < 0) Swap(items, mid, 0);
+		if (compare(items[last], items[mid]) < 0)
+		{
+			Swap(items, last, mid);
+			if (compare(items[mid], items[0]) < 0) Swap(items, mid, 0);
+		}
+		
+		void *pivot = items[mid];
+		size_t lo = 0;
+		size_t hi = last;
+		
+		for (;;)
+		{
+			while (compare(items[++lo], pivot) < 0)
+				;
+			while (compare(pivot, items[--hi]) < 0)
+				;
+			if (lo >= hi)
+				break;
+			Swap(items, lo, hi);
+		}
+		
+		// Recurse into the smaller side, loop on the larger
+		size_t leftCount = hi + 1;
+		if (leftCount < count - leftCount)
+		{
+			IntroSort(items, leftCount, depth, compare);
+			items += leftCount;
+			count -= leftCount;
+		}
+		else
+		{
+			IntroSort(items + leftCount, count - leftCount, depth, compare);
+			count = leftCount;
+		}
+	}
+	
+	InsertionSort(items, count, compare);
+}
+
+MxStatus MxArrayListSort(MxArrayListRef list, MxCompareFunction compare)
+{
+	if (list == NULL || compare == NULL)
+		return MxStatusNullArgument;
+	
+	if (list->count < 2)
+		return MxStatusOK;
+	
+	size_t depth = 0;
+	for (size_t n = list->count; n > 1; n >>= 1)
+		depth += 2;
+	
+	IntroSort(list->items, list->count, depth, compare);
+	
+	return MxStatusOK;
+}
+
+
+
+// Stable sort: natural runs are found (descending ones reversed), short runs are
+// padded out with binary insertion sort and the runs merged off a stack that keeps
+// their lengths roughly balanced - timsort without the galloping
+
+#define StableSortMaxRuns (85)
+
+typedef struct _SortRun {
+	size_t start;
+	size_t length;
+} SortRun;
+
+static size_t MinimumRunLength(size_t count)
+{
+	size_t extra = 0;
+	while (count >= 64)
+	{
+		extra |= count & 1;
+		count >>= 1;
+	}
+	
+	return count + extra;
+}
+
+// Find the run starting at items[0], reversing it if it is strictly descending
+static size_t CountRun(void **items, size_t count, MxCompareFunction compare)
+{
+	if (count < 2)
+		return count;
+	
+	size_t end = 1;
+	if (compare(items[0], items[1]) > 0)
+	{
+		// Strictly descending, so reversing can't reorder equal items
+		while (end + 1 < count && compare(items[end], items[end + 1]) > 0)
+			end++;
+		
+		for (size_t lo = 0, hi = end; lo < hi; ++lo, --hi)
+			Swap(items, lo, hi);
+	}
+	else
+	{
+		while (end + 1 < count && compare(items[end], items[end + 1]) <= 0)
+			end++;
+	}
+	
+	return end + 1;
+}
+
+// items[0..sorted) is sorted - insert the rest using a binary search for each
+static void BinaryInsertionSort(void **items, size_t count, size_t sorted, MxCompareFunction compare)
+{
+	void *item;
+	size_t lo, hi, mid;
+	
+	for (size_t ctr = sorted; ctr < count; ++ctr)
+	{
+		item = items[ctr];
+		lo = 0;
+		hi = ctr;
+		
+		// Upper bound, so equal items stay in their original order
+		while (lo < hi)
+		{
+			mid = lo + ((hi - lo) / 2);
+			if (compare(item, items[mid]) < 0)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		
+		memmove(items + lo + 1, items + lo, (ctr - lo) * sizeof(void *));
+		items[lo] = item;
+	}
+}
+
+// Merge the adjacent runs items[0..leftCount) and items[leftCount..count). The smaller
+// run is copied out, so 'buffer' needs room for half of 'count'
+static void MergeRuns(void **items, size_t leftCount, size_t count, void **buffer, MxCompareFunction compare)
+{
+	// Already in order
+	if (compare(items[leftCount - 1], items[leftCount]) <= 0)
+		return;
+	
+	size_t rightCount = count - leftCount;
+	
+	if (leftCount <= rightCount)
+	{
+		memcpy(buffer, items, leftCount * sizeof(void *));
+		
+		size_t left = 0;
+		size_t right = leftCount;
+		size_t out = 0;
+		
+		while (left < leftCount && right < count)
+		{
+			// Take from the left on ties - that is what keeps the sort stable
+			if (compare(items[right], buffer[left]) < 0)
+				items[out++] = items[right++];
+			else
+				items[out++] = buffer[left++];
+		}
+		
+		// Anything left on the right is already where it belongs
+		memcpy(items + out, buffer + left, (leftCount - left) * sizeof(void *));
+	}
+	else
+	{
+		// Copy out the right run and merge from the back
+		memcpy(buffer, items + leftCount, rightCount * sizeof(void *));
+		
+		size_t left = leftCount;
+		size_t right = rightCount;
+		size_t out = count;
+		
+		while (left > 0 && right > 0)
+		{
+			// Take from the right on ties when merging backwards
+			if (compare(buffer[right - 1], items[left - 1]) < 0)
+				items[--out] = items[--left];
+			else
+				items[--out] = buffer[--right];
+		}
+		
+		// Anything left on the left is already where it belongs
+		memcpy(items + out - right, buffer, right * sizeof(void *));
+	}
+}
+
+static void MergeAt(void **items, SortRun *runs, int *runCount, int idx, void **buffer, MxCompareFunction compare)
+{
+	SortRun *a = runs + idx;
+	SortRun *b = runs + idx + 1;
+	
+	MergeRuns(items + a->start, a->length, a->length + b->length, buffer, compare);
+	
+	a->length += b->length;
+	if (idx + 2 < *runCount)
+		runs[idx + 1] = runs[idx + 2];
+	
+	*runCount -= 1;
+}
+
+// Merge until the run lengths on the stack shrink faster than the Fibonacci numbers
+static void MergeCollapse(void **items, SortRun *runs, int *runCount, void **buffer, MxCompareFunction compare)
+{
+	int n;
+	while ((n = *runCount) > 1)
+	{
+		int idx = n - 2;
+		if ((idx > 0 && runs[idx - 1].length <= runs[idx].length + runs[idx + 1].length) ||
+		    (idx > 1 && runs[idx - 2].length <= runs[idx - 1].length + runs[idx].length))
+		{
+			if (runs[idx - 1].length < runs[idx + 1].length)
+				idx--;
+		}
+		else if (runs[idx].length > runs[idx + 1].length)
+		{
+			break;
+		}
+		
+		MergeAt(items, runs, runCount, idx, buffer, compare);
+	}
+}
+
+MxStatus MxArrayListStableSort(MxArrayListRef list, MxCompareFunction compare)
+{
+	if (list == NULL || compare == NULL)
+		return MxStatusNullArgument;
+	
+	size_t count = list->count;
+	void **items = list->items;
+	
+	if (count < 2)
+		return MxStatusOK;
+	
+	if (count <= SortInsertionThreshold * 4)
+	{
+		BinaryInsertionSort(items, count, 1, compare);
+		return MxStatusOK;
+	}
+	
+	// Merges copy out the smaller run, which is never more than half the list
+	void **buffer = (void **)malloc(((count / 2) + 1) * sizeof(void *));
+	if (buffer == NULL)
+		return MxStatusNoMemory;
+	
+	SortRun runs[StableSortMaxRuns];
+	int runCount = 0;
+	size_t minRun = MinimumRunLength(count);
+	size_t start = 0;
+	
+	while (start < count)
+	{
+		size_t remaining = count - start;
+		size_t length = CountRun(items + start, remaining, compare);
+		
+		if (length < minRun)
+		{
+			size_t forced = (remaining < minRun) ? remaining : minRun;
+			BinaryInsertionSort(items + start, forced, length, compare);
+			length = forced;
+		}
+		
+		runs[runCount].start = start;
+		runs[runCount].length = length;
+		runCount++;
+		
+		MergeCollapse(items, runs, &runCount, buffer, compare);
+		
+		start += length;
+	}
+	
+	while (runCount > 1)
+	{
+		int idx = runCount - 2;
+		if (idx > 0 && runs[idx - 1].length < runs[idx + 1].length)
+			idx--;
+		
+		MergeAt(items, runs, &runCount, idx, buffer, compare);
+	}
+	
+	free(buffer);
+	
+	return MxStatusOK;
+}
+
+
+
+// Radix sorts. Each extracts every item's key once, then sorts the keys and items
+// together without calling back into user code.
+
+MxStatus MxArrayListRadixSortByIntKey(MxArrayListRef list, MxIntKeyFunction keyFunction)
+{
+	if (list == NULL || keyFunction == NULL)
+		return MxStatusNullArgument;
+	
+	size_t count = list->count;
+	if (count < 2)
+		return MxStatusOK;
+	
+	uint64_t *keys = (uint64_t *)malloc(count * 2 * sizeof(uint64_t));
+	void **scratch = (void **)malloc(count * sizeof(void *));
+	if (keys == NULL || scratch == NULL)
+	{
+		free(keys);
+		free(scratch);
+		return MxStatusNoMemory;
+	}
+	
+	uint64_t *scratchKeys = keys + count;
+	void **items = list->items;
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		keys[ctr] = keyFunction(items[ctr]);
+	
+	// Least significant byte first - each pass is a stable counting sort
+	size_t offsets[256];
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		memset(offsets, 0, sizeof(offsets));
+		for (size_t ctr = 0; ctr < count; ++ctr)
+			offsets[(keys[ctr] >> shift) & 0xff]++;
+		
+		// Every key has the same byte here - nothing to do
+		if (offsets[(keys[0] >> shift) & 0xff] == count)
+			continue;
+		
+		size_t total = 0, tmp;
+		for (int bucket = 0; bucket < 256; ++bucket)
+		{
+			tmp = offsets[bucket];
+			offsets[bucket] = total;
+			total += tmp;
+		}
+		
+		size_t dest;
+		for (size_t ctr = 0; ctr < count; ++ctr)
+		{
+			dest = offsets[(keys[ctr] >> shift) & 0xff]++;
+			scratchKeys[dest] = keys[ctr];
+			scratch[dest] = items[ctr];
+		}
+		
+		uint64_t *swapKeys = keys;
+		keys = scratchKeys;
+		scratchKeys = swapKeys;
+		
+		void **swapItems = items;
+		items = scratch;
+		scratch = swapItems;
+	}
+	
+	// An odd number of passes leaves the result in the scratch array
+	if (items != list->items)
+	{
+		memcpy(list->items, items, count * sizeof(void *));
+		scratch = items;
+	}
+	
+	free(keys < scratchKeys ? keys : scratchKeys);
+	free(scratch);
+	
+	return MxStatusOK;
+}
+
+
+#define StringRadixInsertionThreshold (32)
+// Buckets nested deeper than this are merge sorted instead, which bounds the stack
+// however long the keys' shared prefixes are
+#define StringRadixMaxLevels (32)
+
+typedef struct _StringSortItem {
+	const char *key;
+	void *item;
+} StringSortItem;
+
+static void StringInsertionSort(StringSortItem *entries, size_t count, size_t depth)
+{
+	StringSortItem entry;
+	size_t hole;
+	
+	for (size_t ctr = 1; ctr < count; ++ctr)
+	{
+		entry = entries[ctr];
+		hole = ctr;
+		while (hole > 0 && strcmp(entries[hole - 1].key + depth, entry.key + depth) > 0)
+		{
+			entries[hole] = entries[hole - 1];
+			hole--;
+		}
+		entries[hole] = entry;
+	}
+}
+
+// Stable merge sort on the keys from 'depth' on - recursion is log2(count) deep
+static void StringMergeSort(StringSortItem *entries, StringSortItem *scratch, size_t count, size_t depth)
+{
+	if (count <= StringRadixInsertionThreshold)
+	{
+		StringInsertionSort(entries, count, depth);
+		return;
+	}
+	
+	size_t half = count / 2;
+	StringMergeSort(entries, scratch, half, depth);
+	StringMergeSort(entries + half, scratch, count - half, depth);
+	
+	if (strcmp(entries[half - 1].key + depth, entries[half].key + depth) <= 0)
+		return;
+	
+	memcpy(scratch, entries, half * sizeof(StringSortItem));
+	
+	size_t left = 0, right = half, out = 0;
+	while (left < half && right < count)
+	{
+		// Ties take the left entry to keep the sort stable
+		if (strcmp(entries[right].key + depth, scratch[left].key + depth) < 0)
+			entries[out++] = entries[right++];
+		else
+			entries[out++] = scratch[left++];
+	}
+	
+	while (left < half)
+		entries[out++] = scratch[left++];
+}
+
+// Most significant character first: distribute on the character at 'depth' (the
+// end of the string sorting first) then sort each bucket on the next character.
+// 'level' counts the nested calls.
+static void StringRadixSort(StringSortItem *entries, StringSortItem *scratch, size_t count, size_t depth, int level)
+{
+	size_t offsets[258];
+	
+	for (;;)
+	{
+		if (count <= StringRadixInsertionThreshold)
+		{
+			StringInsertionSort(entries, count, depth);
+			return;
+		}
+		
+		memset(offsets, 0, sizeof(offsets));
+		
+		for (size_t ctr = 0; ctr < count; ++ctr)
+			offsets[(unsigned char)entries[ctr].key[depth] + 1]++;
+		
+		// When every key has the same character here there is nothing to distribute -
+		// move on to the next character without recursing
+		unsigned char first = (unsigned char)entries[0].key[depth];
+		if (first == 0 || offsets[first + 1] != count)
+			break;
+		
+		depth++;
+	}
+	
+	for (int bucket = 1; bucket < 258; ++bucket)
+		offsets[bucket] += offsets[bucket - 1];
+	
+	// offsets[c] is now where bucket c starts
+	size_t starts[257];
+	memcpy(starts, offsets, sizeof(starts));
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		scratch[offsets[(unsigned char)entries[ctr].key[depth]]++] = entries[ctr];
+	
+	memcpy(entries, scratch, count * sizeof(StringSortItem));
+	
+	// Bucket 0 holds the strings that ended here - they are all equal
+	for (int bucket = 1; bucket < 256; ++bucket)
+	{
+		size_t bucketCount = starts[bucket + 1] - starts[bucket];
+		if (bucketCount < 2)
+			continue;
+		
+		if (level < StringRadixMaxLevels)
+			StringRadixSort(entries + starts[bucket], scratch, bucketCount, depth + 1, level + 1);
+		else
+			StringMergeSort(entries + starts[bucket], scratch, bucketCount, depth + 1);
+	}
+}
+
+MxStatus MxArrayListRadixSortByStringKey(MxArrayListRef list, MxStringKeyFunction keyFunction)
+{
+	if (list == NULL || keyFunction == NULL)
+		return MxStatusNullArgument;
+	
+	size_t count = list->count;
+	if (count < 2)
+		return MxStatusOK;
+	
+	StringSortItem *entries = (StringSortItem *)malloc(count * 2 * sizeof(StringSortItem));
+	if (entries == NULL)
+		return MxStatusNoMemory;
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		entries[ctr].item = list->items[ctr];
+		entries[ctr].key = keyFunction(list->items[ctr]);
+		if (entries[ctr].key == NULL)
+			entries[ctr].key = "";
+	}
+	
+	StringRadixSort(entries, entries + count, count, 0, 0);
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		list->items[ctr] = entries[ctr].item;
+	
+	free(entries);
+	
+	return MxStatusOK;
+}
@@ -14,10 +14,50 @@
 
 #include "MxStatus.h"
 #include "MxFunctions.h"
+#include "MxThreadPool.h"
 
 #define MxArrayListDefaultCapacity (31)
 #define MxArrayListExpansionFactor (2)
 
+// Auto-shrinking lists give memory back when they fall to 1/MxArrayListShrinkDivisor
+// full, but never shrink below MxArrayListDefaultCapacity
+#define MxArrayListShrinkDivisor (4)
+
+// MxArrayListIndexOfParallel searches smaller lists on the calling thread
+#define MxArrayListParallelSearchThreshold (1 << 20)
+#define MxArrayListParallelSearchBlock (1 << 14)
+#define MxArrayListParallelMaxThreads (32)
+
+// Where the item array lives
+typedef enum {
+	// malloc'd and grown with realloc
+	MxArrayListHeapStorage = 0,
+	
+	// For very large lists - an anonymous mmap, grown with mremap (where the
+	// platform has it) so growing never copies the items. Clearing the list
+	// hands its pages back to the system with MADV_DONTNEED.
+	MxArrayListMappedStorage,
+	
+	// As MxArrayListMappedStorage, in whole 2MB pages and with transparent
+	// huge pages requested through madvise(MADV_HUGEPAGE)
+	MxArrayListHugePageStorage
+} MxArrayListStorage;
+
+// How the item array grows when it fills up
+typedef enum {
+	// Double the capacity (the default)
+	MxArrayListGrowByDoubling = 0,
+	
+	// Grow by half - wastes less memory on large lists, at the cost of more reallocs
+	MxArrayListGrowByHalf,
+	
+	// Add a fixed number of slots each time
+	MxArrayListGrowByIncrement,
+	
+	// Grow by half, then round up to fill the allocator's size class
+	MxArrayListGrowToSizeClass
+} MxArrayListGrowthPolicy;
+
 typedef struct _MxArrayList {
 	size_t capacity;
 	size_t count;
@@ -25,6 +65,12 @@ typedef struct _MxArrayList {
 	MxFreeFunction itemFree;
 	MxEqualsFunction itemEquals;
 	
+	MxArrayListStorage storage;
+	
+	MxArrayListGrowthPolicy growthPolicy;
+	size_t growthIncrement;
+	int autoShrink;
+	
 	void **items;
 } MxArrayList, *MxArrayListRef;
 
@@ -33,26 +79,62 @@ MxArrayListRef MxArrayListCreate(void);
 MxArrayListRef MxArrayListCreateWithFunctions(MxFreeFunction itemFree, MxEqualsFunction itemEquals);
 MxArrayListRef MxArrayListCreateWithCapacity(size_t capacity);
 MxArrayListRef MxArrayListCreateWithCapacityAndFunctions(size_t capacity, MxFreeFunction itemFree, MxEqualsFunction itemEquals);
+MxArrayListRef MxArrayListCreateWithStorage(size_t capacity, MxArrayListStorage storage, MxFreeFunction itemFree, MxEqualsFunction itemEquals);
 
 MxStatus MxArrayListInit(MxArrayListRef list);
 MxStatus MxArrayListInitWithCapacity(MxArrayListRef list, size_t capacity);
 MxStatus MxArrayListInitWithFunctions(MxArrayListRef list, MxFreeFunction itemFree, MxEqualsFunction itemEquals);
 MxStatus MxArrayListInitWithCapacityAndFunctions(MxArrayListRef list, size_t capacity, MxFreeFunction itemfree, MxEqualsFunction itemEquals);
+// Mapped storage rounds the capacity up to a whole number of pages
+MxStatus MxArrayListInitWithStorage(MxArrayListRef list, size_t capacity, MxArrayListStorage storage, MxFreeFunction itemFree, MxEqualsFunction itemEquals);
 
 
 MxStatus MxArrayListWipe(MxArrayListRef list);
 MxStatus MxArrayListDelete(MxArrayListRef list);
 
 
+// 'increment' is the number of slots to add for MxArrayListGrowByIncrement, and ignored otherwise
+MxStatus MxArrayListSetGrowthPolicy(MxArrayListRef list, MxArrayListGrowthPolicy policy, size_t increment);
+// When set, removing items (Pop, RemoveAt, RemoveRange, Clear) can shrink the item array
+MxStatus MxArrayListSetAutoShrink(MxArrayListRef list, int autoShrink);
+// Make room for at least 'capacity' items in one go
+MxStatus MxArrayListReserve(MxArrayListRef list, size_t capacity);
+// Release any capacity beyond the current count
+MxStatus MxArrayListShrinkToFit(MxArrayListRef list);
+
+
 MxStatus MxArrayListAppend(MxArrayListRef list, const void *item);
 MxStatus MxArrayListPush(MxArrayListRef list, const void *item);
 MxStatus MxArrayListInsertAt(MxArrayListRef list, const void *item, int index);
 MxStatus MxArrayListReplaceAt(MxArrayListRef list, const void *item, int index);
 
+// Bulk operations - each reallocates and moves the existing items at most once
+MxStatus MxArrayListAppendMany(MxArrayListRef list, const void **items, size_t count);
+// 'index' may equal the list's count, which appends
+MxStatus MxArrayListInsertManyAt(MxArrayListRef list, const void **items, size_t count, int index);
+// Append every item in 'other' (the items are shared, not copied)
+MxStatus MxArrayListExtend(MxArrayListRef list, MxArrayListRef other);
+// Remove 'count' items starting at 'index'. If 'removed' is not NULL the items are copied
+// into it (it must have room for 'count' pointers) and handed to the caller, otherwise
+// they are freed with the list's itemFree function
+MxStatus MxArrayListRemoveRange(MxArrayListRef list, int index, size_t count, void **removed);
+
 
 MxStatus MxArrayListItemAt(MxArrayListRef list, int index, void **result);
 MxStatus MxArrayListPop(MxArrayListRef list, void **result);
 MxStatus MxArrayListRemoveAt(MxArrayListRef list, int index, void **removed);
+// As MxArrayListRemoveAt, in O(1): the last item is moved into the gap, so the
+// order of the remaining items is not kept
+MxStatus MxArrayListSwapRemove(MxArrayListRef list, int index, void **removed);
+// Remove (and free, with the list's itemFree function) every item that matches
+// 'predicate', in a single pass that keeps the other items in order
+MxStatus MxArrayListRemoveIf(MxArrayListRef list, MxPredicateFunction predicate, void *state);
+// Reorder the list so the items that match 'predicate' come first, and put the
+// number that matched in *split. 'predicate' is called once per item.
+// Partition is in place but doesn't keep the items' relative order;
+// StablePartition keeps it, using a temporary array of up to 'count' pointers.
+MxStatus MxArrayListPartition(MxArrayListRef list, MxPredicateFunction predicate, void *state, size_t *split);
+MxStatus MxArrayListStablePartition(MxArrayListRef list, MxPredicateFunction predicate, void *state, size_t *split);
 MxStatus MxArrayListClear(MxArrayListRef list);
 
 
@@ -61,8 +143,82 @@ MxStatus MxArrayListIterateBackward(MxArrayListRef list, MxIteratorCallback, voi
 
 
 size_t MxArrayListGetCount(MxArrayListRef list);
+
+// The item at 'idx', or NULL if the index is out of range
+static inline void *MxArrayListGetItem(MxArrayListRef list, int idx)
+{
+	if (list != NULL && idx >= 0 && (size_t)idx < list->count)
+		return list->items[idx];
+	
+	return NULL;
+}
+
+// The list's contiguous item storage. The pointer is only good until the list is
+// next added to or removed from.
+MxStatus MxArrayListGetSpan(MxArrayListRef list, void ***items, size_t *count);
+
+// Loop over the items without a callback per item - the loop compiles to a plain
+// pointer walk the compiler can see through:
+//
+//     MX_ARRAYLIST_FOREACH(list, item)
+//         total += *(int *)item;
+//
+// 'item' is declared (as a void *) by the macro and 'list' is evaluated more than
+// once. The list must not be added to or removed from inside the loop; break and
+// continue work as normal.
+#define MX_ARRAYLIST_FOREACH(list, item)                                                            \
+	for (void **item##_at = (list)->items, **item##_end = item##_at + (list)->count, *item;         \
+	     item##_at < item##_end && ((item = *item##_at), 1);                                        \
+	     ++item##_at)
+
+// As MX_ARRAYLIST_FOREACH, from the last item to the first
+#define MX_ARRAYLIST_FOREACH_BACKWARD(list, item)                                                   \
+	for (void **item##_at = (list)->items + (list)->count, **item##_end = (list)->items, *item;     \
+	     item##_at > item##_end && ((item = *(item##_at - 1)), 1);                                  \
+	     --item##_at)
+
+// Index of the first item equal to 'item' by the list's itemEquals function, or -1.
+// Without an itemEquals function items are compared by identity, several at a
+// time with SSE2/AVX2 where the CPU has them.
 int MxArrayListIndexOf(MxArrayListRef list, void *item);
 
+// As MxArrayListIndexOf, but lists of MxArrayListParallelSearchThreshold items or
+// more are split across 'threadCount' threads (one per CPU if it is 0). The
+// itemEquals function, if any, must be safe to call from several threads.
+int MxArrayListIndexOfParallel(MxArrayListRef list, void *item, int threadCount);
+
+
+// Data-parallel operations, split into chunks run on 'pool' (the process-wide
+// MxThreadPoolGetDefault() pool if it is NULL). The functions passed in are
+// called from several threads at once, in no particular order. Each returns the
+// first failure from a chunk, and chunks not yet started are then skipped.
+// Called from inside another parallel operation (or any thread pool task) they
+// run on the calling thread alone rather than waiting on the busy pool.
+MxStatus MxArrayListParallelForEach(MxThreadPoolRef pool, MxArrayListRef list, MxIteratorCallback callback, void *state);
+// Append map(item) for every item to 'dest', in order. If any map call fails 'dest'
+// is left as it was, with results already produced freed by its itemFree function.
+MxStatus MxArrayListParallelMap(MxThreadPoolRef pool, MxArrayListRef list, MxArrayListRef dest, MxMapFunction map, void *state);
+// Append the items that match 'predicate' to 'dest' (which must be another list),
+// keeping their order. The items are shared, not copied.
+MxStatus MxArrayListParallelFilter(MxThreadPoolRef pool, MxArrayListRef list, MxArrayListRef dest, MxPredicateFunction predicate, void *state);
+// Fold the items into *result, an accumulator of 'resultSize' bytes that must hold
+// the identity value on entry. Each chunk folds its items with 'reduce' into its
+// own copy of that identity, then the chunks are folded into *result in list
+// order with 'combine', so 'combine' must be associative.
+MxStatus MxArrayListParallelReduce(MxThreadPoolRef pool, MxArrayListRef list, void *result, size_t resultSize,
+                                   MxReduceFunction reduce, MxCombineFunction combine, void *state);
+
+
+// Sort the list in place. Compare functions are passed the items themselves (not
+// pointers to them, as qsort does).
+// Introsort - O(n log n) worst case, not stable
+MxStatus MxArrayListSort(MxArrayListRef list, MxCompareFunction compare);
+// Adaptive merge sort that takes advantage of already sorted (or reversed) runs. Stable.
+MxStatus MxArrayListStableSort(MxArrayListRef list, MxCompareFunction compare);
+// Stable radix sorts on a key extracted once from each item. NULL string keys sort as "".
+MxStatus MxArrayListRadixSortByIntKey(MxArrayListRef list, MxIntKeyFunction keyFunction);
+MxStatus MxArrayListRadixSortByStringKey(MxArrayListRef list, MxStringKeyFunction keyFunction);
+
 
 
 
@@ -11,7 +11,7 @@
 #include "MxDebug.h"
 #include "MxBinaryTree.h"
 #include "MxFunctions.h"
-#include "MxList.h"
+#include "MxDeque.h"
 
 static MxBinaryTreeNodeRef CreateNode(void *data);
 static MxBinaryTreeNodeRef FindParentFor(MxBinaryTreeNodeRef node, void *data, MxCompareFunction compare);
@@ -372,36 +372,37 @@ MxStatus WalkNodePostOrder(MxBinaryTreeNodeRef node, MxIteratorCallback callback
 
 MxStatus MxBinaryTreeWalkBreadthFirst(MxBinaryTreeRef tree, MxIteratorCallback callback, void *state)
 {
-    if (tree == NULL || callback == NULL)
-        return MxStatusNullArgument;
-    
-    MxList queue;
-    MxListRef queueRef = (MxListRef)(&queue);
-
-    MxStatusCheck(MxListInit(queueRef));
-    MxStatusCheck(MxListAppend(queueRef, tree->root));
-    int count = 1;
-    
-    MxBinaryTreeNodeRef curr;
-    while (count > 0) {
-        MxStatusCheck(MxListPop(queueRef, (void **)(&curr)));
-        if (curr->left != NULL) {
-            MxStatusCheck(MxListPush(queueRef, curr->left));
-        }
-        
-        if (curr->right != NULL) {
-            MxStatusCheck(MxListPush(queueRef, curr->right));
-        }
-        
-        MxStatusCheck(callback(curr, state));
-    }
-   
-    
-    
-    return MxStatusOK;
+	if (tree == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	if (tree->root == NULL)
+		return MxStatusOK;
+	
+	MxDeque queue;
+	MxStatus status = MxDequeInit(&queue);
+	MxStatusCheck(status);
+	
+	MxBinaryTreeNodeRef curr = tree->root;
+	while (curr != NULL)
+	{
+		if (curr->left != NULL && (status = MxDequePushBack(&queue, curr->left)) != MxStatusOK)
+			break;
+		
+		if (curr->right != NULL && (status = MxDequePushBack(&queue, curr->right)) != MxStatusOK)
+			break;
+		
+		if ((status = callback(curr->data, state)) != MxStatusOK)
+			break;
+		
+		MxDequePopFront(&queue, (void **)&curr);
+	}
+	
+	MxDequeWipe(&queue);
+	
+	return status;
 }
 
- 
+
 
 static void CountDepth(MxBinaryTreeNodeRef node, int level, int *depthCount)
 {
@@ -0,0 +1,393 @@
+//
+//  MxBitset.c
+//  core_ds
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define MxBitsetHasSIMD (1)
+#endif
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxBitset.h"
+
+
+#define WordOf(bit) ((bit) / MxBitsetWordBits)
+#define MaskOf(bit) ((uint64_t)1 << ((bit) % MxBitsetWordBits))
+#define WordsFor(bits) (((bits) + MxBitsetWordBits - 1) / MxBitsetWordBits)
+
+// Bits this high can't be grown to - the size and word count would overflow
+#define OutOfRange(bit) ((bit) > MxBitsetMaxBit)
+
+
+// Grow to 'size' bits. New words are zeroed.
+static MxStatus ExpandToFit(MxBitsetRef bitset, size_t size)
+{
+	if (size <= bitset->size)
+		return MxStatusOK;
+	
+	size_t words = WordsFor(size);
+	if (words > bitset->capacity)
+	{
+		size_t newCapacity = bitset->capacity * MxBitsetExpansionFactor;
+		if (newCapacity < words)
+			newCapacity = words;
+		
+		uint64_t *newWords = (uint64_t *)realloc(bitset->words, newCapacity * sizeof(uint64_t));
+		if (newWords == NULL)
+			return MxStatusNoMemory;
+		
+		bitset->words = newWords;
+		bitset->capacity = newCapacity;
+	}
+	
+	if (words > bitset->wordCount)
+	{
+		memset(bitset->words + bitset->wordCount, 0, (words - bitset->wordCount) * sizeof(uint64_t));
+		bitset->wordCount = words;
+	}
+	
+	bitset->size = size;
+	
+	return MxStatusOK;
+}
+
+
+MxBitsetRef MxBitsetCreate(void)
+{
+	return MxBitsetCreateWithSize(0);
+}
+
+MxBitsetRef MxBitsetCreateWithSize(size_t size)
+{
+	MxBitsetRef bitset = (MxBitsetRef)malloc(sizeof(MxBitset));
+	if (bitset != NULL)
+	{
+		if (MxBitsetInitWithSize(bitset, size) != MxStatusOK)
+		{
+			free(bitset);
+			bitset = NULL;
+		}
+	}
+	
+	return bitset;
+}
+
+
+MxStatus MxBitsetInit(MxBitsetRef bitset)
+{
+	return MxBitsetInitWithSize(bitset, 0);
+}
+
+MxStatus MxBitsetInitWithSize(MxBitsetRef bitset, size_t size)
+{
+	if (bitset == NULL)
+		return MxStatusNullArgument;
+	
+	bitset->capacity = WordsFor(size);
+	if (bitset->capacity < MxBitsetDefaultCapacity)
+		bitset->capacity = MxBitsetDefaultCapacity;
+	
+	bitset->words = (uint64_t *)calloc(bitset->capacity, sizeof(uint64_t));
+	if (bitset->words == NULL)
+		return MxStatusNoMemory;
+	
+	bitset->size = size;
+	bitset->wordCount = WordsFor(size);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxBitsetWipe(MxBitsetRef bitset)
+{
+	if (bitset == NULL)
+		return MxStatusNullArgument;
+	
+	free(bitset->words);
+	bitset->words = NULL;
+	bitset->size = 0;
+	bitset->wordCount = 0;
+	bitset->capacity = 0;
+	
+	return MxStatusOK;
+}
+
+MxStatus MxBitsetDelete(MxBitsetRef bitset)
+{
+	MxStatus status = MxBitsetWipe(bitset);
+	if (status == MxStatusOK)
+		free(bitset);
+	
+	return status;
+}
+
+
+MxStatus MxBitsetSetBit(MxBitsetRef bitset, size_t bit)
+{
+	if (bitset == NULL)
+		return MxStatusNullArgument;
+	
+	if (OutOfRange(bit))
+		return MxStatusIndexOutOfRange;
+	
+	MxStatus status = ExpandToFit(bitset, bit + 1);
+	MxStatusCheck(status);
+	
+	bitset->words[WordOf(bit)] |= MaskOf(bit);
+	
+	return MxStatusOK;
+}
+
+MxStatus MxBitsetClearBit(MxBitsetRef bitset, size_t bit)
+{
+	if (bitset == NULL)
+		return MxStatusNullArgument;
+	
+	// Past the end is already clear
+	if (bit < bitset->size)
+		bitset->words[WordOf(bit)] &= ~MaskOf(bit);
+	
+	return MxStatusOK;
+}
+
+MxStatus MxBitsetFlipBit(MxBitsetRef bitset, size_t bit)
+{
+	if (bitset == NULL)
+		return MxStatusNullArgument;
+	
+	if (OutOfRange(bit))
+		return MxStatusIndexOutOfRange;
+	
+	MxStatus status = ExpandToFit(bitset, bit + 1);
+	MxStatusCheck(status);
+	
+	bitset->words[WordOf(bit)] ^= MaskOf(bit);
+	
+	return MxStatusOK;
+}
+
+int MxBitsetTestBit(MxBitsetRef bitset, size_t bit)
+{
+	if (bitset == NULL || bit >= bitset->size)
+		return MxStatusFalse;
+	
+	return (bitset->words[WordOf(bit)] & MaskOf(bit)) ? MxStatusTrue : MxStatusFalse;
+}
+
+
+MxStatus MxBitsetClear(MxBitsetRef bitset)
+{
+	if (bitset == NULL)
+		return MxStatusNullArgument;
+	
+	memset(bitset->words, 0, bitset->wordCount * sizeof(uint64_t));
+	
+	return MxStatusOK;
+}
+
+
+size_t MxBitsetCount(MxBitsetRef bitset)
+{
+	if (bitset == NULL)
+		return 0;
+	
+	size_t count = 0;
+	for (size_t ctr = 0; ctr < bitset->wordCount; ++ctr)
+		count += (size_t)__builtin_popcountll(bitset->words[ctr]);
+	
+	return count;
+}
+
+
+MxStatus MxBitsetFindNextSet(MxBitsetRef bitset, size_t from, size_t *result)
+{
+	if (bitset == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	if (from >= bitset->size)
+		return MxStatusNotFound;
+	
+	size_t word = WordOf(from);
+	
+	// Ignore the bits before 'from' in its word
+	uint64_t bits = bitset->words[word] & (~(uint64_t)0 << (from % MxBitsetWordBits));
+	
+	while (bits == 0)
+	{
+		if (++word >= bitset->wordCount)
+			return MxStatusNotFound;
+		
+		bits = bitset->words[word];
+	}
+	
+	*result = word * MxBitsetWordBits + (size_t)__builtin_ctzll(bits);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxBitsetIterate(MxBitsetRef bitset, MxIteratorCallback callback, void *state)
+{
+	if (bitset == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = MxStatusOK;
+	
+	for (size_t word = 0; word < bitset->wordCount; ++word)
+	{
+		uint64_t bits = bitset->words[word];
+		
+		// Peel off the lowest set bit each time round
+		while (bits != 0)
+		{
+			size_t bit = word * MxBitsetWordBits + (size_t)__builtin_ctzll(bits);
+			if ((result = callback(&bit, state)) != MxStatusOK)
+				return result;
+			
+			bits &= bits - 1;
+		}
+	}
+	
+	return result;
+}
+
+
+// -- Bulk operations ---------------------------------------------------------
+
+
+// Each defines Name(dest, src, count) applying 'dest[i] = dest[i] <op> src[i]' over
+// 'count' words, plus SSE2 and AVX2 versions picked at run time where available.
+#ifdef MxBitsetHasSIMD
+
+#define DefineBulkOperation(Name, ScalarOp, SSE2Op, AVX2Op)                            \
+static void Name##Scalar(uint64_t *dest, const uint64_t *src, size_t start, size_t count) \
+{                                                                                      \
+	for (size_t ctr = start; ctr < count; ++ctr)                                       \
+		dest[ctr] = ScalarOp(dest[ctr], src[ctr]);                                     \
+}                                                                                      \
+                                                                                       \
+static void Name##SSE2(uint64_t *dest, const uint64_t *src, size_t count)              \
+{                                                                                      \
+	size_t ctr = 0;                                                                    \
+	for (; ctr + 2 <= count; ctr += 2)                                                 \
+	{                                                                                  \
+		__m128i a = _mm_loadu_si128((const __m128i *)(dest + ctr));                    \
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + ctr));                     \
+		_mm_storeu_si128((__m128i *)(dest + ctr), SSE2Op(a, b));                       \
+	}                                                                                  \
+	Name##Scalar(dest, src, ctr, count);                                               \
+}                                                                                      \
+                                                                                       \
+__attribute__((target("avx2")))                                                        \
+static void Name##AVX2(uint64_t *dest, const uint64_t *src, size_t count)              \
+{                                                                                      \
+	size_t ctr = 0;                                                                    \
+	for (; ctr + 4 <= count; ctr += 4)                                                 \
+	{                                                                                  \
+		__m256i a = _mm256_loadu_si256((const __m256i *)(dest + ctr));                 \
+		__m256i b = _mm256_loadu_si256((const __m256i *)(src + ctr));                  \
+		_mm256_storeu_si256((__m256i *)(dest + ctr), AVX2Op(a, b));                    \
+	}                                                                                  \
+	Name##Scalar(dest, src, ctr, count);                                               \
+}                                                                                      \
+                                                                                       \
+static void Name(uint64_t *dest, const uint64_t *src, size_t count)                    \
+{                                                                                      \
+	if (__builtin_cpu_supports("avx2"))                                                \
+		Name##AVX2(dest, src, count);                                                  \
+	else                                                                               \
+		Name##SSE2(dest, src, count);                                                  \
+}
+
+#else
+
+#define DefineBulkOperation(Name, ScalarOp, SSE2Op, AVX2Op)                            \
+static void Name(uint64_t *dest, const uint64_t *src, size_t count)                    \
+{                                                                                      \
+	for (size_t ctr = 0; ctr < count; ++ctr)                                           \
+		dest[ctr] = ScalarOp(dest[ctr], src[ctr]);                                     \
+}
+
+#endif
+
+#define ScalarAnd(a, b) ((a) & (b))
+#define ScalarOr(a, b) ((a) | (b))
+#define ScalarXor(a, b) ((a) ^ (b))
+#define ScalarAndNot(a, b) ((a) & ~(b))
+
+// _mm_andnot computes ~first & second, so the operands are swapped
+#define SSE2AndNot(a, b) _mm_andnot_si128(b, a)
+#define AVX2AndNot(a, b) _mm256_andnot_si256(b, a)
+
+DefineBulkOperation(AndWords, ScalarAnd, _mm_and_si128, _mm256_and_si256)
+DefineBulkOperation(OrWords, ScalarOr, _mm_or_si128, _mm256_or_si256)
+DefineBulkOperation(XorWords, ScalarXor, _mm_xor_si128, _mm256_xor_si256)
+DefineBulkOperation(AndNotWords, ScalarAndNot, SSE2AndNot, AVX2AndNot)
+
+
+static inline size_t SharedWords(MxBitsetRef bitset, MxBitsetRef other)
+{
+	return (bitset->wordCount < other->wordCount) ? bitset->wordCount : other->wordCount;
+}
+
+MxStatus MxBitsetAnd(MxBitsetRef bitset, MxBitsetRef other)
+{
+	if (bitset == NULL || other == NULL)
+		return MxStatusNullArgument;
+	
+	size_t shared = SharedWords(bitset, other);
+	AndWords(bitset->words, other->words, shared);
+	
+	// Anything past the end of 'other' is ANDed with 0
+	memset(bitset->words + shared, 0, (bitset->wordCount - shared) * sizeof(uint64_t));
+	
+	return MxStatusOK;
+}
+
+MxStatus MxBitsetOr(MxBitsetRef bitset, MxBitsetRef other)
+{
+	if (bitset == NULL || other == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus status = ExpandToFit(bitset, other->size);
+	MxStatusCheck(status);
+	
+	OrWords(bitset->words, other->words, other->wordCount);
+	
+	return MxStatusOK;
+}
+
+MxStatus MxBitsetXor(MxBitsetRef bitset, MxBitsetRef other)
+{
+	if (bitset == NULL || other == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus status = ExpandToFit(bitset, other->size);
+	MxStatusCheck(status);
+	
+	XorWords(bitset->words, other->words, other->wordCount);
+	
+	return MxStatusOK;
+}
+
+MxStatus MxBitsetAndNot(MxBitsetRef bitset, MxBitsetRef other)
+{
+	if (bitset == NULL || other == NULL)
+		return MxStatusNullArgument;
+	
+	AndNotWords(bitset->words, other->words, SharedWords(bitset, other));
+	
+	return MxStatusOK;
+}
+
+
+size_t MxBitsetGetSize(MxBitsetRef bitset)
+{
+	return (bitset != NULL) ? bitset->size : 0;
+}
@@ -0,0 +1,84 @@
+//
+//  MxBitset.h
+//  core_ds
+//
+//  A growable array of bits, for dense sets of small integers.
+//
+//  Setting a bit past the end grows the bitset; bits that have never been
+//  set read as 0. Whole-bitset operations work a vector of words at a time
+//  (AVX2 where the CPU has it, SSE2 otherwise on x86-64) and set bits are
+//  found with count-trailing-zeros rather than testing each bit.
+//
+
+#ifndef core_ds_MxBitset_h
+#define core_ds_MxBitset_h
+
+#include <stdint.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+
+#define MxBitsetWordBits (64)
+#define MxBitsetDefaultCapacity (4)
+#define MxBitsetExpansionFactor (2)
+// The highest bit a bitset can hold
+#define MxBitsetMaxBit (SIZE_MAX - MxBitsetWordBits)
+
+typedef struct _MxBitset {
+	// Bits in use - always zero past this
+	size_t size;
+	
+	size_t wordCount;
+	size_t capacity;
+	
+	uint64_t *words;
+} MxBitset, *MxBitsetRef;
+
+
+MxBitsetRef MxBitsetCreate(void);
+MxBitsetRef MxBitsetCreateWithSize(size_t size);
+
+MxStatus MxBitsetInit(MxBitsetRef bitset);
+// Start with 'size' bits, all clear
+MxStatus MxBitsetInitWithSize(MxBitsetRef bitset, size_t size);
+
+MxStatus MxBitsetWipe(MxBitsetRef bitset);
+MxStatus MxBitsetDelete(MxBitsetRef bitset);
+
+
+// Setting a bit past the end grows the bitset to include it
+// returns MxStatusIndexOutOfRange for bits above MxBitsetMaxBit (SetBit and FlipBit)
+MxStatus MxBitsetSetBit(MxBitsetRef bitset, size_t bit);
+MxStatus MxBitsetClearBit(MxBitsetRef bitset, size_t bit);
+MxStatus MxBitsetFlipBit(MxBitsetRef bitset, size_t bit);
+
+// Returns MxStatusTrue if the bit is set, MxStatusFalse if it is clear or past the end
+int MxBitsetTestBit(MxBitsetRef bitset, size_t bit);
+
+// Clear every bit (the size is kept)
+MxStatus MxBitsetClear(MxBitsetRef bitset);
+
+
+// The number of set bits
+size_t MxBitsetCount(MxBitsetRef bitset);
+
+// Put the index of the first set bit at or after 'from' in *result
+// returns MxStatusNotFound if there is none
+MxStatus MxBitsetFindNextSet(MxBitsetRef bitset, size_t from, size_t *result);
+
+// The callback is passed a pointer to each set bit's index (a const size_t *), in order
+MxStatus MxBitsetIterate(MxBitsetRef bitset, MxIteratorCallback callback, void *state);
+
+
+// In place: bitset = bitset <op> other. Or and Xor grow 'bitset' to the size of
+// 'other' if it is larger.
+MxStatus MxBitsetAnd(MxBitsetRef bitset, MxBitsetRef other);
+MxStatus MxBitsetOr(MxBitsetRef bitset, MxBitsetRef other);
+MxStatus MxBitsetXor(MxBitsetRef bitset, MxBitsetRef other);
+// bitset = bitset & ~other
+MxStatus MxBitsetAndNot(MxBitsetRef bitset, MxBitsetRef other);
+
+
+size_t MxBitsetGetSize(MxBitsetRef bitset);
+
+#endif
@@ -0,0 +1,548 @@
+//
+//  MxColumnTable.c
+//  core_ds
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define MxColumnTableHasSSE2 (1)
+#endif
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxColumnTable.h"
+
+
+static size_t WidthOfType(MxColumnType type, size_t width);
+static MxStatus ExpandIfNeeded(MxColumnTableRef table);
+static MxStatus ExpandSelection(MxSelectionRef selection, size_t needed);
+
+
+MxColumnTableRef MxColumnTableCreate(const MxColumnSpec *schema, size_t columnCount)
+{
+	MxColumnTableRef table = (MxColumnTableRef)malloc(sizeof(MxColumnTable));
+	if (table != NULL)
+	{
+		if (MxColumnTableInit(table, schema, columnCount) != MxStatusOK)
+		{
+			free(table);
+			table = NULL;
+		}
+	}
+	
+	return table;
+}
+
+
+MxStatus MxColumnTableInit(MxColumnTableRef table, const MxColumnSpec *schema, size_t columnCount)
+{
+	if (table == NULL || schema == NULL)
+		return MxStatusNullArgument;
+	
+	if (columnCount == 0)
+		return MxStatusIllegalArgument;
+	
+	for (size_t ctr = 0; ctr < columnCount; ++ctr)
+		if (WidthOfType(schema[ctr].type, schema[ctr].width) == 0)
+			return MxStatusIllegalArgument;
+	
+	table->columns = (MxColumn *)calloc(columnCount, sizeof(MxColumn));
+	if (table->columns == NULL)
+		return MxStatusNoMemory;
+	
+	table->columnCount = columnCount;
+	table->rowCount = 0;
+	table->capacity = MxColumnTableDefaultCapacity;
+	
+	for (size_t ctr = 0; ctr < columnCount; ++ctr)
+	{
+		MxColumnRef column = table->columns + ctr;
+		column->type = schema[ctr].type;
+		column->width = WidthOfType(schema[ctr].type, schema[ctr].width);
+		
+		if ((column->data = (unsigned char *)malloc(table->capacity * column->width)) == NULL)
+		{
+			MxColumnTableWipe(table);
+			return MxStatusNoMemory;
+		}
+	}
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxColumnTableWipe(MxColumnTableRef table)
+{
+	if (table == NULL)
+		return MxStatusNullArgument;
+	
+	for (size_t ctr = 0; ctr < table->columnCount; ++ctr)
+		free(table->columns[ctr].data);
+	
+	free(table->columns);
+	table->columns = NULL;
+	table->columnCount = 0;
+	table->rowCount = 0;
+	table->capacity = 0;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxColumnTableDelete(MxColumnTableRef table)
+{
+	if (table == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus status = MxColumnTableWipe(table);
+	if (status == MxStatusOK)
+		free(table);
+	
+	return status;
+}
+
+
+MxStatus MxColumnTableAppendRow(MxColumnTableRef table, const void **values)
+{
+	if (table == NULL || values == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus status = ExpandIfNeeded(table);
+	MxStatusCheck(status);
+	
+	for (size_t ctr = 0; ctr < table->columnCount; ++ctr)
+	{
+		MxColumnRef column = table->columns + ctr;
+		memcpy(column->data + table->rowCount * column->width, values[ctr], column->width);
+	}
+	
+	table->rowCount += 1;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxColumnTableRemoveRow(MxColumnTableRef table, size_t row)
+{
+	if (table == NULL)
+		return MxStatusNullArgument;
+	
+	if (row >= table->rowCount)
+		return MxStatusIndexOutOfRange;
+	
+	size_t tail = table->rowCount - row - 1;
+	
+	for (size_t ctr = 0; ctr < table->columnCount; ++ctr)
+	{
+		MxColumnRef column = table->columns + ctr;
+		unsigned char *at = column->data + row * column->width;
+		memmove(at, at + column->width, tail * column->width);
+	}
+	
+	table->rowCount -= 1;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxColumnTableClear(MxColumnTableRef table)
+{
+	if (table == NULL)
+		return MxStatusNullArgument;
+	
+	table->rowCount = 0;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxColumnTableGetValue(MxColumnTableRef table, size_t row, size_t column, void *result)
+{
+	if (table == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	if (row >= table->rowCount || column >= table->columnCount)
+		return MxStatusIndexOutOfRange;
+	
+	MxColumnRef col = table->columns + column;
+	memcpy(result, col->data + row * col->width, col->width);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxColumnTableSetValue(MxColumnTableRef table, size_t row, size_t column, const void *value)
+{
+	if (table == NULL || value == NULL)
+		return MxStatusNullArgument;
+	
+	if (row >= table->rowCount || column >= table->columnCount)
+		return MxStatusIndexOutOfRange;
+	
+	MxColumnRef col = table->columns + column;
+	memcpy(col->data + row * col->width, value, col->width);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxColumnTableGetColumn(MxColumnTableRef table, size_t column, void **data)
+{
+	if (table == NULL || data == NULL)
+		return MxStatusNullArgument;
+	
+	if (column >= table->columnCount)
+		return MxStatusIndexOutOfRange;
+	
+	*data = table->columns[column].data;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxColumnTableScanColumn(MxColumnTableRef table, size_t column, MxIteratorCallback callback, void *state)
+{
+	if (table == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	if (column >= table->columnCount)
+		return MxStatusIndexOutOfRange;
+	
+	MxColumnRef col = table->columns + column;
+	
+	MxStatus result = MxStatusOK;
+	for (size_t ctr = 0; ctr < table->rowCount; ++ctr)
+		if ((result = callback(col->data + ctr * col->width, state)) != MxStatusOK)
+			break;
+	
+	return result;
+}
+
+
+// -- Filtering ---------------------------------------------------------------
+
+
+// Every candidate row is written to the output and the count only advances past
+// it if it matched, so the loops have no data-dependent branches. Reading from
+// 'input' while writing to the same array is safe as the writes never overtake
+// the reads. A whole-column filter starts at 'first', the rows before it having
+// been handled by a vector scan.
+#define FilterLoop(T, OP)                                                        \
+	if (inputRows == NULL)                                                       \
+	{                                                                            \
+		for (size_t row = first; row < count; ++row)                             \
+		{                                                                        \
+			rows[matches] = (uint32_t)row;                                       \
+			matches += (values[row] OP operand);                                 \
+		}                                                                        \
+	}                                                                            \
+	else                                                                         \
+	{                                                                            \
+		for (size_t ctr = 0; ctr < count; ++ctr)                                 \
+		{                                                                        \
+			uint32_t row = inputRows[ctr];                                       \
+			rows[matches] = row;                                                 \
+			matches += (values[row] OP operand);                                 \
+		}                                                                        \
+	}
+
+// 'VectorScan(values, compare, operand, count, rows, &matches)' filters a leading
+// run of the column and returns how many rows it covered
+#define DefineFilter(name, T, VectorScan)                                        \
+static size_t name(const void *data, MxColumnCompare compare, const void *value, \
+                   const uint32_t *inputRows, size_t count, uint32_t *rows)      \
+{                                                                                \
+	const T *values = (const T *)data;                                           \
+	const T operand = *(const T *)value;                                         \
+	size_t matches = 0;                                                          \
+	size_t first = 0;                                                            \
+	                                                                             \
+	if (inputRows == NULL)                                                       \
+		first = VectorScan(values, compare, operand, count, rows, &matches);     \
+	                                                                             \
+	switch (compare)                                                             \
+	{                                                                            \
+		case MxColumnEqual:          FilterLoop(T, ==) break;                    \
+		case MxColumnNotEqual:       FilterLoop(T, !=) break;                    \
+		case MxColumnLess:           FilterLoop(T, <)  break;                    \
+		case MxColumnLessOrEqual:    FilterLoop(T, <=) break;                    \
+		case MxColumnGreater:        FilterLoop(T, >)  break;                    \
+		case MxColumnGreaterOrEqual: FilterLoop(T, >=) break;                    \
+	}                                                                            \
+	                                                                             \
+	return matches;                                                              \
+}
+
+#define NoVectorScan(values, compare, operand, count, rows, matches) 0
+
+
+#ifdef MxColumnTableHasSSE2
+
+// Compare a vector of values at once, gather the result into a bit per lane and
+// write out the rows of the set bits. Sparse matches cost a test per vector
+// rather than a store per row. 'Mask' is evaluated with 'row' at the first lane.
+#define MaskLoop(Lanes, Mask)                                                    \
+	for (; row + (Lanes) <= count; row += (Lanes))                               \
+	{                                                                            \
+		unsigned mask = (unsigned)(Mask);                                        \
+		while (mask != 0)                                                        \
+		{                                                                        \
+			rows[matches++] = (uint32_t)(row + (size_t)__builtin_ctz(mask));     \
+			mask &= mask - 1;                                                    \
+		}                                                                        \
+	}
+
+// SSE2 has only ==, < and > for integers, the others are their complements
+#define Int32Mask(CMP, Invert)                                                   \
+	(_mm_movemask_ps(_mm_castsi128_ps(CMP(_mm_loadu_si128((const __m128i *)(values + row)), broadcast))) ^ (Invert))
+
+#define FloatMask(CMP) _mm_movemask_ps(CMP(_mm_loadu_ps(values + row), broadcast))
+#define DoubleMask(CMP) _mm_movemask_pd(CMP(_mm_loadu_pd(values + row), broadcast))
+
+static size_t ScanInt32SSE2(const int32_t *values, MxColumnCompare compare, int32_t operand,
+                            size_t count, uint32_t *rows, size_t *matchCount)
+{
+	const __m128i broadcast = _mm_set1_epi32(operand);
+	size_t matches = 0;
+	size_t row = 0;
+	
+	switch (compare)
+	{
+		case MxColumnEqual:          MaskLoop(4, Int32Mask(_mm_cmpeq_epi32, 0x0)) break;
+		case MxColumnNotEqual:       MaskLoop(4, Int32Mask(_mm_cmpeq_epi32, 0xF)) break;
+		case MxColumnLess:           MaskLoop(4, Int32Mask(_mm_cmplt_epi32, 0x0)) break;
+		case MxColumnLessOrEqual:    MaskLoop(4, Int32Mask(_mm_cmpgt_epi32, 0xF)) break;
+		case MxColumnGreater:        MaskLoop(4, Int32Mask(_mm_cmpgt_epi32, 0x0)) break;
+		case MxColumnGreaterOrEqual: MaskLoop(4, Int32Mask(_mm_cmplt_epi32, 0xF)) break;
+	}
+	
+	*matchCount = matches;
+	return row;
+}
+
+// The ordered float compares are false for NaN and _mm_cmpneq is true, as in C
+static size_t ScanFloatSSE2(const float *values, MxColumnCompare compare, float operand,
+                            size_t count, uint32_t *rows, size_t *matchCount)
+{
+	const __m128 broadcast = _mm_set1_ps(operand);
+	size_t matches = 0;
+	size_t row = 0;
+	
+	switch (compare)
+	{
+		case MxColumnEqual:          MaskLoop(4, FloatMask(_mm_cmpeq_ps))  break;
+		case MxColumnNotEqual:       MaskLoop(4, FloatMask(_mm_cmpneq_ps)) break;
+		case MxColumnLess:           MaskLoop(4, FloatMask(_mm_cmplt_ps))  break;
+		case MxColumnLessOrEqual:    MaskLoop(4, FloatMask(_mm_cmple_ps))  break;
+		case MxColumnGreater:        MaskLoop(4, FloatMask(_mm_cmpgt_ps))  break;
+		case MxColumnGreaterOrEqual: MaskLoop(4, FloatMask(_mm_cmpge_ps))  break;
+	}
+	
+	*matchCount = matches;
+	return row;
+}
+
+static size_t ScanDoubleSSE2(const double *values, MxColumnCompare compare, double operand,
+                             size_t count, uint32_t *rows, size_t *matchCount)
+{
+	const __m128d broadcast = _mm_set1_pd(operand);
+	size_t matches = 0;
+	size_t row = 0;
+	
+	switch (compare)
+	{
+		case MxColumnEqual:          MaskLoop(2, DoubleMask(_mm_cmpeq_pd))  break;
+		case MxColumnNotEqual:       MaskLoop(2, DoubleMask(_mm_cmpneq_pd)) break;
+		case MxColumnLess:           MaskLoop(2, DoubleMask(_mm_cmplt_pd))  break;
+		case MxColumnLessOrEqual:    MaskLoop(2, DoubleMask(_mm_cmple_pd))  break;
+		case MxColumnGreater:        MaskLoop(2, DoubleMask(_mm_cmpgt_pd))  break;
+		case MxColumnGreaterOrEqual: MaskLoop(2, DoubleMask(_mm_cmpge_pd))  break;
+	}
+	
+	*matchCount = matches;
+	return row;
+}
+
+#else
+
+#define ScanInt32SSE2 NoVectorScan
+#define ScanFloatSSE2 NoVectorScan
+#define ScanDoubleSSE2 NoVectorScan
+
+#endif
+
+// SSE2 has no 64-bit integer compare, so int64 columns are always scalar
+DefineFilter(FilterInt32, int32_t, ScanInt32SSE2)
+DefineFilter(FilterInt64, int64_t, NoVectorScan)
+DefineFilter(FilterFloat, float, ScanFloatSSE2)
+DefineFilter(FilterDouble, double, ScanDoubleSSE2)
+
+
+static size_t FilterBytes(MxColumnRef column, int wantEqual, const void *value,
+                          const uint32_t *inputRows, size_t count, uint32_t *rows)
+{
+	size_t matches = 0;
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		uint32_t row = (inputRows != NULL) ? inputRows[ctr] : (uint32_t)ctr;
+		int equal = (memcmp(column->data + row * column->width, value, column->width) == 0);
+		
+		rows[matches] = row;
+		matches += (equal == wantEqual);
+	}
+	
+	return matches;
+}
+
+
+MxStatus MxColumnTableFilter(MxColumnTableRef table, size_t column, MxColumnCompare compare, const void *value,
+                             MxSelectionRef input, MxSelectionRef output)
+{
+	if (table == NULL || value == NULL || output == NULL)
+		return MxStatusNullArgument;
+	
+	if (column >= table->columnCount)
+		return MxStatusIndexOutOfRange;
+	
+	if (compare < MxColumnEqual || compare > MxColumnGreaterOrEqual)
+		return MxStatusIllegalArgument;
+	
+	MxColumnRef col = table->columns + column;
+	if (col->type == MxColumnBytes && compare != MxColumnEqual && compare != MxColumnNotEqual)
+		return MxStatusIllegalArgument;
+	
+	size_t count = (input != NULL) ? input->count : table->rowCount;
+	const uint32_t *inputRows = (input != NULL) ? input->rows : NULL;
+	
+	// Room for every candidate, as the loops write each one before deciding to keep it
+	MxStatus status = ExpandSelection(output, count);
+	MxStatusCheck(status);
+	
+	// Growing 'output' may have moved the rows 'input' points at
+	if (input == output)
+		inputRows = output->rows;
+	
+	size_t matches = 0;
+	switch (col->type)
+	{
+		case MxColumnInt32:
+			matches = FilterInt32(col->data, compare, value, inputRows, count, output->rows);
+			break;
+		
+		case MxColumnInt64:
+			matches = FilterInt64(col->data, compare, value, inputRows, count, output->rows);
+			break;
+		
+		case MxColumnFloat:
+			matches = FilterFloat(col->data, compare, value, inputRows, count, output->rows);
+			break;
+		
+		case MxColumnDouble:
+			matches = FilterDouble(col->data, compare, value, inputRows, count, output->rows);
+			break;
+		
+		case MxColumnBytes:
+			matches = FilterBytes(col, compare == MxColumnEqual, value, inputRows, count, output->rows);
+			break;
+	}
+	
+	output->count = matches;
+	
+	return MxStatusOK;
+}
+
+
+size_t MxColumnTableGetRowCount(MxColumnTableRef table)
+{
+	return (table != NULL) ? table->rowCount : 0;
+}
+
+
+MxStatus MxSelectionInit(MxSelectionRef selection)
+{
+	if (selection == NULL)
+		return MxStatusNullArgument;
+	
+	selection->count = 0;
+	selection->capacity = 0;
+	selection->rows = NULL;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxSelectionWipe(MxSelectionRef selection)
+{
+	if (selection == NULL)
+		return MxStatusNullArgument;
+	
+	free(selection->rows);
+	
+	return MxSelectionInit(selection);
+}
+
+
+static size_t WidthOfType(MxColumnType type, size_t width)
+{
+	switch (type)
+	{
+		case MxColumnInt32:  return sizeof(int32_t);
+		case MxColumnInt64:  return sizeof(int64_t);
+		case MxColumnFloat:  return sizeof(float);
+		case MxColumnDouble: return sizeof(double);
+		case MxColumnBytes:  return width;
+	}
+	
+	return 0;
+}
+
+
+// Make room for one more row in every column
+static MxStatus ExpandIfNeeded(MxColumnTableRef table)
+{
+	if (table->rowCount < table->capacity)
+		return MxStatusOK;
+	
+	if (table->rowCount >= MxColumnTableMaxRows)
+		return MxStatusIllegalArgument;
+	
+	size_t newCapacity = table->capacity * MxColumnTableExpansionFactor;
+	if (newCapacity > MxColumnTableMaxRows)
+		newCapacity = MxColumnTableMaxRows;
+	
+	// Columns that grow before a failure just keep their extra room
+	for (size_t ctr = 0; ctr < table->columnCount; ++ctr)
+	{
+		MxColumnRef column = table->columns + ctr;
+		unsigned char *newData = (unsigned char *)realloc(column->data, newCapacity * column->width);
+		if (newData == NULL)
+			return MxStatusNoMemory;
+		
+		column->data = newData;
+	}
+	
+	table->capacity = newCapacity;
+	
+	return MxStatusOK;
+}
+
+
+static MxStatus ExpandSelection(MxSelectionRef selection, size_t needed)
+{
+	if (needed <= selection->capacity)
+		return MxStatusOK;
+	
+	uint32_t *newRows = (uint32_t *)realloc(selection->rows, needed * sizeof(uint32_t));
+	if (newRows == NULL)
+		return MxStatusNoMemory;
+	
+	selection->rows = newRows;
+	selection->capacity = needed;
+	
+	return MxStatusOK;
+}
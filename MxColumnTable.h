@@ -0,0 +1,134 @@
+//
+//  MxColumnTable.h
+//  core_ds
+//
+//  A table of fixed-width records stored column by column.
+//
+//  Each column is one contiguous array, so scanning a field across every
+//  row reads only that field's bytes. Filters compare a whole column
+//  against a value without branching and produce a selection vector -
+//  the indices of the matching rows - which can be passed to the next
+//  filter to AND conditions together.
+//
+//      MxColumnSpec schema[] = { { MxColumnInt64, 0 }, { MxColumnDouble, 0 } };
+//      MxColumnTable t;
+//      MxColumnTableInit(&t, schema, 2);
+//
+//      int64_t id = 7;
+//      double score = 0.5;
+//      const void *row[] = { &id, &score };
+//      MxColumnTableAppendRow(&t, row);
+//
+
+#ifndef core_ds_MxColumnTable_h
+#define core_ds_MxColumnTable_h
+
+#include <stdint.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+
+#define MxColumnTableDefaultCapacity (64)
+#define MxColumnTableExpansionFactor (2)
+
+// Row indices are 32-bit to halve the size of selection vectors
+#define MxColumnTableMaxRows (UINT32_MAX)
+
+
+typedef enum {
+	MxColumnInt32 = 0,
+	MxColumnInt64,
+	MxColumnFloat,
+	MxColumnDouble,
+	
+	// Opaque fixed-width values - can only be filtered for (in)equality
+	MxColumnBytes
+} MxColumnType;
+
+typedef enum {
+	MxColumnEqual = 0,
+	MxColumnNotEqual,
+	MxColumnLess,
+	MxColumnLessOrEqual,
+	MxColumnGreater,
+	MxColumnGreaterOrEqual
+} MxColumnCompare;
+
+typedef struct _MxColumnSpec {
+	MxColumnType type;
+	
+	// Bytes per value - only used for MxColumnBytes, the other types know their size
+	size_t width;
+} MxColumnSpec;
+
+typedef struct _MxColumn {
+	MxColumnType type;
+	size_t width;
+	
+	// 'capacity' values of 'width' bytes
+	unsigned char *data;
+} MxColumn, *MxColumnRef;
+
+typedef struct _MxColumnTable {
+	size_t columnCount;
+	MxColumn *columns;
+	
+	size_t rowCount;
+	size_t capacity;
+} MxColumnTable, *MxColumnTableRef;
+
+
+// The indices of the rows selected by a filter, in ascending order
+typedef struct _MxSelection {
+	size_t count;
+	size_t capacity;
+	
+	uint32_t *rows;
+} MxSelection, *MxSelectionRef;
+
+
+MxColumnTableRef MxColumnTableCreate(const MxColumnSpec *schema, size_t columnCount);
+MxStatus MxColumnTableInit(MxColumnTableRef table, const MxColumnSpec *schema, size_t columnCount);
+
+MxStatus MxColumnTableWipe(MxColumnTableRef table);
+MxStatus MxColumnTableDelete(MxColumnTableRef table);
+
+
+// 'values' holds one pointer per column, to the value to copy into the new row
+MxStatus MxColumnTableAppendRow(MxColumnTableRef table, const void **values);
+
+// Remove a row, keeping the order of the rows after it
+MxStatus MxColumnTableRemoveRow(MxColumnTableRef table, size_t row);
+
+MxStatus MxColumnTableClear(MxColumnTableRef table);
+
+
+// Copy one value out of, or into, the table
+MxStatus MxColumnTableGetValue(MxColumnTableRef table, size_t row, size_t column, void *result);
+MxStatus MxColumnTableSetValue(MxColumnTableRef table, size_t row, size_t column, const void *value);
+
+// The column's contiguous array of values, e.g. an int64_t * for an MxColumnInt64 column.
+// It is valid until the table next grows.
+MxStatus MxColumnTableGetColumn(MxColumnTableRef table, size_t column, void **data);
+
+// Call 'callback' with a pointer to each value in the column, in row order
+MxStatus MxColumnTableScanColumn(MxColumnTableRef table, size_t column, MxIteratorCallback callback, void *state);
+
+
+// Select the rows where 'column <compare> *value'. Only the rows in 'input' are tested
+// if it is not NULL, otherwise every row is. 'output' is overwritten, and may be the
+// same selection as 'input'.
+// On x86-64 a filter over every row of an int32, float or double column compares
+// several values per SSE2 instruction. Filters given an 'input' selection, and int64
+// and bytes columns, test one row at a time.
+// returns MxStatusIllegalArgument for an ordering comparison on an MxColumnBytes column
+MxStatus MxColumnTableFilter(MxColumnTableRef table, size_t column, MxColumnCompare compare, const void *value,
+                             MxSelectionRef input, MxSelectionRef output);
+
+size_t MxColumnTableGetRowCount(MxColumnTableRef table);
+
+
+MxStatus MxSelectionInit(MxSelectionRef selection);
+MxStatus MxSelectionWipe(MxSelectionRef selection);
+
+#endif
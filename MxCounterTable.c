@@ -0,0 +1,323 @@
+//
+//  MxCounterTable.c
+//  core_ds
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxList.h"
+#include "MxHashtable.h"
+#include "MxCounterTable.h"
+
+
+static MxStatus InitCounts(MxHashtableRef counts);
+static MxStatus AddToCounts(MxHashtableRef counts, const char *key, long delta);
+static MxCounterShardRef ShardForCurrentThread(MxCounterTableRef table);
+static MxStatus FoldShard(MxCounterTableRef table, MxCounterShardRef shard);
+static void DestroyShard(MxCounterShardRef shard);
+static void ShardThreadExit(void *vshard);
+
+
+MxCounterTableRef MxCounterTableCreate(void)
+{
+	MxCounterTableRef table = (MxCounterTableRef)malloc(sizeof(MxCounterTable));
+	if (table != NULL)
+	{
+		if (MxCounterTableInit(table) != MxStatusOK)
+		{
+			free(table);
+			table = NULL;
+		}
+	}
+
+	return table;
+}
+
+
+MxStatus MxCounterTableInit(MxCounterTableRef table)
+{
+	if (table == NULL)
+		return MxStatusNullArgument;
+
+	MxStatus status = InitCounts(&table->totals);
+	MxStatusCheck(status);
+
+	if ((status = MxListInitWithFunctions(&table->shards, NULL, NULL)) != MxStatusOK)
+	{
+		MxHashtableWipe(&table->totals);
+		return status;
+	}
+
+	if (pthread_key_create(&table->shardKey, ShardThreadExit) != 0)
+	{
+		MxListWipe(&table->shards);
+		MxHashtableWipe(&table->totals);
+		return MxStatusUnixError;
+	}
+
+	pthread_mutex_init(&table->lock, NULL);
+
+	return MxStatusOK;
+}
+
+
+MxStatus MxCounterTableWipe(MxCounterTableRef table)
+{
+	if (table == NULL)
+		return MxStatusNullArgument;
+
+	// Stops the exit handlers of still-running threads touching the table
+	pthread_key_delete(table->shardKey);
+
+	MxListNodeRef node = table->shards.sentinel->next;
+	while (node != table->shards.sentinel)
+	{
+		DestroyShard((MxCounterShardRef)node->data);
+		node = node->next;
+	}
+
+	MxListWipe(&table->shards);
+	MxHashtableWipe(&table->totals);
+	pthread_mutex_destroy(&table->lock);
+
+	return MxStatusOK;
+}
+
+
+MxStatus MxCounterTableDelete(MxCounterTableRef table)
+{
+	if (table == NULL)
+		return MxStatusNullArgument;
+
+	MxStatus status = MxCounterTableWipe(table);
+	if (status == MxStatusOK)
+		free(table);
+
+	return status;
+}
+
+
+MxStatus MxCounterTableAdd(MxCounterTableRef table, const char *key, long delta)
+{
+	if (table == NULL || key == NULL)
+		return MxStatusNullArgument;
+
+	MxCounterShardRef shard = ShardForCurrentThread(table);
+	if (shard == NULL)
+		return MxStatusNoMemory;
+
+	pthread_mutex_lock(&shard->lock);
+	MxStatus status = AddToCounts(&shard->counts, key, delta);
+	pthread_mutex_unlock(&shard->lock);
+
+	return status;
+}
+
+
+MxStatus MxCounterTableMerge(MxCounterTableRef table)
+{
+	if (table == NULL)
+		return MxStatusNullArgument;
+
+	MxStatus status = MxStatusOK;
+
+	pthread_mutex_lock(&table->lock);
+
+	MxListNodeRef node = table->shards.sentinel->next;
+	while (node != table->shards.sentinel)
+	{
+		if ((status = FoldShard(table, (MxCounterShardRef)node->data)) != MxStatusOK)
+			break;
+		node = node->next;
+	}
+
+	pthread_mutex_unlock(&table->lock);
+
+	return status;
+}
+
+
+MxStatus MxCounterTableGet(MxCounterTableRef table, const char *key, long *result)
+{
+	if (table == NULL || key == NULL || result == NULL)
+		return MxStatusNullArgument;
+
+	*result = 0;
+
+	MxStatus status = MxCounterTableMerge(table);
+	MxStatusCheck(status);
+
+	long *total = NULL;
+
+	pthread_mutex_lock(&table->lock);
+	status = MxHashtableGet(&table->totals, key, (void **)&total);
+	if (status == MxStatusOK)
+		*result = *total;
+	pthread_mutex_unlock(&table->lock);
+
+	return status;
+}
+
+
+static MxStatus CopyTotal(const void *key, const void *value, void *vresult)
+{
+	MxHashtableRef result = (MxHashtableRef)vresult;
+
+	char *keyCopy = strdup((const char *)key);
+	long *valueCopy = (long *)malloc(sizeof(long));
+	if (keyCopy == NULL || valueCopy == NULL)
+	{
+		free(keyCopy);
+		free(valueCopy);
+		return MxStatusNoMemory;
+	}
+
+	*valueCopy = *((const long *)value);
+
+	return MxHashtablePut(result, keyCopy, valueCopy);
+}
+
+MxStatus MxCounterTableSnapshot(MxCounterTableRef table, MxHashtableRef result)
+{
+	if (table == NULL || result == NULL)
+		return MxStatusNullArgument;
+
+	MxStatus status = MxCounterTableMerge(table);
+	MxStatusCheck(status);
+
+	if ((status = MxHashtableClear(result)) != MxStatusOK)
+		return status;
+
+	pthread_mutex_lock(&table->lock);
+	status = MxHashtableIteratePairs(&table->totals, CopyTotal, result);
+	pthread_mutex_unlock(&table->lock);
+
+	return status;
+}
+
+
+static MxStatus InitCounts(MxHashtableRef counts)
+{
+	return MxHashtableInitWithAllFunctions(counts,
+	                                       MxDefaultStringHashFunction,
+	                                       MxDefaultCStrEqualsFunction,
+	                                       MxDefaultFreeFunction,
+	                                       MxDefaultFreeFunction);
+}
+
+
+static MxStatus AddToCounts(MxHashtableRef counts, const char *key, long delta)
+{
+	long *counter = NULL;
+	if (MxHashtableGet(counts, key, (void **)&counter) == MxStatusOK)
+	{
+		*counter += delta;
+		return MxStatusOK;
+	}
+
+	char *keyCopy = strdup(key);
+	counter = (long *)malloc(sizeof(long));
+	if (keyCopy == NULL || counter == NULL)
+	{
+		free(keyCopy);
+		free(counter);
+		return MxStatusNoMemory;
+	}
+
+	*counter = delta;
+
+	return MxHashtablePut(counts, keyCopy, counter);
+}
+
+
+static MxCounterShardRef ShardForCurrentThread(MxCounterTableRef table)
+{
+	MxCounterShardRef shard = (MxCounterShardRef)pthread_getspecific(table->shardKey);
+	if (shard != NULL)
+		return shard;
+
+	// Round up to whole cache lines so neighbouring shards never share one
+	size_t size = ((sizeof(MxCounterShard) + MxCounterTableCacheLineSize - 1) / MxCounterTableCacheLineSize) * MxCounterTableCacheLineSize;
+	if (posix_memalign((void **)&shard, MxCounterTableCacheLineSize, size) != 0)
+		return NULL;
+
+	if (InitCounts(&shard->counts) != MxStatusOK)
+	{
+		free(shard);
+		return NULL;
+	}
+
+	pthread_mutex_init(&shard->lock, NULL);
+	shard->owner = table;
+
+	pthread_mutex_lock(&table->lock);
+	MxStatus status = MxListAppend(&table->shards, shard);
+	pthread_mutex_unlock(&table->lock);
+
+	if (status != MxStatusOK || pthread_setspecific(table->shardKey, shard) != 0)
+	{
+		if (status == MxStatusOK)
+		{
+			pthread_mutex_lock(&table->lock);
+			MxListRemove(&table->shards, shard);
+			pthread_mutex_unlock(&table->lock);
+		}
+
+		DestroyShard(shard);
+		return NULL;
+	}
+
+	return shard;
+}
+
+
+static MxStatus FoldCounter(const void *key, const void *value, void *vtotals)
+{
+	long *counter = (long *)value;
+	if (*counter == 0)
+		return MxStatusOK;
+
+	MxStatus status = AddToCounts((MxHashtableRef)vtotals, (const char *)key, *counter);
+
+	// Keep the shard's key and counter so the owning thread does not have to re-allocate them
+	if (status == MxStatusOK)
+		*counter = 0;
+
+	return status;
+}
+
+// Caller must hold table->lock
+static MxStatus FoldShard(MxCounterTableRef table, MxCounterShardRef shard)
+{
+	pthread_mutex_lock(&shard->lock);
+	MxStatus status = MxHashtableIteratePairs(&shard->counts, FoldCounter, &table->totals);
+	pthread_mutex_unlock(&shard->lock);
+
+	return status;
+}
+
+
+static void DestroyShard(MxCounterShardRef shard)
+{
+	MxHashtableWipe(&shard->counts);
+	pthread_mutex_destroy(&shard->lock);
+	free(shard);
+}
+
+
+static void ShardThreadExit(void *vshard)
+{
+	MxCounterShardRef shard = (MxCounterShardRef)vshard;
+	MxCounterTableRef table = shard->owner;
+
+	pthread_mutex_lock(&table->lock);
+	FoldShard(table, shard);
+	MxListRemove(&table->shards, shard);
+	pthread_mutex_unlock(&table->lock);
+
+	DestroyShard(shard);
+}
@@ -0,0 +1,97 @@
+//
+//  MxCounterTable.h
+//  core_ds
+//
+//  String-keyed counters that can be bumped from many threads at once.
+//
+//  Each thread adds into its own private shard, so threads never contend
+//  for a lock or write to the same shard struct (shards are padded to
+//  whole cache lines). The hashtable nodes, key copies and counters
+//  inside a shard come from plain malloc, though, so they can still share
+//  a line with another thread's allocations. Shards are folded
+//  into the global table by MxCounterTableMerge, by any read
+//  (Get/Snapshot) and when their thread exits.
+//
+//  Each table uses one pthread key, so a process can only hold
+//  PTHREAD_KEYS_MAX tables at once.
+//
+
+#ifndef core_ds_MxCounterTable_h
+#define core_ds_MxCounterTable_h
+
+#include <pthread.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxList.h"
+#include "MxHashtable.h"
+
+
+// Shards are padded out to this so two threads never share a line
+#define MxCounterTableCacheLineSize (64)
+
+struct _MxCounterTable;
+
+typedef struct _MxCounterShard
+{
+    // Only contended while the shard is being merged
+    pthread_mutex_t lock;
+
+    // strdup'd key => long *
+    MxHashtable counts;
+
+    struct _MxCounterTable *owner;
+} MxCounterShard, *MxCounterShardRef;
+
+typedef struct _MxCounterTable
+{
+    // Guards 'totals' and 'shards'
+    pthread_mutex_t lock;
+
+    // strdup'd key => long *
+    MxHashtable totals;
+
+    // Every live MxCounterShardRef
+    MxList shards;
+
+    pthread_key_t shardKey;
+} MxCounterTable, *MxCounterTableRef;
+
+
+// Dynamically create a counter table
+MxCounterTableRef MxCounterTableCreate(void);
+
+// Initialise a pre-allocated counter table
+MxStatus MxCounterTableInit(MxCounterTableRef table);
+
+// Free the internal memory used by the table. No thread may be calling
+// MxCounterTableAdd on it while (or after) it is wiped.
+MxStatus MxCounterTableWipe(MxCounterTableRef table);
+
+// Wipe and free a dynamically alloc'd table
+MxStatus MxCounterTableDelete(MxCounterTableRef table);
+
+
+// Add 'delta' to the counter for 'key' in the calling thread's shard.
+// 'key' is copied the first time the thread sees it.
+// returns MxStatusOK  if the counter was updated
+//         MxStatusNullArgument if table or key is NULL
+//         MxStatusNoMemory if the shard or a new counter could not be allocated
+MxStatus MxCounterTableAdd(MxCounterTableRef table, const char *key, long delta);
+
+// Fold every thread's shard into the global totals
+MxStatus MxCounterTableMerge(MxCounterTableRef table);
+
+// Merge, then put the total for 'key' in *result
+// returns MxStatusOK  if the key has been counted
+//         MxStatusNullArgument if table, key or result is NULL
+//         MxStatusNotFound if nothing has been added against 'key' (*result is 0)
+MxStatus MxCounterTableGet(MxCounterTableRef table, const char *key, long *result);
+
+// Merge, then copy every total into 'result' (which is cleared first).
+// Keys and values put into 'result' are malloc'd copies (char * => long *), so
+// 'result' should be a property map that frees both, e.g.
+//     MxHashtableInitWithAllFunctions(&t, MxDefaultStringHashFunction, MxDefaultCStrEqualsFunction, free, free);
+MxStatus MxCounterTableSnapshot(MxCounterTableRef table, MxHashtableRef result);
+
+#endif
@@ -0,0 +1,324 @@
+//
+//  MxDeque.c
+//  core_ds
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxDeque.h"
+
+
+// Slot of the item 'index' places from the front - capacity is a power of two
+#define Slot(deque, index) (((deque)->head + (index)) & ((deque)->capacity - 1))
+
+
+static size_t RoundUpCapacity(size_t capacity)
+{
+	size_t result = 1;
+	while (result < capacity)
+		result <<= 1;
+	
+	return result;
+}
+
+
+// Double the buffer. The items from 'head' to the old end stay where they are and
+// any that had wrapped round to the start are moved up to follow them.
+static MxStatus ExpandIfNeeded(MxDequeRef deque)
+{
+	if (deque->count < deque->capacity)
+		return MxStatusOK;
+	
+	size_t oldCapacity = deque->capacity;
+	// A wiped deque has no buffer at all
+	size_t newCapacity = (oldCapacity > 0) ? oldCapacity * MxDequeExpansionFactor : MxDequeDefaultCapacity;
+	
+	void **newItems = (void **)realloc(deque->items, newCapacity * sizeof(void *));
+	if (newItems == NULL)
+		return MxStatusNoMemory;
+	
+	// The buffer was full so everything before 'head' has wrapped
+	memcpy(newItems + oldCapacity, newItems, deque->head * sizeof(void *));
+	
+	deque->items = newItems;
+	deque->capacity = newCapacity;
+	
+	return MxStatusOK;
+}
+
+
+MxDequeRef MxDequeCreate(void)
+{
+	return MxDequeCreateWithCapacityAndFunctions(MxDequeDefaultCapacity, NULL);
+}
+
+MxDequeRef MxDequeCreateWithFunctions(MxFreeFunction itemFree)
+{
+	return MxDequeCreateWithCapacityAndFunctions(MxDequeDefaultCapacity, itemFree);
+}
+
+MxDequeRef MxDequeCreateWithCapacity(size_t capacity)
+{
+	return MxDequeCreateWithCapacityAndFunctions(capacity, NULL);
+}
+
+MxDequeRef MxDequeCreateWithCapacityAndFunctions(size_t capacity, MxFreeFunction itemFree)
+{
+	MxDequeRef result = (MxDequeRef)malloc(sizeof(MxDeque));
+	if (result)
+	{
+		if (MxDequeInitWithCapacityAndFunctions(result, capacity, itemFree) != MxStatusOK)
+		{
+			free(result);
+			result = NULL;
+		}
+	}
+	
+	return result;
+}
+
+
+MxStatus MxDequeInit(MxDequeRef deque)
+{
+	return MxDequeInitWithCapacityAndFunctions(deque, MxDequeDefaultCapacity, NULL);
+}
+
+MxStatus MxDequeInitWithFunctions(MxDequeRef deque, MxFreeFunction itemFree)
+{
+	return MxDequeInitWithCapacityAndFunctions(deque, MxDequeDefaultCapacity, itemFree);
+}
+
+MxStatus MxDequeInitWithCapacity(MxDequeRef deque, size_t capacity)
+{
+	return MxDequeInitWithCapacityAndFunctions(deque, capacity, NULL);
+}
+
+MxStatus MxDequeInitWithCapacityAndFunctions(MxDequeRef deque, size_t capacity, MxFreeFunction itemFree)
+{
+	if (deque == NULL)
+		return MxStatusNullArgument;
+	
+	if (capacity == 0)
+		return MxStatusIllegalArgument;
+	
+	capacity = RoundUpCapacity(capacity);
+	
+	deque->items = (void **)malloc(capacity * sizeof(void *));
+	if (deque->items == NULL)
+		return MxStatusNoMemory;
+	
+	deque->capacity = capacity;
+	deque->count = 0;
+	deque->head = 0;
+	deque->itemFree = itemFree;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxDequeWipe(MxDequeRef deque)
+{
+	if (deque == NULL)
+		return MxStatusNullArgument;
+	
+	MxDequeClear(deque);
+	
+	free(deque->items);
+	deque->items = NULL;
+	deque->capacity = 0;
+	
+	return MxStatusOK;
+}
+
+MxStatus MxDequeDelete(MxDequeRef deque)
+{
+	MxStatus result = MxDequeWipe(deque);
+	if (result == MxStatusOK)
+		free(deque);
+	
+	return result;
+}
+
+
+MxStatus MxDequePushBack(MxDequeRef deque, const void *item)
+{
+	if (deque == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = ExpandIfNeeded(deque);
+	if (result != MxStatusOK)
+		return result;
+	
+	deque->items[Slot(deque, deque->count)] = (void *)item;
+	deque->count += 1;
+	
+	return MxStatusOK;
+}
+
+MxStatus MxDequePushFront(MxDequeRef deque, const void *item)
+{
+	if (deque == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = ExpandIfNeeded(deque);
+	if (result != MxStatusOK)
+		return result;
+	
+	deque->head = (deque->head - 1) & (deque->capacity - 1);
+	deque->items[deque->head] = (void *)item;
+	deque->count += 1;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxDequePopBack(MxDequeRef deque, void **result)
+{
+	if (deque == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = NULL;
+	if (deque->count == 0)
+		return MxStatusNotFound;
+	
+	deque->count -= 1;
+	*result = deque->items[Slot(deque, deque->count)];
+	
+	return MxStatusOK;
+}
+
+MxStatus MxDequePopFront(MxDequeRef deque, void **result)
+{
+	if (deque == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = NULL;
+	if (deque->count == 0)
+		return MxStatusNotFound;
+	
+	*result = deque->items[deque->head];
+	deque->head = Slot(deque, 1);
+	deque->count -= 1;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxDequePeekBack(MxDequeRef deque, void **result)
+{
+	if (deque == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = NULL;
+	if (deque->count == 0)
+		return MxStatusNotFound;
+	
+	*result = deque->items[Slot(deque, deque->count - 1)];
+	
+	return MxStatusOK;
+}
+
+MxStatus MxDequePeekFront(MxDequeRef deque, void **result)
+{
+	if (deque == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = NULL;
+	if (deque->count == 0)
+		return MxStatusNotFound;
+	
+	*result = deque->items[deque->head];
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxDequeItemAt(MxDequeRef deque, int index, void **result)
+{
+	if (deque == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	if (index < 0)
+		return MxStatusIllegalArgument;
+	
+	if ((size_t)index >= deque->count)
+		return MxStatusIndexOutOfRange;
+	
+	*result = deque->items[Slot(deque, index)];
+	
+	return MxStatusOK;
+}
+
+MxStatus MxDequeReplaceAt(MxDequeRef deque, const void *item, int index)
+{
+	if (deque == NULL)
+		return MxStatusNullArgument;
+	
+	if (index < 0)
+		return MxStatusIllegalArgument;
+	
+	if ((size_t)index >= deque->count)
+		return MxStatusIndexOutOfRange;
+	
+	size_t slot = Slot(deque, index);
+	if (deque->itemFree)
+		deque->itemFree(deque->items[slot]);
+	
+	deque->items[slot] = (void *)item;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxDequeClear(MxDequeRef deque)
+{
+	if (deque == NULL)
+		return MxStatusNullArgument;
+	
+	if (deque->itemFree)
+	{
+		for (size_t ctr = 0; ctr < deque->count; ++ctr)
+			deque->itemFree(deque->items[Slot(deque, ctr)]);
+	}
+	
+	deque->count = 0;
+	deque->head = 0;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxDequeIterate(MxDequeRef deque, MxIteratorCallback callback, void *state)
+{
+	if (deque == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = MxStatusOK;
+	for (size_t ctr = 0; ctr < deque->count; ++ctr)
+		if ((result = callback(deque->items[Slot(deque, ctr)], state)) != MxStatusOK)
+			break;
+	
+	return result;
+}
+
+MxStatus MxDequeIterateBackward(MxDequeRef deque, MxIteratorCallback callback, void *state)
+{
+	if (deque == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = MxStatusOK;
+	for (size_t ctr = deque->count; ctr > 0; --ctr)
+		if ((result = callback(deque->items[Slot(deque, ctr - 1)], state)) != MxStatusOK)
+			break;
+	
+	return result;
+}
+
+
+size_t MxDequeGetCount(MxDequeRef deque)
+{
+	return (deque != NULL) ? deque->count : 0;
+}
@@ -0,0 +1,76 @@
+//
+//  MxDeque.h
+//  core_ds
+//
+//  Double-ended queue in a power-of-two ring buffer.
+//
+//  Pushing and popping at either end is O(1) with no per-item allocation,
+//  and items can be read by index. When the buffer fills it doubles,
+//  keeping the items in order.
+//
+
+#ifndef core_ds_MxDeque_h
+#define core_ds_MxDeque_h
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+
+// Capacities are rounded up to a power of two
+#define MxDequeDefaultCapacity (32)
+#define MxDequeExpansionFactor (2)
+
+typedef struct _MxDeque {
+	size_t capacity;
+	size_t count;
+	
+	// Slot holding the front item
+	size_t head;
+	
+	MxFreeFunction itemFree;
+	
+	void **items;
+} MxDeque, *MxDequeRef;
+
+
+MxDequeRef MxDequeCreate(void);
+MxDequeRef MxDequeCreateWithFunctions(MxFreeFunction itemFree);
+MxDequeRef MxDequeCreateWithCapacity(size_t capacity);
+MxDequeRef MxDequeCreateWithCapacityAndFunctions(size_t capacity, MxFreeFunction itemFree);
+
+MxStatus MxDequeInit(MxDequeRef deque);
+MxStatus MxDequeInitWithFunctions(MxDequeRef deque, MxFreeFunction itemFree);
+MxStatus MxDequeInitWithCapacity(MxDequeRef deque, size_t capacity);
+MxStatus MxDequeInitWithCapacityAndFunctions(MxDequeRef deque, size_t capacity, MxFreeFunction itemFree);
+
+// Frees any items left in the deque with its itemFree function
+MxStatus MxDequeWipe(MxDequeRef deque);
+MxStatus MxDequeDelete(MxDequeRef deque);
+
+
+MxStatus MxDequePushBack(MxDequeRef deque, const void *item);
+MxStatus MxDequePushFront(MxDequeRef deque, const void *item);
+
+// Popped items are handed to the caller, not freed.
+// returns MxStatusNotFound (and *result NULL) if the deque is empty
+MxStatus MxDequePopBack(MxDequeRef deque, void **result);
+MxStatus MxDequePopFront(MxDequeRef deque, void **result);
+
+// As the pops, but the item stays in the deque
+MxStatus MxDequePeekBack(MxDequeRef deque, void **result);
+MxStatus MxDequePeekFront(MxDequeRef deque, void **result);
+
+// Index 0 is the front
+MxStatus MxDequeItemAt(MxDequeRef deque, int index, void **result);
+MxStatus MxDequeReplaceAt(MxDequeRef deque, const void *item, int index);
+
+MxStatus MxDequeClear(MxDequeRef deque);
+
+
+// Front to back, and back to front
+MxStatus MxDequeIterate(MxDequeRef deque, MxIteratorCallback callback, void *state);
+MxStatus MxDequeIterateBackward(MxDequeRef deque, MxIteratorCallback callback, void *state);
+
+
+size_t MxDequeGetCount(MxDequeRef deque);
+
+#endif
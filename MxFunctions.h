@@ -8,6 +8,8 @@
 #ifndef core_ds_MxFunctions_h
 #define core_ds_MxFunctions_h
 
+#include <stdint.h>
+
 #include "MxStatus.h"
 
 // Iteration callback function. The iteration should terminate if
@@ -35,6 +37,30 @@ typedef void (*MxFreeFunction)(void *value);
 typedef unsigned long (*MxHashFunction)(const void *key);
 
 
+// Extract an unsigned integer sort key from an item (for radix sorting). Signed keys
+// can be mapped to order correctly by flipping the sign bit: (uint64_t)k ^ (1ULL << 63)
+typedef uint64_t (*MxIntKeyFunction)(const void *item);
+
+
+// Extract a \0-terminated string sort key from an item (for radix sorting)
+typedef const char *(*MxStringKeyFunction)(const void *item);
+
+
+// Produce a value from an item (for mapping), putting it in *result
+typedef MxStatus (*MxMapFunction)(const void *item, void **result, void *state);
+
+
+// Test an item. Implementations should return non-0 if the item
+// matches, 0 otherwise...
+typedef int (*MxPredicateFunction)(const void *item, void *state);
+
+
+// Fold an item into an accumulator, and fold one accumulator into another
+// (for reductions)
+typedef MxStatus (*MxReduceFunction)(void *accumulator, const void *item, void *state);
+typedef MxStatus (*MxCombineFunction)(void *accumulator, const void *other, void *state);
+
+
 // Provide some default implementation of common functions
 void MxDefaultFreeFunction(void *data);
 int MxDefaultCompareFunction(const void *first, const void *second);
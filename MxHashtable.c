@@ -23,6 +23,22 @@ static inline void ReplaceValueInPair(MxHashtableRef table, MxPairRef pair, cons
 static MxStatus PutInBucket(MxHashtableRef table, MxListRef bucket, const void *key, const void *value);
 static inline MxListRef BucketForKey(MxHashtableRef table, const void *key);
 
+static MxStatus CompactPut(MxHashtableRef table, const void *key, const void *value);
+static uint32_t CompactFind(MxHashtableRef table, const void *key, uint32_t *prevResult);
+static MxStatus CompactRemoveAt(MxHashtableRef table, uint32_t idx, uint32_t prev, int freeValue);
+static MxStatus CompactRehash(MxHashtableRef table, unsigned int bucketCount);
+static MxStatus CompactClear(MxHashtableRef table);
+static MxStatus CompactResize(MxHashtableRef table, uint32_t capacity);
+static void CompactShrinkIfNeeded(MxHashtableRef table);
+
+static int SmallFind(MxHashtableRef table, const void *key);
+static MxStatus SmallPut(MxHashtableRef table, const void *key, const void *value);
+static void SmallRemoveAt(MxHashtableRef table, int idx, int freeValue);
+static MxStatus SmallClear(MxHashtableRef table);
+static MxStatus Promote(MxHashtableRef table);
+static MxStatus InitBuckets(MxHashtableRef table);
+static void FreeBuckets(MxHashtableRef table);
+
 MxHashtableRef MxHashtableCreate(void) {
 	MxHashtableRef table = (MxHashtableRef)malloc(sizeof(MxHashtable));
 	
@@ -59,7 +75,7 @@ MxStatus MxHashtableInit(MxHashtableRef table)
 	if (table == NULL)
 		return MxStatusNullArgument;
     
-	return MxHashtableInitWithAllFunctions(table, MxDefaultHashFunction, MxDefaultCompareFunction, MxDefaultFreeFunction, MxDefaultFreeFunction);
+	return MxHashtableInitWithAllFunctions(table, MxDefaultHashFunction, MxDefaultEqualsFunction, MxDefaultFreeFunction, MxDefaultFreeFunction);
 }
 
 MxStatus MxHashtableInitWithFunction(MxHashtableRef table, MxHashFunction hashFunction)
@@ -72,24 +88,13 @@ MxStatus MxHashtableInitWithAllFunctions(MxHashtableRef table, MxHashFunction ha
 	if (table == NULL)
 		return MxStatusNullArgument;
 	
-	int ctr, rollbackCtr;
+	// Buckets are only allocated once the table outgrows its small array
+	table->bucketCount = 0;
+	table->buckets = NULL;
 	
-	table->bucketCount = MxHashtableDefaultBucketCount;
-	table->buckets = calloc(table->bucketCount, sizeof(MxList));
-    
-	if (table->buckets == NULL)
-		return MxStatusNoMemory;
-	
-	MxStatus status = MxStatusOK;
-	for (ctr = 0; ctr < table->bucketCount; ++ctr) {
-		if ((status = MxListInitWithFunctions(table->buckets + ctr, free, NULL)) != MxStatusOK)
-		{
-			for (rollbackCtr = 0; rollbackCtr < ctr; ++rollbackCtr)
-				MxListDelete(table->buckets + rollbackCtr);
-			
-			return status;
-		}
-	}
+	table->small = 1;
+	memset(table->smallKeys, 0, sizeof(table->smallKeys));
+	memset(table->smallValues, 0, sizeof(table->smallValues));
 	
 	table->hashFunction = hashFunction ? hashFunction : MxDefaultHashFunction;
 	table->equalsFunction = equals ? equals : MxDefaultEqualsFunction;
@@ -98,6 +103,42 @@ MxStatus MxHashtableInitWithAllFunctions(MxHashtableRef table, MxHashFunction ha
 	
 	table->count = 0;
 	
+	table->compact = 0;
+	table->autoShrink = 1;
+	table->compactBuckets = NULL;
+	table->compactEntries = NULL;
+	table->compactCapacity = 0;
+	
+	return MxStatusOK;
+}
+
+
+MxHashtableRef MxHashtableCreateCompactWithAllFunctions(MxHashFunction hashFunction, MxEqualsFunction equals, MxFreeFunction keyFree, MxFreeFunction valueFree)
+{
+	MxHashtableRef table = (MxHashtableRef)malloc(sizeof(MxHashtable));
+	if (table != NULL)
+	{
+		if (MxHashtableInitCompactWithAllFunctions(table, hashFunction, equals, keyFree, valueFree) != MxStatusOK)
+		{
+			free(table);
+			table = NULL;
+		}
+	}
+	
+	return table;
+}
+
+MxStatus MxHashtableInitCompactWithAllFunctions(MxHashtableRef table, MxHashFunction hashFunction, MxEqualsFunction equals, MxFreeFunction keyFree, MxFreeFunction valueFree)
+{
+	if (table == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus status = MxHashtableInitWithAllFunctions(table, hashFunction, equals, keyFree, valueFree);
+	MxStatusCheck(status);
+	
+	// The entry and bucket arrays are allocated when the table is promoted
+	table->compact = 1;
+	
 	return MxStatusOK;
 }
 
@@ -117,6 +158,41 @@ MxStatus MxHashtableSetValueFreeFunction(MxHashtableRef table, MxFreeFunction fr
 	return MxStatusOK;
 }
 
+MxStatus MxHashtableSetAutoShrink(MxHashtableRef table, int autoShrink)
+{
+	if (table == NULL) return MxStatusNullArgument;
+	table->autoShrink = autoShrink;
+	
+	return MxStatusOK;
+}
+
+MxStatus MxHashtableCompact(MxHashtableRef table)
+{
+	if (table == NULL)
+		return MxStatusNullArgument;
+	
+	// Small tables hold nothing outside the table struct, chained tables free each
+	// node as it is removed - neither has anything to give back
+	if (table->small || !table->compact)
+		return MxStatusOK;
+	
+	uint32_t capacity = (uint32_t)table->count;
+	if (capacity < MxHashtableCompactDefaultCapacity)
+		capacity = MxHashtableCompactDefaultCapacity;
+	
+	unsigned int bucketCount = (unsigned int)table->count | 1;
+	if (bucketCount < MxHashtableDefaultBucketCount)
+		bucketCount = MxHashtableDefaultBucketCount;
+	
+	MxStatus status = CompactResize(table, capacity);
+	MxStatusCheck(status);
+	
+	if (bucketCount != table->bucketCount)
+		status = CompactRehash(table, bucketCount);
+	
+	return status;
+}
+
 
 static MxStatus DestroyPairContents(const void *key, const void *value, void *t)
 {
@@ -142,6 +218,12 @@ MxStatus MxHashtableClear(MxHashtableRef table)
 	if (table->count == 0)
 		return status;
 	
+	if (table->small)
+		return SmallClear(table);
+	
+	if (table->compact)
+		return CompactClear(table);
+	
 	if (table->keyFreeFunction || table->valueFreeFunction)
 		status = MxHashtableIteratePairs(table, DestroyPairContents, table);
     
@@ -166,7 +248,21 @@ MxStatus MxHashtableWipe(MxHashtableRef table)
 	MxStatus status = MxHashtableClear(table);
 	MxStatusCheck(status);
 	
-	free(table->buckets);
+	if (table->small)
+		return MxStatusOK;
+	
+	if (table->compact)
+	{
+		free(table->compactBuckets);
+		free(table->compactEntries);
+		table->compactBuckets = NULL;
+		table->compactEntries = NULL;
+		table->compactCapacity = 0;
+		
+		return MxStatusOK;
+	}
+	
+	FreeBuckets(table);
 	
 	return MxStatusOK;
 }
@@ -244,11 +340,13 @@ static MxStatus PutInBucket(MxHashtableRef table, MxListRef bucket, const void *
 	{
 		// Key was not found...
 		MxPairRef pair = CreatePair(key, value);
-		if (pair != NULL)
-			status = MxListAppend(bucket, pair);
+		if (pair == NULL)
+			return MxStatusNoMemory;
 		
-		if (status == MxStatusOK)
-			table->count += 1;		
+		if ((status = MxListAppend(bucket, pair)) == MxStatusOK)
+			table->count += 1;
+		else
+			free(pair);
 	}
 	
 	
@@ -276,6 +374,20 @@ MxStatus MxHashtablePut(MxHashtableRef table, const void *key, const void *value
     
 //	MxListRef bucket = (MxListRef)table->buckets + bucketIdx;
     
+    if (table->small)
+    {
+        MxStatus status = SmallPut(table, key, value);
+        if (status != MxStatusIncomplete)
+            return status;
+        
+        // Full - move to buckets and carry on
+        if ((status = Promote(table)) != MxStatusOK)
+            return status;
+    }
+    
+    if (table->compact)
+        return CompactPut(table, key, value);
+    
     MxListRef bucket = BucketForKey(table, key);
 	MxStatus result = PutInBucket(table, bucket, key, value);
 	
@@ -290,6 +402,12 @@ MxStatus MxHashtableContainsKey(MxHashtableRef table, const void *key)
 	if (table->hashFunction == NULL)
 		return MxStatusInvalidStructure;
 	
+	if (table->small)
+		return (SmallFind(table, key) >= 0) ? MxStatusTrue : MxStatusFalse;
+	
+	if (table->compact)
+		return (CompactFind(table, key, NULL) != MxHashtableCompactNone) ? MxStatusTrue : MxStatusFalse;
+	
 	unsigned long hash = table->hashFunction(key);
 	unsigned int bucketIdx = (unsigned int)(hash % ((unsigned long)table->bucketCount));
 	
@@ -356,6 +474,26 @@ MxStatus MxHashtableGet(MxHashtableRef table, const void *key, void **result)
 	*result = NULL;
 	int found = 0;
 	
+	if (table->small)
+	{
+		int idx = SmallFind(table, key);
+		if (idx < 0)
+			return MxStatusNotFound;
+		
+		*result = table->smallValues[idx];
+		return MxStatusOK;
+	}
+	
+	if (table->compact)
+	{
+		uint32_t idx = CompactFind(table, key, NULL);
+		if (idx == MxHashtableCompactNone)
+			return MxStatusNotFound;
+		
+		*result = table->compactEntries[idx].value;
+		return MxStatusOK;
+	}
+	
 	if (table->count > 0)
 	{
 		//unsigned long hash = table->hashFunction(key);
@@ -394,6 +532,26 @@ MxStatus MxHashtableRemove(MxHashtableRef table, const void *key)
 	if (table->hashFunction == NULL || table->equalsFunction == NULL)
 		return MxStatusInvalidStructure;
     
+	if (table->small)
+	{
+		int idx = SmallFind(table, key);
+		if (idx < 0)
+			return MxStatusNotFound;
+		
+		SmallRemoveAt(table, idx, 1);
+		return MxStatusOK;
+	}
+	
+	if (table->compact)
+	{
+		uint32_t prev;
+		uint32_t idx = CompactFind(table, key, &prev);
+		if (idx == MxHashtableCompactNone)
+			return MxStatusNotFound;
+		
+		return CompactRemoveAt(table, idx, prev, 1);
+	}
+	
 	int found = 0;
 	if (table->count > 0)
 	{
@@ -444,6 +602,28 @@ MxStatus MxHashtableTake(MxHashtableRef table, const void *key, void **result)
 	*result = NULL;
 	int found = 0;
 	
+	if (table->small)
+	{
+		int idx = SmallFind(table, key);
+		if (idx < 0)
+			return MxStatusNotFound;
+		
+		*result = table->smallValues[idx];
+		SmallRemoveAt(table, idx, 0);
+		return MxStatusOK;
+	}
+	
+	if (table->compact)
+	{
+		uint32_t prev;
+		uint32_t idx = CompactFind(table, key, &prev);
+		if (idx == MxHashtableCompactNone)
+			return MxStatusNotFound;
+		
+		*result = table->compactEntries[idx].value;
+		return CompactRemoveAt(table, idx, prev, 0);
+	}
+	
 	if (table->count > 0)
 	{
 		//unsigned long hash = table->hashFunction(key);
@@ -462,12 +642,10 @@ MxStatus MxHashtableTake(MxHashtableRef table, const void *key, void **result)
 					*result = pair->value;
 					found = 1;
 					
+					// The value now belongs to the caller - only the key is freed
 					if (table->keyFreeFunction)
 						table->keyFreeFunction(pair->key);
 					
-					if (table->valueFreeFunction)
-						table->valueFreeFunction(pair->value);
-					
 					RemoveListNode(node);
 					bucket->count--; // naughty - depends on internal struycture of list
 					
@@ -494,6 +672,7 @@ static void RemoveListNode(MxListNodeRef node)
 	node->prev->next = node->next;
 	node->next->prev = node->prev;
 	
+	free(node->data); // the pair
 	free(node);
 }
 
@@ -505,6 +684,24 @@ MxStatus MxHashtableIterateKeys(MxHashtableRef table, MxIteratorCallback callbac
 	
 	MxStatus result = MxStatusOK;
 	
+	if (table->small)
+	{
+		for (int ctr = 0; ctr < table->count; ++ctr)
+			if ((result = callback(table->smallKeys[ctr], state)) != MxStatusOK)
+				break;
+		
+		return result;
+	}
+	
+	if (table->compact)
+	{
+		for (uint32_t ctr = 0; ctr < (uint32_t)table->count; ++ctr)
+			if ((result = callback(table->compactEntries[ctr].key, state)) != MxStatusOK)
+				break;
+		
+		return result;
+	}
+	
 	if (table->count > 0)
 	{
 		MxListRef bucket;
@@ -534,6 +731,24 @@ MxStatus MxHashtableIterateValues(MxHashtableRef table, MxIteratorCallback callb
 	
 	MxStatus result = MxStatusOK;
 	
+	if (table->small)
+	{
+		for (int ctr = 0; ctr < table->count; ++ctr)
+			if ((result = callback(table->smallValues[ctr], state)) != MxStatusOK)
+				break;
+		
+		return result;
+	}
+	
+	if (table->compact)
+	{
+		for (uint32_t ctr = 0; ctr < (uint32_t)table->count; ++ctr)
+			if ((result = callback(table->compactEntries[ctr].value, state)) != MxStatusOK)
+				break;
+		
+		return result;
+	}
+	
 	if (table->count > 0)
 	{
 		MxListRef bucket;
@@ -564,7 +779,30 @@ int MxHashtableIteratePairs(MxHashtableRef table, MxPairIteratorCallback callbac
 	MxListRef bucket;
 	MxListNodeRef node;
     
-	MxStatus result = 0;
+	MxStatus result = MxStatusOK;
+	
+	if (table->small)
+	{
+		for (int ctr = 0; ctr < table->count; ++ctr)
+			if ((result = callback(table->smallKeys[ctr], table->smallValues[ctr], state)) != MxStatusOK)
+				break;
+		
+		return result;
+	}
+	
+	if (table->compact)
+	{
+		MxHashtableCompactEntryRef entry;
+		for (uint32_t ctr = 0; ctr < (uint32_t)table->count; ++ctr)
+		{
+			entry = table->compactEntries + ctr;
+			if ((result = callback(entry->key, entry->value, state)) != MxStatusOK)
+				break;
+		}
+		
+		return result;
+	}
+	
 	if (table->count > 0) {
 		for (int ctr = 0; ctr < table->bucketCount; ++ctr) {
 			bucket = table->buckets + ctr;
@@ -582,6 +820,39 @@ done:
 	return result;
 }
 
+MxStatus MxHashtableMemoryUsage(MxHashtableRef table, MxHashtableMemoryRef result)
+{
+	if (table == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	size_t count = (size_t)table->count;
+	size_t total;
+	
+	result->payloadBytes = count * 2 * sizeof(void *);
+	
+	if (table->small)
+	{
+		// Held inside the table struct itself
+		total = MxHashtableSmallCapacity * 2 * sizeof(void *);
+		result->allocationCount = 0;
+	}
+	else if (table->compact)
+	{
+		total = (table->bucketCount * sizeof(uint32_t)) + (table->compactCapacity * sizeof(MxHashtableCompactEntry));
+		result->allocationCount = 2;
+	}
+	else
+	{
+		// Bucket array, a sentinel per bucket then a node and a pair per entry
+		total = (table->bucketCount * (sizeof(MxList) + sizeof(MxListNode))) + (count * (sizeof(MxListNode) + sizeof(MxPair)));
+		result->allocationCount = 1 + table->bucketCount + (2 * count);
+	}
+	
+	result->structureBytes = total - result->payloadBytes;
+	
+	return MxStatusOK;
+}
+
 inline int MxHashtableGetCount(MxHashtableRef table)
 {
 	if (table == NULL) return MxStatusNullArgument;
@@ -597,4 +868,365 @@ inline MxHashtableRef MxHashtableCreatePropertyMap()
 inline MxStatus MxHashtableInitAsPropertyMap(MxHashtableRef table)
 {
 	return MxHashtableInitWithAllFunctions(table, MxDefaultStringHashFunction, MxDefaultCStrEqualsFunction, NULL, NULL);
-}
\ No newline at end of file
+}
+
+
+// -- Compact mode ------------------------------------------------------------
+
+
+static inline uint32_t CompactHash(MxHashtableRef table, const void *key)
+{
+	return (uint32_t)table->hashFunction(key);
+}
+
+// Return the index of the entry for 'key' (MxHashtableCompactNone if there isn't one).
+// If prevResult is not NULL it gets the index of the entry chained before it.
+static uint32_t CompactFind(MxHashtableRef table, const void *key, uint32_t *prevResult)
+{
+	uint32_t hash = CompactHash(table, key);
+	uint32_t idx = table->compactBuckets[hash % table->bucketCount];
+	uint32_t prev = MxHashtableCompactNone;
+	MxHashtableCompactEntryRef entry;
+	
+	while (idx != MxHashtableCompactNone)
+	{
+		entry = table->compactEntries + idx;
+		if (entry->hash == hash && (entry->key == key || table->equalsFunction(key, entry->key)))
+			break;
+		
+		prev = idx;
+		idx = entry->next;
+	}
+	
+	if (prevResult != NULL)
+		*prevResult = prev;
+	
+	return idx;
+}
+
+// Rebuild the bucket array with 'bucketCount' buckets from the stored hashes
+static MxStatus CompactRehash(MxHashtableRef table, unsigned int bucketCount)
+{
+	uint32_t *newBuckets = (uint32_t *)malloc(bucketCount * sizeof(uint32_t));
+	if (newBuckets == NULL)
+		return MxStatusNoMemory;
+	
+	memset(newBuckets, 0xff, bucketCount * sizeof(uint32_t)); // all MxHashtableCompactNone
+	
+	MxHashtableCompactEntryRef entry;
+	uint32_t bucketIdx;
+	for (uint32_t ctr = 0; ctr < (uint32_t)table->count; ++ctr)
+	{
+		entry = table->compactEntries + ctr;
+		bucketIdx = entry->hash % bucketCount;
+		entry->next = newBuckets[bucketIdx];
+		newBuckets[bucketIdx] = ctr;
+	}
+	
+	free(table->compactBuckets);
+	table->compactBuckets = newBuckets;
+	table->bucketCount = bucketCount;
+	
+	return MxStatusOK;
+}
+
+static MxStatus CompactPut(MxHashtableRef table, const void *key, const void *value)
+{
+	uint32_t idx = CompactFind(table, key, NULL);
+	if (idx != MxHashtableCompactNone)
+	{
+		MxHashtableCompactEntryRef entry = table->compactEntries + idx;
+		if (table->valueFreeFunction)
+			table->valueFreeFunction(entry->value);
+		
+		entry->value = (void *)value;
+		return MxStatusOK;
+	}
+	
+	if (table->count >= MxHashtableCompactMaxEntries)
+		return MxStatusNoMemory;
+	
+	if ((uint32_t)table->count == table->compactCapacity)
+	{
+		uint32_t newCapacity = table->compactCapacity * 2;
+		if (newCapacity > MxHashtableCompactMaxEntries)
+			newCapacity = MxHashtableCompactMaxEntries;
+		
+		MxStatus status = CompactResize(table, newCapacity);
+		MxStatusCheck(status);
+	}
+	
+	idx = (uint32_t)table->count;
+	
+	MxHashtableCompactEntryRef entry = table->compactEntries + idx;
+	entry->key = (void *)key;
+	entry->value = (void *)value;
+	entry->hash = CompactHash(table, key);
+	
+	uint32_t bucketIdx = entry->hash % table->bucketCount;
+	entry->next = table->compactBuckets[bucketIdx];
+	table->compactBuckets[bucketIdx] = idx;
+	
+	table->count += 1;
+	
+	// Keep the chains short - a failed rehash just leaves them longer
+	if ((unsigned int)table->count > table->bucketCount)
+		CompactRehash(table, (table->bucketCount * 2) + 1);
+	
+	return MxStatusOK;
+}
+
+// Unlink and drop the entry at 'idx' ('prev' is the entry before it in its chain). The
+// last entry is moved into the hole to keep the entry array dense.
+static MxStatus CompactRemoveAt(MxHashtableRef table, uint32_t idx, uint32_t prev, int freeValue)
+{
+	MxHashtableCompactEntryRef entries = table->compactEntries;
+	MxHashtableCompactEntryRef entry = entries + idx;
+	
+	if (table->keyFreeFunction)
+		table->keyFreeFunction(entry->key);
+	
+	if (freeValue && table->valueFreeFunction)
+		table->valueFreeFunction(entry->value);
+	
+	if (prev == MxHashtableCompactNone)
+		table->compactBuckets[entry->hash % table->bucketCount] = entry->next;
+	else
+		entries[prev].next = entry->next;
+	
+	uint32_t last = (uint32_t)table->count - 1;
+	if (idx != last)
+	{
+		// Re-point whatever links to the last entry at its new position
+		uint32_t *link = table->compactBuckets + (entries[last].hash % table->bucketCount);
+		while (*link != last)
+			link = &(entries[*link].next);
+		
+		*link = idx;
+		entries[idx] = entries[last];
+	}
+	
+	table->count -= 1;
+	
+	if (table->autoShrink)
+		CompactShrinkIfNeeded(table);
+	
+	return MxStatusOK;
+}
+
+// Reallocate the entry array to hold 'capacity' entries (which must be >= count)
+static MxStatus CompactResize(MxHashtableRef table, uint32_t capacity)
+{
+	if (capacity == table->compactCapacity)
+		return MxStatusOK;
+	
+	MxHashtableCompactEntryRef newEntries = realloc(table->compactEntries, capacity * sizeof(MxHashtableCompactEntry));
+	if (newEntries == NULL)
+		return MxStatusNoMemory;
+	
+	table->compactEntries = newEntries;
+	table->compactCapacity = capacity;
+	
+	return MxStatusOK;
+}
+
+// Halve the entry array and bucket array once they are less than a quarter used. Growth
+// doubles, so a table hovering around one size never flips back and forth.
+static void CompactShrinkIfNeeded(MxHashtableRef table)
+{
+	uint32_t count = (uint32_t)table->count;
+	
+	if (table->compactCapacity > MxHashtableCompactDefaultCapacity && count < table->compactCapacity / MxHashtableShrinkDivisor)
+		CompactResize(table, table->compactCapacity / 2);
+	
+	if (table->bucketCount > MxHashtableDefaultBucketCount && count < table->bucketCount / MxHashtableShrinkDivisor)
+		CompactRehash(table, (table->bucketCount / 2) | 1);
+	
+	// Failures above just leave the table bigger than it needs to be
+}
+
+static MxStatus CompactClear(MxHashtableRef table)
+{
+	MxHashtableCompactEntryRef entry;
+	for (uint32_t ctr = 0; ctr < (uint32_t)table->count; ++ctr)
+	{
+		entry = table->compactEntries + ctr;
+		DestroyPairContents(entry->key, entry->value, table);
+	}
+	
+	memset(table->compactBuckets, 0xff, table->bucketCount * sizeof(uint32_t));
+	table->count = 0;
+	
+	if (table->autoShrink)
+		return MxHashtableCompact(table);
+	
+	return MxStatusOK;
+}
+
+
+
+// -- Small tables ------------------------------------------------------------
+
+
+// Return the index of 'key' in the small arrays, -1 if it is not there
+static int SmallFind(MxHashtableRef table, const void *key)
+{
+	if (table->equalsFunction == MxDefaultEqualsFunction)
+	{
+		// Identity keys: compare every slot without branching so the loop vectorises.
+		// Unused slots are NULL and keys never are, so they can't match.
+		unsigned int matches = 0;
+		for (int ctr = 0; ctr < MxHashtableSmallCapacity; ++ctr)
+			matches |= (unsigned int)(table->smallKeys[ctr] == key) << ctr;
+		
+		return matches ? __builtin_ctz(matches) : -1;
+	}
+	
+	for (int ctr = 0; ctr < table->count; ++ctr)
+	{
+		if (table->smallKeys[ctr] == key || table->equalsFunction(key, table->smallKeys[ctr]))
+			return ctr;
+	}
+	
+	return -1;
+}
+
+// Returns MxStatusIncomplete if the key is new and the small arrays are full
+static MxStatus SmallPut(MxHashtableRef table, const void *key, const void *value)
+{
+	int idx = SmallFind(table, key);
+	if (idx >= 0)
+	{
+		if (table->valueFreeFunction)
+			table->valueFreeFunction(table->smallValues[idx]);
+		
+		table->smallValues[idx] = (void *)value;
+		return MxStatusOK;
+	}
+	
+	if (table->count == MxHashtableSmallCapacity)
+		return MxStatusIncomplete;
+	
+	table->smallKeys[table->count] = (void *)key;
+	table->smallValues[table->count] = (void *)value;
+	table->count += 1;
+	
+	return MxStatusOK;
+}
+
+static void SmallRemoveAt(MxHashtableRef table, int idx, int freeValue)
+{
+	if (table->keyFreeFunction)
+		table->keyFreeFunction(table->smallKeys[idx]);
+	
+	if (freeValue && table->valueFreeFunction)
+		table->valueFreeFunction(table->smallValues[idx]);
+	
+	int last = table->count - 1;
+	table->smallKeys[idx] = table->smallKeys[last];
+	table->smallValues[idx] = table->smallValues[last];
+	table->smallKeys[last] = NULL;
+	table->smallValues[last] = NULL;
+	
+	table->count -= 1;
+}
+
+static MxStatus SmallClear(MxHashtableRef table)
+{
+	for (int ctr = 0; ctr < table->count; ++ctr)
+		DestroyPairContents(table->smallKeys[ctr], table->smallValues[ctr], table);
+	
+	memset(table->smallKeys, 0, sizeof(table->smallKeys));
+	memset(table->smallValues, 0, sizeof(table->smallValues));
+	table->count = 0;
+	
+	return MxStatusOK;
+}
+
+// Move the contents of the small arrays into a hashed representation
+static MxStatus Promote(MxHashtableRef table)
+{
+	MxStatus status = MxStatusOK;
+	int count = table->count;
+	
+	if (table->compact)
+	{
+		table->compactCapacity = MxHashtableCompactDefaultCapacity;
+		table->compactEntries = calloc(table->compactCapacity, sizeof(MxHashtableCompactEntry));
+		if (table->compactEntries == NULL)
+			return MxStatusNoMemory;
+		
+		for (int ctr = 0; ctr < count; ++ctr)
+		{
+			table->compactEntries[ctr].key = table->smallKeys[ctr];
+			table->compactEntries[ctr].value = table->smallValues[ctr];
+			table->compactEntries[ctr].hash = CompactHash(table, table->smallKeys[ctr]);
+		}
+		
+		if ((status = CompactRehash(table, MxHashtableDefaultBucketCount)) != MxStatusOK)
+		{
+			free(table->compactEntries);
+			table->compactEntries = NULL;
+			return status;
+		}
+	}
+	else
+	{
+		if ((status = InitBuckets(table)) != MxStatusOK)
+			return status;
+		
+		table->count = 0;
+		for (int ctr = 0; ctr < count && status == MxStatusOK; ++ctr)
+			status = PutInBucket(table, BucketForKey(table, table->smallKeys[ctr]), table->smallKeys[ctr], table->smallValues[ctr]);
+		
+		if (status != MxStatusOK)
+		{
+			// Stay small - the keys and values are still in the small arrays
+			FreeBuckets(table);
+			table->count = count;
+			return status;
+		}
+	}
+	
+	table->small = 0;
+	
+	return MxStatusOK;
+}
+
+static MxStatus InitBuckets(MxHashtableRef table)
+{
+	int ctr, rollbackCtr;
+	
+	table->buckets = calloc(MxHashtableDefaultBucketCount, sizeof(MxList));
+	if (table->buckets == NULL)
+		return MxStatusNoMemory;
+	
+	MxStatus status = MxStatusOK;
+	for (ctr = 0; ctr < MxHashtableDefaultBucketCount; ++ctr) {
+		if ((status = MxListInitWithFunctions(table->buckets + ctr, free, NULL)) != MxStatusOK)
+		{
+			for (rollbackCtr = 0; rollbackCtr < ctr; ++rollbackCtr)
+				MxListWipe(table->buckets + rollbackCtr);
+			
+			free(table->buckets);
+			table->buckets = NULL;
+			
+			return status;
+		}
+	}
+	
+	table->bucketCount = MxHashtableDefaultBucketCount;
+	
+	return MxStatusOK;
+}
+
+// Free the buckets, their nodes and pairs - but not the keys and values
+static void FreeBuckets(MxHashtableRef table)
+{
+	for (int ctr = 0; ctr < table->bucketCount; ++ctr)
+		MxListWipe(table->buckets + ctr);
+	
+	free(table->buckets);
+	table->buckets = NULL;
+	table->bucketCount = 0;
+}
@@ -11,6 +11,9 @@
 #ifndef core_ds_MxHashtable_h
 #define core_ds_MxHashtable_h
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "MxStatus.h"
 #include "MxFunctions.h"
 #include "MxList.h"
@@ -18,12 +21,36 @@
 
 #define MxHashtableDefaultBucketCount (89)
 
+// Tables with up to this many entries keep them in two short arrays inside the
+// table and search them linearly - buckets are only allocated past this
+#define MxHashtableSmallCapacity (8)
+
+// Compact tables chain 32-bit entry indices; this marks the end of a chain
+#define MxHashtableCompactNone (UINT32_MAX)
+#define MxHashtableCompactDefaultCapacity (64)
+// Bounded by the int entry count rather than the 32-bit indices
+#define MxHashtableCompactMaxEntries (0x7fffffff)
+// Compact tables shrink once less than 1/MxHashtableShrinkDivisor of their space is used
+#define MxHashtableShrinkDivisor (4)
+
 typedef struct _MxPair
 {
     void *key;
     void *value;
 } MxPair, *MxPairRef;
 
+// An entry in a compact table's dense entry array
+typedef struct _MxHashtableCompactEntry
+{
+    void *key;
+    void *value;
+    
+    // Index of the next entry in the same bucket
+    uint32_t next;
+    // Low 32 bits of the key's hash - lets the table rehash without calling the hash function
+    uint32_t hash;
+} MxHashtableCompactEntry, *MxHashtableCompactEntryRef;
+
 typedef struct _MxHashtable 
 {
     unsigned int bucketCount;
@@ -31,13 +58,39 @@ typedef struct _MxHashtable
     
     int count;
     
+    // While set the entries are in smallKeys/smallValues and 'buckets' is not allocated
+    int small;
+    void *smallKeys[MxHashtableSmallCapacity];
+    void *smallValues[MxHashtableSmallCapacity];
+    
     MxHashFunction hashFunction;
     MxEqualsFunction equalsFunction;
     MxFreeFunction keyFreeFunction;
     MxFreeFunction valueFreeFunction;
+    
+    // Compact mode: 'buckets' is unused, each bucket is the index of the first entry
+    // in its chain and the entries live contiguously in 'compactEntries'
+    int compact;
+    int autoShrink;
+    uint32_t *compactBuckets;
+    MxHashtableCompactEntryRef compactEntries;
+    uint32_t compactCapacity;
 } MxHashtable, *MxHashtableRef;
 
 
+// Memory used to hold a table's entries (the keys and values themselves are not included)
+typedef struct _MxHashtableMemory
+{
+    // Bytes spent on buckets, list nodes, pairs, entry links and spare capacity
+    size_t structureBytes;
+    // Bytes spent holding the key and value pointers of the live entries
+    size_t payloadBytes;
+    // Number of separate heap blocks (0 while the table is small) - multiply by the allocator's per-block
+    // overhead to account for malloc headers
+    size_t allocationCount;
+} MxHashtableMemory, *MxHashtableMemoryRef;
+
+
 
 // Signature of a key/value iterator callback.
 // TODO: Should be in MxFunctions.h
@@ -56,11 +109,31 @@ MxStatus MxHashtableInitWithFunction(MxHashtableRef table, MxHashFunction hashFu
 MxStatus MxHashtableInitWithAllFunctions(MxHashtableRef table, MxHashFunction hashFunction, MxCompareFunction compare, MxFreeFunction keyFree, MxFreeFunction valueFree);
 
 
+// Dynamically create / initialise a compact table. Instead of a list node and a pair per
+// entry a compact table keeps every entry in one dense array chained by 32-bit indices,
+// which roughly halves the per-entry overhead. The bucket array grows with the table.
+// Holds at most MxHashtableCompactMaxEntries entries.
+MxHashtableRef MxHashtableCreateCompactWithAllFunctions(MxHashFunction hashFunction, MxEqualsFunction equals, MxFreeFunction keyFree, MxFreeFunction valueFree);
+MxStatus MxHashtableInitCompactWithAllFunctions(MxHashtableRef table, MxHashFunction hashFunction, MxEqualsFunction equals, MxFreeFunction keyFree, MxFreeFunction valueFree);
+
+
 // Set the function used to free memory consumed by a key
 MxStatus MxHashtableSetKeyFreeFunction(MxHashtableRef table, MxFreeFunction freeFunction);
 // Set the function used to free memory consumed by a value
 MxStatus MxHashtableSetValueFreeFunction(MxHashtableRef table, MxFreeFunction freeFunction);
 
+// Turn automatic shrinking on (the default) or off. With it on a compact table halves its
+// entry and bucket arrays whenever removals leave them less than a quarter full.
+MxStatus MxHashtableSetAutoShrink(MxHashtableRef table, int autoShrink);
+
+// Give back all the memory a table is holding beyond its live entries. For a compact table
+// the entry array is cut to fit and the buckets rehashed to match the count; chained tables
+// free each entry as it is removed so are left as they are.
+// returns MxStatusOK  if the table was compacted
+//         MxStatusNullArgument if table is NULL
+//         MxStatusNoMemory if the smaller arrays could not be allocated (the table stays usable)
+MxStatus MxHashtableCompact(MxHashtableRef table);
+
 // Wipe the internal memory used by a table (i.e. dynamically alloc'd buckets
 // Does NOT free the table reference itself (use with stack alloc'd tables)
 MxStatus MxHashtableWipe(MxHashtableRef table);
@@ -74,6 +147,7 @@ MxStatus MxHashtableDelete(MxHashtableRef table);
 // returns MxStatusOK  if the value was stored
 //         MxStatusNullArgument if table, key or value is NULL
 //         MxStatusInvalidStructure  if 'table' does not have a hash function
+//         MxStatusNoMemory if the entry could not be allocated (or a compact table is full)
 MxStatus MxHashtablePut(MxHashtableRef table, const void *key, const void *value);
 
 // Get the value stored against key 'key'. A refernce to the value is placed in *result.
@@ -93,7 +167,8 @@ MxStatus MxHashtableGet(MxHashtableRef table, const void *key, void **result);
 MxStatus MxHashtableRemove(MxHashtableRef table, const void *key);
 
 // Remove and return (in *result) the value stored against 'key'
-// If the table has functions to free memory consumed by keys then 'key' will be freed
+// If the table has functions to free memory consumed by keys then 'key' will be freed,
+// the value is never freed
 // returns MxStatusOK  if the value was removed
 //         MxStatusNullArgument if table or key is NULL
 //         MxStatusInvalidStructure  if 'table' does not have a hash or equals function
@@ -134,6 +209,12 @@ MxStatus MxHashtableIteratePairs(MxHashtableRef table, MxPairIteratorCallback ca
 int MxHashtableGetCount(MxHashtableRef table);
 
 
+// Fill in *result with the heap memory used by the table's own structure
+// returns MxStatusOK
+//         MxStatusNullArgument if table or result is NULL
+MxStatus MxHashtableMemoryUsage(MxHashtableRef table, MxHashtableMemoryRef result);
+
+
 // Return:
 //          MxStatusTrue if the table contains the key
 //          MxStatusFalse if the table does not contain the key
@@ -0,0 +1,247 @@
+//
+//  MxIList.h
+//  core_ds
+//
+//  Intrusive doubly-linked list.
+//
+//  Rather than the list allocating a node for each item, the items carry
+//  their own MxIListLink, so adding and removing never allocates and any
+//  item can be unlinked in O(1) without searching for it:
+//
+//      typedef struct {
+//          int fd;
+//          MxIListLink link;
+//      } Connection;
+//
+//      MxIList connections;
+//      MxIListInit(&connections);
+//
+//      MxIListLinkInit(&conn->link);
+//      MxIListAppend(&connections, &conn->link);
+//      ...
+//      MxIListRemove(&connections, &conn->link);
+//
+//      MX_ILIST_FOREACH(&connections, link)
+//          Poll(MxIListEntry(link, Connection, link));
+//
+//  The list never owns the items - freeing them is up to the caller, after
+//  they are removed. A link can be in one list at a time; an item that needs
+//  to be in several lists embeds a link for each.
+//
+
+#ifndef core_ds_MxIList_h
+#define core_ds_MxIList_h
+
+#include <stddef.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+
+
+typedef struct _MxIListLink {
+	struct _MxIListLink *next;
+	struct _MxIListLink *prev;
+} MxIListLink, *MxIListLinkRef;
+
+typedef struct _MxIList {
+	// Its own next and prev are the first and last links
+	MxIListLink sentinel;
+	size_t count;
+} MxIList, *MxIListRef;
+
+
+// The struct of type 'type' whose member 'member' is the link 'link'
+#define MxIListEntry(link, type, member) ((type *)((char *)(link) - offsetof(type, member)))
+
+// Loop over the links, first to last. 'link' is declared by the macro.
+#define MX_ILIST_FOREACH(list, link)                                                        \
+	for (MxIListLinkRef link = (list)->sentinel.next; link != &(list)->sentinel; link = link->next)
+
+// As MX_ILIST_FOREACH, but 'link' may be removed (or freed) inside the loop
+#define MX_ILIST_FOREACH_SAFE(list, link)                                                   \
+	for (MxIListLinkRef link = (list)->sentinel.next, link##_next = link->next;             \
+	     link != &(list)->sentinel;                                                         \
+	     link = link##_next, link##_next = link->next)
+
+
+static inline MxStatus MxIListInit(MxIListRef list)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	list->sentinel.next = &list->sentinel;
+	list->sentinel.prev = &list->sentinel;
+	list->count = 0;
+	
+	return MxStatusOK;
+}
+
+// Mark a link as not in any list. Links must be initialised (or zeroed) before
+// they are first added.
+static inline void MxIListLinkInit(MxIListLinkRef link)
+{
+	link->next = NULL;
+	link->prev = NULL;
+}
+
+static inline int MxIListIsLinked(MxIListLinkRef link)
+{
+	return link->next != NULL;
+}
+
+
+static inline void MxIListSplice(MxIListLinkRef prev, MxIListLinkRef next, MxIListLinkRef link)
+{
+	link->prev = prev;
+	link->next = next;
+	prev->next = link;
+	next->prev = link;
+}
+
+// Put 'link' after 'after', which must be in 'list'
+// returns MxStatusIllegalArgument if 'link' is already in a list
+static inline MxStatus MxIListInsertAfter(MxIListRef list, MxIListLinkRef after, MxIListLinkRef link)
+{
+	if (list == NULL || after == NULL || link == NULL)
+		return MxStatusNullArgument;
+	
+	if (MxIListIsLinked(link))
+		return MxStatusIllegalArgument;
+	
+	MxIListSplice(after, after->next, link);
+	list->count += 1;
+	
+	return MxStatusOK;
+}
+
+// Put 'link' before 'before', which must be in 'list'
+static inline MxStatus MxIListInsertBefore(MxIListRef list, MxIListLinkRef before, MxIListLinkRef link)
+{
+	if (before == NULL)
+		return MxStatusNullArgument;
+	
+	return MxIListInsertAfter(list, before->prev, link);
+}
+
+static inline MxStatus MxIListAppend(MxIListRef list, MxIListLinkRef link)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	return MxIListInsertAfter(list, list->sentinel.prev, link);
+}
+
+static inline MxStatus MxIListPush(MxIListRef list, MxIListLinkRef link)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	return MxIListInsertAfter(list, &list->sentinel, link);
+}
+
+
+// Unlink 'link', which must be in 'list', in O(1)
+// returns MxStatusNotFound if 'link' isn't in a list
+static inline MxStatus MxIListRemove(MxIListRef list, MxIListLinkRef link)
+{
+	if (list == NULL || link == NULL)
+		return MxStatusNullArgument;
+	
+	if (!MxIListIsLinked(link))
+		return MxStatusNotFound;
+	
+	link->prev->next = link->next;
+	link->next->prev = link->prev;
+	MxIListLinkInit(link);
+	list->count -= 1;
+	
+	return MxStatusOK;
+}
+
+// Remove the first (Pop) or last (Dequeue) link, as MxList does.
+// *result is NULL if the list is empty.
+static inline MxStatus MxIListPop(MxIListRef list, MxIListLinkRef *result)
+{
+	if (list == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = NULL;
+	if (list->count == 0)
+		return MxStatusOK;
+	
+	*result = list->sentinel.next;
+	
+	return MxIListRemove(list, *result);
+}
+
+static inline MxStatus MxIListDequeue(MxIListRef list, MxIListLinkRef *result)
+{
+	if (list == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = NULL;
+	if (list->count == 0)
+		return MxStatusOK;
+	
+	*result = list->sentinel.prev;
+	
+	return MxIListRemove(list, *result);
+}
+
+
+// The first and last links, or NULL if the list is empty
+static inline MxIListLinkRef MxIListFirst(MxIListRef list)
+{
+	return (list != NULL && list->count > 0) ? list->sentinel.next : NULL;
+}
+
+static inline MxIListLinkRef MxIListLast(MxIListRef list)
+{
+	return (list != NULL && list->count > 0) ? list->sentinel.prev : NULL;
+}
+
+// The links either side of 'link', or NULL at the ends of the list
+static inline MxIListLinkRef MxIListNext(MxIListRef list, MxIListLinkRef link)
+{
+	return (link->next != &list->sentinel) ? link->next : NULL;
+}
+
+static inline MxIListLinkRef MxIListPrev(MxIListRef list, MxIListLinkRef link)
+{
+	return (link->prev != &list->sentinel) ? link->prev : NULL;
+}
+
+
+// Unlink everything. The items themselves are left alone.
+static inline MxStatus MxIListClear(MxIListRef list)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	MX_ILIST_FOREACH_SAFE(list, link)
+		MxIListLinkInit(link);
+	
+	return MxIListInit(list);
+}
+
+// The callback is passed each link (a const MxIListLink *), first to last.
+// It may remove the link it is passed.
+static inline MxStatus MxIListIterate(MxIListRef list, MxIteratorCallback callback, void *state)
+{
+	if (list == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = MxStatusOK;
+	MX_ILIST_FOREACH_SAFE(list, link)
+		if ((result = callback(link, state)) != MxStatusOK)
+			break;
+	
+	return result;
+}
+
+static inline size_t MxIListGetCount(MxIListRef list)
+{
+	return (list != NULL) ? list->count : 0;
+}
+
+#endif
@@ -15,15 +15,105 @@
 #include "MxList.h"
 
 
-static MxListNodeRef MxListNodeCreate(void *data);
+static MxListNodeRef MxListNodeCreate(MxListRef list, void *data);
+static void MxListNodeRelease(MxListRef list, MxListNodeRef node);
 static void MxListNodeInsertBefore(MxListNodeRef before, MxListNodeRef newNode);
 static void MxListNodeInsertAfter(MxListNodeRef after, MxListNodeRef newNode);
 static MxListNodeRef MxListNodeLookup(MxListRef list, void *data);
-static void MxListNodeRemove(MxListNodeRef node);
+static void MxListNodeRemove(MxListRef list, MxListNodeRef node);
+static MxStatus MxListInitWithNodePool(MxListRef list, MxListNodePoolRef pool, int ownsPool, MxFreeFunction free, MxEqualsFunction equals);
 
 
-MxStatus MxListInit(MxListRef list) {
-	list->sentinel = MxListNodeCreate(NULL);
+MxListNodePoolRef MxListNodePoolCreate(size_t nodesPerSlab) {
+	MxListNodePoolRef pool = (MxListNodePoolRef)malloc(sizeof(MxListNodePool));
+	if (pool != NULL) {
+		if (MxListNodePoolInit(pool, nodesPerSlab) != MxStatusOK) {
+			free(pool);
+			pool = NULL;
+		}
+	}
+	
+	return pool;
+}
+
+
+MxStatus MxListNodePoolInit(MxListNodePoolRef pool, size_t nodesPerSlab) {
+	if (pool == NULL)
+		return MxStatusNullArgument;
+	
+	pool->slabs = NULL;
+	pool->slabCount = 0;
+	pool->nodesPerSlab = (nodesPerSlab > 0) ? nodesPerSlab : MxListNodePoolDefaultSlabNodes;
+	pool->freeNodes = NULL;
+	pool->unused = NULL;
+	pool->unusedEnd = NULL;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxListNodePoolWipe(MxListNodePoolRef pool) {
+	if (pool == NULL)
+		return MxStatusNullArgument;
+	
+	MxListNodeRef slab = pool->slabs;
+	while (slab != NULL) {
+		MxListNodeRef next = slab->next;
+		free(slab);
+		slab = next;
+	}
+	
+	return MxListNodePoolInit(pool, pool->nodesPerSlab);
+}
+
+
+MxStatus MxListNodePoolDelete(MxListNodePoolRef pool) {
+	MxStatus result = MxListNodePoolWipe(pool);
+	
+	if (result == MxStatusOK)
+		free(pool);
+	
+	return result;
+}
+
+
+static MxListNodeRef MxListNodePoolTake(MxListNodePoolRef pool) {
+	MxListNodeRef node = pool->freeNodes;
+	if (node != NULL) {
+		pool->freeNodes = node->next;
+		return node;
+	}
+	
+	if (pool->unused == pool->unusedEnd) {
+		// One extra node at the front holds the slab's link
+		MxListNodeRef slab = (MxListNodeRef)malloc((pool->nodesPerSlab + 1) * sizeof(MxListNode));
+		if (slab == NULL)
+			return NULL;
+		
+		slab->next = pool->slabs;
+		pool->slabs = slab;
+		pool->slabCount += 1;
+		
+		pool->unused = slab + 1;
+		pool->unusedEnd = slab + 1 + pool->nodesPerSlab;
+	}
+	
+	return pool->unused++;
+}
+
+
+static void MxListNodePoolGive(MxListNodePoolRef pool, MxListNodeRef node) {
+	node->next = pool->freeNodes;
+	pool->freeNodes = node;
+}
+
+
+
+static MxStatus MxListInitWithNodePool(MxListRef list, MxListNodePoolRef pool, int ownsPool, MxFreeFunction free, MxEqualsFunction equals) {
+	list->pool = pool;
+	list->ownsPool = ownsPool;
+	
+	list->sentinel = MxListNodeCreate(list, NULL);
 	if (list->sentinel == NULL)
 		return MxStatusNoMemory ;
     
@@ -32,21 +122,44 @@ MxStatus MxListInit(MxListRef list) {
     
 	list->count = 0;
     
-	list->itemEquals = MxDefaultEqualsFunction;
-	list->itemFree = MxDefaultFreeFunction;
+	list->itemEquals = equals;
+	list->itemFree = free;
     
 	return MxStatusOK;
 }
 
 
+MxStatus MxListInit(MxListRef list) {
+	return MxListInitWithNodePool(list, NULL, 0, MxDefaultFreeFunction, MxDefaultEqualsFunction);
+}
+
+
 MxStatus MxListInitWithFunctions(MxListRef list, MxFreeFunction free, MxEqualsFunction equals) {
-	int result = MxListInit(list);
-	if (result == MxStatusOK) {
-		list->itemEquals = equals;
-		list->itemFree = free;
-	}
-    
-	return MxStatusOK;
+	return MxListInitWithNodePool(list, NULL, 0, free, equals);
+}
+
+
+MxStatus MxListInitWithPool(MxListRef list, MxListNodePoolRef pool, MxFreeFunction free, MxEqualsFunction equals) {
+	if (list == NULL || pool == NULL)
+		return MxStatusNullArgument;
+	
+	return MxListInitWithNodePool(list, pool, 0, free, equals);
+}
+
+
+MxStatus MxListInitWithPrivatePool(MxListRef list, size_t nodesPerSlab, MxFreeFunction free, MxEqualsFunction equals) {
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	MxListNodePoolRef pool = MxListNodePoolCreate(nodesPerSlab);
+	if (pool == NULL)
+		return MxStatusNoMemory;
+	
+	MxStatus result = MxListInitWithNodePool(list, pool, 1, free, equals);
+	if (result != MxStatusOK)
+		MxListNodePoolDelete(pool);
+	
+	return result;
 }
 
 
@@ -78,6 +191,34 @@ MxListRef MxListCreateWithFunctions(MxFreeFunction free, MxEqualsFunction equals
 }
 
 
+MxListRef MxListCreateWithPool(MxListNodePoolRef pool, MxFreeFunction free, MxEqualsFunction equals) {
+	MxListRef result = (MxListRef)malloc(sizeof(MxList));
+    
+	if (result != NULL) {
+		if (MxListInitWithPool(result, pool, free, equals) != MxStatusOK) {
+			free(result);
+			result = NULL;
+		}
+	}
+    
+	return result;
+}
+
+
+MxListRef MxListCreateWithPrivatePool(size_t nodesPerSlab, MxFreeFunction free, MxEqualsFunction equals) {
+	MxListRef result = (MxListRef)malloc(sizeof(MxList));
+    
+	if (result != NULL) {
+		if (MxListInitWithPrivatePool(result, nodesPerSlab, free, equals) != MxStatusOK) {
+			free(result);
+			result = NULL;
+		}
+	}
+    
+	return result;
+}
+
+
 MxStatus MxListClear(MxListRef list)
 {
 	if (list == NULL)
@@ -96,10 +237,10 @@ MxStatus MxListClear(MxListRef list)
 	}
 	
 	/* Destoy the nodes */
-	curr = curr->next;
+	curr = list->sentinel->next;
 	while (curr != list->sentinel) {
 		tmp = curr->next;
-		free(curr);
+		MxListNodeRelease(list, curr);
 		curr = tmp;
 	}
 	
@@ -126,16 +267,22 @@ MxStatus MxListWipe(MxListRef list) {
 		}
 	}
     
-	/* Destoy the nodes */
-	curr = curr->next;
-	while (curr != list->sentinel) {
-		tmp = curr->next;
-		free(curr);
-		curr = tmp;
+	if (list->ownsPool) {
+		/* Every node came from our own pool - drop it a slab at a time */
+		MxListNodePoolDelete(list->pool);
+	}
+	else {
+		/* Destoy the nodes */
+		curr = list->sentinel->next;
+		while (curr != list->sentinel) {
+			tmp = curr->next;
+			MxListNodeRelease(list, curr);
+			curr = tmp;
+		}
+		
+		/* Destroy the sentinel */
+		MxListNodeRelease(list, list->sentinel);
 	}
-    
-	/* Destroy the sentinel */
-	free(list->sentinel);
 	
 	/* Just in case */
 	memset(list, 0, sizeof(MxList));
@@ -156,8 +303,8 @@ MxStatus MxListDelete(MxListRef list) {
 }
 
 
-static MxListNodeRef MxListNodeCreate(void *data) {
-	MxListNodeRef result = malloc(sizeof(MxListNode));
+static MxListNodeRef MxListNodeCreate(MxListRef list, void *data) {
+	MxListNodeRef result = (list->pool != NULL) ? MxListNodePoolTake(list->pool) : malloc(sizeof(MxListNode));
 	if (result != NULL) {
 		result->next = NULL;
 		result->prev = NULL;
@@ -168,6 +315,14 @@ static MxListNodeRef MxListNodeCreate(void *data) {
 }
 
 
+static void MxListNodeRelease(MxListRef list, MxListNodeRef node) {
+	if (list->pool != NULL)
+		MxListNodePoolGive(list->pool, node);
+	else
+		free(node);
+}
+
+
 
 MxStatus MxListAppend(MxListRef list, void *data) {
 	if (!list)
@@ -177,7 +332,7 @@ MxStatus MxListAppend(MxListRef list, void *data) {
 		return MxStatusBadArgument;
     
     
-	MxListNodeRef newNode = MxListNodeCreate(data);
+	MxListNodeRef newNode = MxListNodeCreate(list, data);
 	if (!newNode)
 		return MxStatusNoMemory;
     
@@ -197,7 +352,7 @@ MxStatus MxListPush(MxListRef list, void *data) {
 	if (!list->sentinel)
 		return MxStatusBadArgument;
     
-	MxListNodeRef newNode = MxListNodeCreate(data);
+	MxListNodeRef newNode = MxListNodeCreate(list, data);
 	if (!newNode)
 		return MxStatusNoMemory;
     
@@ -221,7 +376,7 @@ MxStatus MxListInsertAfter(MxListRef list, void *after, void *data) {
 	if (!afterNode) 
 		return MxStatusNotFound;
     
-	MxListNodeRef newNode = MxListNodeCreate(data);
+	MxListNodeRef newNode = MxListNodeCreate(list, data);
 	if (!newNode) 
 		return MxStatusNoMemory;
     
@@ -243,7 +398,7 @@ MxStatus MxListInsertBefore(MxListRef list, void *before, void *data) {
 	if (beforeNode == NULL) 
 		return MxStatusNotFound;
     
-	MxListNodeRef newNode = MxListNodeCreate(data);
+	MxListNodeRef newNode = MxListNodeCreate(list, data);
 	if (newNode == NULL) 
 		return MxStatusNoMemory;
     
@@ -264,7 +419,7 @@ MxStatus MxListInsertAtIndex(MxListRef list, int index, void *data) {
 		return MxStatusIndexOutOfRange;
     
     
-	MxListNodeRef newNode = MxListNodeCreate(data);
+	MxListNodeRef newNode = MxListNodeCreate(list, data);
 	if (newNode == NULL) 
 		return MxStatusNoMemory;
     
@@ -292,7 +447,7 @@ MxStatus MxListRemoveAtIndex(MxListRef list, int index, void **result) {
 	for (int ctr = 0; ctr < index; ++ctr) node = node->next;
     
 	*result = node->data;
-	MxListNodeRemove(node);
+	MxListNodeRemove(list, node);
     
 	list->count--;
 	return MxStatusOK;
@@ -358,17 +513,17 @@ MxStatus MxListRemove(MxListRef list, void *data) {
 	if (list->itemFree != NULL)
 	 	list->itemFree(toRemove->data);
     
-	MxListNodeRemove(toRemove);
+	MxListNodeRemove(list, toRemove);
     
 	list->count--;
 	return MxStatusOK;
 }
 
-static void MxListNodeRemove(MxListNodeRef node) {
+static void MxListNodeRemove(MxListRef list, MxListNodeRef node) {
 	node->prev->next = node->next;
 	node->next->prev = node->prev;
     
-	free(node);
+	MxListNodeRelease(list, node);
 }
 
 /// Remove the node at the head of the list and return the data in it
@@ -386,7 +541,7 @@ MxStatus MxListDequeue(MxListRef list, void **result)
 	}
 	
 	*result = list->sentinel->prev->data;
-	MxListNodeRemove(list->sentinel->prev);
+	MxListNodeRemove(list, list->sentinel->prev);
 	
 	list->count--;
 	return MxStatusOK;
@@ -407,7 +562,7 @@ MxStatus MxListPop(MxListRef list, void **result)
     
     
 	*result = list->sentinel->next->data;
-	MxListNodeRemove(list->sentinel->next);
+	MxListNodeRemove(list, list->sentinel->next);
 	
 	list->count--;
 	return MxStatusOK;
@@ -476,7 +631,7 @@ MxStatus MxListFilter(MxListRef list, MxIteratorCallback callback, void *state)
         
 		if (toRemove) {
 			if (ff) ff(toRemove->data);
-			MxListNodeRemove(toRemove);
+			MxListNodeRemove(list, toRemove);
 			list->count--;
 		}	
 	}
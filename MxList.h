@@ -25,6 +25,30 @@ typedef struct _MxListNode {
 } MxListNode, *MxListNodeRef;
 
 
+// Nodes per slab for pools created with a 'nodesPerSlab' of 0
+#define MxListNodePoolDefaultSlabNodes (1023)
+
+/// A slab allocator for list nodes. Nodes are carved out of large blocks
+/// and released nodes are kept on a free list (threaded through their
+/// 'next' pointers) for reuse, so a busy queue stops calling malloc and
+/// free once it has warmed up. Blocks are only given back when the pool
+/// is wiped. A pool can be private to one list or shared between several,
+/// but is not thread safe.
+typedef struct _MxListNodePool {
+	// Every slab, newest first - the first node of each links to the next slab
+	MxListNodeRef slabs;
+	size_t slabCount;
+	size_t nodesPerSlab;
+	
+	// Released nodes waiting for reuse
+	MxListNodeRef freeNodes;
+	
+	// The part of the newest slab never handed out
+	MxListNodeRef unused;
+	MxListNodeRef unusedEnd;
+} MxListNodePool, *MxListNodePoolRef;
+
+
 typedef struct _MxList {
 	MxListNodeRef sentinel;
     
@@ -32,9 +56,22 @@ typedef struct _MxList {
 	MxEqualsFunction itemEquals;
     
 	int count;
+	
+	// Where nodes come from - malloc if NULL
+	MxListNodePoolRef pool;
+	int ownsPool;
 } MxList, *MxListRef;
 
 
+/// Create or initialise a node pool - 'nodesPerSlab' of 0 uses MxListNodePoolDefaultSlabNodes
+MxListNodePoolRef MxListNodePoolCreate(size_t nodesPerSlab);
+MxStatus MxListNodePoolInit(MxListNodePoolRef pool, size_t nodesPerSlab);
+
+/// Free every slab in the pool. Lists using the pool must be wiped first.
+MxStatus MxListNodePoolWipe(MxListNodePoolRef pool);
+MxStatus MxListNodePoolDelete(MxListNodePoolRef pool);
+
+
 
 /// Dynamically allocate a new list
 MxListRef MxListCreate(void);
@@ -46,6 +83,15 @@ MxStatus MxListInit(MxListRef list);
 MxStatus MxListInitWithFunctions(MxListRef list, MxFreeFunction free, MxEqualsFunction equals);
 
 
+/// Lists that take their nodes from a shared pool, which must outlive them
+MxListRef MxListCreateWithPool(MxListNodePoolRef pool, MxFreeFunction free, MxEqualsFunction equals);
+MxStatus MxListInitWithPool(MxListRef list, MxListNodePoolRef pool, MxFreeFunction free, MxEqualsFunction equals);
+
+/// Lists with a pool of their own - wiping the list frees its nodes a whole slab at a time
+MxListRef MxListCreateWithPrivatePool(size_t nodesPerSlab, MxFreeFunction free, MxEqualsFunction equals);
+MxStatus MxListInitWithPrivatePool(MxListRef list, size_t nodesPerSlab, MxFreeFunction free, MxEqualsFunction equals);
+
+
 /// Wipe a list structure - i.e. free and reset the internal state
 MxStatus MxListWipe(MxListRef list);
 
@@ -0,0 +1,420 @@
+//
+//  MxMultiMap.c
+//  core_ds
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxHashtable.h"
+#include "MxMultiMap.h"
+
+
+static MxMultiMapEntryRef CreateEntry(void);
+static void DestroyEntry(MxMultiMapRef map, MxMultiMapEntryRef entry);
+static MxStatus ExpandEntryIfNeeded(MxMultiMapEntryRef entry);
+static inline MxMultiMapEntryRef EntryForKey(MxMultiMapRef map, const void *key);
+
+
+MxMultiMapRef MxMultiMapCreate(void)
+{
+	return MxMultiMapCreateWithAllFunctions(MxDefaultHashFunction, MxDefaultEqualsFunction, MxDefaultFreeFunction, MxDefaultFreeFunction);
+}
+
+
+MxMultiMapRef MxMultiMapCreateWithAllFunctions(MxHashFunction hashFunction, MxEqualsFunction keyEquals, MxFreeFunction keyFree, MxFreeFunction valueFree)
+{
+	MxMultiMapRef map = (MxMultiMapRef)malloc(sizeof(MxMultiMap));
+	if (map != NULL)
+	{
+		if (MxMultiMapInitWithAllFunctions(map, hashFunction, keyEquals, keyFree, valueFree) != MxStatusOK)
+		{
+			free(map);
+			map = NULL;
+		}
+	}
+
+	return map;
+}
+
+
+MxStatus MxMultiMapInit(MxMultiMapRef map)
+{
+	return MxMultiMapInitWithAllFunctions(map, MxDefaultHashFunction, MxDefaultEqualsFunction, MxDefaultFreeFunction, MxDefaultFreeFunction);
+}
+
+
+MxStatus MxMultiMapInitWithAllFunctions(MxMultiMapRef map, MxHashFunction hashFunction, MxEqualsFunction keyEquals, MxFreeFunction keyFree, MxFreeFunction valueFree)
+{
+	if (map == NULL)
+		return MxStatusNullArgument;
+
+	MxStatus status = MxHashtableInitWithAllFunctions(&map->table, hashFunction, keyEquals, NULL, NULL);
+	MxStatusCheck(status);
+
+	// The table owns the keys but the entries are managed here
+	map->table.keyFreeFunction = keyFree;
+	map->table.valueFreeFunction = NULL;
+
+	map->valueCount = 0;
+	map->valueEqualsFunction = NULL;
+	map->keyFreeFunction = keyFree;
+	map->valueFreeFunction = valueFree;
+
+	return MxStatusOK;
+}
+
+
+MxMultiMapRef MxMultiMapCreatePropertyMap(void)
+{
+	return MxMultiMapCreateWithAllFunctions(MxDefaultStringHashFunction, MxDefaultCStrEqualsFunction, NULL, NULL);
+}
+
+
+MxStatus MxMultiMapInitAsPropertyMap(MxMultiMapRef map)
+{
+	return MxMultiMapInitWithAllFunctions(map, MxDefaultStringHashFunction, MxDefaultCStrEqualsFunction, NULL, NULL);
+}
+
+
+MxStatus MxMultiMapSetKeyFreeFunction(MxMultiMapRef map, MxFreeFunction freeFunction)
+{
+	if (map == NULL) return MxStatusNullArgument;
+	map->keyFreeFunction = freeFunction;
+	map->table.keyFreeFunction = freeFunction;
+
+	return MxStatusOK;
+}
+
+
+MxStatus MxMultiMapSetValueFreeFunction(MxMultiMapRef map, MxFreeFunction freeFunction)
+{
+	if (map == NULL) return MxStatusNullArgument;
+	map->valueFreeFunction = freeFunction;
+
+	return MxStatusOK;
+}
+
+
+MxStatus MxMultiMapSetValueEqualsFunction(MxMultiMapRef map, MxEqualsFunction equalsFunction)
+{
+	if (map == NULL) return MxStatusNullArgument;
+	map->valueEqualsFunction = equalsFunction;
+
+	return MxStatusOK;
+}
+
+
+static MxMultiMapEntryRef CreateEntry(void)
+{
+	MxMultiMapEntryRef entry = (MxMultiMapEntryRef)malloc(sizeof(MxMultiMapEntry));
+	if (entry != NULL)
+	{
+		entry->count = 0;
+		entry->capacity = MxMultiMapInlineValueCount;
+		entry->values = entry->inlineValues;
+	}
+
+	return entry;
+}
+
+
+static void DestroyEntry(MxMultiMapRef map, MxMultiMapEntryRef entry)
+{
+	if (map->valueFreeFunction)
+	{
+		for (size_t ctr = 0; ctr < entry->count; ++ctr)
+			map->valueFreeFunction(entry->values[ctr]);
+	}
+
+	map->valueCount -= (int)entry->count;
+
+	if (entry->values != entry->inlineValues)
+		free(entry->values);
+
+	free(entry);
+}
+
+
+// grow the value vector geometrically, moving it out of the entry on first overflow
+static MxStatus ExpandEntryIfNeeded(MxMultiMapEntryRef entry)
+{
+	if (entry->count < entry->capacity)
+		return MxStatusOK;
+
+	size_t newCapacity = entry->capacity * MxMultiMapExpansionFactor;
+	void **newValues;
+
+	if (entry->values == entry->inlineValues)
+	{
+		newValues = (void **)malloc(newCapacity * sizeof(void *));
+		if (newValues != NULL)
+			memcpy(newValues, entry->inlineValues, entry->count * sizeof(void *));
+	}
+	else
+	{
+		newValues = (void **)realloc(entry->values, newCapacity * sizeof(void *));
+	}
+
+	if (newValues == NULL)
+		return MxStatusNoMemory;
+
+	entry->values = newValues;
+	entry->capacity = newCapacity;
+
+	return MxStatusOK;
+}
+
+
+static inline MxMultiMapEntryRef EntryForKey(MxMultiMapRef map, const void *key)
+{
+	void *entry = NULL;
+	if (MxHashtableGet(&map->table, key, &entry) != MxStatusOK)
+		return NULL;
+
+	return (MxMultiMapEntryRef)entry;
+}
+
+
+static MxStatus DestroyEntryCallback(const void *key, const void *value, void *vmap)
+{
+	(void)key;
+	DestroyEntry((MxMultiMapRef)vmap, (MxMultiMapEntryRef)value);
+	return MxStatusOK;
+}
+
+MxStatus MxMultiMapClear(MxMultiMapRef map)
+{
+	if (map == NULL)
+		return MxStatusNullArgument;
+
+	MxStatus status = MxHashtableIteratePairs(&map->table, DestroyEntryCallback, map);
+	MxStatusCheck(status);
+
+	// Frees the keys...
+	status = MxHashtableClear(&map->table);
+	map->valueCount = 0;
+
+	return status;
+}
+
+
+MxStatus MxMultiMapWipe(MxMultiMapRef map)
+{
+	if (map == NULL)
+		return MxStatusNullArgument;
+
+	MxStatus status = MxMultiMapClear(map);
+	MxStatusCheck(status);
+
+	return MxHashtableWipe(&map->table);
+}
+
+
+MxStatus MxMultiMapDelete(MxMultiMapRef map)
+{
+	if (map == NULL)
+		return MxStatusNullArgument;
+
+	MxStatus status = MxMultiMapWipe(map);
+	if (status == MxStatusOK)
+		free(map);
+
+	return status;
+}
+
+
+MxStatus MxMultiMapAppend(MxMultiMapRef map, const void *key, const void *value)
+{
+	if (map == NULL || key == NULL || value == NULL)
+		return MxStatusNullArgument;
+
+	MxMultiMapEntryRef entry = EntryForKey(map, key);
+	MxStatus status = MxStatusOK;
+
+	if (entry == NULL)
+	{
+		if ((entry = CreateEntry()) == NULL)
+			return MxStatusNoMemory;
+
+		if ((status = MxHashtablePut(&map->table, key, entry)) != MxStatusOK)
+		{
+			free(entry);
+			return status;
+		}
+	}
+
+	if ((status = ExpandEntryIfNeeded(entry)) != MxStatusOK)
+		return status;
+
+	entry->values[entry->count] = (void *)value;
+	entry->count += 1;
+	map->valueCount += 1;
+
+	return MxStatusOK;
+}
+
+
+MxStatus MxMultiMapRemoveValue(MxMultiMapRef map, const void *key, const void *value)
+{
+	if (map == NULL || key == NULL || value == NULL)
+		return MxStatusNullArgument;
+
+	MxMultiMapEntryRef entry = EntryForKey(map, key);
+	if (entry == NULL)
+		return MxStatusNotFound;
+
+	MxEqualsFunction eq = map->valueEqualsFunction;
+	size_t idx;
+	for (idx = 0; idx < entry->count; ++idx)
+	{
+		if (eq ? eq(entry->values[idx], value) : (entry->values[idx] == value))
+			break;
+	}
+
+	if (idx == entry->count)
+		return MxStatusNotFound;
+
+	if (map->valueFreeFunction)
+		map->valueFreeFunction(entry->values[idx]);
+
+	// Keep insertion order for the remaining values
+	memmove(entry->values + idx, entry->values + idx + 1, (entry->count - idx - 1) * sizeof(void *));
+	entry->count -= 1;
+	map->valueCount -= 1;
+
+	if (entry->count == 0)
+		return MxMultiMapRemoveKey(map, key);
+
+	return MxStatusOK;
+}
+
+
+MxStatus MxMultiMapRemoveKey(MxMultiMapRef map, const void *key)
+{
+	if (map == NULL || key == NULL)
+		return MxStatusNullArgument;
+
+	// Take frees the stored key (if there is a key free function) but leaves the entry to us
+	void *entry = NULL;
+	MxStatus status = MxHashtableTake(&map->table, key, &entry);
+	MxStatusCheck(status);
+
+	DestroyEntry(map, (MxMultiMapEntryRef)entry);
+
+	return MxStatusOK;
+}
+
+
+MxStatus MxMultiMapGetValues(MxMultiMapRef map, const void *key, void ***values, size_t *count)
+{
+	if (map == NULL || key == NULL || values == NULL || count == NULL)
+		return MxStatusNullArgument;
+
+	*values = NULL;
+	*count = 0;
+
+	MxMultiMapEntryRef entry = EntryForKey(map, key);
+	if (entry == NULL)
+		return MxStatusNotFound;
+
+	*values = entry->values;
+	*count = entry->count;
+
+	return MxStatusOK;
+}
+
+
+MxStatus MxMultiMapIterateValuesForKey(MxMultiMapRef map, const void *key, MxIteratorCallback callback, void *state)
+{
+	if (map == NULL || key == NULL || callback == NULL)
+		return MxStatusNullArgument;
+
+	MxMultiMapEntryRef entry = EntryForKey(map, key);
+	if (entry == NULL)
+		return MxStatusNotFound;
+
+	MxStatus result = MxStatusOK;
+	for (size_t ctr = 0; ctr < entry->count; ++ctr)
+		if ((result = callback(entry->values[ctr], state)) != MxStatusOK)
+			break;
+
+	return result;
+}
+
+
+MxStatus MxMultiMapIterateKeys(MxMultiMapRef map, MxIteratorCallback callback, void *state)
+{
+	if (map == NULL || callback == NULL)
+		return MxStatusNullArgument;
+
+	return MxHashtableIterateKeys(&map->table, callback, state);
+}
+
+
+typedef struct _PairIterationState
+{
+	MxPairIteratorCallback callback;
+	void *state;
+} PairIterationState;
+
+static MxStatus IterateEntryPairs(const void *key, const void *value, void *vstate)
+{
+	PairIterationState *pairState = (PairIterationState *)vstate;
+	MxMultiMapEntryRef entry = (MxMultiMapEntryRef)value;
+
+	MxStatus result = MxStatusOK;
+	for (size_t ctr = 0; ctr < entry->count; ++ctr)
+		if ((result = pairState->callback(key, entry->values[ctr], pairState->state)) != MxStatusOK)
+			break;
+
+	return result;
+}
+
+MxStatus MxMultiMapIteratePairs(MxMultiMapRef map, MxPairIteratorCallback callback, void *state)
+{
+	if (map == NULL || callback == NULL)
+		return MxStatusNullArgument;
+
+	PairIterationState pairState = { callback, state };
+
+	return MxHashtableIteratePairs(&map->table, IterateEntryPairs, &pairState);
+}
+
+
+int MxMultiMapContainsKey(MxMultiMapRef map, const void *key)
+{
+	if (map == NULL || key == NULL)
+		return MxStatusNullArgument;
+
+	return MxHashtableContainsKey(&map->table, key);
+}
+
+
+int MxMultiMapGetKeyCount(MxMultiMapRef map)
+{
+	if (map == NULL) return MxStatusNullArgument;
+
+	return map->table.count;
+}
+
+
+int MxMultiMapGetCount(MxMultiMapRef map)
+{
+	if (map == NULL) return MxStatusNullArgument;
+
+	return map->valueCount;
+}
+
+
+size_t MxMultiMapGetValueCount(MxMultiMapRef map, const void *key)
+{
+	if (map == NULL || key == NULL)
+		return 0;
+
+	MxMultiMapEntryRef entry = EntryForKey(map, key);
+
+	return (entry != NULL) ? entry->count : 0;
+}
@@ -0,0 +1,135 @@
+//
+//  MxMultiMap.h
+//  core_ds
+//
+//  A hashtable mapping each key to any number of values. The values for
+//  a key are kept in a small contiguous vector (inline in the entry until it
+//  overflows) so scanning every value for a key is a linear array walk.
+//
+
+#ifndef core_ds_MxMultiMap_h
+#define core_ds_MxMultiMap_h
+
+#include <stddef.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxHashtable.h"
+
+
+// Number of values held inside an entry before it spills to the heap
+#define MxMultiMapInlineValueCount (4)
+#define MxMultiMapExpansionFactor (2)
+
+typedef struct _MxMultiMapEntry
+{
+    size_t count;
+    size_t capacity;
+
+    // Points at inlineValues until the entry outgrows it
+    void **values;
+    void *inlineValues[MxMultiMapInlineValueCount];
+} MxMultiMapEntry, *MxMultiMapEntryRef;
+
+typedef struct _MxMultiMap
+{
+    // key => MxMultiMapEntryRef
+    MxHashtable table;
+
+    int valueCount;
+
+    MxEqualsFunction valueEqualsFunction;
+    MxFreeFunction keyFreeFunction;
+    MxFreeFunction valueFreeFunction;
+} MxMultiMap, *MxMultiMapRef;
+
+
+// Dynamically create a multimap.
+MxMultiMapRef MxMultiMapCreate(void);
+MxMultiMapRef MxMultiMapCreateWithAllFunctions(MxHashFunction hashFunction, MxEqualsFunction keyEquals, MxFreeFunction keyFree, MxFreeFunction valueFree);
+
+// Initialise a pre-allocated multimap...
+MxStatus MxMultiMapInit(MxMultiMapRef map);
+MxStatus MxMultiMapInitWithAllFunctions(MxMultiMapRef map, MxHashFunction hashFunction, MxEqualsFunction keyEquals, MxFreeFunction keyFree, MxFreeFunction valueFree);
+
+// Dynamically create / initialise a multimap keyed by C strings. Keys and values are not freed.
+MxMultiMapRef MxMultiMapCreatePropertyMap(void);
+MxStatus MxMultiMapInitAsPropertyMap(MxMultiMapRef map);
+
+
+// Set the function used to free memory consumed by a key
+MxStatus MxMultiMapSetKeyFreeFunction(MxMultiMapRef map, MxFreeFunction freeFunction);
+// Set the function used to free memory consumed by a value
+MxStatus MxMultiMapSetValueFreeFunction(MxMultiMapRef map, MxFreeFunction freeFunction);
+// Set the function MxMultiMapRemoveValue uses to match values ("==" if NULL)
+MxStatus MxMultiMapSetValueEqualsFunction(MxMultiMapRef map, MxEqualsFunction equalsFunction);
+
+
+// Wipe the internal memory used by a map. Does NOT free the map reference itself
+MxStatus MxMultiMapWipe(MxMultiMapRef map);
+
+// Free all the memory used by a dynamically alloc'd map
+MxStatus MxMultiMapDelete(MxMultiMapRef map);
+
+
+// Append 'value' to the values stored against 'key'.
+// If 'key' is already present the existing key is kept and 'key' is not retained
+// (the same as MxHashtablePut).
+// returns MxStatusOK  if the value was stored
+//         MxStatusNullArgument if map, key or value is NULL
+//         MxStatusNoMemory if the value vector could not grow
+MxStatus MxMultiMapAppend(MxMultiMapRef map, const void *key, const void *value);
+
+// Remove the first value matching 'value' from the values stored against 'key'.
+// The value is freed if the map has a value free function. If it was the last value
+// for 'key' the key is removed (and freed) too.
+// returns MxStatusOK  if the value was removed
+//         MxStatusNullArgument if map, key or value is NULL
+//         MxStatusNotFound if the key or value is not in the map
+MxStatus MxMultiMapRemoveValue(MxMultiMapRef map, const void *key, const void *value);
+
+// Remove 'key' and every value stored against it, running the free functions
+// returns MxStatusOK  if the key was removed
+//         MxStatusNullArgument if map or key is NULL
+//         MxStatusNotFound if there is nothing against 'key' in the map
+MxStatus MxMultiMapRemoveKey(MxMultiMapRef map, const void *key);
+
+// Get the contiguous array of values stored against 'key'. The array belongs to the
+// map and is only valid until the next modification of 'key'.
+// returns MxStatusOK  if the key was found
+//         MxStatusNullArgument if map, key, values or count is NULL
+//         MxStatusNotFound if there is nothing against 'key' in the map (*values is NULL, *count 0)
+MxStatus MxMultiMapGetValues(MxMultiMapRef map, const void *key, void ***values, size_t *count);
+
+// Call 'callback' for each value stored against 'key', in insertion order.
+// returns MxStatusOK  if the iteration completed, the status returned by the terminating callback otherwise
+//         MxStatusNullArgument if map, key or callback is NULL
+//         MxStatusNotFound if there is nothing against 'key' in the map
+MxStatus MxMultiMapIterateValuesForKey(MxMultiMapRef map, const void *key, MxIteratorCallback callback, void *state);
+
+// Iterate over every distinct key in the map
+MxStatus MxMultiMapIterateKeys(MxMultiMapRef map, MxIteratorCallback callback, void *state);
+
+// Call 'callback' once for every key/value pair in the map
+MxStatus MxMultiMapIteratePairs(MxMultiMapRef map, MxPairIteratorCallback callback, void *state);
+
+
+// Remove every key and value, running the free functions
+MxStatus MxMultiMapClear(MxMultiMapRef map);
+
+// Return:
+//          MxStatusTrue if the map contains the key
+//          MxStatusFalse if the map does not contain the key
+//          MxStatusNullArgument if map or key is NULL
+int MxMultiMapContainsKey(MxMultiMapRef map, const void *key);
+
+// Number of distinct keys in the map
+int MxMultiMapGetKeyCount(MxMultiMapRef map);
+
+// Number of values in the map, across all keys
+int MxMultiMapGetCount(MxMultiMapRef map);
+
+// Number of values stored against 'key' (0 if the key is not present)
+size_t MxMultiMapGetValueCount(MxMultiMapRef map, const void *key);
+
+#endif
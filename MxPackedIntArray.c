@@ -0,0 +1,611 @@
+//
+//  MxPackedIntArray.c
+//  core_ds
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MxPackedIntArrayHasSSE2 (1)
+#endif
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxPackedIntArray.h"
+
+
+#define BlockSize MxPackedIntArrayBlockSize
+
+// Blocks are 32 rows of 4 lanes - value i is in row i / 4, lane i % 4. Each lane's
+// 32 deltas are packed into 'bits' consecutive words, and the lanes' words are
+// interleaved so word k of every lane loads as one 4 x 32-bit vector.
+#define Lanes (4)
+#define Rows (BlockSize / Lanes)
+
+
+static MxStatus PackTail(MxPackedIntArrayRef array);
+static void DecodeBlock(MxPackedIntArrayRef array, size_t block, uint32_t *output);
+
+
+static inline uint32_t BitsNeeded(uint32_t value)
+{
+	return (value == 0) ? 0 : 32 - __builtin_clz(value);
+}
+
+static inline uint32_t MaskForBits(uint32_t bits)
+{
+	return (bits >= 32) ? UINT32_MAX : ((1u << bits) - 1);
+}
+
+
+static void PackDeltas(const uint32_t *deltas, uint32_t bits, uint32_t *out)
+{
+	memset(out, 0, Lanes * bits * sizeof(uint32_t));
+	if (bits == 0)
+		return;
+	
+	for (size_t lane = 0; lane < Lanes; ++lane)
+	{
+		size_t word = 0;
+		uint32_t shift = 0;
+		
+		for (size_t row = 0; row < Rows; ++row)
+		{
+			uint32_t value = deltas[row * Lanes + lane];
+			
+			out[word * Lanes + lane] |= value << shift;
+			if (shift + bits > 32)
+				out[(word + 1) * Lanes + lane] |= value >> (32 - shift);
+			
+			shift += bits;
+			if (shift >= 32)
+			{
+				shift -= 32;
+				word += 1;
+			}
+		}
+	}
+}
+
+
+#ifdef MxPackedIntArrayHasSSE2
+
+// Unpack a block's deltas a row - four values - at a time and turn them back into
+// values starting at 'first'. The prefix sum is done in-register: two shifted adds
+// sum within the row, then the previous row's last value is broadcast and added.
+static void UnpackBlockSSE2(const uint32_t *in, uint32_t bits, uint32_t first, uint32_t *out)
+{
+	const __m128i mask = _mm_set1_epi32((int)MaskForBits(bits));
+	__m128i running = _mm_set1_epi32((int)first);
+	__m128i current = _mm_setzero_si128();
+	size_t word = 0;
+	uint32_t shift = 0;
+	
+	if (bits > 0)
+		current = _mm_loadu_si128((const __m128i *)in);
+	
+	for (size_t row = 0; row < Rows; ++row)
+	{
+		__m128i value = _mm_setzero_si128();
+		
+		if (bits > 0)
+		{
+			value = _mm_srl_epi32(current, _mm_cvtsi32_si128((int)shift));
+			
+			if (shift + bits >= 32)
+			{
+				word += 1;
+				if (word < bits)
+					current = _mm_loadu_si128((const __m128i *)(in + word * Lanes));
+				
+				if (shift + bits > 32)
+					value = _mm_or_si128(value, _mm_sll_epi32(current, _mm_cvtsi32_si128((int)(32 - shift))));
+			}
+			
+			value = _mm_and_si128(value, mask);
+			shift = (shift + bits) & 31;
+		}
+		
+		value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+		value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+		value = _mm_add_epi32(value, running);
+		
+		_mm_storeu_si128((__m128i *)(out + row * Lanes), value);
+		running = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+}
+
+#define UnpackBlock UnpackBlockSSE2
+
+#else
+
+// Unpack a block's deltas and turn them back into values starting at 'first'
+static void UnpackBlockScalar(const uint32_t *in, uint32_t bits, uint32_t first, uint32_t *out)
+{
+	uint32_t mask = MaskForBits(bits);
+	
+	if (bits == 0)
+	{
+		memset(out, 0, BlockSize * sizeof(uint32_t));
+	}
+	else
+	{
+		for (size_t lane = 0; lane < Lanes; ++lane)
+		{
+			size_t word = 0;
+			uint32_t shift = 0;
+			
+			for (size_t row = 0; row < Rows; ++row)
+			{
+				uint32_t value = in[word * Lanes + lane] >> shift;
+				if (shift + bits > 32)
+					value |= in[(word + 1) * Lanes + lane] << (32 - shift);
+				
+				out[row * Lanes + lane] = value & mask;
+				
+				shift += bits;
+				if (shift >= 32)
+				{
+					shift -= 32;
+					word += 1;
+				}
+			}
+		}
+	}
+	
+	uint32_t running = first;
+	for (size_t ctr = 0; ctr < BlockSize; ++ctr)
+	{
+		running += out[ctr];
+		out[ctr] = running;
+	}
+}
+
+#define UnpackBlock UnpackBlockScalar
+
+#endif
+
+
+MxPackedIntArrayRef MxPackedIntArrayCreate(void)
+{
+	MxPackedIntArrayRef array = (MxPackedIntArrayRef)malloc(sizeof(MxPackedIntArray));
+	if (array != NULL)
+	{
+		if (MxPackedIntArrayInit(array) != MxStatusOK)
+		{
+			free(array);
+			array = NULL;
+		}
+	}
+	
+	return array;
+}
+
+
+MxStatus MxPackedIntArrayInit(MxPackedIntArrayRef array)
+{
+	if (array == NULL)
+		return MxStatusNullArgument;
+	
+	array->blocks = (MxPackedIntBlock *)malloc(MxPackedIntArrayDefaultCapacity * sizeof(MxPackedIntBlock));
+	array->data = (uint32_t *)malloc(MxPackedIntArrayDefaultCapacity * Lanes * sizeof(uint32_t));
+	if (array->blocks == NULL || array->data == NULL)
+	{
+		free(array->blocks);
+		free(array->data);
+		return MxStatusNoMemory;
+	}
+	
+	array->blockCapacity = MxPackedIntArrayDefaultCapacity;
+	array->dataCapacity = MxPackedIntArrayDefaultCapacity * Lanes;
+	
+	return MxPackedIntArrayClear(array);
+}
+
+
+MxStatus MxPackedIntArrayWipe(MxPackedIntArrayRef array)
+{
+	if (array == NULL)
+		return MxStatusNullArgument;
+	
+	free(array->blocks);
+	free(array->data);
+	array->blocks = NULL;
+	array->data = NULL;
+	array->blockCapacity = 0;
+	array->dataCapacity = 0;
+	
+	return MxPackedIntArrayClear(array);
+}
+
+
+MxStatus MxPackedIntArrayDelete(MxPackedIntArrayRef array)
+{
+	if (array == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus status = MxPackedIntArrayWipe(array);
+	if (status == MxStatusOK)
+		free(array);
+	
+	return status;
+}
+
+
+MxStatus MxPackedIntArrayClear(MxPackedIntArrayRef array)
+{
+	if (array == NULL)
+		return MxStatusNullArgument;
+	
+	array->count = 0;
+	array->blockCount = 0;
+	array->dataCount = 0;
+	array->tailCount = 0;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxPackedIntArrayAppend(MxPackedIntArrayRef array, uint32_t value)
+{
+	if (array == NULL)
+		return MxStatusNullArgument;
+	
+	if (array->count > 0)
+	{
+		uint32_t last = (array->tailCount > 0) ? array->tail[array->tailCount - 1] : array->blocks[array->blockCount - 1].last;
+		if (value < last)
+			return MxStatusIllegalArgument;
+	}
+	
+	array->tail[array->tailCount] = value;
+	array->tailCount += 1;
+	array->count += 1;
+	
+	if (array->tailCount == BlockSize)
+	{
+		MxStatus status = PackTail(array);
+		if (status != MxStatusOK)
+		{
+			// Leave the array as it was before the append
+			array->tailCount -= 1;
+			array->count -= 1;
+			return status;
+		}
+	}
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxPackedIntArrayGet(MxPackedIntArrayRef array, size_t index, uint32_t *result)
+{
+	if (array == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	if (index >= array->count)
+		return MxStatusIndexOutOfRange;
+	
+	size_t block = index / BlockSize;
+	if (block == array->blockCount)
+	{
+		*result = array->tail[index % BlockSize];
+		return MxStatusOK;
+	}
+	
+	uint32_t values[BlockSize];
+	DecodeBlock(array, block, values);
+	*result = values[index % BlockSize];
+	
+	return MxStatusOK;
+}
+
+
+// Index of the first value >= 'value' in sorted values[0, count)
+static size_t LowerBoundInValues(const uint32_t *values, size_t count, uint32_t value)
+{
+	size_t low = 0, high = count;
+	
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		if (values[mid] < value)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	
+	return low;
+}
+
+// Index of the first block whose last value is >= 'value', searching from 'start'
+static size_t BlockForValue(MxPackedIntArrayRef array, size_t start, uint32_t value)
+{
+	size_t low = start, high = array->blockCount;
+	
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		if (array->blocks[mid].last < value)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	
+	return low;
+}
+
+MxStatus MxPackedIntArrayLowerBound(MxPackedIntArrayRef array, uint32_t value, size_t *result)
+{
+	if (array == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	size_t block = BlockForValue(array, 0, value);
+	if (block == array->blockCount)
+	{
+		*result = block * BlockSize + LowerBoundInValues(array->tail, array->tailCount, value);
+		return MxStatusOK;
+	}
+	
+	uint32_t values[BlockSize];
+	DecodeBlock(array, block, values);
+	*result = block * BlockSize + LowerBoundInValues(values, BlockSize, value);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxPackedIntArrayDecode(MxPackedIntArrayRef array, uint32_t *output)
+{
+	if (array == NULL || output == NULL)
+		return MxStatusNullArgument;
+	
+	for (size_t block = 0; block < array->blockCount; ++block)
+		DecodeBlock(array, block, output + block * BlockSize);
+	
+	memcpy(output + array->blockCount * BlockSize, array->tail, array->tailCount * sizeof(uint32_t));
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxPackedIntArrayIterate(MxPackedIntArrayRef array, MxIteratorCallback callback, void *state)
+{
+	if (array == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	uint32_t values[BlockSize];
+	MxStatus result = MxStatusOK;
+	
+	for (size_t block = 0; block <= array->blockCount; ++block)
+	{
+		const uint32_t *source = values;
+		size_t count = BlockSize;
+		
+		if (block == array->blockCount)
+		{
+			source = array->tail;
+			count = array->tailCount;
+		}
+		else
+		{
+			DecodeBlock(array, block, values);
+		}
+		
+		for (size_t ctr = 0; ctr < count; ++ctr)
+			if ((result = callback(source + ctr, state)) != MxStatusOK)
+				return result;
+	}
+	
+	return result;
+}
+
+
+// -- Intersection ------------------------------------------------------------
+
+
+// A position in an array, with the current block decoded
+typedef struct _Cursor {
+	MxPackedIntArrayRef array;
+	
+	// The tail counts as block 'blockCount'
+	size_t block;
+	const uint32_t *values;
+	size_t count;
+	size_t position;
+	
+	uint32_t decoded[BlockSize];
+} Cursor;
+
+static void CursorLoadBlock(Cursor *cursor, size_t block)
+{
+	MxPackedIntArrayRef array = cursor->array;
+	
+	cursor->block = block;
+	cursor->position = 0;
+	
+	if (block < array->blockCount)
+	{
+		DecodeBlock(array, block, cursor->decoded);
+		cursor->values = cursor->decoded;
+		cursor->count = BlockSize;
+	}
+	else
+	{
+		cursor->values = array->tail;
+		cursor->count = (block == array->blockCount) ? array->tailCount : 0;
+	}
+}
+
+static inline int CursorAtEnd(Cursor *cursor)
+{
+	return cursor->position >= cursor->count;
+}
+
+// Move to the first value >= 'value', skipping whole blocks without decoding them
+static void CursorSeek(Cursor *cursor, uint32_t value)
+{
+	MxPackedIntArrayRef array = cursor->array;
+	
+	if (cursor->count == 0 || cursor->values[cursor->count - 1] < value)
+	{
+		size_t block = cursor->block + 1;
+		if (block < array->blockCount)
+			block = BlockForValue(array, block, value);
+		
+		if (block > array->blockCount)
+		{
+			cursor->count = 0;
+			cursor->position = 0;
+			return;
+		}
+		
+		CursorLoadBlock(cursor, block);
+	}
+	
+	cursor->position += LowerBoundInValues(cursor->values + cursor->position, cursor->count - cursor->position, value);
+	
+	// Only possible in the tail, if every value in it is smaller
+	if (CursorAtEnd(cursor))
+		cursor->count = 0;
+}
+
+static void CursorNext(Cursor *cursor)
+{
+	cursor->position += 1;
+	if (CursorAtEnd(cursor) && cursor->block < cursor->array->blockCount)
+		CursorLoadBlock(cursor, cursor->block + 1);
+}
+
+MxStatus MxPackedIntArrayIntersect(MxPackedIntArrayRef a, MxPackedIntArrayRef b, MxPackedIntArrayRef result)
+{
+	if (a == NULL || b == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	if (result == a || result == b)
+		return MxStatusIllegalArgument;
+	
+	if (a->count == 0 || b->count == 0)
+		return MxStatusOK;
+	
+	Cursor cursors[2];
+	Cursor *ca = cursors, *cb = cursors + 1;
+	ca->array = a;
+	cb->array = b;
+	CursorLoadBlock(ca, 0);
+	CursorLoadBlock(cb, 0);
+	
+	MxStatus status = MxStatusOK;
+	
+	while (!CursorAtEnd(ca) && !CursorAtEnd(cb))
+	{
+		uint32_t va = ca->values[ca->position];
+		uint32_t vb = cb->values[cb->position];
+		
+		if (va == vb)
+		{
+			if ((status = MxPackedIntArrayAppend(result, va)) != MxStatusOK)
+				break;
+			
+			CursorNext(ca);
+			CursorNext(cb);
+		}
+		else if (va < vb)
+		{
+			CursorSeek(ca, vb);
+		}
+		else
+		{
+			CursorSeek(cb, va);
+		}
+	}
+	
+	return status;
+}
+
+
+size_t MxPackedIntArrayGetCount(MxPackedIntArrayRef array)
+{
+	return (array != NULL) ? array->count : 0;
+}
+
+
+size_t MxPackedIntArrayGetMemoryUsage(MxPackedIntArrayRef array)
+{
+	if (array == NULL)
+		return 0;
+	
+	return sizeof(MxPackedIntArray)
+	       + array->blockCapacity * sizeof(MxPackedIntBlock)
+	       + array->dataCapacity * sizeof(uint32_t);
+}
+
+
+static void DecodeBlock(MxPackedIntArrayRef array, size_t block, uint32_t *output)
+{
+	MxPackedIntBlockRef header = array->blocks + block;
+	UnpackBlock(array->data + header->offset, header->bits, header->first, output);
+}
+
+
+// Delta-encode and pack the full tail as a new block
+static MxStatus PackTail(MxPackedIntArrayRef array)
+{
+	uint32_t deltas[BlockSize];
+	uint32_t widest = 0;
+	
+	deltas[0] = 0;
+	for (size_t ctr = 1; ctr < BlockSize; ++ctr)
+	{
+		deltas[ctr] = array->tail[ctr] - array->tail[ctr - 1];
+		widest |= deltas[ctr];
+	}
+	
+	uint32_t bits = BitsNeeded(widest);
+	size_t words = Lanes * bits;
+	
+	if (array->blockCount == array->blockCapacity)
+	{
+		size_t newCapacity = array->blockCapacity * MxPackedIntArrayExpansionFactor;
+		if (newCapacity < array->blockCount + 1)
+			newCapacity = array->blockCount + 1;
+		
+		MxPackedIntBlock *newBlocks = (MxPackedIntBlock *)realloc(array->blocks, newCapacity * sizeof(MxPackedIntBlock));
+		if (newBlocks == NULL)
+			return MxStatusNoMemory;
+		
+		array->blocks = newBlocks;
+		array->blockCapacity = newCapacity;
+	}
+	
+	if (array->dataCount + words > array->dataCapacity)
+	{
+		size_t newCapacity = array->dataCapacity * MxPackedIntArrayExpansionFactor;
+		if (newCapacity < array->dataCount + words)
+			newCapacity = array->dataCount + words;
+		
+		uint32_t *newData = (uint32_t *)realloc(array->data, newCapacity * sizeof(uint32_t));
+		if (newData == NULL)
+			return MxStatusNoMemory;
+		
+		array->data = newData;
+		array->dataCapacity = newCapacity;
+	}
+	
+	PackDeltas(deltas, bits, array->data + array->dataCount);
+	
+	MxPackedIntBlockRef header = array->blocks + array->blockCount;
+	header->first = array->tail[0];
+	header->last = array->tail[BlockSize - 1];
+	header->bits = bits;
+	header->offset = array->dataCount;
+	
+	array->dataCount += words;
+	array->blockCount += 1;
+	array->tailCount = 0;
+	
+	return MxStatusOK;
+}
@@ -0,0 +1,91 @@
+//
+//  MxPackedIntArray.h
+//  core_ds
+//
+//  A compressed, append-only sequence of sorted 32-bit unsigned integers
+//  (e.g. a posting list of document IDs).
+//
+//  Values are delta-encoded and bit-packed in blocks of 128, each block
+//  using just enough bits for its largest gap. The deltas are laid out in
+//  four interleaved lanes so a block can be unpacked and prefix-summed
+//  four values at a time with SSE2 (there is a scalar version for other
+//  CPUs). A skip entry per block records its first and last values and
+//  where its data starts, so random access, searches and intersections
+//  only decode the blocks they need.
+//
+//  The last, partly filled block is kept unpacked until it fills.
+//
+
+#ifndef core_ds_MxPackedIntArray_h
+#define core_ds_MxPackedIntArray_h
+
+#include <stdint.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+
+#define MxPackedIntArrayBlockSize (128)
+#define MxPackedIntArrayDefaultCapacity (16)
+#define MxPackedIntArrayExpansionFactor (2)
+
+typedef struct _MxPackedIntBlock {
+	uint32_t first;
+	uint32_t last;
+	
+	// Bits per delta, and where the block's 4 * bits words start in 'data'
+	uint32_t bits;
+	size_t offset;
+} MxPackedIntBlock, *MxPackedIntBlockRef;
+
+typedef struct _MxPackedIntArray {
+	size_t count;
+	
+	MxPackedIntBlock *blocks;
+	size_t blockCount;
+	size_t blockCapacity;
+	
+	uint32_t *data;
+	size_t dataCount;
+	size_t dataCapacity;
+	
+	// Values appended since the last full block
+	uint32_t tail[MxPackedIntArrayBlockSize];
+	size_t tailCount;
+} MxPackedIntArray, *MxPackedIntArrayRef;
+
+
+MxPackedIntArrayRef MxPackedIntArrayCreate(void);
+MxStatus MxPackedIntArrayInit(MxPackedIntArrayRef array);
+
+MxStatus MxPackedIntArrayWipe(MxPackedIntArrayRef array);
+MxStatus MxPackedIntArrayDelete(MxPackedIntArrayRef array);
+
+MxStatus MxPackedIntArrayClear(MxPackedIntArrayRef array);
+
+
+// Values must be appended in non-decreasing order
+// returns MxStatusIllegalArgument if 'value' is less than the last one
+MxStatus MxPackedIntArrayAppend(MxPackedIntArrayRef array, uint32_t value);
+
+MxStatus MxPackedIntArrayGet(MxPackedIntArrayRef array, size_t index, uint32_t *result);
+
+// Index of the first value not less than 'value' (the count if there is none)
+MxStatus MxPackedIntArrayLowerBound(MxPackedIntArrayRef array, uint32_t value, size_t *result);
+
+// Decode every value into 'output', which must have room for the count
+MxStatus MxPackedIntArrayDecode(MxPackedIntArrayRef array, uint32_t *output);
+
+// The callback is passed a pointer to each value (a const uint32_t *), in order
+MxStatus MxPackedIntArrayIterate(MxPackedIntArrayRef array, MxIteratorCallback callback, void *state);
+
+// Append the values in both 'a' and 'b' to 'result', which must be a different array.
+// Blocks of one that don't overlap the other's current range are skipped undecoded.
+MxStatus MxPackedIntArrayIntersect(MxPackedIntArrayRef a, MxPackedIntArrayRef b, MxPackedIntArrayRef result);
+
+
+size_t MxPackedIntArrayGetCount(MxPackedIntArrayRef array);
+
+// Bytes allocated for the array, including the struct itself
+size_t MxPackedIntArrayGetMemoryUsage(MxPackedIntArrayRef array);
+
+#endif
@@ -0,0 +1,1372 @@
+//
+//  MxRoaringBitmap.c
+//  core_ds
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxRoaringBitmap.h"
+
+
+#define High(value) ((uint16_t)((value) >> 16))
+#define Low(value) ((uint16_t)((value) & 0xffff))
+#define ContainerValues (65536)
+#define BitmapBytes (MxRoaringBitmapWords * sizeof(uint64_t))
+
+
+// -- Containers --------------------------------------------------------------
+
+
+static MxStatus InitArrayContainer(MxRoaringContainerRef container, uint16_t key, uint32_t capacity)
+{
+	container->data = malloc(capacity * sizeof(uint16_t));
+	if (container->data == NULL)
+		return MxStatusNoMemory;
+	
+	container->key = key;
+	container->type = MxRoaringArrayContainer;
+	container->cardinality = 0;
+	container->count = 0;
+	container->capacity = capacity;
+	
+	return MxStatusOK;
+}
+
+static void FreeContainer(MxRoaringContainerRef container)
+{
+	free(container->data);
+	container->data = NULL;
+}
+
+static MxStatus CopyContainer(MxRoaringContainerRef dest, MxRoaringContainerRef src)
+{
+	size_t bytes;
+	switch (src->type)
+	{
+		case MxRoaringArrayContainer: bytes = src->count * sizeof(uint16_t); break;
+		case MxRoaringBitmapContainer: bytes = BitmapBytes; break;
+		default: bytes = src->count * sizeof(MxRoaringRun); break;
+	}
+	
+	*dest = *src;
+	dest->capacity = src->count;
+	
+	// Never a zero-byte malloc, whose result may be NULL
+	if ((dest->data = malloc(bytes ? bytes : 1)) == NULL)
+		return MxStatusNoMemory;
+	
+	memcpy(dest->data, src->data, bytes);
+	
+	return MxStatusOK;
+}
+
+
+// Index of the first of 'count' sorted values >= 'value'
+static size_t LowerBound16(const uint16_t *values, size_t count, uint16_t value)
+{
+	size_t low = 0, high = count;
+	
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		if (values[mid] < value)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	
+	return low;
+}
+
+// Index of the last run starting at or before 'value', or -1
+static long FindRun(const MxRoaringRun *runs, size_t count, uint16_t value)
+{
+	size_t low = 0, high = count;
+	
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		if (runs[mid].start <= value)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	
+	return (long)low - 1;
+}
+
+
+static int ContainerContains(MxRoaringContainerRef container, uint16_t low)
+{
+	switch (container->type)
+	{
+		case MxRoaringArrayContainer:
+		{
+			const uint16_t *values = (const uint16_t *)container->data;
+			size_t idx = LowerBound16(values, container->count, low);
+			return idx < container->count && values[idx] == low;
+		}
+		
+		case MxRoaringBitmapContainer:
+			return (((const uint64_t *)container->data)[low >> 6] >> (low & 63)) & 1;
+		
+		default:
+		{
+			const MxRoaringRun *runs = (const MxRoaringRun *)container->data;
+			long idx = FindRun(runs, container->count, low);
+			return idx >= 0 && (uint32_t)(low - runs[idx].start) <= runs[idx].length;
+		}
+	}
+}
+
+
+// Set bits 'start' to 'end' inclusive
+static void SetRange(uint64_t *words, uint32_t start, uint32_t end)
+{
+	uint32_t firstWord = start >> 6, lastWord = end >> 6;
+	uint64_t firstMask = ~(uint64_t)0 << (start & 63);
+	uint64_t lastMask = ~(uint64_t)0 >> (63 - (end & 63));
+	
+	if (firstWord == lastWord)
+	{
+		words[firstWord] |= firstMask & lastMask;
+		return;
+	}
+	
+	words[firstWord] |= firstMask;
+	for (uint32_t word = firstWord + 1; word < lastWord; ++word)
+		words[word] = ~(uint64_t)0;
+	words[lastWord] |= lastMask;
+}
+
+// OR the container's values into a 65536-bit bitmap
+static void AddToWords(MxRoaringContainerRef container, uint64_t *words)
+{
+	switch (container->type)
+	{
+		case MxRoaringArrayContainer:
+		{
+			const uint16_t *values = (const uint16_t *)container->data;
+			for (uint32_t ctr = 0; ctr < container->count; ++ctr)
+				words[values[ctr] >> 6] |= (uint64_t)1 << (values[ctr] & 63);
+			break;
+		}
+		
+		case MxRoaringBitmapContainer:
+		{
+			const uint64_t *src = (const uint64_t *)container->data;
+			for (uint32_t ctr = 0; ctr < MxRoaringBitmapWords; ++ctr)
+				words[ctr] |= src[ctr];
+			break;
+		}
+		
+		default:
+		{
+			const MxRoaringRun *runs = (const MxRoaringRun *)container->data;
+			for (uint32_t ctr = 0; ctr < container->count; ++ctr)
+				SetRange(words, runs[ctr].start, (uint32_t)runs[ctr].start + runs[ctr].length);
+			break;
+		}
+	}
+}
+
+static uint32_t WordsCardinality(const uint64_t *words)
+{
+	uint32_t cardinality = 0;
+	for (uint32_t ctr = 0; ctr < MxRoaringBitmapWords; ++ctr)
+		cardinality += (uint32_t)__builtin_popcountll(words[ctr]);
+	
+	return cardinality;
+}
+
+// Replace the container's contents with the bits set in 'words' (which may be the
+// container's own data), as an array or bitmap depending on how many there are
+static MxStatus SetFromWords(MxRoaringContainerRef container, const uint64_t *words, uint32_t cardinality)
+{
+	void *data;
+	
+	if (cardinality <= MxRoaringArrayMaxCardinality)
+	{
+		uint16_t *values = (uint16_t *)malloc((cardinality ? cardinality : 1) * sizeof(uint16_t));
+		if (values == NULL)
+			return MxStatusNoMemory;
+		
+		uint32_t count = 0;
+		for (uint32_t word = 0; word < MxRoaringBitmapWords; ++word)
+		{
+			for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1)
+				values[count++] = (uint16_t)(word * 64 + (uint32_t)__builtin_ctzll(bits));
+		}
+		
+		container->type = MxRoaringArrayContainer;
+		container->count = count;
+		container->capacity = (cardinality ? cardinality : 1);
+		data = values;
+	}
+	else
+	{
+		if (words == container->data)
+		{
+			container->cardinality = cardinality;
+			return MxStatusOK;
+		}
+		
+		if ((data = malloc(BitmapBytes)) == NULL)
+			return MxStatusNoMemory;
+		
+		memcpy(data, words, BitmapBytes);
+		container->type = MxRoaringBitmapContainer;
+		container->count = 0;
+		container->capacity = 0;
+	}
+	
+	free(container->data);
+	container->data = data;
+	container->cardinality = cardinality;
+	
+	return MxStatusOK;
+}
+
+// Turn a run container back into an array or bitmap so it can be changed
+static MxStatus Unrun(MxRoaringContainerRef container)
+{
+	if (container->type != MxRoaringRunContainer)
+		return MxStatusOK;
+	
+	uint64_t *words = (uint64_t *)calloc(MxRoaringBitmapWords, sizeof(uint64_t));
+	if (words == NULL)
+		return MxStatusNoMemory;
+	
+	AddToWords(container, words);
+	MxStatus status = SetFromWords(container, words, container->cardinality);
+	free(words);
+	
+	return status;
+}
+
+
+// *added is set to 0 if the value was already there
+static MxStatus ContainerAdd(MxRoaringContainerRef container, uint16_t low, int *added)
+{
+	MxStatus status = Unrun(container);
+	MxStatusCheck(status);
+	
+	*added = 0;
+	
+	if (container->type == MxRoaringBitmapContainer)
+	{
+		uint64_t *words = (uint64_t *)container->data;
+		uint64_t mask = (uint64_t)1 << (low & 63);
+		
+		if ((words[low >> 6] & mask) == 0)
+		{
+			words[low >> 6] |= mask;
+			container->cardinality += 1;
+			*added = 1;
+		}
+		
+		return MxStatusOK;
+	}
+	
+	uint16_t *values = (uint16_t *)container->data;
+	size_t idx = LowerBound16(values, container->count, low);
+	if (idx < container->count && values[idx] == low)
+		return MxStatusOK;
+	
+	if (container->count == MxRoaringArrayMaxCardinality)
+	{
+		// Full - from here on a bitmap is smaller
+		uint64_t *words = (uint64_t *)calloc(MxRoaringBitmapWords, sizeof(uint64_t));
+		if (words == NULL)
+			return MxStatusNoMemory;
+		
+		AddToWords(container, words);
+		words[low >> 6] |= (uint64_t)1 << (low & 63);
+		
+		free(container->data);
+		container->data = words;
+		container->type = MxRoaringBitmapContainer;
+		container->count = 0;
+		container->capacity = 0;
+		container->cardinality += 1;
+		*added = 1;
+		
+		return MxStatusOK;
+	}
+	
+	if (container->count == container->capacity)
+	{
+		uint32_t newCapacity = container->capacity * 2;
+		if (newCapacity > MxRoaringArrayMaxCardinality)
+			newCapacity = MxRoaringArrayMaxCardinality;
+		
+		uint16_t *newValues = (uint16_t *)realloc(values, newCapacity * sizeof(uint16_t));
+		if (newValues == NULL)
+			return MxStatusNoMemory;
+		
+		container->data = values = newValues;
+		container->capacity = newCapacity;
+	}
+	
+	memmove(values + idx + 1, values + idx, (container->count - idx) * sizeof(uint16_t));
+	values[idx] = low;
+	container->count += 1;
+	container->cardinality += 1;
+	*added = 1;
+	
+	return MxStatusOK;
+}
+
+
+// *removed is set to 0 if the value wasn't there
+static MxStatus ContainerRemove(MxRoaringContainerRef container, uint16_t low, int *removed)
+{
+	*removed = 0;
+	if (!ContainerContains(container, low))
+		return MxStatusOK;
+	
+	MxStatus status = Unrun(container);
+	MxStatusCheck(status);
+	
+	if (container->type == MxRoaringBitmapContainer)
+	{
+		uint64_t *words = (uint64_t *)container->data;
+		words[low >> 6] &= ~((uint64_t)1 << (low & 63));
+		*removed = 1;
+		
+		// Back down to where an array is smaller
+		if (container->cardinality - 1 <= MxRoaringArrayMaxCardinality)
+			return SetFromWords(container, words, container->cardinality - 1);
+		
+		container->cardinality -= 1;
+		return MxStatusOK;
+	}
+	
+	uint16_t *values = (uint16_t *)container->data;
+	size_t idx = LowerBound16(values, container->count, low);
+	
+	memmove(values + idx, values + idx + 1, (container->count - idx - 1) * sizeof(uint16_t));
+	container->count -= 1;
+	container->cardinality -= 1;
+	*removed = 1;
+	
+	return MxStatusOK;
+}
+
+
+// The number of values in the container <= 'low'
+static uint32_t ContainerRank(MxRoaringContainerRef container, uint16_t low)
+{
+	switch (container->type)
+	{
+		case MxRoaringArrayContainer:
+		{
+			const uint16_t *values = (const uint16_t *)container->data;
+			size_t idx = LowerBound16(values, container->count, low);
+			if (idx < container->count && values[idx] == low)
+				idx += 1;
+			return (uint32_t)idx;
+		}
+		
+		case MxRoaringBitmapContainer:
+		{
+			const uint64_t *words = (const uint64_t *)container->data;
+			uint32_t rank = 0;
+			for (uint32_t word = 0; word < (uint32_t)(low >> 6); ++word)
+				rank += (uint32_t)__builtin_popcountll(words[word]);
+			
+			uint64_t upTo = ~(uint64_t)0 >> (63 - (low & 63));
+			return rank + (uint32_t)__builtin_popcountll(words[low >> 6] & upTo);
+		}
+		
+		default:
+		{
+			const MxRoaringRun *runs = (const MxRoaringRun *)container->data;
+			uint32_t rank = 0;
+			for (uint32_t ctr = 0; ctr < container->count && runs[ctr].start <= low; ++ctr)
+			{
+				uint32_t end = (uint32_t)runs[ctr].start + runs[ctr].length;
+				rank += ((end < low) ? end : low) - runs[ctr].start + 1;
+			}
+			return rank;
+		}
+	}
+}
+
+
+static MxStatus ContainerIterate(MxRoaringContainerRef container, MxIteratorCallback callback, void *state)
+{
+	uint32_t high = (uint32_t)container->key << 16;
+	uint32_t value;
+	MxStatus result = MxStatusOK;
+	
+	switch (container->type)
+	{
+		case MxRoaringArrayContainer:
+		{
+			const uint16_t *values = (const uint16_t *)container->data;
+			for (uint32_t ctr = 0; ctr < container->count; ++ctr)
+			{
+				value = high | values[ctr];
+				if ((result = callback(&value, state)) != MxStatusOK)
+					return result;
+			}
+			break;
+		}
+		
+		case MxRoaringBitmapContainer:
+		{
+			const uint64_t *words = (const uint64_t *)container->data;
+			for (uint32_t word = 0; word < MxRoaringBitmapWords; ++word)
+			{
+				for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1)
+				{
+					value = high | (word * 64 + (uint32_t)__builtin_ctzll(bits));
+					if ((result = callback(&value, state)) != MxStatusOK)
+						return result;
+				}
+			}
+			break;
+		}
+		
+		default:
+		{
+			const MxRoaringRun *runs = (const MxRoaringRun *)container->data;
+			for (uint32_t ctr = 0; ctr < container->count; ++ctr)
+			{
+				uint32_t end = (uint32_t)runs[ctr].start + runs[ctr].length;
+				for (uint32_t low = runs[ctr].start; low <= end; ++low)
+				{
+					value = high | low;
+					if ((result = callback(&value, state)) != MxStatusOK)
+						return result;
+				}
+			}
+			break;
+		}
+	}
+	
+	return result;
+}
+
+
+// container = container | other
+static MxStatus ContainerOr(MxRoaringContainerRef container, MxRoaringContainerRef other)
+{
+	if (container->type == MxRoaringArrayContainer && other->type == MxRoaringArrayContainer &&
+	    container->count + other->count <= MxRoaringArrayMaxCardinality)
+	{
+		const uint16_t *a = (const uint16_t *)container->data, *b = (const uint16_t *)other->data;
+		uint32_t na = container->count, nb = other->count;
+		
+		uint16_t *merged = (uint16_t *)malloc((na + nb) * sizeof(uint16_t));
+		if (merged == NULL)
+			return MxStatusNoMemory;
+		
+		uint32_t i = 0, j = 0, count = 0;
+		while (i < na && j < nb)
+		{
+			uint16_t va = a[i], vb = b[j];
+			merged[count++] = (va < vb) ? va : vb;
+			i += (va <= vb);
+			j += (vb <= va);
+		}
+		while (i < na)
+			merged[count++] = a[i++];
+		while (j < nb)
+			merged[count++] = b[j++];
+		
+		free(container->data);
+		container->data = merged;
+		container->count = container->cardinality = count;
+		container->capacity = na + nb;
+		
+		return MxStatusOK;
+	}
+	
+	MxStatus status = Unrun(container);
+	MxStatusCheck(status);
+	
+	if (container->type == MxRoaringBitmapContainer)
+	{
+		AddToWords(other, (uint64_t *)container->data);
+		container->cardinality = WordsCardinality((const uint64_t *)container->data);
+		return MxStatusOK;
+	}
+	
+	uint64_t *words = (uint64_t *)calloc(MxRoaringBitmapWords, sizeof(uint64_t));
+	if (words == NULL)
+		return MxStatusNoMemory;
+	
+	AddToWords(container, words);
+	AddToWords(other, words);
+	status = SetFromWords(container, words, WordsCardinality(words));
+	free(words);
+	
+	return status;
+}
+
+
+// container = container & other
+static MxStatus ContainerAnd(MxRoaringContainerRef container, MxRoaringContainerRef other)
+{
+	if (container->type == MxRoaringArrayContainer)
+	{
+		// Filter in place
+		uint16_t *values = (uint16_t *)container->data;
+		uint32_t count = 0;
+		
+		for (uint32_t ctr = 0; ctr < container->count; ++ctr)
+		{
+			values[count] = values[ctr];
+			count += (uint32_t)ContainerContains(other, values[ctr]);
+		}
+		
+		container->count = container->cardinality = count;
+		return MxStatusOK;
+	}
+	
+	if (other->type == MxRoaringArrayContainer)
+	{
+		const uint16_t *theirs = (const uint16_t *)other->data;
+		uint16_t *values = (uint16_t *)malloc((other->count ? other->count : 1) * sizeof(uint16_t));
+		if (values == NULL)
+			return MxStatusNoMemory;
+		
+		uint32_t count = 0;
+		for (uint32_t ctr = 0; ctr < other->count; ++ctr)
+		{
+			values[count] = theirs[ctr];
+			count += (uint32_t)ContainerContains(container, theirs[ctr]);
+		}
+		
+		free(container->data);
+		container->data = values;
+		container->type = MxRoaringArrayContainer;
+		container->count = container->cardinality = count;
+		container->capacity = (other->count ? other->count : 1);
+		
+		return MxStatusOK;
+	}
+	
+	// Both bitmaps or runs. A run container of ours may come back as an array,
+	// which the filter above handles.
+	MxStatus status = Unrun(container);
+	MxStatusCheck(status);
+	
+	if (container->type == MxRoaringArrayContainer)
+		return ContainerAnd(container, other);
+	
+	// AND into our own words - only a run needs expanding into scratch space
+	uint64_t *mine = (uint64_t *)container->data;
+	const uint64_t *theirs = (const uint64_t *)other->data;
+	uint64_t *scratch = NULL;
+	
+	if (other->type == MxRoaringRunContainer)
+	{
+		if ((scratch = (uint64_t *)calloc(MxRoaringBitmapWords, sizeof(uint64_t))) == NULL)
+			return MxStatusNoMemory;
+		
+		AddToWords(other, scratch);
+		theirs = scratch;
+	}
+	
+	for (uint32_t ctr = 0; ctr < MxRoaringBitmapWords; ++ctr)
+		mine[ctr] &= theirs[ctr];
+	
+	free(scratch);
+	
+	return SetFromWords(container, mine, WordsCardinality(mine));
+}
+
+
+// Index of the first bit at or after 'from' that equals 'set', or ContainerValues
+static uint32_t NextBit(const uint64_t *words, uint32_t from, int set)
+{
+	while (from < ContainerValues)
+	{
+		uint64_t word = set ? words[from >> 6] : ~words[from >> 6];
+		word &= ~(uint64_t)0 << (from & 63);
+		
+		if (word != 0)
+			return (from & ~63u) + (uint32_t)__builtin_ctzll(word);
+		
+		from = (from & ~63u) + 64;
+	}
+	
+	return ContainerValues;
+}
+
+static MxStatus ContainerRunOptimize(MxRoaringContainerRef container)
+{
+	if (container->type == MxRoaringRunContainer)
+		return MxStatusOK;
+	
+	uint64_t *words = (uint64_t *)calloc(MxRoaringBitmapWords, sizeof(uint64_t));
+	if (words == NULL)
+		return MxStatusNoMemory;
+	
+	AddToWords(container, words);
+	
+	// A run starts at each set bit whose lower neighbour is clear
+	uint32_t runCount = 0;
+	uint64_t carry = 0;
+	for (uint32_t ctr = 0; ctr < MxRoaringBitmapWords; ++ctr)
+	{
+		runCount += (uint32_t)__builtin_popcountll(words[ctr] & ~((words[ctr] << 1) | carry));
+		carry = words[ctr] >> 63;
+	}
+	
+	size_t currentBytes = (container->type == MxRoaringArrayContainer) ? container->count * sizeof(uint16_t) : BitmapBytes;
+	MxStatus status = MxStatusOK;
+	
+	if (runCount * sizeof(MxRoaringRun) < currentBytes)
+	{
+		MxRoaringRun *runs = (MxRoaringRun *)malloc(runCount * sizeof(MxRoaringRun));
+		if (runs == NULL)
+		{
+			status = MxStatusNoMemory;
+		}
+		else
+		{
+			uint32_t count = 0;
+			for (uint32_t start = NextBit(words, 0, 1); start < ContainerValues; start = NextBit(words, start, 1))
+			{
+				uint32_t end = NextBit(words, start, 0);
+				runs[count].start = (uint16_t)start;
+				runs[count].length = (uint16_t)(end - start - 1);
+				count += 1;
+				start = end;
+			}
+			
+			free(container->data);
+			container->data = runs;
+			container->type = MxRoaringRunContainer;
+			container->count = container->capacity = count;
+		}
+	}
+	
+	free(words);
+	
+	return status;
+}
+
+
+// -- Bitmaps -----------------------------------------------------------------
+
+
+// Returns 1 and the container's index if 'key' has a container, otherwise 0 and
+// the index it would be inserted at
+static int FindContainer(MxRoaringBitmapRef bitmap, uint16_t key, size_t *index)
+{
+	size_t low = 0, high = bitmap->count;
+	
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		if (bitmap->containers[mid].key < key)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	
+	*index = low;
+	
+	return low < bitmap->count && bitmap->containers[low].key == key;
+}
+
+static MxStatus ExpandIfNeeded(MxRoaringBitmapRef bitmap, size_t needed)
+{
+	if (needed <= bitmap->capacity)
+		return MxStatusOK;
+	
+	size_t newCapacity = bitmap->capacity * 2;
+	if (newCapacity < needed)
+		newCapacity = needed;
+	
+	MxRoaringContainer *newContainers = (MxRoaringContainer *)realloc(bitmap->containers, newCapacity * sizeof(MxRoaringContainer));
+	if (newContainers == NULL)
+		return MxStatusNoMemory;
+	
+	bitmap->containers = newContainers;
+	bitmap->capacity = newCapacity;
+	
+	return MxStatusOK;
+}
+
+static void RemoveContainerAt(MxRoaringBitmapRef bitmap, size_t index)
+{
+	FreeContainer(bitmap->containers + index);
+	memmove(bitmap->containers + index, bitmap->containers + index + 1, (bitmap->count - index - 1) * sizeof(MxRoaringContainer));
+	bitmap->count -= 1;
+}
+
+
+MxRoaringBitmapRef MxRoaringBitmapCreate(void)
+{
+	MxRoaringBitmapRef bitmap = (MxRoaringBitmapRef)malloc(sizeof(MxRoaringBitmap));
+	if (bitmap != NULL)
+	{
+		if (MxRoaringBitmapInit(bitmap) != MxStatusOK)
+		{
+			free(bitmap);
+			bitmap = NULL;
+		}
+	}
+	
+	return bitmap;
+}
+
+
+MxStatus MxRoaringBitmapInit(MxRoaringBitmapRef bitmap)
+{
+	if (bitmap == NULL)
+		return MxStatusNullArgument;
+	
+	bitmap->containers = (MxRoaringContainer *)malloc(MxRoaringDefaultCapacity * sizeof(MxRoaringContainer));
+	if (bitmap->containers == NULL)
+		return MxStatusNoMemory;
+	
+	bitmap->count = 0;
+	bitmap->capacity = MxRoaringDefaultCapacity;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxRoaringBitmapWipe(MxRoaringBitmapRef bitmap)
+{
+	MxStatus status = MxRoaringBitmapClear(bitmap);
+	MxStatusCheck(status);
+	
+	free(bitmap->containers);
+	bitmap->containers = NULL;
+	bitmap->capacity = 0;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxRoaringBitmapDelete(MxRoaringBitmapRef bitmap)
+{
+	MxStatus status = MxRoaringBitmapWipe(bitmap);
+	if (status == MxStatusOK)
+		free(bitmap);
+	
+	return status;
+}
+
+
+MxStatus MxRoaringBitmapClear(MxRoaringBitmapRef bitmap)
+{
+	if (bitmap == NULL)
+		return MxStatusNullArgument;
+	
+	for (size_t ctr = 0; ctr < bitmap->count; ++ctr)
+		FreeContainer(bitmap->containers + ctr);
+	
+	bitmap->count = 0;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxRoaringBitmapAdd(MxRoaringBitmapRef bitmap, uint32_t value)
+{
+	if (bitmap == NULL)
+		return MxStatusNullArgument;
+	
+	size_t index;
+	if (!FindContainer(bitmap, High(value), &index))
+	{
+		MxStatus status = ExpandIfNeeded(bitmap, bitmap->count + 1);
+		MxStatusCheck(status);
+		
+		MxRoaringContainer container;
+		if ((status = InitArrayContainer(&container, High(value), MxRoaringDefaultCapacity)) != MxStatusOK)
+			return status;
+		
+		memmove(bitmap->containers + index + 1, bitmap->containers + index, (bitmap->count - index) * sizeof(MxRoaringContainer));
+		bitmap->containers[index] = container;
+		bitmap->count += 1;
+	}
+	
+	int added;
+	return ContainerAdd(bitmap->containers + index, Low(value), &added);
+}
+
+
+MxStatus MxRoaringBitmapRemove(MxRoaringBitmapRef bitmap, uint32_t value)
+{
+	if (bitmap == NULL)
+		return MxStatusNullArgument;
+	
+	size_t index;
+	if (!FindContainer(bitmap, High(value), &index))
+		return MxStatusNotFound;
+	
+	int removed;
+	MxStatus status = ContainerRemove(bitmap->containers + index, Low(value), &removed);
+	MxStatusCheck(status);
+	
+	if (!removed)
+		return MxStatusNotFound;
+	
+	if (bitmap->containers[index].cardinality == 0)
+		RemoveContainerAt(bitmap, index);
+	
+	return MxStatusOK;
+}
+
+
+int MxRoaringBitmapContains(MxRoaringBitmapRef bitmap, uint32_t value)
+{
+	if (bitmap == NULL)
+		return MxStatusFalse;
+	
+	size_t index;
+	if (!FindContainer(bitmap, High(value), &index))
+		return MxStatusFalse;
+	
+	return ContainerContains(bitmap->containers + index, Low(value)) ? MxStatusTrue : MxStatusFalse;
+}
+
+
+uint64_t MxRoaringBitmapGetCardinality(MxRoaringBitmapRef bitmap)
+{
+	if (bitmap == NULL)
+		return 0;
+	
+	uint64_t cardinality = 0;
+	for (size_t ctr = 0; ctr < bitmap->count; ++ctr)
+		cardinality += bitmap->containers[ctr].cardinality;
+	
+	return cardinality;
+}
+
+
+uint64_t MxRoaringBitmapRank(MxRoaringBitmapRef bitmap, uint32_t value)
+{
+	if (bitmap == NULL)
+		return 0;
+	
+	uint64_t rank = 0;
+	for (size_t ctr = 0; ctr < bitmap->count && bitmap->containers[ctr].key <= High(value); ++ctr)
+	{
+		MxRoaringContainerRef container = bitmap->containers + ctr;
+		
+		if (container->key < High(value))
+			rank += container->cardinality;
+		else
+			rank += ContainerRank(container, Low(value));
+	}
+	
+	return rank;
+}
+
+
+MxStatus MxRoaringBitmapIterate(MxRoaringBitmapRef bitmap, MxIteratorCallback callback, void *state)
+{
+	if (bitmap == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = MxStatusOK;
+	for (size_t ctr = 0; ctr < bitmap->count; ++ctr)
+		if ((result = ContainerIterate(bitmap->containers + ctr, callback, state)) != MxStatusOK)
+			break;
+	
+	return result;
+}
+
+
+// If memory runs out part way, 'bitmap' is left holding part of the union
+MxStatus MxRoaringBitmapOr(MxRoaringBitmapRef bitmap, MxRoaringBitmapRef other)
+{
+	if (bitmap == NULL || other == NULL)
+		return MxStatusNullArgument;
+	
+	if (bitmap == other)
+		return MxStatusOK;
+	
+	// Merge the two sorted key lists into a new container array
+	size_t capacity = bitmap->count + other->count;
+	MxRoaringContainer *merged = (MxRoaringContainer *)malloc((capacity ? capacity : 1) * sizeof(MxRoaringContainer));
+	if (merged == NULL)
+		return MxStatusNoMemory;
+	
+	MxStatus status = MxStatusOK;
+	size_t i = 0, j = 0, count = 0;
+	
+	while (i < bitmap->count)
+	{
+		MxRoaringContainerRef mine = bitmap->containers + i;
+		
+		if (status == MxStatusOK && j < other->count && other->containers[j].key < mine->key)
+		{
+			if ((status = CopyContainer(merged + count, other->containers + j)) == MxStatusOK)
+				count += 1;
+			j += 1;
+			continue;
+		}
+		
+		if (status == MxStatusOK && j < other->count && other->containers[j].key == mine->key)
+		{
+			status = ContainerOr(mine, other->containers + j);
+			j += 1;
+		}
+		
+		// Always carried over, even after a failure, so nothing is lost
+		merged[count++] = *mine;
+		i += 1;
+	}
+	
+	for (; status == MxStatusOK && j < other->count; ++j)
+	{
+		if ((status = CopyContainer(merged + count, other->containers + j)) == MxStatusOK)
+			count += 1;
+	}
+	
+	free(bitmap->containers);
+	bitmap->containers = merged;
+	bitmap->count = count;
+	bitmap->capacity = capacity ? capacity : 1;
+	
+	return status;
+}
+
+
+// If memory runs out part way, 'bitmap' is left holding part of the intersection
+MxStatus MxRoaringBitmapAnd(MxRoaringBitmapRef bitmap, MxRoaringBitmapRef other)
+{
+	if (bitmap == NULL || other == NULL)
+		return MxStatusNullArgument;
+	
+	if (bitmap == other)
+		return MxStatusOK;
+	
+	MxStatus status = MxStatusOK;
+	size_t j = 0, count = 0;
+	
+	for (size_t i = 0; i < bitmap->count; ++i)
+	{
+		MxRoaringContainerRef mine = bitmap->containers + i;
+		
+		if (status == MxStatusOK)
+		{
+			while (j < other->count && other->containers[j].key < mine->key)
+				j += 1;
+			
+			if (j == other->count || other->containers[j].key != mine->key)
+			{
+				FreeContainer(mine);
+				continue;
+			}
+			
+			status = ContainerAnd(mine, other->containers + j);
+			
+			if (status == MxStatusOK && mine->cardinality == 0)
+			{
+				FreeContainer(mine);
+				continue;
+			}
+		}
+		
+		bitmap->containers[count++] = *mine;
+	}
+	
+	bitmap->count = count;
+	
+	return status;
+}
+
+
+MxStatus MxRoaringBitmapRunOptimize(MxRoaringBitmapRef bitmap)
+{
+	if (bitmap == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus status = MxStatusOK;
+	for (size_t ctr = 0; ctr < bitmap->count; ++ctr)
+		if ((status = ContainerRunOptimize(bitmap->containers + ctr)) != MxStatusOK)
+			break;
+	
+	return status;
+}
+
+
+// -- Serialization -----------------------------------------------------------
+//
+// All integers are little-endian:
+//
+//   header       "MXRB", uint32 version, uint32 container count, uint32 reserved
+//   descriptors  one per container, in key order:
+//                uint16 key, uint8 type, uint8 reserved,
+//                uint32 cardinality, uint32 element count, uint32 data offset
+//   data         per container, at an 8-byte aligned offset from the start:
+//                arrays  - uint16 values
+//                bitmaps - 1024 uint64 words, value v is bit v % 64 of word v / 64
+//                runs    - uint16 start, uint16 length pairs
+//
+
+
+#define SerialMagic "MXRB"
+#define SerialVersion (1)
+#define HeaderBytes (16)
+#define DescriptorBytes (16)
+
+static inline uint16_t Read16(const unsigned char *p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t Read32(const unsigned char *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void Write16(unsigned char *p, uint16_t value)
+{
+	p[0] = (unsigned char)value;
+	p[1] = (unsigned char)(value >> 8);
+}
+
+static inline void Write32(unsigned char *p, uint32_t value)
+{
+	for (int ctr = 0; ctr < 4; ++ctr)
+		p[ctr] = (unsigned char)(value >> (8 * ctr));
+}
+
+static size_t ElementBytes(uint8_t type, uint32_t elements)
+{
+	switch (type)
+	{
+		case MxRoaringArrayContainer: return elements * sizeof(uint16_t);
+		case MxRoaringBitmapContainer: return BitmapBytes;
+		default: return elements * 2 * sizeof(uint16_t);
+	}
+}
+
+static inline size_t Align8(size_t offset)
+{
+	return (offset + 7) & ~(size_t)7;
+}
+
+// Check a container's data holds what its descriptor says: arrays strictly increasing,
+// runs sorted, apart and inside the container, and the cardinality matching the data
+static int ValidContainerData(uint8_t type, uint32_t cardinality, uint32_t elements, const unsigned char *data)
+{
+	uint32_t counted = 0;
+	
+	switch (type)
+	{
+		case MxRoaringArrayContainer:
+		{
+			if (elements > MxRoaringArrayMaxCardinality)
+				return 0;
+			
+			for (uint32_t idx = 1; idx < elements; ++idx)
+				if (Read16(data + idx * 2) <= Read16(data + (idx - 1) * 2))
+					return 0;
+			
+			counted = elements;
+			break;
+		}
+		
+		case MxRoaringBitmapContainer:
+		{
+			for (uint32_t idx = 0; idx < MxRoaringBitmapWords * 2; ++idx)
+				counted += (uint32_t)__builtin_popcount(Read32(data + idx * 4));
+			break;
+		}
+		
+		default:
+		{
+			// Where the next run may start
+			uint32_t next = 0;
+			for (uint32_t idx = 0; idx < elements; ++idx)
+			{
+				uint32_t start = Read16(data + idx * 4), length = Read16(data + idx * 4 + 2);
+				if (start < next || start + length > 0xffff)
+					return 0;
+				
+				counted += length + 1;
+				next = start + length + 1;
+			}
+			break;
+		}
+	}
+	
+	return counted == cardinality;
+}
+
+
+size_t MxRoaringBitmapGetSerializedSize(MxRoaringBitmapRef bitmap)
+{
+	if (bitmap == NULL)
+		return 0;
+	
+	size_t size = HeaderBytes + bitmap->count * DescriptorBytes;
+	for (size_t ctr = 0; ctr < bitmap->count; ++ctr)
+	{
+		MxRoaringContainerRef container = bitmap->containers + ctr;
+		size = Align8(size) + ElementBytes(container->type, container->count);
+	}
+	
+	return size;
+}
+
+
+MxStatus MxRoaringBitmapSerialize(MxRoaringBitmapRef bitmap, void *buffer, size_t size)
+{
+	if (bitmap == NULL || buffer == NULL)
+		return MxStatusNullArgument;
+	
+	if (size < MxRoaringBitmapGetSerializedSize(bitmap))
+		return MxStatusIllegalArgument;
+	
+	unsigned char *out = (unsigned char *)buffer;
+	
+	memcpy(out, SerialMagic, 4);
+	Write32(out + 4, SerialVersion);
+	Write32(out + 8, (uint32_t)bitmap->count);
+	Write32(out + 12, 0);
+	
+	size_t offset = HeaderBytes + bitmap->count * DescriptorBytes;
+	
+	for (size_t ctr = 0; ctr < bitmap->count; ++ctr)
+	{
+		MxRoaringContainerRef container = bitmap->containers + ctr;
+		unsigned char *descriptor = out + HeaderBytes + ctr * DescriptorBytes;
+		
+		// Zero the alignment padding so equal bitmaps serialize identically
+		size_t aligned = Align8(offset);
+		memset(out + offset, 0, aligned - offset);
+		offset = aligned;
+		
+		Write16(descriptor, container->key);
+		descriptor[2] = container->type;
+		descriptor[3] = 0;
+		Write32(descriptor + 4, container->cardinality);
+		Write32(descriptor + 8, container->count);
+		Write32(descriptor + 12, (uint32_t)offset);
+		
+		unsigned char *data = out + offset;
+		
+		if (container->type == MxRoaringArrayContainer)
+		{
+			const uint16_t *values = (const uint16_t *)container->data;
+			for (uint32_t idx = 0; idx < container->count; ++idx)
+				Write16(data + idx * 2, values[idx]);
+		}
+		else if (container->type == MxRoaringBitmapContainer)
+		{
+			const uint64_t *words = (const uint64_t *)container->data;
+			for (uint32_t idx = 0; idx < MxRoaringBitmapWords; ++idx)
+			{
+				Write32(data + idx * 8, (uint32_t)words[idx]);
+				Write32(data + idx * 8 + 4, (uint32_t)(words[idx] >> 32));
+			}
+		}
+		else
+		{
+			const MxRoaringRun *runs = (const MxRoaringRun *)container->data;
+			for (uint32_t idx = 0; idx < container->count; ++idx)
+			{
+				Write16(data + idx * 4, runs[idx].start);
+				Write16(data + idx * 4 + 2, runs[idx].length);
+			}
+		}
+		
+		offset += ElementBytes(container->type, container->count);
+	}
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxRoaringBitmapViewInit(MxRoaringBitmapViewRef view, const void *buffer, size_t size)
+{
+	if (view == NULL || buffer == NULL)
+		return MxStatusNullArgument;
+	
+	const unsigned char *in = (const unsigned char *)buffer;
+	
+	if (size < HeaderBytes || memcmp(in, SerialMagic, 4) != 0 || Read32(in + 4) != SerialVersion)
+		return MxStatusIllegalArgument;
+	
+	size_t count = Read32(in + 8);
+	if (count > ContainerValues || HeaderBytes + count * DescriptorBytes > size)
+		return MxStatusIllegalArgument;
+	
+	// Check everything up front so queries need no bounds checks
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		const unsigned char *descriptor = in + HeaderBytes + ctr * DescriptorBytes;
+		uint8_t type = descriptor[2];
+		uint32_t cardinality = Read32(descriptor + 4);
+		uint32_t elements = Read32(descriptor + 8);
+		size_t offset = Read32(descriptor + 12);
+		
+		if (type < MxRoaringArrayContainer || type > MxRoaringRunContainer)
+			return MxStatusIllegalArgument;
+		
+		if (cardinality == 0 || cardinality > ContainerValues || elements > ContainerValues)
+			return MxStatusIllegalArgument;
+		
+		if (type == MxRoaringArrayContainer && elements != cardinality)
+			return MxStatusIllegalArgument;
+		
+		if (offset > size || ElementBytes(type, elements) > size - offset)
+			return MxStatusIllegalArgument;
+		
+		if (!ValidContainerData(type, cardinality, elements, in + offset))
+			return MxStatusIllegalArgument;
+		
+		if (ctr > 0 && Read16(descriptor) <= Read16(descriptor - DescriptorBytes))
+			return MxStatusIllegalArgument;
+	}
+	
+	view->buffer = in;
+	view->size = size;
+	view->containerCount = count;
+	
+	return MxStatusOK;
+}
+
+
+int MxRoaringBitmapViewContains(MxRoaringBitmapViewRef view, uint32_t value)
+{
+	if (view == NULL)
+		return MxStatusFalse;
+	
+	const unsigned char *descriptors = view->buffer + HeaderBytes;
+	size_t lowIdx = 0, highIdx = view->containerCount;
+	
+	while (lowIdx < highIdx)
+	{
+		size_t mid = lowIdx + (highIdx - lowIdx) / 2;
+		if (Read16(descriptors + mid * DescriptorBytes) < High(value))
+			lowIdx = mid + 1;
+		else
+			highIdx = mid;
+	}
+	
+	if (lowIdx == view->containerCount || Read16(descriptors + lowIdx * DescriptorBytes) != High(value))
+		return MxStatusFalse;
+	
+	const unsigned char *descriptor = descriptors + lowIdx * DescriptorBytes;
+	const unsigned char *data = view->buffer + Read32(descriptor + 12);
+	uint32_t elements = Read32(descriptor + 8);
+	uint16_t low = Low(value);
+	
+	switch (descriptor[2])
+	{
+		case MxRoaringArrayContainer:
+		{
+			uint32_t first = 0, last = elements;
+			while (first < last)
+			{
+				uint32_t mid = first + (last - first) / 2;
+				if (Read16(data + mid * 2) < low)
+					first = mid + 1;
+				else
+					last = mid;
+			}
+			return (first < elements && Read16(data + first * 2) == low) ? MxStatusTrue : MxStatusFalse;
+		}
+		
+		case MxRoaringBitmapContainer:
+			// Little-endian words put value v in bit v % 8 of byte v / 8
+			return ((data[low >> 3] >> (low & 7)) & 1) ? MxStatusTrue : MxStatusFalse;
+		
+		default:
+		{
+			uint32_t first = 0, last = elements;
+			while (first < last)
+			{
+				uint32_t mid = first + (last - first) / 2;
+				if (Read16(data + mid * 4) <= low)
+					first = mid + 1;
+				else
+					last = mid;
+			}
+			if (first == 0)
+				return MxStatusFalse;
+			
+			const unsigned char *run = data + (first - 1) * 4;
+			return ((uint32_t)(low - Read16(run)) <= Read16(run + 2)) ? MxStatusTrue : MxStatusFalse;
+		}
+	}
+}
+
+
+uint64_t MxRoaringBitmapViewGetCardinality(MxRoaringBitmapViewRef view)
+{
+	if (view == NULL)
+		return 0;
+	
+	uint64_t cardinality = 0;
+	for (size_t ctr = 0; ctr < view->containerCount; ++ctr)
+		cardinality += Read32(view->buffer + HeaderBytes + ctr * DescriptorBytes + 4);
+	
+	return cardinality;
+}
+
+
+MxStatus MxRoaringBitmapDeserialize(MxRoaringBitmapRef bitmap, const void *buffer, size_t size)
+{
+	if (bitmap == NULL || buffer == NULL)
+		return MxStatusNullArgument;
+	
+	MxRoaringBitmapView view;
+	MxStatus status = MxRoaringBitmapViewInit(&view, buffer, size);
+	MxStatusCheck(status);
+	
+	if ((status = MxRoaringBitmapClear(bitmap)) != MxStatusOK)
+		return status;
+	
+	if ((status = ExpandIfNeeded(bitmap, view.containerCount)) != MxStatusOK)
+		return status;
+	
+	for (size_t ctr = 0; ctr < view.containerCount; ++ctr)
+	{
+		const unsigned char *descriptor = view.buffer + HeaderBytes + ctr * DescriptorBytes;
+		const unsigned char *data = view.buffer + Read32(descriptor + 12);
+		MxRoaringContainerRef container = bitmap->containers + ctr;
+		
+		container->key = Read16(descriptor);
+		container->type = descriptor[2];
+		container->cardinality = Read32(descriptor + 4);
+		container->count = container->capacity = Read32(descriptor + 8);
+		
+		size_t bytes = ElementBytes(container->type, container->count);
+		if ((container->data = malloc(bytes ? bytes : 1)) == NULL)
+		{
+			bitmap->count = ctr;
+			MxRoaringBitmapClear(bitmap);
+			return MxStatusNoMemory;
+		}
+		
+		if (container->type == MxRoaringBitmapContainer)
+		{
+			uint64_t *words = (uint64_t *)container->data;
+			for (uint32_t idx = 0; idx < MxRoaringBitmapWords; ++idx)
+				words[idx] = (uint64_t)Read32(data + idx * 8) | ((uint64_t)Read32(data + idx * 8 + 4) << 32);
+		}
+		else
+		{
+			// Arrays and runs are both just uint16s
+			uint16_t *values = (uint16_t *)container->data;
+			for (size_t idx = 0; idx < bytes / 2; ++idx)
+				values[idx] = Read16(data + idx * 2);
+		}
+	}
+	
+	bitmap->count = view.containerCount;
+	
+	return MxStatusOK;
+}
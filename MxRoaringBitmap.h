@@ -0,0 +1,132 @@
+//
+//  MxRoaringBitmap.h
+//  core_ds
+//
+//  A compressed set of 32-bit unsigned integers.
+//
+//  Values are split by their high 16 bits into containers of up to 65536
+//  values each, and every container uses whichever of three layouts is
+//  smallest for what it holds:
+//
+//    array   - a sorted array of the low 16 bits, for up to 4096 values
+//    bitmap  - a 65536-bit bitmap, for denser containers
+//    run     - sorted runs of consecutive values (only made by
+//              MxRoaringBitmapRunOptimize; a run container changed by Add
+//              or Remove goes back to an array or bitmap)
+//
+//  A bitmap can be serialized into a portable little-endian format and
+//  queried in place through an MxRoaringBitmapView - e.g. straight out of
+//  an mmap'd file - without being loaded.
+//
+
+#ifndef core_ds_MxRoaringBitmap_h
+#define core_ds_MxRoaringBitmap_h
+
+#include <stdint.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+
+// Array containers become bitmaps past this many values (where a bitmap gets smaller)
+#define MxRoaringArrayMaxCardinality (4096)
+#define MxRoaringBitmapWords (1024)
+#define MxRoaringDefaultCapacity (4)
+
+typedef enum {
+	MxRoaringArrayContainer = 1,
+	MxRoaringBitmapContainer = 2,
+	MxRoaringRunContainer = 3
+} MxRoaringContainerType;
+
+// The values start to start + length inclusive
+typedef struct _MxRoaringRun {
+	uint16_t start;
+	uint16_t length;
+} MxRoaringRun;
+
+typedef struct _MxRoaringContainer {
+	// The high 16 bits shared by every value in the container
+	uint16_t key;
+	uint8_t type;
+	
+	uint32_t cardinality;
+	
+	// Array containers: values in use and room for. Run containers: runs.
+	uint32_t count;
+	uint32_t capacity;
+	
+	// uint16_t * for arrays, uint64_t * for bitmaps, MxRoaringRun * for runs
+	void *data;
+} MxRoaringContainer, *MxRoaringContainerRef;
+
+typedef struct _MxRoaringBitmap {
+	// Sorted by key
+	MxRoaringContainer *containers;
+	size_t count;
+	size_t capacity;
+} MxRoaringBitmap, *MxRoaringBitmapRef;
+
+// A serialized bitmap, read in place
+typedef struct _MxRoaringBitmapView {
+	const unsigned char *buffer;
+	size_t size;
+	size_t containerCount;
+} MxRoaringBitmapView, *MxRoaringBitmapViewRef;
+
+
+MxRoaringBitmapRef MxRoaringBitmapCreate(void);
+MxStatus MxRoaringBitmapInit(MxRoaringBitmapRef bitmap);
+
+MxStatus MxRoaringBitmapWipe(MxRoaringBitmapRef bitmap);
+MxStatus MxRoaringBitmapDelete(MxRoaringBitmapRef bitmap);
+
+MxStatus MxRoaringBitmapClear(MxRoaringBitmapRef bitmap);
+
+
+MxStatus MxRoaringBitmapAdd(MxRoaringBitmapRef bitmap, uint32_t value);
+
+// returns MxStatusNotFound if 'value' was not in the bitmap
+MxStatus MxRoaringBitmapRemove(MxRoaringBitmapRef bitmap, uint32_t value);
+
+// Returns MxStatusTrue or MxStatusFalse
+int MxRoaringBitmapContains(MxRoaringBitmapRef bitmap, uint32_t value);
+
+uint64_t MxRoaringBitmapGetCardinality(MxRoaringBitmapRef bitmap);
+
+// The number of values less than or equal to 'value'
+uint64_t MxRoaringBitmapRank(MxRoaringBitmapRef bitmap, uint32_t value);
+
+// The callback is passed a pointer to each value (a const uint32_t *), in order
+MxStatus MxRoaringBitmapIterate(MxRoaringBitmapRef bitmap, MxIteratorCallback callback, void *state);
+
+
+// In place: bitmap = bitmap | other, and bitmap = bitmap & other
+MxStatus MxRoaringBitmapOr(MxRoaringBitmapRef bitmap, MxRoaringBitmapRef other);
+MxStatus MxRoaringBitmapAnd(MxRoaringBitmapRef bitmap, MxRoaringBitmapRef other);
+
+// Switch each container to run encoding where that is smaller
+MxStatus MxRoaringBitmapRunOptimize(MxRoaringBitmapRef bitmap);
+
+
+// Bytes needed to serialize the bitmap
+size_t MxRoaringBitmapGetSerializedSize(MxRoaringBitmapRef bitmap);
+
+// Write the bitmap into 'buffer'
+// returns MxStatusIllegalArgument if 'size' is less than MxRoaringBitmapGetSerializedSize
+MxStatus MxRoaringBitmapSerialize(MxRoaringBitmapRef bitmap, void *buffer, size_t size);
+
+// Load a serialized bitmap into an initialised (empty) bitmap
+// returns MxStatusIllegalArgument if the buffer is not a valid serialized bitmap
+MxStatus MxRoaringBitmapDeserialize(MxRoaringBitmapRef bitmap, const void *buffer, size_t size);
+
+
+// Check a serialized bitmap and set up 'view' to query it. The buffer must stay
+// valid, and unchanged, for as long as the view is used. Every container's data is
+// checked against its descriptor, so this reads the whole buffer once.
+// returns MxStatusIllegalArgument if the buffer is not a valid serialized bitmap
+MxStatus MxRoaringBitmapViewInit(MxRoaringBitmapViewRef view, const void *buffer, size_t size);
+
+int MxRoaringBitmapViewContains(MxRoaringBitmapViewRef view, uint32_t value);
+uint64_t MxRoaringBitmapViewGetCardinality(MxRoaringBitmapViewRef view);
+
+#endif
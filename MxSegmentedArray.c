@@ -0,0 +1,243 @@
+//
+//  MxSegmentedArray.c
+//  core_ds
+//
+
+#include <stdlib.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxSegmentedArray.h"
+
+
+#define SegmentOf(index) ((index) >> MxSegmentedArraySegmentShift)
+#define OffsetOf(index) ((index) & (MxSegmentedArraySegmentSize - 1))
+#define Slot(array, index) ((array)->segments[SegmentOf(index)] + OffsetOf(index))
+
+
+// Make sure there is a segment for item 'count'
+static MxStatus ExpandIfNeeded(MxSegmentedArrayRef array)
+{
+	if (SegmentOf(array->count) < array->segmentCount)
+		return MxStatusOK;
+	
+	if (array->segmentCount == array->directoryCapacity)
+	{
+		// Only the segment pointers move, never the items
+		size_t newCapacity = array->directoryCapacity * 2;
+		// A wiped array has no directory at all
+		if (newCapacity < MxSegmentedArrayDefaultDirectoryCapacity)
+			newCapacity = MxSegmentedArrayDefaultDirectoryCapacity;
+		
+		void ***newSegments = (void ***)realloc(array->segments, newCapacity * sizeof(void **));
+		if (newSegments == NULL)
+			return MxStatusNoMemory;
+		
+		array->segments = newSegments;
+		array->directoryCapacity = newCapacity;
+	}
+	
+	void **segment = (void **)malloc(MxSegmentedArraySegmentSize * sizeof(void *));
+	if (segment == NULL)
+		return MxStatusNoMemory;
+	
+	array->segments[array->segmentCount] = segment;
+	array->segmentCount += 1;
+	
+	return MxStatusOK;
+}
+
+
+MxSegmentedArrayRef MxSegmentedArrayCreate(void)
+{
+	return MxSegmentedArrayCreateWithFunctions(NULL);
+}
+
+MxSegmentedArrayRef MxSegmentedArrayCreateWithFunctions(MxFreeFunction itemFree)
+{
+	MxSegmentedArrayRef result = (MxSegmentedArrayRef)malloc(sizeof(MxSegmentedArray));
+	if (result)
+	{
+		if (MxSegmentedArrayInitWithFunctions(result, itemFree) != MxStatusOK)
+		{
+			free(result);
+			result = NULL;
+		}
+	}
+	
+	return result;
+}
+
+
+MxStatus MxSegmentedArrayInit(MxSegmentedArrayRef array)
+{
+	return MxSegmentedArrayInitWithFunctions(array, NULL);
+}
+
+MxStatus MxSegmentedArrayInitWithFunctions(MxSegmentedArrayRef array, MxFreeFunction itemFree)
+{
+	if (array == NULL)
+		return MxStatusNullArgument;
+	
+	array->segments = (void ***)malloc(MxSegmentedArrayDefaultDirectoryCapacity * sizeof(void **));
+	if (array->segments == NULL)
+		return MxStatusNoMemory;
+	
+	array->directoryCapacity = MxSegmentedArrayDefaultDirectoryCapacity;
+	array->segmentCount = 0;
+	array->count = 0;
+	array->itemFree = itemFree;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxSegmentedArrayWipe(MxSegmentedArrayRef array)
+{
+	if (array == NULL)
+		return MxStatusNullArgument;
+	
+	MxSegmentedArrayClear(array);
+	
+	for (size_t ctr = 0; ctr < array->segmentCount; ++ctr)
+		free(array->segments[ctr]);
+	
+	free(array->segments);
+	array->segments = NULL;
+	array->segmentCount = 0;
+	array->directoryCapacity = 0;
+	
+	return MxStatusOK;
+}
+
+MxStatus MxSegmentedArrayDelete(MxSegmentedArrayRef array)
+{
+	MxStatus result = MxSegmentedArrayWipe(array);
+	if (result == MxStatusOK)
+		free(array);
+	
+	return result;
+}
+
+
+MxStatus MxSegmentedArrayAppend(MxSegmentedArrayRef array, const void *item)
+{
+	if (array == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = ExpandIfNeeded(array);
+	if (result != MxStatusOK)
+		return result;
+	
+	*Slot(array, array->count) = (void *)item;
+	array->count += 1;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxSegmentedArrayPop(MxSegmentedArrayRef array, void **result)
+{
+	if (array == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = NULL;
+	if (array->count == 0)
+		return MxStatusNotFound;
+	
+	array->count -= 1;
+	*result = *Slot(array, array->count);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxSegmentedArrayItemAt(MxSegmentedArrayRef array, size_t index, void **result)
+{
+	if (array == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	if (index >= array->count)
+		return MxStatusIndexOutOfRange;
+	
+	*result = *Slot(array, index);
+	
+	return MxStatusOK;
+}
+
+MxStatus MxSegmentedArrayReplaceAt(MxSegmentedArrayRef array, const void *item, size_t index)
+{
+	if (array == NULL)
+		return MxStatusNullArgument;
+	
+	if (index >= array->count)
+		return MxStatusIndexOutOfRange;
+	
+	void **slot = Slot(array, index);
+	if (array->itemFree)
+		array->itemFree(*slot);
+	
+	*slot = (void *)item;
+	
+	return MxStatusOK;
+}
+
+MxStatus MxSegmentedArraySlotAt(MxSegmentedArrayRef array, size_t index, void ***result)
+{
+	if (array == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	if (index >= array->count)
+		return MxStatusIndexOutOfRange;
+	
+	*result = Slot(array, index);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxSegmentedArrayClear(MxSegmentedArrayRef array)
+{
+	if (array == NULL)
+		return MxStatusNullArgument;
+	
+	if (array->itemFree)
+	{
+		for (size_t ctr = 0; ctr < array->count; ++ctr)
+			array->itemFree(*Slot(array, ctr));
+	}
+	
+	array->count = 0;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxSegmentedArrayIterate(MxSegmentedArrayRef array, MxIteratorCallback callback, void *state)
+{
+	if (array == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = MxStatusOK;
+	
+	// A segment at a time, so the inner loop is a plain walk over contiguous memory
+	for (size_t seg = 0; seg * MxSegmentedArraySegmentSize < array->count; ++seg)
+	{
+		void **segment = array->segments[seg];
+		size_t end = array->count - seg * MxSegmentedArraySegmentSize;
+		if (end > MxSegmentedArraySegmentSize)
+			end = MxSegmentedArraySegmentSize;
+		
+		for (size_t ctr = 0; ctr < end; ++ctr)
+			if ((result = callback(segment[ctr], state)) != MxStatusOK)
+				return result;
+	}
+	
+	return result;
+}
+
+
+size_t MxSegmentedArrayGetCount(MxSegmentedArrayRef array)
+{
+	return (array != NULL) ? array->count : 0;
+}
@@ -0,0 +1,69 @@
+//
+//  MxSegmentedArray.h
+//  core_ds
+//
+//  An array list stored as a directory of fixed-size segments.
+//
+//  Growing never moves items: an append at most allocates one new segment
+//  (and occasionally doubles the directory, which holds one pointer per
+//  segment), so appends have a small bounded cost and the address of
+//  each slot stays valid for the life of the array. Indexing is a shift
+//  and a mask.
+//
+
+#ifndef core_ds_MxSegmentedArray_h
+#define core_ds_MxSegmentedArray_h
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+
+// Each segment holds 1 << MxSegmentedArraySegmentShift items
+#define MxSegmentedArraySegmentShift (10)
+#define MxSegmentedArraySegmentSize (1 << MxSegmentedArraySegmentShift)
+#define MxSegmentedArrayDefaultDirectoryCapacity (16)
+
+typedef struct _MxSegmentedArray {
+	size_t count;
+	
+	// Segments allocated so far, and room in the directory for them
+	size_t segmentCount;
+	size_t directoryCapacity;
+	
+	MxFreeFunction itemFree;
+	
+	void ***segments;
+} MxSegmentedArray, *MxSegmentedArrayRef;
+
+
+MxSegmentedArrayRef MxSegmentedArrayCreate(void);
+MxSegmentedArrayRef MxSegmentedArrayCreateWithFunctions(MxFreeFunction itemFree);
+
+MxStatus MxSegmentedArrayInit(MxSegmentedArrayRef array);
+MxStatus MxSegmentedArrayInitWithFunctions(MxSegmentedArrayRef array, MxFreeFunction itemFree);
+
+// Frees the items with the array's itemFree function, and all the segments
+MxStatus MxSegmentedArrayWipe(MxSegmentedArrayRef array);
+MxStatus MxSegmentedArrayDelete(MxSegmentedArrayRef array);
+
+
+MxStatus MxSegmentedArrayAppend(MxSegmentedArrayRef array, const void *item);
+
+// Hands the last item back (it is not freed)
+// returns MxStatusNotFound (and *result NULL) if the array is empty
+MxStatus MxSegmentedArrayPop(MxSegmentedArrayRef array, void **result);
+
+MxStatus MxSegmentedArrayItemAt(MxSegmentedArrayRef array, size_t index, void **result);
+MxStatus MxSegmentedArrayReplaceAt(MxSegmentedArrayRef array, const void *item, size_t index);
+
+// The address of the slot holding item 'index'. It stays valid until the array
+// is wiped, however much the array grows.
+MxStatus MxSegmentedArraySlotAt(MxSegmentedArrayRef array, size_t index, void ***result);
+
+// Free the items but keep the segments for reuse
+MxStatus MxSegmentedArrayClear(MxSegmentedArrayRef array);
+
+MxStatus MxSegmentedArrayIterate(MxSegmentedArrayRef array, MxIteratorCallback callback, void *state);
+
+size_t MxSegmentedArrayGetCount(MxSegmentedArrayRef array);
+
+#endif
@@ -0,0 +1,335 @@
+//
+//  MxSmallArrayList.h
+//  core_ds
+//
+//  Array lists of pointers with the first few slots held inline.
+//
+//  MX_DEFINE_SMALL_ARRAY_LIST(name, N) generates a struct 'name' (and
+//  'nameRef') holding N item slots in the struct itself, plus static inline
+//  functions following the MxArrayList API. Until it holds more than N
+//  items a list never touches the heap, so one declared on the stack
+//  costs no malloc or free at all:
+//
+//      MX_DEFINE_SMALL_ARRAY_LIST(MxArrayList16, 16)
+//
+//      MxArrayList16 pending;
+//      MxArrayList16Init(&pending);
+//      MxArrayList16Append(&pending, request);
+//      ...
+//      MxArrayList16Wipe(&pending);
+//
+//  Past N items the list spills to a heap array that grows geometrically.
+//  ShrinkToFit moves it back into the inline slots once it fits again.
+//  The struct holds no pointers into itself, so it can be copied by value
+//  (though only one copy may then be used).
+//
+
+#ifndef core_ds_MxSmallArrayList_h
+#define core_ds_MxSmallArrayList_h
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+
+#define MxSmallArrayListExpansionFactor (2)
+
+
+#define MX_DEFINE_SMALL_ARRAY_LIST(name, N)                                             \
+                                                                                        \
+_Static_assert((N) > 0, #name ": a small array list needs at least one inline slot");   \
+                                                                                        \
+typedef struct _##name {                                                                \
+	size_t capacity;                                                                    \
+	size_t count;                                                                       \
+                                                                                        \
+	MxFreeFunction itemFree;                                                            \
+	MxEqualsFunction itemEquals;                                                        \
+                                                                                        \
+	/* NULL until the list outgrows inlineItems */                                      \
+	void **heapItems;                                                                   \
+	void *inlineItems[N];                                                               \
+} name, *name##Ref;                                                                     \
+                                                                                        \
+/* The array currently holding the items */                                            \
+static inline void **name##Items(name##Ref list)                                        \
+{                                                                                       \
+	return (list->heapItems != NULL) ? list->heapItems : list->inlineItems;             \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##ExpandIfNeeded(name##Ref list)                             \
+{                                                                                       \
+	if (list->count < list->capacity)                                                   \
+		return MxStatusOK;                                                              \
+                                                                                        \
+	size_t newCapacity = list->capacity * MxSmallArrayListExpansionFactor;              \
+	void **newItems;                                                                    \
+                                                                                        \
+	if (list->heapItems == NULL)                                                        \
+	{                                                                                   \
+		newItems = (void **)malloc(newCapacity * sizeof(void *));                       \
+		if (newItems != NULL)                                                           \
+			memcpy(newItems, list->inlineItems, list->count * sizeof(void *));          \
+	}                                                                                   \
+	else                                                                                \
+	{                                                                                   \
+		newItems = (void **)realloc(list->heapItems, newCapacity * sizeof(void *));     \
+	}                                                                                   \
+                                                                                        \
+	if (newItems == NULL)                                                               \
+		return MxStatusNoMemory;                                                        \
+                                                                                        \
+	list->heapItems = newItems;                                                         \
+	list->capacity = newCapacity;                                                       \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##InitWithFunctions(name##Ref list, MxFreeFunction itemFree, MxEqualsFunction itemEquals) \
+{                                                                                       \
+	if (list == NULL)                                                                   \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	list->capacity = (N);                                                               \
+	list->count = 0;                                                                    \
+	list->itemFree = itemFree;                                                          \
+	list->itemEquals = itemEquals;                                                      \
+	list->heapItems = NULL;                                                             \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##Init(name##Ref list)                                       \
+{                                                                                       \
+	return name##InitWithFunctions(list, NULL, NULL);                                   \
+}                                                                                       \
+                                                                                        \
+static inline name##Ref name##CreateWithFunctions(MxFreeFunction itemFree, MxEqualsFunction itemEquals) \
+{                                                                                       \
+	name##Ref result = (name##Ref)malloc(sizeof(name));                                 \
+	if (result)                                                                         \
+		name##InitWithFunctions(result, itemFree, itemEquals);                          \
+                                                                                        \
+	return result;                                                                      \
+}                                                                                       \
+                                                                                        \
+static inline name##Ref name##Create(void)                                              \
+{                                                                                       \
+	return name##CreateWithFunctions(NULL, NULL);                                       \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##Clear(name##Ref list)                                      \
+{                                                                                       \
+	if (list == NULL)                                                                   \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (list->itemFree)                                                                 \
+	{                                                                                   \
+		void **items = name##Items(list);                                               \
+		for (size_t ctr = 0; ctr < list->count; ++ctr)                                  \
+			list->itemFree(items[ctr]);                                                 \
+	}                                                                                   \
+                                                                                        \
+	list->count = 0;                                                                    \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+/* Frees the items with itemFree and goes back to the inline slots */                  \
+static inline MxStatus name##Wipe(name##Ref list)                                       \
+{                                                                                       \
+	MxStatus result = name##Clear(list);                                                \
+	if (result != MxStatusOK)                                                           \
+		return result;                                                                  \
+                                                                                        \
+	free(list->heapItems);                                                              \
+	list->heapItems = NULL;                                                             \
+	list->capacity = (N);                                                               \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+/* Give back heap space beyond the count - a list that fits in its inline slots */      \
+/* again moves back into them */                                                        \
+static inline MxStatus name##ShrinkToFit(name##Ref list)                                \
+{                                                                                       \
+	if (list == NULL)                                                                   \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (list->heapItems == NULL || list->count == list->capacity)                       \
+		return MxStatusOK;                                                              \
+                                                                                        \
+	if (list->count <= (N))                                                             \
+	{                                                                                   \
+		memcpy(list->inlineItems, list->heapItems, list->count * sizeof(void *));       \
+		free(list->heapItems);                                                          \
+		list->heapItems = NULL;                                                         \
+		list->capacity = (N);                                                           \
+		return MxStatusOK;                                                              \
+	}                                                                                   \
+                                                                                        \
+	void **newItems = (void **)realloc(list->heapItems, list->count * sizeof(void *));  \
+	if (newItems == NULL)                                                               \
+		return MxStatusNoMemory;                                                        \
+                                                                                        \
+	list->heapItems = newItems;                                                         \
+	list->capacity = list->count;                                                       \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##Delete(name##Ref list)                                     \
+{                                                                                       \
+	MxStatus result = name##Wipe(list);                                                 \
+	if (result == MxStatusOK)                                                           \
+		free(list);                                                                     \
+                                                                                        \
+	return result;                                                                      \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##Append(name##Ref list, const void *item)                   \
+{                                                                                       \
+	if (list == NULL)                                                                   \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	MxStatus result = name##ExpandIfNeeded(list);                                       \
+	if (result != MxStatusOK)                                                           \
+		return result;                                                                  \
+                                                                                        \
+	name##Items(list)[list->count] = (void *)item;                                      \
+	list->count += 1;                                                                   \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+/* 'index' may equal the count, which appends */                                        \
+static inline MxStatus name##InsertAt(name##Ref list, const void *item, int index)      \
+{                                                                                       \
+	if (list == NULL)                                                                   \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (index < 0)                                                                      \
+		return MxStatusIllegalArgument;                                                 \
+                                                                                        \
+	if ((size_t)index > list->count)                                                    \
+		return MxStatusIndexOutOfRange;                                                 \
+                                                                                        \
+	MxStatus result = name##ExpandIfNeeded(list);                                       \
+	if (result != MxStatusOK)                                                           \
+		return result;                                                                  \
+                                                                                        \
+	void **items = name##Items(list);                                                   \
+	memmove(items + index + 1, items + index, (list->count - index) * sizeof(void *));  \
+	items[index] = (void *)item;                                                        \
+	list->count += 1;                                                                   \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##ReplaceAt(name##Ref list, const void *item, int index)     \
+{                                                                                       \
+	if (list == NULL)                                                                   \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (index < 0)                                                                      \
+		return MxStatusIllegalArgument;                                                 \
+                                                                                        \
+	if ((size_t)index >= list->count)                                                   \
+		return MxStatusIndexOutOfRange;                                                 \
+                                                                                        \
+	void **items = name##Items(list);                                                   \
+	if (list->itemFree)                                                                 \
+		list->itemFree(items[index]);                                                   \
+                                                                                        \
+	items[index] = (void *)item;                                                        \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##ItemAt(name##Ref list, int index, void **result)           \
+{                                                                                       \
+	if (list == NULL || result == NULL)                                                 \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (index < 0)                                                                      \
+		return MxStatusIllegalArgument;                                                 \
+                                                                                        \
+	if ((size_t)index >= list->count)                                                   \
+		return MxStatusIndexOutOfRange;                                                 \
+                                                                                        \
+	*result = name##Items(list)[index];                                                 \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+/* Returns MxStatusNotFound (and *result NULL) if the list is empty */                  \
+static inline MxStatus name##Pop(name##Ref list, void **result)                         \
+{                                                                                       \
+	if (list == NULL || result == NULL)                                                 \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	*result = NULL;                                                                     \
+	if (list->count == 0)                                                               \
+		return MxStatusNotFound;                                                        \
+                                                                                        \
+	list->count -= 1;                                                                   \
+	*result = name##Items(list)[list->count];                                           \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+/* The item is handed back in *removed, not freed */                                    \
+static inline MxStatus name##RemoveAt(name##Ref list, int index, void **removed)        \
+{                                                                                       \
+	if (list == NULL || removed == NULL)                                                \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (index < 0)                                                                      \
+		return MxStatusIllegalArgument;                                                 \
+                                                                                        \
+	if ((size_t)index >= list->count)                                                   \
+		return MxStatusIndexOutOfRange;                                                 \
+                                                                                        \
+	void **items = name##Items(list);                                                   \
+	*removed = items[index];                                                            \
+	memmove(items + index, items + index + 1, (list->count - index - 1) * sizeof(void *)); \
+	list->count -= 1;                                                                   \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+/* Index of the first item equal to 'item' (by itemEquals, or identity), or -1 */       \
+static inline int name##IndexOf(name##Ref list, const void *item)                       \
+{                                                                                       \
+	if (list == NULL)                                                                   \
+		return -1;                                                                      \
+                                                                                        \
+	void **items = name##Items(list);                                                   \
+	for (size_t ctr = 0; ctr < list->count; ++ctr)                                      \
+		if (list->itemEquals ? list->itemEquals(items[ctr], item) : (items[ctr] == item)) \
+			return (int)ctr;                                                            \
+                                                                                        \
+	return -1;                                                                          \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##Iterate(name##Ref list, MxIteratorCallback callback, void *state) \
+{                                                                                       \
+	if (list == NULL || callback == NULL)                                               \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	void **items = name##Items(list);                                                   \
+	MxStatus result = MxStatusOK;                                                       \
+	for (size_t ctr = 0; ctr < list->count; ++ctr)                                      \
+		if ((result = callback(items[ctr], state)) != MxStatusOK)                       \
+			break;                                                                      \
+                                                                                        \
+	return result;                                                                      \
+}                                                                                       \
+                                                                                        \
+static inline size_t name##GetCount(name##Ref list)                                     \
+{                                                                                       \
+	return (list != NULL) ? list->count : 0;                                            \
+}
+
+#endif
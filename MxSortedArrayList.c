@@ -0,0 +1,226 @@
+//
+//  MxSortedArrayList.c
+//  core_ds
+//
+
+#include <stdlib.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxArrayList.h"
+#include "MxSortedArrayList.h"
+
+
+// Branchless binary search for the first item where !(item < key), or with 'upper'
+// set, the first where key < item. The window halves every step whatever the
+// comparison says, so the only branch is the loop itself; both places the next
+// probe could land are prefetched while this one is compared.
+static inline size_t Search(void **items, size_t count, const void *key, MxCompareFunction compare, int upper)
+{
+	if (count == 0)
+		return 0;
+	
+	void **base = items;
+	size_t half;
+	
+	while (count > 1)
+	{
+		half = count / 2;
+		__builtin_prefetch(base + (half / 2));
+		__builtin_prefetch(base + half + (half / 2));
+		
+		int cmp = compare(base[half], key);
+		base = (upper ? cmp <= 0 : cmp < 0) ? base + half : base;
+		count -= half;
+	}
+	
+	int cmp = compare(*base, key);
+	
+	return (size_t)(base - items) + (upper ? cmp <= 0 : cmp < 0);
+}
+
+
+MxSortedArrayListRef MxSortedArrayListCreate(MxCompareFunction itemCompare)
+{
+	return MxSortedArrayListCreateWithFunctions(itemCompare, NULL);
+}
+
+MxSortedArrayListRef MxSortedArrayListCreateWithFunctions(MxCompareFunction itemCompare, MxFreeFunction itemFree)
+{
+	MxSortedArrayListRef result = malloc(sizeof(MxSortedArrayList));
+	if (result)
+	{
+		if (MxSortedArrayListInitWithFunctions(result, itemCompare, itemFree) != MxStatusOK)
+		{
+			free(result);
+			result = NULL;
+		}
+	}
+	
+	return result;
+}
+
+
+MxStatus MxSortedArrayListInit(MxSortedArrayListRef list, MxCompareFunction itemCompare)
+{
+	return MxSortedArrayListInitWithFunctions(list, itemCompare, NULL);
+}
+
+MxStatus MxSortedArrayListInitWithFunctions(MxSortedArrayListRef list, MxCompareFunction itemCompare, MxFreeFunction itemFree)
+{
+	if (list == NULL || itemCompare == NULL)
+		return MxStatusNullArgument;
+	
+	list->itemCompare = itemCompare;
+	
+	return MxArrayListInitWithFunctions(&list->list, itemFree, NULL);
+}
+
+
+MxStatus MxSortedArrayListWipe(MxSortedArrayListRef list)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	return MxArrayListWipe(&list->list);
+}
+
+MxStatus MxSortedArrayListDelete(MxSortedArrayListRef list)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = MxSortedArrayListWipe(list);
+	if (result == MxStatusOK)
+		free(list);
+	
+	return result;
+}
+
+
+MxStatus MxSortedArrayListInsert(MxSortedArrayListRef list, const void *item, size_t *index)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	size_t idx = Search(list->list.items, list->list.count, item, list->itemCompare, 1);
+	
+	MxStatus result = MxArrayListInsertManyAt(&list->list, &item, 1, (int)idx);
+	if (result == MxStatusOK && index != NULL)
+		*index = idx;
+	
+	return result;
+}
+
+
+MxStatus MxSortedArrayListLowerBound(MxSortedArrayListRef list, const void *item, size_t *result)
+{
+	if (list == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = Search(list->list.items, list->list.count, item, list->itemCompare, 0);
+	
+	return MxStatusOK;
+}
+
+MxStatus MxSortedArrayListUpperBound(MxSortedArrayListRef list, const void *item, size_t *result)
+{
+	if (list == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = Search(list->list.items, list->list.count, item, list->itemCompare, 1);
+	
+	return MxStatusOK;
+}
+
+MxStatus MxSortedArrayListEqualRange(MxSortedArrayListRef list, const void *item, size_t *first, size_t *last)
+{
+	if (list == NULL || first == NULL || last == NULL)
+		return MxStatusNullArgument;
+	
+	*first = Search(list->list.items, list->list.count, item, list->itemCompare, 0);
+	
+	// The upper bound can only be at or after the lower one
+	*last = *first + Search(list->list.items + *first, list->list.count - *first, item, list->itemCompare, 1);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxSortedArrayListFind(MxSortedArrayListRef list, const void *item, void **result)
+{
+	if (list == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = NULL;
+	
+	size_t idx = Search(list->list.items, list->list.count, item, list->itemCompare, 0);
+	if (idx == list->list.count || list->itemCompare(list->list.items[idx], item) != 0)
+		return MxStatusNotFound;
+	
+	*result = list->list.items[idx];
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxSortedArrayListRemove(MxSortedArrayListRef list, const void *item)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	size_t idx = Search(list->list.items, list->list.count, item, list->itemCompare, 0);
+	if (idx == list->list.count || list->itemCompare(list->list.items[idx], item) != 0)
+		return MxStatusNotFound;
+	
+	return MxArrayListRemoveRange(&list->list, (int)idx, 1, NULL);
+}
+
+
+MxStatus MxSortedArrayListRemoveAt(MxSortedArrayListRef list, int index, void **removed)
+{
+	if (list == NULL || removed == NULL)
+		return MxStatusNullArgument;
+	
+	if (index < 0)
+		return MxStatusIllegalArgument;
+	
+	if ((size_t)index >= list->list.count)
+		return MxStatusIndexOutOfRange;
+	
+	return MxArrayListRemoveRange(&list->list, index, 1, removed);
+}
+
+
+MxStatus MxSortedArrayListItemAt(MxSortedArrayListRef list, int index, void **result)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	return MxArrayListItemAt(&list->list, index, result);
+}
+
+MxStatus MxSortedArrayListClear(MxSortedArrayListRef list)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	return MxArrayListClear(&list->list);
+}
+
+MxStatus MxSortedArrayListIterate(MxSortedArrayListRef list, MxIteratorCallback callback, void *state)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	return MxArrayListIterate(&list->list, callback, state);
+}
+
+
+size_t MxSortedArrayListGetCount(MxSortedArrayListRef list)
+{
+	if (list == NULL)
+		return 0;
+	
+	return list->list.count;
+}
@@ -0,0 +1,66 @@
+//
+//  MxSortedArrayList.h
+//  core_ds
+//
+//  An MxArrayList kept in order by a compare function. Lookups are
+//  binary searches over the contiguous item array - a compact,
+//  read-mostly alternative to MxBinaryTree.
+//
+//  Equal items are kept in the order they were inserted.
+//
+
+#ifndef core_ds_MxSortedArrayList_h
+#define core_ds_MxSortedArrayList_h
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxArrayList.h"
+
+
+typedef struct _MxSortedArrayList {
+	MxArrayList list;
+	
+	MxCompareFunction itemCompare;
+} MxSortedArrayList, *MxSortedArrayListRef;
+
+
+MxSortedArrayListRef MxSortedArrayListCreate(MxCompareFunction itemCompare);
+MxSortedArrayListRef MxSortedArrayListCreateWithFunctions(MxCompareFunction itemCompare, MxFreeFunction itemFree);
+
+MxStatus MxSortedArrayListInit(MxSortedArrayListRef list, MxCompareFunction itemCompare);
+MxStatus MxSortedArrayListInitWithFunctions(MxSortedArrayListRef list, MxCompareFunction itemCompare, MxFreeFunction itemFree);
+
+MxStatus MxSortedArrayListWipe(MxSortedArrayListRef list);
+MxStatus MxSortedArrayListDelete(MxSortedArrayListRef list);
+
+
+// Insert 'item' after any items equal to it. If 'index' is not NULL it is set to
+// where the item went.
+MxStatus MxSortedArrayListInsert(MxSortedArrayListRef list, const void *item, size_t *index);
+
+// Index of the first item not less than 'item' (the count if there is none)
+MxStatus MxSortedArrayListLowerBound(MxSortedArrayListRef list, const void *item, size_t *result);
+
+// Index of the first item greater than 'item' (the count if there is none)
+MxStatus MxSortedArrayListUpperBound(MxSortedArrayListRef list, const void *item, size_t *result);
+
+// The half-open range [*first, *last) of items equal to 'item'
+MxStatus MxSortedArrayListEqualRange(MxSortedArrayListRef list, const void *item, size_t *first, size_t *last);
+
+// Put the first item equal to 'item' in *result
+// returns MxStatusOK if one was found, MxStatusNotFound (and *result NULL) otherwise
+MxStatus MxSortedArrayListFind(MxSortedArrayListRef list, const void *item, void **result);
+
+// Remove the first item equal to 'item', freeing it with the list's itemFree function
+MxStatus MxSortedArrayListRemove(MxSortedArrayListRef list, const void *item);
+
+// Remove the item at 'index' and hand it back in *removed (it is not freed)
+MxStatus MxSortedArrayListRemoveAt(MxSortedArrayListRef list, int index, void **removed);
+
+MxStatus MxSortedArrayListItemAt(MxSortedArrayListRef list, int index, void **result);
+MxStatus MxSortedArrayListClear(MxSortedArrayListRef list);
+MxStatus MxSortedArrayListIterate(MxSortedArrayListRef list, MxIteratorCallback callback, void *state);
+
+size_t MxSortedArrayListGetCount(MxSortedArrayListRef list);
+
+#endif
@@ -0,0 +1,273 @@
+//
+//  MxThreadPool.c
+//  core_ds
+//
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "MxStatus.h"
+#include "MxThreadPool.h"
+
+
+static void *WorkerMain(void *vpool);
+static void RunTasks(MxThreadPoolRef pool);
+static MxStatus RunInline(size_t taskCount, MxThreadPoolTask task, void *state);
+static MxStatus StopWorkers(MxThreadPoolRef pool, size_t started);
+
+
+static MxThreadPoolRef defaultPool = NULL;
+static pthread_once_t defaultPoolOnce = PTHREAD_ONCE_INIT;
+
+// Set while this thread is running a task of any pool's job
+static __thread int runningTask = 0;
+
+
+MxThreadPoolRef MxThreadPoolCreate(size_t threadCount)
+{
+	MxThreadPoolRef pool = (MxThreadPoolRef)malloc(sizeof(MxThreadPool));
+	if (pool != NULL)
+	{
+		if (MxThreadPoolInit(pool, threadCount) != MxStatusOK)
+		{
+			free(pool);
+			pool = NULL;
+		}
+	}
+	
+	return pool;
+}
+
+
+MxStatus MxThreadPoolInit(MxThreadPoolRef pool, size_t threadCount)
+{
+	if (pool == NULL)
+		return MxStatusNullArgument;
+	
+	if (threadCount == 0)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threadCount = (cpus > 1) ? (size_t)(cpus - 1) : 0;
+	}
+	
+	pool->threads = NULL;
+	if (threadCount > 0 && (pool->threads = (pthread_t *)malloc(threadCount * sizeof(pthread_t))) == NULL)
+		return MxStatusNoMemory;
+	
+	pthread_mutex_init(&pool->runLock, NULL);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->workReady, NULL);
+	pthread_cond_init(&pool->workDone, NULL);
+	
+	pool->threadCount = threadCount;
+	pool->generation = 0;
+	pool->shuttingDown = 0;
+	pool->task = NULL;
+	pool->state = NULL;
+	pool->taskCount = 0;
+	pool->nextTask = 0;
+	pool->busyWorkers = 0;
+	pool->status = MxStatusOK;
+	
+	for (size_t ctr = 0; ctr < threadCount; ++ctr)
+	{
+		if (pthread_create(pool->threads + ctr, NULL, WorkerMain, pool) != 0)
+		{
+			StopWorkers(pool, ctr);
+			return MxStatusUnixError;
+		}
+	}
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxThreadPoolWipe(MxThreadPoolRef pool)
+{
+	if (pool == NULL)
+		return MxStatusNullArgument;
+	
+	return StopWorkers(pool, pool->threadCount);
+}
+
+
+MxStatus MxThreadPoolDelete(MxThreadPoolRef pool)
+{
+	if (pool == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus status = MxThreadPoolWipe(pool);
+	if (status == MxStatusOK)
+		free(pool);
+	
+	return status;
+}
+
+
+static void CreateDefaultPool(void)
+{
+	defaultPool = MxThreadPoolCreate(0);
+}
+
+MxThreadPoolRef MxThreadPoolGetDefault(void)
+{
+	pthread_once(&defaultPoolOnce, CreateDefaultPool);
+	
+	return defaultPool;
+}
+
+
+MxStatus MxThreadPoolRun(MxThreadPoolRef pool, size_t taskCount, MxThreadPoolTask task, void *state)
+{
+	if (pool == NULL || task == NULL)
+		return MxStatusNullArgument;
+	
+	if (taskCount == 0)
+		return MxStatusOK;
+	
+	// A task submitting a job of its own would wait for the runLock its own job
+	// holds (or for workers busy with that job) - run the nested job here instead
+	if (runningTask)
+		return RunInline(taskCount, task, state);
+	
+	pthread_mutex_lock(&pool->runLock);
+	
+	pthread_mutex_lock(&pool->lock);
+	pool->task = task;
+	pool->state = state;
+	pool->taskCount = taskCount;
+	pool->nextTask = 0;
+	pool->status = MxStatusOK;
+	
+	// Not worth waking workers for a single task
+	if (taskCount > 1 && pool->threadCount > 0)
+	{
+		pool->busyWorkers = pool->threadCount;
+		pool->generation += 1;
+		pthread_cond_broadcast(&pool->workReady);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	
+	RunTasks(pool);
+	
+	pthread_mutex_lock(&pool->lock);
+	while (pool->busyWorkers > 0)
+		pthread_cond_wait(&pool->workDone, &pool->lock);
+	
+	MxStatus status = pool->status;
+	pool->task = NULL;
+	pool->state = NULL;
+	pthread_mutex_unlock(&pool->lock);
+	
+	pthread_mutex_unlock(&pool->runLock);
+	
+	return status;
+}
+
+
+size_t MxThreadPoolGetConcurrency(MxThreadPoolRef pool)
+{
+	return (pool != NULL) ? pool->threadCount + 1 : 1;
+}
+
+
+static void RunTasks(MxThreadPoolRef pool)
+{
+	size_t taskCount = pool->taskCount;
+	MxThreadPoolTask task = pool->task;
+	void *state = pool->state;
+	
+	runningTask = 1;
+	
+	for (;;)
+	{
+		size_t index = __atomic_fetch_add(&pool->nextTask, 1, __ATOMIC_RELAXED);
+		if (index >= taskCount)
+			break;
+		
+		// Don't start anything new once a task has failed
+		if (__atomic_load_n(&pool->status, __ATOMIC_RELAXED) != MxStatusOK)
+			break;
+		
+		MxStatus status = task(index, state);
+		if (status != MxStatusOK)
+		{
+			MxStatus expected = MxStatusOK;
+			__atomic_compare_exchange_n(&pool->status, &expected, status, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+		}
+	}
+	
+	runningTask = 0;
+}
+
+
+// Run a nested job's tasks in order on this thread, stopping at the first failure
+static MxStatus RunInline(size_t taskCount, MxThreadPoolTask task, void *state)
+{
+	for (size_t index = 0; index < taskCount; ++index)
+	{
+		MxStatus status = task(index, state);
+		if (status != MxStatusOK)
+			return status;
+	}
+	
+	return MxStatusOK;
+}
+
+
+static void *WorkerMain(void *vpool)
+{
+	MxThreadPoolRef pool = (MxThreadPoolRef)vpool;
+	
+	pthread_mutex_lock(&pool->lock);
+	// Init set the generation to 0 before starting any worker, and a job may
+	// already have been submitted by the time this thread gets the lock
+	unsigned long seen = 0;
+	
+	for (;;)
+	{
+		while (pool->generation == seen && !pool->shuttingDown)
+			pthread_cond_wait(&pool->workReady, &pool->lock);
+		
+		if (pool->shuttingDown)
+			break;
+		
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+		
+		RunTasks(pool);
+		
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->busyWorkers == 0)
+			pthread_cond_signal(&pool->workDone);
+	}
+	
+	pthread_mutex_unlock(&pool->lock);
+	
+	return NULL;
+}
+
+
+// Tell the first 'started' workers to exit, join them and free everything
+static MxStatus StopWorkers(MxThreadPoolRef pool, size_t started)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->shuttingDown = 1;
+	pthread_cond_broadcast(&pool->workReady);
+	pthread_mutex_unlock(&pool->lock);
+	
+	for (size_t ctr = 0; ctr < started; ++ctr)
+		pthread_join(pool->threads[ctr], NULL);
+	
+	free(pool->threads);
+	pool->threads = NULL;
+	pool->threadCount = 0;
+	
+	pthread_cond_destroy(&pool->workDone);
+	pthread_cond_destroy(&pool->workReady);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_mutex_destroy(&pool->runLock);
+	
+	return MxStatusOK;
+}
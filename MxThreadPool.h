@@ -0,0 +1,83 @@
+//
+//  MxThreadPool.h
+//  core_ds
+//
+//  A fixed set of worker threads for data-parallel jobs.
+//
+//  A job is 'taskCount' independent tasks, numbered from 0. The workers
+//  (and the thread that submitted the job) claim task numbers until none
+//  are left, and the submitter gets control back once every task has
+//  finished. One job runs at a time; the threads wait between jobs and
+//  are reused, so a pool is meant to be created once and kept.
+//
+
+#ifndef core_ds_MxThreadPool_h
+#define core_ds_MxThreadPool_h
+
+#include <pthread.h>
+
+#include "MxStatus.h"
+
+
+// Run task number 'index' of a job. Anything other than MxStatusOK fails the job
+// and stops further tasks being started.
+typedef MxStatus (*MxThreadPoolTask)(size_t index, void *state);
+
+typedef struct _MxThreadPool {
+	pthread_t *threads;
+	size_t threadCount;
+	
+	// Held for the whole of a job, so concurrent submitters queue up
+	pthread_mutex_t runLock;
+	
+	// Guards everything below
+	pthread_mutex_t lock;
+	pthread_cond_t workReady;
+	pthread_cond_t workDone;
+	
+	// Bumped for each job - a worker runs a job once when it sees a new generation
+	unsigned long generation;
+	int shuttingDown;
+	
+	// The current job
+	MxThreadPoolTask task;
+	void *state;
+	size_t taskCount;
+	
+	// Claimed atomically by the running threads
+	size_t nextTask;
+	
+	// Workers yet to finish with the current job
+	size_t busyWorkers;
+	
+	// First failure, if any
+	MxStatus status;
+} MxThreadPool, *MxThreadPoolRef;
+
+
+// 'threadCount' worker threads, in addition to the thread submitting the job.
+// 0 means one fewer than the number of CPUs, so a job uses every CPU.
+MxThreadPoolRef MxThreadPoolCreate(size_t threadCount);
+MxStatus MxThreadPoolInit(MxThreadPoolRef pool, size_t threadCount);
+
+// Stops and joins the worker threads. There must be no job running.
+MxStatus MxThreadPoolWipe(MxThreadPoolRef pool);
+MxStatus MxThreadPoolDelete(MxThreadPoolRef pool);
+
+// A process-wide pool with the default number of threads, created on first use
+// and never destroyed. Returns NULL if it could not be created.
+MxThreadPoolRef MxThreadPoolGetDefault(void);
+
+
+// Run tasks 0 to taskCount - 1 and wait for them all to finish.
+// A task may submit a job of its own (to this pool or any other): the threads
+// are all busy with the outer job, so the nested job's tasks run one after
+// another on the thread that submitted it.
+// returns MxStatusOK if every task did
+//         the status of the first task that failed otherwise
+MxStatus MxThreadPoolRun(MxThreadPoolRef pool, size_t taskCount, MxThreadPoolTask task, void *state);
+
+// The number of threads that run a job: the workers plus the submitter
+size_t MxThreadPoolGetConcurrency(MxThreadPoolRef pool);
+
+#endif
@@ -0,0 +1,265 @@
+//
+//  MxTypedArray.h
+//  core_ds
+//
+//  Dynamic arrays that store their elements by value.
+//
+//  MX_DEFINE_ARRAY(name, T) generates a struct 'name' (and 'nameRef') plus
+//  static inline functions following the MxArrayList API, so an array of
+//  ints or small structs is one contiguous block with no per-element
+//  allocation:
+//
+//      MX_DEFINE_ARRAY(MxIntArray, int)
+//
+//      MxIntArray numbers;
+//      MxIntArrayInit(&numbers);
+//      MxIntArrayAppend(&numbers, 42);
+//
+//  Items are passed and returned by value; Iterate hands the callback a
+//  pointer to each element in place.
+//
+
+#ifndef core_ds_MxTypedArray_h
+#define core_ds_MxTypedArray_h
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+
+#define MxTypedArrayDefaultCapacity (32)
+#define MxTypedArrayExpansionFactor (2)
+
+
+#define MX_DEFINE_ARRAY(name, T)                                                        \
+                                                                                        \
+typedef struct _##name {                                                                \
+	size_t capacity;                                                                    \
+	size_t count;                                                                       \
+	T *items;                                                                           \
+} name, *name##Ref;                                                                     \
+                                                                                        \
+static inline MxStatus name##ExpandIfNeeded(name##Ref array, size_t extra)              \
+{                                                                                       \
+	if (array->count + extra <= array->capacity)                                        \
+		return MxStatusOK;                                                              \
+                                                                                        \
+	size_t newCapacity = array->capacity * MxTypedArrayExpansionFactor;                 \
+	if (newCapacity < array->count + extra)                                             \
+		newCapacity = array->count + extra;                                             \
+                                                                                        \
+	T *newItems = (T *)realloc(array->items, newCapacity * sizeof(T));                  \
+	if (newItems == NULL)                                                               \
+		return MxStatusNoMemory;                                                        \
+                                                                                        \
+	array->items = newItems;                                                            \
+	array->capacity = newCapacity;                                                      \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##InitWithCapacity(name##Ref array, size_t capacity)         \
+{                                                                                       \
+	if (array == NULL)                                                                  \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (capacity == 0)                                                                  \
+		return MxStatusIllegalArgument;                                                 \
+                                                                                        \
+	array->items = (T *)malloc(capacity * sizeof(T));                                   \
+	if (array->items == NULL)                                                           \
+		return MxStatusNoMemory;                                                        \
+                                                                                        \
+	array->capacity = capacity;                                                         \
+	array->count = 0;                                                                   \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##Init(name##Ref array)                                      \
+{                                                                                       \
+	return name##InitWithCapacity(array, MxTypedArrayDefaultCapacity);                 \
+}                                                                                       \
+                                                                                        \
+static inline name##Ref name##CreateWithCapacity(size_t capacity)                       \
+{                                                                                       \
+	name##Ref result = (name##Ref)malloc(sizeof(name));                                 \
+	if (result)                                                                         \
+	{                                                                                   \
+		if (name##InitWithCapacity(result, capacity) != MxStatusOK)                     \
+		{                                                                               \
+			free(result);                                                               \
+			result = NULL;                                                              \
+		}                                                                               \
+	}                                                                                   \
+                                                                                        \
+	return result;                                                                      \
+}                                                                                       \
+                                                                                        \
+static inline name##Ref name##Create(void)                                              \
+{                                                                                       \
+	return name##CreateWithCapacity(MxTypedArrayDefaultCapacity);                      \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##Wipe(name##Ref array)                                      \
+{                                                                                       \
+	if (array == NULL)                                                                  \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	free(array->items);                                                                 \
+	array->items = NULL;                                                                \
+	array->capacity = 0;                                                                \
+	array->count = 0;                                                                   \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##Delete(name##Ref array)                                    \
+{                                                                                       \
+	MxStatus result = name##Wipe(array);                                                \
+	if (result == MxStatusOK)                                                           \
+		free(array);                                                                    \
+                                                                                        \
+	return result;                                                                      \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##Append(name##Ref array, T item)                            \
+{                                                                                       \
+	if (array == NULL)                                                                  \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	MxStatus result = name##ExpandIfNeeded(array, 1);                                   \
+	if (result != MxStatusOK)                                                           \
+		return result;                                                                  \
+                                                                                        \
+	array->items[array->count] = item;                                                  \
+	array->count += 1;                                                                  \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+/* 'index' may equal the count, which appends */                                        \
+static inline MxStatus name##InsertAt(name##Ref array, T item, int index)               \
+{                                                                                       \
+	if (array == NULL)                                                                  \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (index < 0)                                                                      \
+		return MxStatusIllegalArgument;                                                 \
+                                                                                        \
+	if ((size_t)index > array->count)                                                   \
+		return MxStatusIndexOutOfRange;                                                 \
+                                                                                        \
+	MxStatus result = name##ExpandIfNeeded(array, 1);                                   \
+	if (result != MxStatusOK)                                                           \
+		return result;                                                                  \
+                                                                                        \
+	memmove(array->items + index + 1, array->items + index,                             \
+	        (array->count - index) * sizeof(T));                                        \
+                                                                                        \
+	array->items[index] = item;                                                         \
+	array->count += 1;                                                                  \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##ReplaceAt(name##Ref array, T item, int index)              \
+{                                                                                       \
+	if (array == NULL)                                                                  \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (index < 0)                                                                      \
+		return MxStatusIllegalArgument;                                                 \
+                                                                                        \
+	if ((size_t)index >= array->count)                                                  \
+		return MxStatusIndexOutOfRange;                                                 \
+                                                                                        \
+	array->items[index] = item;                                                         \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##ItemAt(name##Ref array, int index, T *result)              \
+{                                                                                       \
+	if (array == NULL || result == NULL)                                                \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (index < 0)                                                                      \
+		return MxStatusIllegalArgument;                                                 \
+                                                                                        \
+	if ((size_t)index >= array->count)                                                  \
+		return MxStatusIndexOutOfRange;                                                 \
+                                                                                        \
+	*result = array->items[index];                                                      \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+/* Returns MxStatusNotFound (leaving *result alone) if the array is empty */            \
+static inline MxStatus name##Pop(name##Ref array, T *result)                            \
+{                                                                                       \
+	if (array == NULL || result == NULL)                                                \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (array->count == 0)                                                              \
+		return MxStatusNotFound;                                                        \
+                                                                                        \
+	array->count -= 1;                                                                  \
+	*result = array->items[array->count];                                               \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+/* 'removed' may be NULL if the caller doesn't want the item */                         \
+static inline MxStatus name##RemoveAt(name##Ref array, int index, T *removed)           \
+{                                                                                       \
+	if (array == NULL)                                                                  \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	if (index < 0)                                                                      \
+		return MxStatusIllegalArgument;                                                 \
+                                                                                        \
+	if ((size_t)index >= array->count)                                                  \
+		return MxStatusIndexOutOfRange;                                                 \
+                                                                                        \
+	if (removed != NULL)                                                                \
+		*removed = array->items[index];                                                 \
+                                                                                        \
+	memmove(array->items + index, array->items + index + 1,                             \
+	        (array->count - index - 1) * sizeof(T));                                    \
+	array->count -= 1;                                                                  \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+static inline MxStatus name##Clear(name##Ref array)                                     \
+{                                                                                       \
+	if (array == NULL)                                                                  \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	array->count = 0;                                                                   \
+                                                                                        \
+	return MxStatusOK;                                                                  \
+}                                                                                       \
+                                                                                        \
+/* The callback is passed a pointer to each element (a const T *) */                    \
+static inline MxStatus name##Iterate(name##Ref array, MxIteratorCallback callback, void *state) \
+{                                                                                       \
+	if (array == NULL || callback == NULL)                                              \
+		return MxStatusNullArgument;                                                    \
+                                                                                        \
+	MxStatus result = MxStatusOK;                                                       \
+	for (size_t ctr = 0; ctr < array->count; ++ctr)                                     \
+		if ((result = callback(array->items + ctr, state)) != MxStatusOK)               \
+			break;                                                                      \
+                                                                                        \
+	return result;                                                                      \
+}                                                                                       \
+                                                                                        \
+static inline size_t name##GetCount(name##Ref array)                                    \
+{                                                                                       \
+	return (array != NULL) ? array->count : 0;                                          \
+}
+
+#endif
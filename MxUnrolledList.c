@@ -0,0 +1,497 @@
+//
+//  MxUnrolledList.c
+//  core_ds
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+#include "MxUnrolledList.h"
+
+
+// Nodes below this many items try to merge with a neighbour
+#define MergeThreshold (MxUnrolledListNodeCapacity / 2)
+
+
+// -- Nodes -------------------------------------------------------------------
+
+
+static MxUnrolledListNodeRef CreateNodeAfter(MxUnrolledListRef list, MxUnrolledListNodeRef after)
+{
+	MxUnrolledListNodeRef node = (MxUnrolledListNodeRef)malloc(sizeof(MxUnrolledListNode));
+	if (node == NULL)
+		return NULL;
+	
+	node->count = 0;
+	node->prev = after;
+	node->next = (after != NULL) ? after->next : list->head;
+	
+	if (node->next != NULL)
+		node->next->prev = node;
+	else
+		list->tail = node;
+	
+	if (after != NULL)
+		after->next = node;
+	else
+		list->head = node;
+	
+	list->nodeCount += 1;
+	
+	return node;
+}
+
+static void DeleteNode(MxUnrolledListRef list, MxUnrolledListNodeRef node)
+{
+	if (node->prev != NULL)
+		node->prev->next = node->next;
+	else
+		list->head = node->next;
+	
+	if (node->next != NULL)
+		node->next->prev = node->prev;
+	else
+		list->tail = node->prev;
+	
+	list->nodeCount -= 1;
+	free(node);
+}
+
+// Move the items of the node after 'node' into it if they fit
+static void MergeWithNext(MxUnrolledListRef list, MxUnrolledListNodeRef node)
+{
+	MxUnrolledListNodeRef next = node->next;
+	if (next == NULL || node->count + next->count > MxUnrolledListNodeCapacity)
+		return;
+	
+	memcpy(node->items + node->count, next->items, next->count * sizeof(void *));
+	node->count += next->count;
+	DeleteNode(list, next);
+}
+
+// Called after items are taken out of 'node' - drops it if it's empty,
+// otherwise merges it with a neighbour if it's under half full
+static void Rebalance(MxUnrolledListRef list, MxUnrolledListNodeRef node)
+{
+	if (node->count == 0)
+	{
+		DeleteNode(list, node);
+		return;
+	}
+	
+	if (node->count >= MergeThreshold)
+		return;
+	
+	if (node->next != NULL && node->count + node->next->count <= MxUnrolledListNodeCapacity)
+		MergeWithNext(list, node);
+	else if (node->prev != NULL)
+		MergeWithNext(list, node->prev);
+}
+
+// The node holding item 'index' (which must be in range), and its offset in it.
+// Walks from whichever end is nearer, a whole node at a time.
+static MxUnrolledListNodeRef Seek(MxUnrolledListRef list, int index, int *offset)
+{
+	MxUnrolledListNodeRef node;
+	
+	if (index < list->count / 2)
+	{
+		node = list->head;
+		while (index >= node->count)
+		{
+			index -= node->count;
+			node = node->next;
+		}
+	}
+	else
+	{
+		int fromEnd = list->count - index;
+		node = list->tail;
+		while (fromEnd > node->count)
+		{
+			fromEnd -= node->count;
+			node = node->prev;
+		}
+		index = node->count - fromEnd;
+	}
+	
+	*offset = index;
+	
+	return node;
+}
+
+// Put 'data' at 'offset' in 'node', splitting the node first if it's full
+static MxStatus InsertInNode(MxUnrolledListRef list, MxUnrolledListNodeRef node, int offset, void *data)
+{
+	if (node->count == MxUnrolledListNodeCapacity)
+	{
+		MxUnrolledListNodeRef upper = CreateNodeAfter(list, node);
+		if (upper == NULL)
+			return MxStatusNoMemory;
+		
+		int half = MxUnrolledListNodeCapacity / 2;
+		memcpy(upper->items, node->items + half, (node->count - half) * sizeof(void *));
+		upper->count = node->count - half;
+		node->count = half;
+		
+		if (offset > half)
+		{
+			node = upper;
+			offset -= half;
+		}
+	}
+	
+	memmove(node->items + offset + 1, node->items + offset, (node->count - offset) * sizeof(void *));
+	node->items[offset] = data;
+	node->count += 1;
+	list->count += 1;
+	
+	return MxStatusOK;
+}
+
+static void *RemoveFromNode(MxUnrolledListRef list, MxUnrolledListNodeRef node, int offset)
+{
+	void *data = node->items[offset];
+	
+	memmove(node->items + offset, node->items + offset + 1, (node->count - offset - 1) * sizeof(void *));
+	node->count -= 1;
+	list->count -= 1;
+	
+	Rebalance(list, node);
+	
+	return data;
+}
+
+
+// -- Lists -------------------------------------------------------------------
+
+
+MxUnrolledListRef MxUnrolledListCreate(void)
+{
+	return MxUnrolledListCreateWithFunctions(MxDefaultFreeFunction, MxDefaultEqualsFunction);
+}
+
+MxUnrolledListRef MxUnrolledListCreateWithFunctions(MxFreeFunction itemFree, MxEqualsFunction itemEquals)
+{
+	MxUnrolledListRef result = (MxUnrolledListRef)malloc(sizeof(MxUnrolledList));
+	if (result)
+	{
+		if (MxUnrolledListInitWithFunctions(result, itemFree, itemEquals) != MxStatusOK)
+		{
+			free(result);
+			result = NULL;
+		}
+	}
+	
+	return result;
+}
+
+
+MxStatus MxUnrolledListInit(MxUnrolledListRef list)
+{
+	return MxUnrolledListInitWithFunctions(list, MxDefaultFreeFunction, MxDefaultEqualsFunction);
+}
+
+MxStatus MxUnrolledListInitWithFunctions(MxUnrolledListRef list, MxFreeFunction itemFree, MxEqualsFunction itemEquals)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	list->head = NULL;
+	list->tail = NULL;
+	list->itemFree = itemFree;
+	list->itemEquals = itemEquals;
+	list->count = 0;
+	list->nodeCount = 0;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxUnrolledListWipe(MxUnrolledListRef list)
+{
+	return MxUnrolledListClear(list);
+}
+
+MxStatus MxUnrolledListDelete(MxUnrolledListRef list)
+{
+	MxStatus status = MxUnrolledListWipe(list);
+	if (status == MxStatusOK)
+		free(list);
+	
+	return status;
+}
+
+
+MxStatus MxUnrolledListAppend(MxUnrolledListRef list, void *data)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	// Start a fresh node rather than splitting, so appended runs fill nodes completely
+	MxUnrolledListNodeRef node = list->tail;
+	if (node == NULL || node->count == MxUnrolledListNodeCapacity)
+		if ((node = CreateNodeAfter(list, list->tail)) == NULL)
+			return MxStatusNoMemory;
+	
+	node->items[node->count++] = data;
+	list->count += 1;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxUnrolledListPush(MxUnrolledListRef list, void *data)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	MxUnrolledListNodeRef node = list->head;
+	if (node == NULL || node->count == MxUnrolledListNodeCapacity)
+		if ((node = CreateNodeAfter(list, NULL)) == NULL)
+			return MxStatusNoMemory;
+	
+	return InsertInNode(list, node, 0, data);
+}
+
+
+MxStatus MxUnrolledListInsertAtIndex(MxUnrolledListRef list, int index, void *data)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	if (index < 0 || index > list->count)
+		return MxStatusIndexOutOfRange;
+	
+	if (index == list->count)
+		return MxUnrolledListAppend(list, data);
+	
+	int offset;
+	MxUnrolledListNodeRef node = Seek(list, index, &offset);
+	
+	return InsertInNode(list, node, offset, data);
+}
+
+
+MxStatus MxUnrolledListRemoveAtIndex(MxUnrolledListRef list, int index, void **result)
+{
+	if (list == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	if (index < 0 || index >= list->count)
+		return MxStatusIndexOutOfRange;
+	
+	int offset;
+	MxUnrolledListNodeRef node = Seek(list, index, &offset);
+	*result = RemoveFromNode(list, node, offset);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxUnrolledListRemove(MxUnrolledListRef list, void *data)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	for (MxUnrolledListNodeRef node = list->head; node != NULL; node = node->next)
+	{
+		for (int ctr = 0; ctr < node->count; ++ctr)
+		{
+			void *item = node->items[ctr];
+			if (list->itemEquals ? list->itemEquals(item, data) : item == data)
+			{
+				RemoveFromNode(list, node, ctr);
+				if (list->itemFree)
+					list->itemFree(item);
+				
+				return MxStatusOK;
+			}
+		}
+	}
+	
+	return MxStatusNotFound;
+}
+
+
+MxStatus MxUnrolledListPop(MxUnrolledListRef list, void **result)
+{
+	if (list == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = NULL;
+	if (list->count == 0)
+		return MxStatusOK;
+	
+	*result = RemoveFromNode(list, list->head, 0);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxUnrolledListDequeue(MxUnrolledListRef list, void **result)
+{
+	if (list == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	*result = NULL;
+	if (list->count == 0)
+		return MxStatusOK;
+	
+	*result = RemoveFromNode(list, list->tail, list->tail->count - 1);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxUnrolledListItemAt(MxUnrolledListRef list, int index, void **result)
+{
+	if (list == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	if (index < 0 || index >= list->count)
+		return MxStatusIndexOutOfRange;
+	
+	int offset;
+	MxUnrolledListNodeRef node = Seek(list, index, &offset);
+	*result = node->items[offset];
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxUnrolledListClear(MxUnrolledListRef list)
+{
+	if (list == NULL)
+		return MxStatusNullArgument;
+	
+	MxUnrolledListNodeRef node = list->head;
+	while (node != NULL)
+	{
+		MxUnrolledListNodeRef next = node->next;
+		
+		if (list->itemFree)
+			for (int ctr = 0; ctr < node->count; ++ctr)
+				list->itemFree(node->items[ctr]);
+		
+		free(node);
+		node = next;
+	}
+	
+	list->head = NULL;
+	list->tail = NULL;
+	list->count = 0;
+	list->nodeCount = 0;
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxUnrolledListIterateForward(MxUnrolledListRef list, MxIteratorCallback callback, void *state)
+{
+	if (list == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = MxStatusOK;
+	for (MxUnrolledListNodeRef node = list->head; node != NULL; node = node->next)
+		for (int ctr = 0; ctr < node->count; ++ctr)
+			if ((result = callback(node->items[ctr], state)) != MxStatusOK)
+				return result;
+	
+	return result;
+}
+
+
+MxStatus MxUnrolledListIterateBackward(MxUnrolledListRef list, MxIteratorCallback callback, void *state)
+{
+	if (list == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	MxStatus result = MxStatusOK;
+	for (MxUnrolledListNodeRef node = list->tail; node != NULL; node = node->prev)
+		for (int ctr = node->count - 1; ctr >= 0; --ctr)
+			if ((result = callback(node->items[ctr], state)) != MxStatusOK)
+				return result;
+	
+	return result;
+}
+
+
+MxStatus MxUnrolledListFilter(MxUnrolledListRef list, MxIteratorCallback callback, void *state)
+{
+	if (list == NULL || callback == NULL)
+		return MxStatusNullArgument;
+	
+	// Compact each node in place, then tidy up the emptied and sparse nodes
+	MxUnrolledListNodeRef node = list->head;
+	while (node != NULL)
+	{
+		int kept = 0;
+		for (int ctr = 0; ctr < node->count; ++ctr)
+		{
+			void *item = node->items[ctr];
+			
+			if (callback(item, state))
+			{
+				if (list->itemFree)
+					list->itemFree(item);
+			}
+			else
+			{
+				node->items[kept++] = item;
+			}
+		}
+		
+		list->count -= node->count - kept;
+		node->count = kept;
+		
+		MxUnrolledListNodeRef next = node->next;
+		if (kept == 0)
+			DeleteNode(list, node);
+		else if (node->prev != NULL && node->prev->count < MergeThreshold)
+			MergeWithNext(list, node->prev);
+		
+		node = next;
+	}
+	
+	if (list->tail != NULL && list->tail->prev != NULL && list->tail->count < MergeThreshold)
+		MergeWithNext(list, list->tail->prev);
+	
+	return MxStatusOK;
+}
+
+
+MxStatus MxUnrolledListFindIndex(MxUnrolledListRef list, void *lookFor, MxEqualsFunction equalsFunction, int *result)
+{
+	if (list == NULL || result == NULL)
+		return MxStatusNullArgument;
+	
+	MxEqualsFunction equals = (equalsFunction != NULL) ? equalsFunction : list->itemEquals;
+	int base = 0;
+	
+	for (MxUnrolledListNodeRef node = list->head; node != NULL; node = node->next)
+	{
+		for (int ctr = 0; ctr < node->count; ++ctr)
+		{
+			if (equals ? equals(node->items[ctr], lookFor) : node->items[ctr] == lookFor)
+			{
+				*result = base + ctr;
+				return MxStatusOK;
+			}
+		}
+		
+		base += node->count;
+	}
+	
+	*result = -1;
+	
+	return MxStatusNotFound;
+}
+
+
+int MxUnrolledListGetCount(MxUnrolledListRef list)
+{
+	return (list != NULL) ? list->count : 0;
+}
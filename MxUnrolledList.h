@@ -0,0 +1,95 @@
+//
+//  MxUnrolledList.h
+//  core_ds
+//
+//  Doubly-linked list whose nodes each hold a small array of items.
+//
+//  Walking the list touches one node per MxUnrolledListNodeCapacity items
+//  rather than one per item, and seeking to an index skips whole nodes.
+//  Full nodes split in half when inserted into and a node that falls
+//  below half full is merged with a neighbour when the two fit in one,
+//  so edits in the middle cost about what they do in an MxList.
+//
+//  The API mirrors MxList: Pop removes from the front and Dequeue from
+//  the back.
+//
+
+#ifndef core_ds_MxUnrolledList_h
+#define core_ds_MxUnrolledList_h
+
+#include "MxStatus.h"
+#include "MxFunctions.h"
+
+// Items per node - a node is then a few cache lines
+#define MxUnrolledListNodeCapacity (32)
+
+typedef struct _MxUnrolledListNode {
+	struct _MxUnrolledListNode *next;
+	struct _MxUnrolledListNode *prev;
+	
+	int count;
+	void *items[MxUnrolledListNodeCapacity];
+} MxUnrolledListNode, *MxUnrolledListNodeRef;
+
+typedef struct _MxUnrolledList {
+	MxUnrolledListNodeRef head;
+	MxUnrolledListNodeRef tail;
+	
+	MxFreeFunction itemFree;
+	MxEqualsFunction itemEquals;
+	
+	int count;
+	int nodeCount;
+} MxUnrolledList, *MxUnrolledListRef;
+
+
+MxUnrolledListRef MxUnrolledListCreate(void);
+MxUnrolledListRef MxUnrolledListCreateWithFunctions(MxFreeFunction itemFree, MxEqualsFunction itemEquals);
+
+MxStatus MxUnrolledListInit(MxUnrolledListRef list);
+MxStatus MxUnrolledListInitWithFunctions(MxUnrolledListRef list, MxFreeFunction itemFree, MxEqualsFunction itemEquals);
+
+// Frees any items left in the list with its itemFree function
+MxStatus MxUnrolledListWipe(MxUnrolledListRef list);
+MxStatus MxUnrolledListDelete(MxUnrolledListRef list);
+
+
+MxStatus MxUnrolledListAppend(MxUnrolledListRef list, void *data);
+MxStatus MxUnrolledListPush(MxUnrolledListRef list, void *data);
+
+// 'index' may equal the count, which appends
+MxStatus MxUnrolledListInsertAtIndex(MxUnrolledListRef list, int index, void *data);
+
+// Removed items are handed to the caller, not freed
+MxStatus MxUnrolledListRemoveAtIndex(MxUnrolledListRef list, int index, void **result);
+
+// Remove (and free, with the itemFree function) the first item equal to 'data'
+// by the list's itemEquals function, or by identity if it has none
+// returns MxStatusNotFound if there is no such item
+MxStatus MxUnrolledListRemove(MxUnrolledListRef list, void *data);
+
+// Remove the item at the front (Pop) or back (Dequeue) and hand it to the caller.
+// *result is NULL if the list is empty.
+MxStatus MxUnrolledListPop(MxUnrolledListRef list, void **result);
+MxStatus MxUnrolledListDequeue(MxUnrolledListRef list, void **result);
+
+MxStatus MxUnrolledListItemAt(MxUnrolledListRef list, int index, void **result);
+
+MxStatus MxUnrolledListClear(MxUnrolledListRef list);
+
+
+MxStatus MxUnrolledListIterateForward(MxUnrolledListRef list, MxIteratorCallback callback, void *state);
+MxStatus MxUnrolledListIterateBackward(MxUnrolledListRef list, MxIteratorCallback callback, void *state);
+
+// Remove (and free) every item for which 'callback' returns non-0, in one pass
+MxStatus MxUnrolledListFilter(MxUnrolledListRef list, MxIteratorCallback callback, void *state);
+
+// Index of the first item matching 'lookFor' by 'equalsFunction', or the list's
+// itemEquals function if that is NULL, or identity if both are
+// returns MxStatusNotFound (and *result -1) if there is none
+MxStatus MxUnrolledListFindIndex(MxUnrolledListRef list, void *lookFor, MxEqualsFunction equalsFunction, int *result);
+
+
+int MxUnrolledListGetCount(MxUnrolledListRef list);
+
+#endif
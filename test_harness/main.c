@@ -12,6 +12,20 @@
 #include "test_buffer.h"
 #include "test_array_list.h"
 #include "test_bintree.h"
+#include "test_multimap.h"
+#include "test_typed_array.h"
+#include "test_deque.h"
+#include "test_column_table.h"
+#include "test_unrolled_list.h"
+#include "test_counter_table.h"
+#include "test_sorted_array_list.h"
+#include "test_segmented_array.h"
+#include "test_small_array_list.h"
+#include "test_thread_pool.h"
+#include "test_packed_int_array.h"
+#include "test_bitset.h"
+#include "test_roaring.h"
+#include "test_ilist.h"
 
 int main (int argc, const char * argv[])
 {
@@ -21,6 +35,20 @@ int main (int argc, const char * argv[])
     //test_buffer();
     //test_array_list();
     test_bintree();
+    //test_multimap();
+    //test_typed_array();
+    //test_deque();
+    //test_column_table();
+    //test_unrolled_list();
+    //test_counter_table();
+    //test_sorted_array_list();
+    //test_segmented_array();
+    //test_small_array_list();
+    //test_thread_pool();
+    //test_packed_int_array();
+    //test_bitset();
+    //test_roaring();
+    //test_ilist();
     
     return 0;
 }
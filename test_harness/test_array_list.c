@@ -6,20 +6,80 @@
 //  Copyright 2011 __MyCompanyName__. All rights reserved.
 //
 
+// For mincore
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "test_array_list.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "MxArrayList.h"
 
 #include "utils.h"
 
 #define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
 
-static int PrintingIterator(const void *item, void *state);
+static int PrintCallback(const void *value, void *state);
 static void PrintArrayList(MxArrayListRef list);
 
+static void test_sorting(void);
+static void test_index_of(void);
+static void test_bulk(void);
+static void test_removal(void);
+static void test_partition(void);
+static void FillNumbers(MxArrayListRef list, int count);
+static void CheckNumbers(MxArrayListRef list, const int *expected, size_t count, const char *message);
+static int IsMultipleOfThree(const void *item, void *state);
+static int IsEven(const void *item, void *state);
+static void LogFree(void *item);
+
+// Small integers stored in the item pointer itself, offset so that 0 isn't NULL
+#define Number(n) ((void *)(uintptr_t)((n) + 1))
+#define NumberValue(item) ((int)(uintptr_t)(item) - 1)
+
+// What LogFree has been passed
+static int freedNumbers[64];
+static size_t freedCount = 0;
+static void test_growth(void);
+static void CheckGrowth(MxArrayListGrowthPolicy policy, size_t increment, const size_t *expected, size_t expectedCount);
+#ifdef __linux__
+static void test_mapped_storage(void);
+static size_t ResidentPages(MxArrayListRef list);
+#endif
+
+// Sorted by 'key' or 'text'; 'seq' is the original position, to check stability
+typedef struct _SortRecord {
+	uint64_t key;
+	const char *text;
+	size_t seq;
+} SortRecord;
+
+typedef enum _SortInput {
+	SortInputRandom,
+	SortInputSorted,
+	SortInputReversed,
+	SortInputEqual,
+	SortInputCount
+} SortInput;
+
+static const char *SortInputNames[] = { "random", "sorted", "reversed", "all equal" };
+
+static void CheckSorts(const char *title, SortRecord *records, size_t count);
+static void CheckOrder(const char *title, MxArrayListRef list, SortRecord **expected, size_t count, int stable);
+static int CompareRecordKeys(const void *first, const void *second);
+static int QsortByKey(const void *first, const void *second);
+static int QsortByText(const void *first, const void *second);
+static uint64_t RecordKey(const void *item);
+static const char *RecordText(const void *item);
+
 
 void test_array_list(void)
 {
@@ -125,12 +185,777 @@ void test_array_list(void)
 	}
 	
 	PrintArrayList(&list);
+	
+	printf("Backward...\n");
+	check("Iterating backward", MxArrayListIterateBackward(&list, PrintCallback, NULL));
+	
+	printf("Foreach...\n");
+	MX_ARRAYLIST_FOREACH(&list, item)
+		printf("%s\n", (const char *)item);
+	
+	MX_ARRAYLIST_FOREACH_BACKWARD(&list, item)
+		printf("%s\n", (const char *)item);
+	
+	void **items;
+	size_t count;
+	check("Getting span", MxArrayListGetSpan(&list, &items, &count));
+	printf("Span: %zu items, first is %s\n", count, (const char *)items[0]);
+	printf("Item 0: %s\n", (const char *)MxArrayListGetItem(&list, 0));
+	
+	MxArrayListWipe(&list);
+	
+	test_sorting();
+	test_index_of();
+	test_bulk();
+	test_removal();
+	test_partition();
+	test_growth();
+#ifdef __linux__
+	test_mapped_storage();
+#endif
+}
+
+
+// Capacity sequences for each growth policy, explicit sizing, and shrinking
+static void test_growth(void)
+{
+	static const size_t doubling[] = { 10, 20, 40, 80, 160, 320, 640, 1280, 2560 };
+	static const size_t byHalf[] = { 10, 16, 25, 38, 58, 88, 133, 200, 301, 452, 679, 1019, 1529, 2294 };
+	static const size_t byIncrement[] = { 10, 110, 210, 310, 410, 510, 610, 710, 810, 910, 1010,
+	                                      1110, 1210, 1310, 1410, 1510, 1610, 1710, 1810, 1910, 2010 };
+	// Half again, rounded up to 1, 1.25, 1.5 or 1.75 times a power of two bytes
+	static const size_t toSizeClass[] = { 10, 16, 28, 48, 80, 128, 224, 384, 640, 1024, 1792, 3072 };
+	
+	MxStatus status = MxStatusOK;
+	MxArrayList list;
+	static char items[2];
+	void *item = NULL;
+	
+	printf("\n-- Growth ------\n");
+	
+	CheckGrowth(MxArrayListGrowByDoubling, 0, doubling, sizeof(doubling) / sizeof(size_t));
+	CheckGrowth(MxArrayListGrowByHalf, 0, byHalf, sizeof(byHalf) / sizeof(size_t));
+	CheckGrowth(MxArrayListGrowByIncrement, 100, byIncrement, sizeof(byIncrement) / sizeof(size_t));
+	CheckGrowth(MxArrayListGrowToSizeClass, 0, toSizeClass, sizeof(toSizeClass) / sizeof(size_t));
+	
+	check("Initialising growth list", MxArrayListInitWithCapacity(&list, 10));
+	status = MxArrayListSetGrowthPolicy(&list, MxArrayListGrowByIncrement, 0);
+	expect(status == MxStatusIllegalArgument, "A zero increment should be rejected");
+	status = MxArrayListSetGrowthPolicy(&list, (MxArrayListGrowthPolicy)99, 0);
+	expect(status == MxStatusIllegalArgument, "An unknown policy should be rejected");
+	
+	// Reserve allocates exactly what's asked for, once, and never shrinks
+	check("Reserve", MxArrayListReserve(&list, 5000));
+	expect(list.capacity == 5000, "Reserve should allocate exactly");
+	check("Reserve smaller", MxArrayListReserve(&list, 100));
+	expect(list.capacity == 5000, "Reserving less shouldn't shrink");
+	
+	for (size_t ctr = 0; ctr < 5000; ++ctr)
+		check("Appending reserved", MxArrayListAppend(&list, items + ctr % 2));
+	expect(list.capacity == 5000, "Appends within the reservation shouldn't grow");
+	
+	// ShrinkToFit cuts to the count, keeping one slot when empty
+	for (size_t ctr = 0; ctr < 4000; ++ctr)
+		check("Popping", MxArrayListPop(&list, &item));
+	check("Shrink to fit", MxArrayListShrinkToFit(&list));
+	expect(list.capacity == 1000 && MxArrayListGetCount(&list) == 1000, "ShrinkToFit should cut to the count");
+	
+	check("Clearing", MxArrayListClear(&list));
+	check("Shrink empty", MxArrayListShrinkToFit(&list));
+	expect(list.capacity == 1, "ShrinkToFit on an empty list should keep one slot");
+	check("Append after shrink", MxArrayListAppend(&list, items));
+	check("Append after shrink", MxArrayListAppend(&list, items + 1));
+	expect(MxArrayListGetCount(&list) == 2 && list.items[1] == items + 1, "Should grow again after shrinking");
+	
+	MxArrayListWipe(&list);
+	
+	// Auto shrink waits until a quarter full, then halves to twice the count - never
+	// below the default capacity
+	check("Initialising shrinking list", MxArrayListInitWithCapacity(&list, 1024));
+	check("Auto shrink on", MxArrayListSetAutoShrink(&list, 1));
+	for (size_t ctr = 0; ctr < 1024; ++ctr)
+		check("Filling", MxArrayListAppend(&list, items));
+	
+	size_t capacity = list.capacity;
+	int shrinks = 0;
+	while (MxArrayListGetCount(&list) > 0)
+	{
+		check("Auto shrink pop", MxArrayListPop(&list, &item));
+		
+		size_t count = MxArrayListGetCount(&list);
+		if (list.capacity != capacity)
+		{
+			size_t expected = (count * 2 > MxArrayListDefaultCapacity) ? count * 2 : MxArrayListDefaultCapacity;
+			expect(count <= capacity / MxArrayListShrinkDivisor, "Shrank before a quarter full");
+			expect(list.capacity == expected, "Should shrink to twice the count");
+			
+			// Hovering around the new size doesn't regrow or shrink again
+			check("Hover push", MxArrayListAppend(&list, items));
+			check("Hover pop", MxArrayListPop(&list, &item));
+			expect(list.capacity == expected, "Hovering after a shrink changed the capacity");
+			
+			shrinks++;
+			capacity = list.capacity;
+		}
+		else
+		{
+			expect(capacity <= MxArrayListDefaultCapacity || count > capacity / MxArrayListShrinkDivisor, "Didn't shrink at a quarter full");
+		}
+	}
+	
+	printf("Auto shrink: %d shrinks down to capacity %zu\n", shrinks, list.capacity);
+	expect(list.capacity == MxArrayListDefaultCapacity, "Should stop at the default capacity");
+	
+	// Clear shrinks straight down
+	check("Reserve again", MxArrayListReserve(&list, 4096));
+	for (size_t ctr = 0; ctr < 4096; ++ctr)
+		check("Refilling", MxArrayListAppend(&list, items));
+	check("Clear shrinking list", MxArrayListClear(&list));
+	expect(list.capacity == MxArrayListDefaultCapacity, "Clear should shrink to the default capacity");
+	
+	MxArrayListWipe(&list);
+}
+
+
+// Append until past 2000 items from a capacity of 10, checking each capacity in turn
+static void CheckGrowth(MxArrayListGrowthPolicy policy, size_t increment, const size_t *expected, size_t expectedCount)
+{
+	MxStatus status = MxStatusOK;
+	MxArrayList list;
+	size_t step = 0;
+	
+	check("Initialising growth list", MxArrayListInitWithCapacity(&list, 10));
+	check("Setting growth policy", MxArrayListSetGrowthPolicy(&list, policy, increment));
+	expect(list.capacity == expected[0], "Wrong initial capacity");
+	
+	for (size_t ctr = 0; ctr < 2001; ++ctr)
+	{
+		check("Growth append", MxArrayListAppend(&list, NULL));
+		
+		if (list.capacity != expected[step])
+		{
+			step++;
+			expect(step < expectedCount && list.capacity == expected[step], "Unexpected capacity");
+			expect(ctr == expected[step - 1], "Grew before the list was full");
+		}
+	}
+	
+	expect(step == expectedCount - 1, "Missed a growth step");
+	printf("Policy %d: %zu reallocs to capacity %zu\n", (int)policy, step, list.capacity);
+	
+	MxArrayListWipe(&list);
+}
+
+
+#ifdef __linux__
+
+// Mapped lists grow with mremap, so the mapping must always cover the whole capacity,
+// and Clear drops their pages
+static void test_mapped_storage(void)
+{
+	MxStatus status = MxStatusOK;
+	MxArrayList list;
+	void *item;
+	size_t pageItems = (size_t)sysconf(_SC_PAGESIZE) / sizeof(void *);
+	size_t hugePageItems = ((size_t)2 << 20) / sizeof(void *);
+	
+	printf("\n-- Mapped storage ------\n");
+	
+	// Capacity is rounded up to whole pages, and the items start on a page
+	check("Initialising mapped list", MxArrayListInitWithStorage(&list, 10, MxArrayListMappedStorage, NULL, NULL));
+	expect(list.capacity == pageItems, "Mapped capacity should round up to a page");
+	expect((uintptr_t)list.items % (pageItems * sizeof(void *)) == 0, "Mapped items should be page aligned");
+	
+	size_t count = pageItems * 40 + 3;
+	size_t lastCapacity = list.capacity;
+	int growths = 0;
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		check("Mapped append", MxArrayListAppend(&list, (void *)(uintptr_t)(ctr + 1)));
+		
+		if (list.capacity != lastCapacity)
+		{
+			growths++;
+			expect(list.capacity % pageItems == 0, "Grown capacity should be whole pages");
+			
+			// mincore fails if any of the range isn't mapped
+			ResidentPages(&list);
+			lastCapacity = list.capacity;
+		}
+	}
+	
+	printf("%zu items, capacity %zu after %d mremaps\n", count, list.capacity, growths);
+	expect(growths > 0, "Mapped list should have grown");
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		check("Mapped item at", MxArrayListItemAt(&list, (int)ctr, &item));
+		expect(item == (void *)(uintptr_t)(ctr + 1), "Item lost in mremap");
+	}
+	
+	// Clear hands every page back and leaves the capacity alone...
+	expect(ResidentPages(&list) > 0, "Filled list should have resident pages");
+	size_t capacity = list.capacity;
+	check("Clearing mapped list", MxArrayListClear(&list));
+	expect(ResidentPages(&list) == 0, "Clear should drop the pages");
+	expect(list.capacity == capacity && MxArrayListGetCount(&list) == 0, "Clear should keep the mapping");
+	
+	// ...which come back zero-filled when the list is reused
+	expect(list.items[count - 1] == NULL, "Dropped pages should read as zero");
+	for (size_t ctr = 0; ctr < pageItems * 2; ++ctr)
+		check("Append after clear", MxArrayListAppend(&list, (void *)(uintptr_t)(ctr + 7)));
+	check("Item after clear", MxArrayListItemAt(&list, (int)(pageItems * 2 - 1), &item));
+	expect(item == (void *)(uintptr_t)(pageItems * 2 + 6), "Wrong item after reuse");
+	expect(list.capacity == capacity, "Reuse shouldn't remap");
+	
+	check("Wiping mapped list", MxArrayListWipe(&list));
+	expect(list.items == NULL, "Wipe should unmap the items");
+	
+	// Huge page lists round to 2MB
+	check("Initialising huge page list", MxArrayListInitWithStorage(&list, 10, MxArrayListHugePageStorage, NULL, NULL));
+	expect(list.capacity == hugePageItems, "Huge page capacity should round up to 2MB");
+	
+	for (size_t ctr = 0; ctr < hugePageItems + 1; ++ctr)
+		check("Huge page append", MxArrayListAppend(&list, (void *)(uintptr_t)(ctr + 1)));
+	expect(list.capacity == hugePageItems * 2, "Huge page list should grow by whole huge pages");
+	check("Huge page item at", MxArrayListItemAt(&list, (int)hugePageItems, &item));
+	expect(item == (void *)(uintptr_t)(hugePageItems + 1), "Item lost growing the huge page list");
+	
+	check("Wiping huge page list", MxArrayListWipe(&list));
+	
+	printf("Mapped and huge page lists grow, clear and reuse\n");
+}
+
+
+// Pages of the list's mapping that are in memory
+static size_t ResidentPages(MxArrayListRef list)
+{
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t pages = (list->capacity * sizeof(void *) + pageSize - 1) / pageSize;
+	unsigned char *resident = (unsigned char *)malloc(pages);
+	expect(resident != NULL, "Allocating residency vector");
+	
+	if (mincore(list->items, list->capacity * sizeof(void *), resident) != 0)
+		die("Mapping doesn't cover the list's capacity");
+	
+	size_t result = 0;
+	for (size_t ctr = 0; ctr < pages; ++ctr)
+		result += resident[ctr] & 1;
+	
+	free(resident);
+	
+	return result;
+}
+
+#endif
+
+
+// The identity search compares several items at a time - check a match at every
+// position within a vector, in the scalar tail, and no match at all
+static void test_index_of(void)
+{
+	MxStatus status = MxStatusOK;
+	MxArrayList list;
+	static char items[80];
+	char absent;
+	
+	printf("\n-- Index of ------\n");
+	
+	check("Initialising search list", MxArrayListInit(&list));
+	
+	for (int count = 0; count <= 70; ++count)
+	{
+		check("Clearing search list", MxArrayListClear(&list));
+		for (int ctr = 0; ctr < count; ++ctr)
+			check("Appending search item", MxArrayListAppend(&list, items + ctr));
+		
+		for (int ctr = 0; ctr < count; ++ctr)
+			expect(MxArrayListIndexOf(&list, items + ctr) == ctr, "IndexOf missed an item");
+		
+		expect(MxArrayListIndexOf(&list, &absent) == -1, "IndexOf found an absent item");
+		
+		// The first of two matches wins, wherever the second is
+		if (count >= 2)
+		{
+			check("Duplicating last item", MxArrayListReplaceAt(&list, items + count - 1, 0));
+			expect(MxArrayListIndexOf(&list, items + count - 1) == 0, "IndexOf should find the first match");
+		}
+	}
+	
+	printf("IndexOf matched every position in lists of up to 70 items\n");
+	
+	// Big enough to be split across threads, including the 32nd
+	size_t count = MxArrayListParallelSearchThreshold + 12345;
+	check("Clearing search list", MxArrayListClear(&list));
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		check("Appending search item", MxArrayListAppend(&list, items));
+	
+	size_t positions[] = { 0, 1, count / 2, count - MxArrayListParallelSearchBlock, count - 1 };
+	for (size_t ctr = 0; ctr < sizeof(positions) / sizeof(positions[0]); ++ctr)
+	{
+		check("Placing search item", MxArrayListReplaceAt(&list, items + 1, (int)positions[ctr]));
+		expect(MxArrayListIndexOfParallel(&list, items + 1, MxArrayListParallelMaxThreads) == (int)positions[ctr], "Parallel IndexOf missed the item");
+		expect(MxArrayListIndexOfParallel(&list, items + 1, 0) == (int)positions[ctr], "Parallel IndexOf missed the item");
+		check("Removing search item", MxArrayListReplaceAt(&list, items, (int)positions[ctr]));
+	}
+	
+	expect(MxArrayListIndexOfParallel(&list, &absent, MxArrayListParallelMaxThreads) == -1, "Parallel IndexOf found an absent item");
+	
+	printf("Parallel IndexOf matched across %d threads\n", MxArrayListParallelMaxThreads);
+	
+	MxArrayListWipe(&list);
+}
+
+
+// AppendMany, InsertManyAt, Extend and RemoveRange
+static void test_bulk(void)
+{
+	MxStatus status = MxStatusOK;
+	MxArrayList list;
+	const void *numbers[20];
+	void *removed[8];
+	
+	printf("\n-- Bulk operations ------\n");
+	
+	for (int ctr = 0; ctr < 20; ++ctr)
+		numbers[ctr] = Number(ctr);
+	
+	// Growing past the capacity in one go allocates exactly what's needed, once
+	check("Initialising bulk list", MxArrayListInitWithCapacityAndFunctions(&list, 4, LogFree, NULL));
+	check("Appending many", MxArrayListAppendMany(&list, numbers, 3));
+	expect(list.capacity == 4, "AppendMany within the capacity shouldn't grow");
+	check("Appending many", MxArrayListAppendMany(&list, numbers + 3, 7));
+	expect(list.capacity == 10, "AppendMany should grow straight to the count, not double twice");
+	static const int tenNumbers[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+	CheckNumbers(&list, tenNumbers, 10, "AppendMany");
+	
+	check("Appending nothing", MxArrayListAppendMany(&list, NULL, 0));
+	CheckNumbers(&list, tenNumbers, 10, "Appending nothing changed the list");
+	
+	// Inserting at the front, the end and in between
+	check("Inserting at the front", MxArrayListInsertManyAt(&list, numbers + 10, 2, 0));
+	check("Inserting at the end", MxArrayListInsertManyAt(&list, numbers + 12, 2, 12));
+	check("Inserting in the middle", MxArrayListInsertManyAt(&list, numbers + 14, 3, 5));
+	static const int inserted[] = { 10, 11, 0, 1, 2, 14, 15, 16, 3, 4, 5, 6, 7, 8, 9, 12, 13 };
+	CheckNumbers(&list, inserted, 17, "InsertManyAt");
+	
+	status = MxArrayListInsertManyAt(&list, numbers, 1, 18);
+	expect(status == MxStatusIndexOutOfRange, "Inserting past the end should be out of range");
+	status = MxArrayListInsertManyAt(&list, numbers, 1, -1);
+	expect(status == MxStatusIllegalArgument, "Inserting at a negative index should be rejected");
+	check("Inserting nothing", MxArrayListInsertManyAt(&list, NULL, 0, 17));
+	CheckNumbers(&list, inserted, 17, "Failed and empty inserts changed the list");
+	
+	// RemoveRange hands the items over when given a buffer...
+	freedCount = 0;
+	check("Removing a range", MxArrayListRemoveRange(&list, 5, 3, removed));
+	expect(freedCount == 0, "Items removed into a buffer shouldn't be freed");
+	expect(NumberValue(removed[0]) == 14 && NumberValue(removed[1]) == 15 && NumberValue(removed[2]) == 16, "RemoveRange returned the wrong items");
+	static const int afterRange[] = { 10, 11, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 12, 13 };
+	CheckNumbers(&list, afterRange, 14, "RemoveRange into a buffer");
+	expect(list.items[14] == NULL && list.items[16] == NULL, "RemoveRange should clear the vacated slots");
+	
+	// ...and frees them otherwise, up to and including the last item
+	check("Removing the front", MxArrayListRemoveRange(&list, 0, 2, NULL));
+	check("Removing the end", MxArrayListRemoveRange(&list, 10, 2, NULL));
+	expect(freedCount == 4 && freedNumbers[0] == 10 && freedNumbers[1] == 11 && freedNumbers[2] == 12 && freedNumbers[3] == 13, "RemoveRange freed the wrong items");
+	CheckNumbers(&list, tenNumbers, 10, "RemoveRange with itemFree");
+	
+	// Zero-length ranges anywhere up to the end are fine; anything past it isn't
+	check("Removing nothing", MxArrayListRemoveRange(&list, 4, 0, NULL));
+	check("Removing nothing at the end", MxArrayListRemoveRange(&list, 10, 0, NULL));
+	status = MxArrayListRemoveRange(&list, 11, 0, NULL);
+	expect(status == MxStatusIndexOutOfRange, "An empty range past the end should be out of range");
+	status = MxArrayListRemoveRange(&list, 8, 3, NULL);
+	expect(status == MxStatusIndexOutOfRange, "A range running off the end should be out of range");
+	status = MxArrayListRemoveRange(&list, 0, SIZE_MAX, NULL);
+	expect(status == MxStatusIndexOutOfRange, "A huge range should be out of range");
+	status = MxArrayListRemoveRange(&list, -1, 1, NULL);
+	expect(status == MxStatusIllegalArgument, "A negative index should be rejected");
+	expect(freedCount == 4, "Rejected ranges freed items");
+	CheckNumbers(&list, tenNumbers, 10, "Empty and rejected ranges changed the list");
+	
+	// Extending a list with itself doubles it, even when that means growing
+	check("Shrinking to fit", MxArrayListShrinkToFit(&list));
+	expect(list.capacity == 10, "Expected an exactly full list");
+	check("Extending with itself", MxArrayListExtend(&list, &list));
+	static const int doubled[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+	CheckNumbers(&list, doubled, 20, "Extend with itself");
+	expect(list.capacity == 20, "Extend grew the wrong amount");
+	
+	printf("Bulk appends, inserts, extends and range removals correct\n");
+	
+	MxArrayListWipe(&list);
+}
+
+
+static void test_removal(void)
+{
+	MxStatus status = MxStatusOK;
+	MxArrayList list;
+	void *removed = NULL;
+	int calls = 0;
+	
+	printf("\n-- Removal ------\n");
+	
+	// Exactly full, so a move of one item too many reads past the array
+	check("Initialising removal list", MxArrayListInitWithCapacityAndFunctions(&list, 10, LogFree, NULL));
+	FillNumbers(&list, 10);
+	
+	check("Removing the last item", MxArrayListRemoveAt(&list, 9, &removed));
+	expect(NumberValue(removed) == 9, "RemoveAt returned the wrong item");
+	static const int afterLast[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+	CheckNumbers(&list, afterLast, 9, "RemoveAt of the last item");
+	
+	check("Removing a middle item", MxArrayListRemoveAt(&list, 4, &removed));
+	expect(NumberValue(removed) == 4, "RemoveAt returned the wrong item");
+	static const int afterMiddle[] = { 0, 1, 2, 3, 5, 6, 7, 8 };
+	CheckNumbers(&list, afterMiddle, 8, "RemoveAt of a middle item");
+	expect(list.items[8] == NULL, "RemoveAt should clear the vacated slot");
+	
+	status = MxArrayListRemoveAt(&list, 8, &removed);
+	expect(status == MxStatusIndexOutOfRange, "RemoveAt at the count should be out of range");
+	
+	// SwapRemove fills the hole with the last item
+	check("Clearing", MxArrayListClear(&list));
+	FillNumbers(&list, 10);
+	freedCount = 0;
+	
+	check("Swap removing", MxArrayListSwapRemove(&list, 2, &removed));
+	expect(NumberValue(removed) == 2, "SwapRemove returned the wrong item");
+	static const int afterSwap[] = { 0, 1, 9, 3, 4, 5, 6, 7, 8 };
+	CheckNumbers(&list, afterSwap, 9, "SwapRemove from the middle");
+	
+	check("Swap removing the last item", MxArrayListSwapRemove(&list, 8, &removed));
+	expect(NumberValue(removed) == 8, "SwapRemove returned the wrong item");
+	CheckNumbers(&list, afterSwap, 8, "SwapRemove of the last item");
+	expect(list.items[8] == NULL, "SwapRemove should clear the vacated slot");
+	expect(freedCount == 0, "Removed items are the caller's, not freed");
+	
+	status = MxArrayListSwapRemove(&list, 8, &removed);
+	expect(status == MxStatusIndexOutOfRange, "SwapRemove at the count should be out of range");
+	
+	// RemoveIf frees exactly the items it removes, and asks about each item once
+	check("Clearing", MxArrayListClear(&list));
+	FillNumbers(&list, 20);
+	freedCount = 0;
+	
+	check("Removing multiples of 3", MxArrayListRemoveIf(&list, IsMultipleOfThree, &calls));
+	expect(calls == 20, "RemoveIf should ask about each item once");
+	static const int notThrees[] = { 1, 2, 4, 5, 7, 8, 10, 11, 13, 14, 16, 17, 19 };
+	CheckNumbers(&list, notThrees, 13, "RemoveIf kept the wrong items");
+	expect(freedCount == 7, "RemoveIf freed the wrong number of items");
+	for (size_t ctr = 0; ctr < freedCount; ++ctr)
+		expect(freedNumbers[ctr] == (int)ctr * 3, "RemoveIf freed the wrong items");
+	
+	// Removing nothing, and then everything
+	calls = 0;
+	freedCount = 0;
+	check("Removing nothing", MxArrayListRemoveIf(&list, IsMultipleOfThree, &calls));
+	expect(calls == 13 && freedCount == 0, "RemoveIf with no matches changed something");
+	CheckNumbers(&list, notThrees, 13, "RemoveIf with no matches");
+	
+	check("Clearing", MxArrayListClear(&list));
+	for (int ctr = 0; ctr < 5; ++ctr)
+		check("Appending threes", MxArrayListAppend(&list, Number(ctr * 3)));
+	calls = 0;
+	freedCount = 0;
+	check("Removing everything", MxArrayListRemoveIf(&list, IsMultipleOfThree, &calls));
+	expect(calls == 5 && freedCount == 5 && MxArrayListGetCount(&list) == 0, "RemoveIf should remove every match");
+	
+	calls = 0;
+	check("Removing from an empty list", MxArrayListRemoveIf(&list, IsMultipleOfThree, &calls));
+	expect(calls == 0 && freedCount == 5, "RemoveIf on an empty list did something");
+	status = MxArrayListSwapRemove(&list, 0, &removed);
+	expect(status == MxStatusIndexOutOfRange, "SwapRemove from an empty list should be out of range");
+	
+	printf("RemoveAt, SwapRemove and RemoveIf removed and freed the right items\n");
+	
+	MxArrayListWipe(&list);
+}
+
+
+static void test_partition(void)
+{
+	MxStatus status = MxStatusOK;
+	MxArrayList list;
+	size_t split = 99;
+	int calls = 0;
+	
+	printf("\n-- Partition ------\n");
+	
+	check("Initialising partition list", MxArrayListInit(&list));
+	
+	for (int stable = 0; stable < 2; ++stable)
+	{
+		const char *name = stable ? "StablePartition" : "Partition";
+		
+		// Empty lists, no matches, all matches and a mix - odd and even lengths
+		for (int count = 0; count <= 21; ++count)
+		{
+			for (int pattern = 0; pattern < 3; ++pattern)
+			{
+				check("Clearing", MxArrayListClear(&list));
+				
+				// 0: alternating, 1: all even, 2: all odd
+				int step = (pattern == 0) ? 1 : 2;
+				int first = (pattern == 2) ? 1 : 0;
+				for (int ctr = 0; ctr < count; ++ctr)
+					check("Appending", MxArrayListAppend(&list, Number(first + ctr * step)));
+				
+				calls = 0;
+				if (stable)
+					check(name, MxArrayListStablePartition(&list, IsEven, &calls, &split))
+				else
+					check(name, MxArrayListPartition(&list, IsEven, &calls, &split))
+				
+				size_t evens = (pattern == 0) ? (size_t)(count + 1) / 2 : (pattern == 1) ? (size_t)count : 0;
+				expect(calls == count, "Partition should ask about each item once");
+				expect(split == evens, "Partition returned the wrong split");
+				expect(MxArrayListGetCount(&list) == (size_t)count, "Partition changed the count");
+				
+				// Every item still there once, matches first; in order for StablePartition
+				int seen[64] = { 0 };
+				int lastEven = -1, lastOdd = -1;
+				for (size_t ctr = 0; ctr < (size_t)count; ++ctr)
+				{
+					int value = NumberValue(list.items[ctr]);
+					expect((value % 2 == 0) == (ctr < split), "Partition left an item on the wrong side");
+					expect(value >= 0 && value < 64 && !seen[value], "Partition lost or duplicated an item");
+					seen[value] = 1;
+					
+					int *last = (value % 2 == 0) ? &lastEven : &lastOdd;
+					expect(!stable || value > *last, "StablePartition changed the relative order");
+					*last = value;
+				}
+			}
+		}
+	}
+	
+	printf("Partition and StablePartition split lists of 0 to 21 items\n");
+	
+	MxArrayListWipe(&list);
+}
+
+
+// The list holds Number(0) to Number(count - 1), after whatever it held already
+static void FillNumbers(MxArrayListRef list, int count)
+{
+	MxStatus status = MxStatusOK;
+	
+	for (int ctr = 0; ctr < count; ++ctr)
+		check("Appending number", MxArrayListAppend(list, Number(ctr)));
+}
+
+static void CheckNumbers(MxArrayListRef list, const int *expected, size_t count, const char *message)
+{
+	expect(MxArrayListGetCount(list) == count, message);
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		expect(NumberValue(list->items[ctr]) == expected[ctr], message);
+}
+
+// Both count their calls in the int 'state' points to
+static int IsMultipleOfThree(const void *item, void *state)
+{
+	*(int *)state += 1;
+	return NumberValue(item) % 3 == 0;
+}
+
+static int IsEven(const void *item, void *state)
+{
+	*(int *)state += 1;
+	return NumberValue(item) % 2 == 0;
+}
+
+static void LogFree(void *item)
+{
+	if (freedCount < sizeof(freedNumbers) / sizeof(freedNumbers[0]))
+		freedNumbers[freedCount] = NumberValue(item);
+	freedCount++;
+}
+
+
+// Every sort against qsort, on patterned inputs with plenty of duplicate keys
+static void test_sorting(void)
+{
+	static const char *texts[] = { "pear", "apple", "", NULL, "apples", "app", "banana", "pea", "a", "peach" };
+	static const size_t sizes[] = { 0, 1, 2, 31, 33, 1000 };
+	size_t textCount = sizeof(texts) / sizeof(texts[0]);
+	
+	printf("\n-- Sorting ------\n");
+	
+	SortRecord *records = (SortRecord *)malloc(1000 * sizeof(SortRecord));
+	expect(records != NULL, "Allocating sort records");
+	
+	srand(42);
+	for (int input = 0; input < SortInputCount; ++input)
+	{
+		for (size_t sizeIdx = 0; sizeIdx < sizeof(sizes) / sizeof(sizes[0]); ++sizeIdx)
+		{
+			size_t count = sizes[sizeIdx];
+			
+			for (size_t ctr = 0; ctr < count; ++ctr)
+			{
+				size_t rank;
+				switch (input)
+				{
+					case SortInputRandom:   rank = (size_t)rand() % 37; break;
+					case SortInputSorted:   rank = ctr / 3; break;
+					case SortInputReversed: rank = (count - ctr) / 3; break;
+					default:                rank = 7; break;
+				}
+				
+				// Keys straddle the byte boundaries the int radix sort works on
+				records[ctr].key = (uint64_t)rank * 0x01010101010101ULL;
+				records[ctr].text = texts[rank % textCount];
+				records[ctr].seq = ctr;
+			}
+			
+			char title[64];
+			snprintf(title, sizeof(title), "%zu %s", count, SortInputNames[input]);
+			CheckSorts(title, records, count);
+		}
+	}
+	
+	free(records);
+	
+	// Keys sharing long prefixes used to recurse once per shared character
+	size_t length = 5000;
+	char *longKey = (char *)malloc(length + 1);
+	expect(longKey != NULL, "Allocating long key");
+	memset(longKey, 'x', length);
+	longKey[length] = '\0';
+	
+	SortRecord longRecords[200];
+	for (size_t ctr = 0; ctr < 64; ++ctr)
+		longRecords[ctr] = (SortRecord){ 0, longKey, ctr };
+	CheckSorts("64 identical 5000 character keys", longRecords, 64);
+	
+	// ...and nested prefixes of one another, each level splitting off a single key
+	for (size_t ctr = 0; ctr < 200; ++ctr)
+		longRecords[ctr] = (SortRecord){ 0, longKey + length - ((ctr * 7919) % 200), ctr };
+	CheckSorts("200 nested prefixes", longRecords, 200);
+	
+	free(longKey);
+}
+
+
+// Run all four sorts over the records and compare each with qsort
+static void CheckSorts(const char *title, SortRecord *records, size_t count)
+{
+	MxStatus status = MxStatusOK;
+	MxArrayList list;
+	
+	SortRecord **byKey = (SortRecord **)malloc((count + 1) * sizeof(SortRecord *));
+	SortRecord **byText = (SortRecord **)malloc((count + 1) * sizeof(SortRecord *));
+	expect(byKey != NULL && byText != NULL, "Allocating expected orders");
+	
+	// Ties break on the original position, giving the stable order
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		byKey[ctr] = byText[ctr] = records + ctr;
+	qsort(byKey, count, sizeof(SortRecord *), QsortByKey);
+	qsort(byText, count, sizeof(SortRecord *), QsortByText);
+	
+	check("Initialising sort list", MxArrayListInitWithCapacity(&list, count + 1));
+	
+	for (int sort = 0; sort < 4; ++sort)
+	{
+		check("Clearing sort list", MxArrayListClear(&list));
+		for (size_t ctr = 0; ctr < count; ++ctr)
+			check("Appending record", MxArrayListAppend(&list, records + ctr));
+		
+		switch (sort)
+		{
+			case 0:
+				check("Sort", MxArrayListSort(&list, CompareRecordKeys));
+				CheckOrder("Sort", &list, byKey, count, 0);
+				break;
+			case 1:
+				check("Stable sort", MxArrayListStableSort(&list, CompareRecordKeys));
+				CheckOrder("Stable sort", &list, byKey, count, 1);
+				break;
+			case 2:
+				check("Int radix sort", MxArrayListRadixSortByIntKey(&list, RecordKey));
+				CheckOrder("Int radix sort", &list, byKey, count, 1);
+				break;
+			default:
+				check("String radix sort", MxArrayListRadixSortByStringKey(&list, RecordText));
+				CheckOrder("String radix sort", &list, byText, count, 1);
+				break;
+		}
+	}
+	
+	MxArrayListWipe(&list);
+	free(byKey);
+	free(byText);
+	
+	printf("%s: sorted\n", title);
+}
+
+
+// A stable sort must match 'expected' exactly; an unstable one must match its keys and
+// hold each record once
+static void CheckOrder(const char *title, MxArrayListRef list, SortRecord **expected, size_t count, int stable)
+{
+	expect(list->count == count, title);
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		SortRecord *record = (SortRecord *)list->items[ctr];
+		
+		if (stable)
+			expect(record == expected[ctr], title)
+		else
+			expect(record->key == expected[ctr]->key, title);
+	}
+	
+	if (!stable)
+	{
+		size_t seqSum = 0;
+		for (size_t ctr = 0; ctr < count; ++ctr)
+			seqSum += ((SortRecord *)list->items[ctr])->seq;
+		expect(count == 0 || seqSum == count * (count - 1) / 2, title);
+	}
+}
+
+
+static int CompareRecordKeys(const void *first, const void *second)
+{
+	uint64_t a = ((const SortRecord *)first)->key, b = ((const SortRecord *)second)->key;
+	return (a > b) - (a < b);
+}
+
+static int QsortByKey(const void *first, const void *second)
+{
+	const SortRecord *a = *(SortRecord * const *)first, *b = *(SortRecord * const *)second;
+	int result = CompareRecordKeys(a, b);
+	return result ? result : (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+// NULL texts sort as ""
+static int QsortByText(const void *first, const void *second)
+{
+	const SortRecord *a = *(SortRecord * const *)first, *b = *(SortRecord * const *)second;
+	int result = strcmp(a->text ? a->text : "", b->text ? b->text : "");
+	return result ? result : (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+static uint64_t RecordKey(const void *item)
+{
+	return ((const SortRecord *)item)->key;
+}
+
+static const char *RecordText(const void *item)
+{
+	return ((const SortRecord *)item)->text;
 }
 
 static int PrintCallback(const void *value, void *state)
 {
 	fprintf(stdout, "%s\n", (const char *)value);
-	return 0;
+	return MxStatusOK;
 }
 
 static void PrintArrayList(MxArrayListRef list)
@@ -23,6 +23,19 @@ static int NumberPrintingIterator(const void *item, void *state);
 static void PrintNumberTree(const char *title, MxBinaryTreeRef tree);
 static void PrintStringTree(const char *title, MxBinaryTreeRef tree);
 static void ShuffleIntArray(int array[], int len);
+static void test_breadth_first(void);
+static void InsertBalanced(MxBinaryTreeRef tree, int *values, int low, int high);
+static int CollectingIterator(const void *item, void *state);
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+// Where CollectingIterator writes, and when it should stop the walk
+typedef struct {
+	int values[127];
+	int count;
+	int stopAt;
+} CollectState;
 
 
 void test_bintree(void)
@@ -105,6 +118,90 @@ void test_bintree(void)
     if ((numStatus = MxBinaryTreeWipe(&numberTree)) != MxStatusOK) {
         dieWithStatus("Wiping number tree", numStatus);
     }
+	
+	test_breadth_first();
+}
+
+
+static void test_breadth_first(void)
+{
+	MxStatus status = MxStatusOK;
+	MxBinaryTree tree;
+	CollectState state = { { 0 }, 0, 0 };
+	int values[127];
+	
+	printf("\n-- Breadth first walk ------\n");
+	
+	check("Initialising", MxBinaryTreeInitWithComparer(&tree, MxDefaultCompareIntFunction));
+	
+	check("Walking an empty tree", MxBinaryTreeWalkBreadthFirst(&tree, CollectingIterator, &state));
+	expect(state.count == 0, "Walking an empty tree visited something");
+	
+	static int small[] = { 50, 30, 70, 20, 40, 60, 80, 10 };
+	for (int ctr = 0; ctr < 8; ++ctr)
+		check("Inserting", MxBinaryTreeInsert(&tree, small + ctr));
+	
+	check("Walking", MxBinaryTreeWalkBreadthFirst(&tree, CollectingIterator, &state));
+	expect(state.count == 8, "Walk missed nodes");
+	for (int ctr = 0; ctr < 8; ++ctr)
+		expect(state.values[ctr] == small[ctr], "Walk wasn't in level order");
+	
+	// A callback that fails stops the walk with its status
+	state.count = 0;
+	state.stopAt = 3;
+	status = MxBinaryTreeWalkBreadthFirst(&tree, CollectingIterator, &state);
+	expect(status == MxStatusIllegalArgument && state.count == 3, "A failing callback should stop the walk");
+	
+	check("Wiping", MxBinaryTreeWipe(&tree));
+	
+	// A complete tree of 1 to 127 - its bottom level of 64 is more than the queue starts with
+	for (int ctr = 0; ctr < 127; ++ctr)
+		values[ctr] = ctr + 1;
+	check("Initialising", MxBinaryTreeInitWithComparer(&tree, MxDefaultCompareIntFunction));
+	InsertBalanced(&tree, values, 0, 126);
+	
+	state.count = 0;
+	state.stopAt = 0;
+	check("Walking", MxBinaryTreeWalkBreadthFirst(&tree, CollectingIterator, &state));
+	expect(state.count == 127, "Walk missed nodes");
+	
+	// Level 'level' holds the odd multiples of 2^(6 - level), left to right
+	int position = 0;
+	for (int level = 0; level < 7; ++level)
+		for (int node = 0; node < (1 << level); ++node)
+			expect(state.values[position++] == (2 * node + 1) << (6 - level), "Complete tree walked out of level order");
+	
+	printf("Breadth first walks in level order\n");
+	
+	check("Wiping", MxBinaryTreeWipe(&tree));
+}
+
+
+// Insert values[low..high] so the tree comes out balanced
+static void InsertBalanced(MxBinaryTreeRef tree, int *values, int low, int high)
+{
+	if (low > high)
+		return;
+	
+	int mid = low + (high - low) / 2;
+	MxStatus status = MxBinaryTreeInsert(tree, values + mid);
+	dieIfBad("Inserting", status);
+	
+	InsertBalanced(tree, values, low, mid - 1);
+	InsertBalanced(tree, values, mid + 1, high);
+}
+
+
+static int CollectingIterator(const void *item, void *vstate)
+{
+	CollectState *state = (CollectState *)vstate;
+	
+	if (state->stopAt > 0 && state->count == state->stopAt)
+		return MxStatusIllegalArgument;
+	
+	state->values[state->count++] = *(const int *)item;
+	
+	return MxStatusOK;
 }
 
 
@@ -0,0 +1,229 @@
+//
+//  test_bitset.c
+//  core_ds
+//
+
+#include "test_bitset.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "MxBitset.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+// Largest bitset the tests build
+#define MaxTestBits (1000)
+
+static void test_find_and_iterate(void);
+static void test_operations(void);
+static void Build(MxBitsetRef bitset, const char *bits, size_t size);
+static void CheckBits(MxBitsetRef bitset, const char *expected, size_t size, const char *message);
+static MxStatus CompareBit(const void *value, void *state);
+
+// Where CompareBit is up to, and the bits it should see
+typedef struct {
+	const char *expected;
+	size_t size;
+	size_t position;
+} IterateState;
+
+// Operand sizes: empty, inside a word, on and across word boundaries, and word counts
+// that leave 0 to 3 words for the scalar tail after the 2 and 4 word vector steps
+static const size_t operandSizes[] = { 0, 1, 63, 64, 65, 130, 200, 256, 300, 520, 1000 };
+#define OperandSizeCount (sizeof(operandSizes) / sizeof(operandSizes[0]))
+
+
+void test_bitset(void)
+{
+	printf("\n-- Bitset ------\n");
+	
+	test_find_and_iterate();
+	test_operations();
+}
+
+
+static void test_find_and_iterate(void)
+{
+	MxStatus status = MxStatusOK;
+	MxBitset bitset;
+	char bits[MaxTestBits] = { 0 };
+	
+	// Either side of each word boundary, plus the very last bit
+	static const size_t setBits[] = { 0, 62, 63, 64, 127, 128, 130, 500, 640, 703, 704, MaxTestBits - 1 };
+	for (size_t ctr = 0; ctr < sizeof(setBits) / sizeof(setBits[0]); ++ctr)
+		bits[setBits[ctr]] = 1;
+	
+	check("Initialising", MxBitsetInit(&bitset));
+	Build(&bitset, bits, MaxTestBits);
+	expect(MxBitsetCount(&bitset) == sizeof(setBits) / sizeof(setBits[0]), "Count doesn't match the bits set");
+	
+	// From every position the next set bit must be the reference's
+	for (size_t from = 0; from < MaxTestBits; ++from)
+	{
+		size_t next = from;
+		while (next < MaxTestBits && !bits[next])
+			++next;
+		
+		size_t found = 0;
+		check("Finding the next bit", MxBitsetFindNextSet(&bitset, from, &found));
+		expect(found == next, "FindNextSet found the wrong bit");
+	}
+	
+	size_t found = 0;
+	status = MxBitsetFindNextSet(&bitset, MaxTestBits, &found);
+	expect(status == MxStatusNotFound, "Nothing should be found past the end");
+	
+	// With the last bit cleared the search from 705 runs off the end
+	check("Clearing the last bit", MxBitsetClearBit(&bitset, MaxTestBits - 1));
+	status = MxBitsetFindNextSet(&bitset, 705, &found);
+	expect(status == MxStatusNotFound, "Nothing should be found after the last set bit");
+	check("Setting the last bit", MxBitsetSetBit(&bitset, MaxTestBits - 1));
+	
+	IterateState state = { bits, MaxTestBits, 0 };
+	check("Iterating", MxBitsetIterate(&bitset, CompareBit, &state));
+	expect(state.position == MaxTestBits, "Iterate missed bits at the end");
+	
+	printf("FindNextSet and Iterate agree across word boundaries\n");
+	
+	// Bits at the top of the range can't be grown to
+	status = MxBitsetSetBit(&bitset, SIZE_MAX);
+	expect(status == MxStatusIndexOutOfRange, "Setting bit SIZE_MAX should be out of range");
+	status = MxBitsetFlipBit(&bitset, SIZE_MAX);
+	expect(status == MxStatusIndexOutOfRange, "Flipping bit SIZE_MAX should be out of range");
+	status = MxBitsetSetBit(&bitset, MxBitsetMaxBit + 1);
+	expect(status == MxStatusIndexOutOfRange, "Setting a bit past MxBitsetMaxBit should be out of range");
+	expect(MxBitsetGetSize(&bitset) == MaxTestBits && MxBitsetCount(&bitset) == sizeof(setBits) / sizeof(setBits[0]), "Rejected bits changed the bitset");
+	
+	printf("Bits past MxBitsetMaxBit rejected\n");
+	
+	check("Wiping", MxBitsetWipe(&bitset));
+}
+
+
+// Every operation on every pair of sizes, checked bit by bit against plain arrays
+static void test_operations(void)
+{
+	MxStatus status = MxStatusOK;
+	MxBitset bitset, other;
+	char a[MaxTestBits], b[MaxTestBits], expected[MaxTestBits];
+	
+	srand(11);
+	for (size_t aCtr = 0; aCtr < OperandSizeCount; ++aCtr)
+	{
+		for (size_t bCtr = 0; bCtr < OperandSizeCount; ++bCtr)
+		{
+			size_t aSize = operandSizes[aCtr], bSize = operandSizes[bCtr];
+			size_t largest = (aSize > bSize) ? aSize : bSize;
+			
+			memset(a, 0, sizeof(a));
+			memset(b, 0, sizeof(b));
+			for (size_t ctr = 0; ctr < aSize; ++ctr)
+				a[ctr] = (rand() % 3 == 0);
+			for (size_t ctr = 0; ctr < bSize; ++ctr)
+				b[ctr] = (rand() % 2 == 0);
+			
+			check("Initialising the operand", MxBitsetInit(&other));
+			Build(&other, b, bSize);
+			
+			for (int op = 0; op < 4; ++op)
+			{
+				check("Initialising", MxBitsetInit(&bitset));
+				Build(&bitset, a, aSize);
+				
+				size_t resultSize = aSize;
+				switch (op)
+				{
+					case 0:
+						check("And", MxBitsetAnd(&bitset, &other));
+						for (size_t ctr = 0; ctr < MaxTestBits; ++ctr)
+							expected[ctr] = a[ctr] && b[ctr];
+						break;
+					case 1:
+						check("Or", MxBitsetOr(&bitset, &other));
+						for (size_t ctr = 0; ctr < MaxTestBits; ++ctr)
+							expected[ctr] = a[ctr] || b[ctr];
+						resultSize = largest;
+						break;
+					case 2:
+						check("Xor", MxBitsetXor(&bitset, &other));
+						for (size_t ctr = 0; ctr < MaxTestBits; ++ctr)
+							expected[ctr] = a[ctr] != b[ctr];
+						resultSize = largest;
+						break;
+					default:
+						check("AndNot", MxBitsetAndNot(&bitset, &other));
+						for (size_t ctr = 0; ctr < MaxTestBits; ++ctr)
+							expected[ctr] = a[ctr] && !b[ctr];
+						break;
+				}
+				
+				expect(MxBitsetGetSize(&bitset) == resultSize, "Operation left the wrong size");
+				CheckBits(&bitset, expected, resultSize, "Operation set the wrong bits");
+				
+				check("Wiping", MxBitsetWipe(&bitset));
+			}
+			
+			check("Wiping the operand", MxBitsetWipe(&other));
+		}
+	}
+	
+	printf("And, Or, Xor and AndNot correct for %d pairs of sizes\n", (int)(OperandSizeCount * OperandSizeCount));
+}
+
+
+// Grow 'bitset' to 'size' bits holding 'bits'
+static void Build(MxBitsetRef bitset, const char *bits, size_t size)
+{
+	MxStatus status = MxStatusOK;
+	
+	// Flip the last bit on and back off to set the size without setting anything
+	if (size > 0)
+	{
+		check("Sizing", MxBitsetFlipBit(bitset, size - 1));
+		check("Sizing", MxBitsetFlipBit(bitset, size - 1));
+	}
+	
+	for (size_t ctr = 0; ctr < size; ++ctr)
+		if (bits[ctr])
+			check("Setting a bit", MxBitsetSetBit(bitset, ctr));
+}
+
+
+static void CheckBits(MxBitsetRef bitset, const char *expected, size_t size, const char *message)
+{
+	size_t count = 0;
+	
+	for (size_t ctr = 0; ctr < size; ++ctr)
+	{
+		expect((MxBitsetTestBit(bitset, ctr) == MxStatusTrue) == (expected[ctr] != 0), message);
+		count += (expected[ctr] != 0);
+	}
+	
+	expect(MxBitsetCount(bitset) == count, "Count doesn't match the bits set");
+	
+	IterateState state = { expected, size, 0 };
+	MxStatus status = MxBitsetIterate(bitset, CompareBit, &state);
+	dieIfBad("Iterating", status);
+}
+
+
+// Each bit passed must be the next set bit in the reference, in order
+static MxStatus CompareBit(const void *value, void *vstate)
+{
+	IterateState *state = (IterateState *)vstate;
+	size_t bit = *(const size_t *)value;
+	
+	while (state->position < state->size && !state->expected[state->position])
+		++state->position;
+	
+	expect(bit == state->position, "Iterate visited the wrong bit");
+	++state->position;
+	
+	return MxStatusOK;
+}
@@ -0,0 +1,11 @@
+//
+//  test_bitset.h
+//  core_ds
+//
+
+#ifndef core_ds_test_bitset_h
+#define core_ds_test_bitset_h
+
+void test_bitset(void);
+
+#endif
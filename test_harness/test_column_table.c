@@ -0,0 +1,333 @@
+//
+//  test_column_table.c
+//  core_ds
+//
+
+#include "test_column_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "MxColumnTable.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+enum { Int32Column, Int64Column, FloatColumn, DoubleColumn, TagColumn };
+
+// Not a multiple of four, so the vector scans leave a tail for the scalar loop
+#define RowCount (37)
+
+// The row whose float and double are NaN
+#define NaNRow (5)
+
+static void FillTable(MxColumnTableRef table);
+static int Matches(MxColumnTableRef table, size_t row, size_t column, MxColumnCompare compare, const void *value);
+static void CheckFilter(MxColumnTableRef table, size_t column, MxColumnCompare compare, const void *value);
+static void CheckRows(MxSelectionRef selection, const uint32_t *expected, size_t count, const char *message);
+static void test_filters(MxColumnTableRef table);
+static void test_chained_filters(MxColumnTableRef table);
+static void test_bytes_filters(MxColumnTableRef table);
+static MxStatus SumInt32(const void *value, void *state);
+
+static const char *CompareNames[] = { "==", "!=", "<", "<=", ">", ">=" };
+
+
+void test_column_table(void)
+{
+	MxStatus status = MxStatusOK;
+	MxColumnSpec schema[] = {
+		{ MxColumnInt32, 0 },
+		{ MxColumnInt64, 0 },
+		{ MxColumnFloat, 0 },
+		{ MxColumnDouble, 0 },
+		{ MxColumnBytes, 4 }
+	};
+	MxColumnTable table;
+	
+	printf("\n-- Column table ------\n");
+	
+	check("Initialising", MxColumnTableInit(&table, schema, 5));
+	FillTable(&table);
+	expect(MxColumnTableGetRowCount(&table) == RowCount, "Every row should have been appended");
+	
+	int64_t total = 0;
+	check("Scanning", MxColumnTableScanColumn(&table, Int32Column, SumInt32, &total));
+	
+	int64_t expectedTotal = 0;
+	for (int row = 0; row < RowCount; ++row)
+		expectedTotal += (row * 7) % 10 - 5;
+	expect(total == expectedTotal, "The scan should visit every value once");
+	
+	test_filters(&table);
+	test_chained_filters(&table);
+	test_bytes_filters(&table);
+	
+	check("Removing row", MxColumnTableRemoveRow(&table, 0));
+	
+	int64_t id = 0;
+	check("Getting id", MxColumnTableGetValue(&table, 0, Int64Column, &id));
+	expect(id == 2 * 10000000000LL, "Removing a row should shift the later rows down");
+	expect(MxColumnTableGetRowCount(&table) == RowCount - 1, "Removing a row should shrink the table");
+	
+	check("Wiping table", MxColumnTableWipe(&table));
+	printf("Column table OK\n");
+}
+
+
+// Every compare on every numeric column, checked against the same compare done
+// a row at a time in C. The operands cover no rows, some rows and every row.
+static void test_filters(MxColumnTableRef table)
+{
+	const int operands[] = { -6, -5, 0, 2, 4, 5 };
+	
+	for (size_t ctr = 0; ctr < sizeof(operands) / sizeof(operands[0]); ++ctr)
+	{
+		int32_t int32Value = operands[ctr];
+		int64_t int64Value = operands[ctr] * 10000000000LL;
+		float floatValue = (float)operands[ctr] * 0.5f;
+		double doubleValue = (double)operands[ctr] * 0.25;
+		
+		for (MxColumnCompare compare = MxColumnEqual; compare <= MxColumnGreaterOrEqual; ++compare)
+		{
+			CheckFilter(table, Int32Column, compare, &int32Value);
+			CheckFilter(table, Int64Column, compare, &int64Value);
+			CheckFilter(table, FloatColumn, compare, &floatValue);
+			CheckFilter(table, DoubleColumn, compare, &doubleValue);
+		}
+	}
+	
+	// A few spelled out, so the reference itself is checked
+	MxStatus status = MxStatusOK;
+	MxSelection selection;
+	MxSelectionInit(&selection);
+	
+	int32_t four = 4;
+	const uint32_t equalFour[] = { 7, 17, 27 };
+	check("Filtering int32", MxColumnTableFilter(table, Int32Column, MxColumnEqual, &four, NULL, &selection));
+	CheckRows(&selection, equalFour, 3, "int32 == 4 selected the wrong rows");
+	
+	// Every row but the NaN one
+	double big = 100.0;
+	uint32_t allButNaN[RowCount - 1];
+	for (uint32_t row = 0, next = 0; row < RowCount; ++row)
+		if (row != NaNRow)
+			allButNaN[next++] = row;
+	check("Filtering double", MxColumnTableFilter(table, DoubleColumn, MxColumnLess, &big, NULL, &selection));
+	CheckRows(&selection, allButNaN, RowCount - 1, "NaN should fail an ordered compare");
+	
+	float nan = NAN;
+	check("Filtering float", MxColumnTableFilter(table, FloatColumn, MxColumnEqual, &nan, NULL, &selection));
+	expect(selection.count == 0, "Nothing should equal NaN");
+	check("Filtering float", MxColumnTableFilter(table, FloatColumn, MxColumnNotEqual, &nan, NULL, &selection));
+	expect(selection.count == RowCount, "Everything should not equal NaN");
+	
+	check("Wiping selection", MxSelectionWipe(&selection));
+}
+
+
+static void test_chained_filters(MxColumnTableRef table)
+{
+	MxStatus status = MxStatusOK;
+	MxSelection selection;
+	MxSelectionInit(&selection);
+	
+	// int32 >= 0, then narrowed in place to the fizz rows, then to int64 < 3e10
+	int32_t zero = 0;
+	check("Filtering int32", MxColumnTableFilter(table, Int32Column, MxColumnGreaterOrEqual, &zero, NULL, &selection));
+	
+	const uint32_t atLeastZero[] = { 1, 4, 5, 7, 8, 11, 14, 15, 17, 18, 21, 24, 25, 27, 28, 31, 34, 35 };
+	CheckRows(&selection, atLeastZero, sizeof(atLeastZero) / sizeof(atLeastZero[0]), "int32 >= 0 selected the wrong rows");
+	
+	check("Filtering tags", MxColumnTableFilter(table, TagColumn, MxColumnEqual, "fizz", &selection, &selection));
+	
+	const uint32_t fizzAtLeastZero[] = { 15, 18, 21, 24, 27 };
+	CheckRows(&selection, fizzAtLeastZero, 5, "An in-place filter selected the wrong rows");
+	
+	int64_t limit = 3 * 10000000000LL;
+	check("Filtering int64", MxColumnTableFilter(table, Int64Column, MxColumnLess, &limit, &selection, &selection));
+	
+	const uint32_t narrowest[] = { 15, 18, 21 };
+	CheckRows(&selection, narrowest, 3, "A second in-place filter selected the wrong rows");
+	
+	// Filtering a selection into a different one leaves the input alone
+	MxSelection other;
+	MxSelectionInit(&other);
+	
+	float half = 0.5f;
+	check("Filtering float", MxColumnTableFilter(table, FloatColumn, MxColumnGreaterOrEqual, &half, &selection, &other));
+	
+	const uint32_t atLeastHalf[] = { 18, 21 };
+	CheckRows(&other, atLeastHalf, 2, "Filtering into another selection selected the wrong rows");
+	CheckRows(&selection, narrowest, 3, "Filtering into another selection changed the input");
+	
+	// An empty input gives an empty output
+	other.count = 0;
+	check("Filtering empty", MxColumnTableFilter(table, Int32Column, MxColumnGreaterOrEqual, &zero, &other, &other));
+	expect(other.count == 0, "An empty input should select nothing");
+	
+	check("Wiping selection", MxSelectionWipe(&selection));
+	check("Wiping selection", MxSelectionWipe(&other));
+}
+
+
+static void test_bytes_filters(MxColumnTableRef table)
+{
+	MxStatus status = MxStatusOK;
+	MxSelection selection;
+	MxSelectionInit(&selection);
+	
+	uint32_t fizz[RowCount];
+	uint32_t none[RowCount];
+	size_t fizzCount = 0;
+	size_t noneCount = 0;
+	
+	for (uint32_t row = 0; row < RowCount; ++row)
+	{
+		if (row % 3 == 0)
+			fizz[fizzCount++] = row;
+		else
+			none[noneCount++] = row;
+	}
+	
+	check("Filtering tags", MxColumnTableFilter(table, TagColumn, MxColumnEqual, "fizz", NULL, &selection));
+	CheckRows(&selection, fizz, fizzCount, "tag == fizz selected the wrong rows");
+	
+	check("Filtering tags", MxColumnTableFilter(table, TagColumn, MxColumnNotEqual, "fizz", NULL, &selection));
+	CheckRows(&selection, none, noneCount, "tag != fizz selected the wrong rows");
+	
+	// Bytes have no order, and a rejected filter leaves the output as it was
+	for (MxColumnCompare compare = MxColumnLess; compare <= MxColumnGreaterOrEqual; ++compare)
+	{
+		status = MxColumnTableFilter(table, TagColumn, compare, "fizz", NULL, &selection);
+		expect(status == MxStatusIllegalArgument, "An ordering filter on a bytes column should be rejected");
+		CheckRows(&selection, none, noneCount, "A rejected filter changed the output");
+	}
+	
+	status = MxColumnTableFilter(table, Int32Column, (MxColumnCompare)(MxColumnGreaterOrEqual + 1), "fizz", NULL, &selection);
+	expect(status == MxStatusIllegalArgument, "An unknown compare should be rejected");
+	
+	check("Wiping selection", MxSelectionWipe(&selection));
+}
+
+
+// Row r holds v = (r * 7) % 10 - 5 as v, v * 1e10, v / 2 and v / 4, with a NaN row,
+// and is tagged "fizz" every third row
+static void FillTable(MxColumnTableRef table)
+{
+	MxStatus status = MxStatusOK;
+	
+	for (int row = 0; row < RowCount; ++row)
+	{
+		int32_t value = (row * 7) % 10 - 5;
+		int64_t wide = value * 10000000000LL;
+		float half = (float)value * 0.5f;
+		double quarter = (double)value * 0.25;
+		const char *tag = (row % 3 == 0) ? "fizz" : "none";
+		
+		if (row == NaNRow)
+			half = quarter = NAN;
+		
+		const void *values[] = { &value, &wide, &half, &quarter, tag };
+		check("Appending row", MxColumnTableAppendRow(table, values));
+	}
+}
+
+
+static void CheckFilter(MxColumnTableRef table, size_t column, MxColumnCompare compare, const void *value)
+{
+	MxStatus status = MxStatusOK;
+	MxSelection selection;
+	MxSelectionInit(&selection);
+	
+	check("Filtering", MxColumnTableFilter(table, column, compare, value, NULL, &selection));
+	
+	uint32_t expected[RowCount];
+	size_t count = 0;
+	for (size_t row = 0; row < RowCount; ++row)
+		if (Matches(table, row, column, compare, value))
+			expected[count++] = (uint32_t)row;
+	
+	if (selection.count != count || memcmp(selection.rows, expected, count * sizeof(uint32_t)) != 0)
+	{
+		printf("Column %lu, compare %s\n", (unsigned long)column, CompareNames[compare]);
+		die("A filter selected the wrong rows");
+	}
+	
+	check("Wiping selection", MxSelectionWipe(&selection));
+}
+
+
+#define Compare(a, b)                                              \
+	switch (compare)                                               \
+	{                                                              \
+		case MxColumnEqual:          return (a) == (b);            \
+		case MxColumnNotEqual:       return (a) != (b);            \
+		case MxColumnLess:           return (a) < (b);             \
+		case MxColumnLessOrEqual:    return (a) <= (b);            \
+		case MxColumnGreater:        return (a) > (b);             \
+		case MxColumnGreaterOrEqual: return (a) >= (b);            \
+	}
+
+static int Matches(MxColumnTableRef table, size_t row, size_t column, MxColumnCompare compare, const void *value)
+{
+	MxStatus status = MxStatusOK;
+	
+	switch (column)
+	{
+		case Int32Column:
+		{
+			int32_t stored = 0;
+			check("Getting value", MxColumnTableGetValue(table, row, column, &stored));
+			Compare(stored, *(const int32_t *)value)
+			break;
+		}
+		
+		case Int64Column:
+		{
+			int64_t stored = 0;
+			check("Getting value", MxColumnTableGetValue(table, row, column, &stored));
+			Compare(stored, *(const int64_t *)value)
+			break;
+		}
+		
+		case FloatColumn:
+		{
+			float stored = 0;
+			check("Getting value", MxColumnTableGetValue(table, row, column, &stored));
+			Compare(stored, *(const float *)value)
+			break;
+		}
+		
+		case DoubleColumn:
+		{
+			double stored = 0;
+			check("Getting value", MxColumnTableGetValue(table, row, column, &stored));
+			Compare(stored, *(const double *)value)
+			break;
+		}
+	}
+	
+	die("No reference compare for the column");
+	return 0;
+}
+
+
+static void CheckRows(MxSelectionRef selection, const uint32_t *expected, size_t count, const char *message)
+{
+	expect(selection->count == count, message);
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		expect(selection->rows[ctr] == expected[ctr], message);
+}
+
+
+static MxStatus SumInt32(const void *value, void *state)
+{
+	*(int64_t *)state += *(const int32_t *)value;
+	return MxStatusOK;
+}
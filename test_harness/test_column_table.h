@@ -0,0 +1,11 @@
+//
+//  test_column_table.h
+//  core_ds
+//
+
+#ifndef core_ds_test_column_table_h
+#define core_ds_test_column_table_h
+
+void test_column_table(void);
+
+#endif
@@ -0,0 +1,109 @@
+//
+//  test_counter_table.c
+//  core_ds
+//
+
+#include "test_counter_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "MxCounterTable.h"
+#include "MxHashtable.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+#define ThreadCount (8)
+#define AddsPerThread (10000)
+
+typedef struct {
+	MxCounterTableRef table;
+	int index;
+} Worker;
+
+static void *AddCounts(void *vworker);
+
+
+void test_counter_table(void)
+{
+	MxStatus status = MxStatusOK;
+	MxCounterTable table;
+	pthread_t threads[ThreadCount];
+	Worker workers[ThreadCount];
+	long total;
+	
+	check("Initialising", MxCounterTableInit(&table));
+	
+	status = MxCounterTableGet(&table, "hits", &total);
+	printf("Before any adds: %s, total %ld\n", MxStatusMsg(status), total);
+	expect(status == MxStatusNotFound && total == 0, "Empty table should not find 'hits'");
+	
+	// Every thread exits before the totals are read, so its shard is folded in by
+	// the thread-exit handler rather than by Get
+	printf("Adding from %d threads...\n", ThreadCount);
+	for (int ctr = 0; ctr < ThreadCount; ++ctr)
+	{
+		workers[ctr].table = &table;
+		workers[ctr].index = ctr;
+		if (pthread_create(threads + ctr, NULL, AddCounts, workers + ctr) != 0)
+			die("Creating thread");
+	}
+	
+	for (int ctr = 0; ctr < ThreadCount; ++ctr)
+		pthread_join(threads[ctr], NULL);
+	
+	expect(MxListGetCount(&table.shards) == 0, "Exited threads should have folded and dropped their shards");
+	
+	// And one shard that's still live, merged by Get
+	check("Adding on main thread", MxCounterTableAdd(&table, "hits", 5));
+	
+	check("Getting hits", MxCounterTableGet(&table, "hits", &total));
+	printf("hits: %ld\n", total);
+	expect(total == (long)ThreadCount * AddsPerThread + 5, "Wrong 'hits' total");
+	
+	check("Getting misses", MxCounterTableGet(&table, "misses", &total));
+	printf("misses: %ld\n", total);
+	expect(total == -(long)ThreadCount * AddsPerThread / 2, "Wrong 'misses' total");
+	
+	MxHashtable snapshot;
+	check("Initialising snapshot", MxHashtableInitWithAllFunctions(&snapshot, MxDefaultStringHashFunction,
+	                                                               MxDefaultCStrEqualsFunction, free, free));
+	check("Snapshotting", MxCounterTableSnapshot(&table, &snapshot));
+	printf("Snapshot holds %d counters\n", MxHashtableGetCount(&snapshot));
+	expect(MxHashtableGetCount(&snapshot) == 2 + ThreadCount, "Snapshot should hold every counter");
+	
+	long *value;
+	char key[32];
+	for (int ctr = 0; ctr < ThreadCount; ++ctr)
+	{
+		snprintf(key, sizeof(key), "thread %d", ctr);
+		check("Getting thread counter", MxHashtableGet(&snapshot, key, (void **)&value));
+		expect(*value == AddsPerThread, "Wrong per-thread total");
+	}
+	
+	check("Wiping snapshot", MxHashtableWipe(&snapshot));
+	check("Wiping", MxCounterTableWipe(&table));
+}
+
+
+static void *AddCounts(void *vworker)
+{
+	Worker *worker = (Worker *)vworker;
+	char key[32];
+	
+	snprintf(key, sizeof(key), "thread %d", worker->index);
+	
+	for (int ctr = 0; ctr < AddsPerThread; ++ctr)
+	{
+		dieIfBad("Adding hit", MxCounterTableAdd(worker->table, "hits", 1));
+		dieIfBad("Adding own", MxCounterTableAdd(worker->table, key, 1));
+		if (ctr % 2)
+			dieIfBad("Adding miss", MxCounterTableAdd(worker->table, "misses", -1));
+	}
+	
+	return NULL;
+}
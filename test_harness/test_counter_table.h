@@ -0,0 +1,11 @@
+//
+//  test_counter_table.h
+//  core_ds
+//
+
+#ifndef core_ds_test_counter_table_h
+#define core_ds_test_counter_table_h
+
+void test_counter_table(void);
+
+#endif
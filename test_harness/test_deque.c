@@ -0,0 +1,209 @@
+//
+//  test_deque.c
+//  core_ds
+//
+
+#include "test_deque.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "MxDeque.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+// Items are integers stored in the pointer itself
+#define Item(n) ((void *)(uintptr_t)(n))
+#define Value(item) ((int)(uintptr_t)(item))
+
+static void test_push_and_pop(void);
+static void test_wrap_around(void);
+static void test_wipe_and_free(void);
+static void CheckContents(MxDequeRef deque, int first, size_t count, const char *message);
+static MxStatus CheckForward(const void *item, void *state);
+static MxStatus CheckBackward(const void *item, void *state);
+static void CountFree(void *item);
+
+static int itemsFreed = 0;
+
+
+void test_deque(void)
+{
+	printf("\n-- Deque ------\n");
+	
+	test_push_and_pop();
+	test_wrap_around();
+	test_wipe_and_free();
+}
+
+
+static void test_push_and_pop(void)
+{
+	MxStatus status = MxStatusOK;
+	MxDeque deque;
+	void *item = NULL;
+	
+	// Small enough that the pushes below wrap round and grow the buffer
+	check("Initialising", MxDequeInitWithCapacity(&deque, 3));
+	expect(deque.capacity == 4, "Capacity should round up to a power of two");
+	
+	for (int ctr = 10; ctr < 20; ++ctr)
+		check("Pushing back", MxDequePushBack(&deque, Item(ctr)));
+	for (int ctr = 9; ctr >= 0; --ctr)
+		check("Pushing front", MxDequePushFront(&deque, Item(ctr)));
+	
+	expect(deque.capacity == 32, "Expected 4 to double to 32");
+	CheckContents(&deque, 0, 20, "Pushed at both ends");
+	
+	check("Peeking front", MxDequePeekFront(&deque, &item));
+	expect(Value(item) == 0 && MxDequeGetCount(&deque) == 20, "Peek front should leave the front item");
+	check("Peeking back", MxDequePeekBack(&deque, &item));
+	expect(Value(item) == 19 && MxDequeGetCount(&deque) == 20, "Peek back should leave the back item");
+	
+	status = MxDequeItemAt(&deque, 20, &item);
+	expect(status == MxStatusIndexOutOfRange, "Item past the end should be out of range");
+	status = MxDequeItemAt(&deque, -1, &item);
+	expect(status == MxStatusIllegalArgument, "Negative index should be rejected");
+	
+	// Alternate ends, so each pop meets the other end's order
+	for (int ctr = 0; ctr < 10; ++ctr)
+	{
+		check("Popping front", MxDequePopFront(&deque, &item));
+		expect(Value(item) == ctr, "Popped the wrong front item");
+		check("Popping back", MxDequePopBack(&deque, &item));
+		expect(Value(item) == 19 - ctr, "Popped the wrong back item");
+	}
+	
+	status = MxDequePopFront(&deque, &item);
+	expect(status == MxStatusNotFound && item == NULL, "Popping an empty deque should be NotFound");
+	status = MxDequePopBack(&deque, &item);
+	expect(status == MxStatusNotFound && item == NULL, "Popping an empty deque should be NotFound");
+	status = MxDequePeekFront(&deque, &item);
+	expect(status == MxStatusNotFound && item == NULL, "Peeking an empty deque should be NotFound");
+	
+	printf("Pushed at both ends, popped in order\n");
+	
+	check("Wiping", MxDequeWipe(&deque));
+}
+
+
+// Fill a buffer whose items have wrapped past the end, then grow it
+static void test_wrap_around(void)
+{
+	MxStatus status = MxStatusOK;
+	MxDeque deque;
+	void *item = NULL;
+	
+	check("Initialising", MxDequeInitWithCapacity(&deque, 8));
+	
+	// Move the head to slot 5 so the next pushes wrap
+	for (int ctr = 0; ctr < 5; ++ctr)
+		check("Pushing", MxDequePushBack(&deque, Item(ctr)));
+	for (int ctr = 0; ctr < 5; ++ctr)
+		check("Popping", MxDequePopFront(&deque, &item));
+	expect(deque.head == 5, "Expected the head at slot 5");
+	
+	for (int ctr = 100; ctr < 108; ++ctr)
+		check("Pushing round the end", MxDequePushBack(&deque, Item(ctr)));
+	expect(deque.capacity == 8 && deque.head == 5, "A wrapped full buffer shouldn't have grown yet");
+	CheckContents(&deque, 100, 8, "Wrapped round the end");
+	
+	// Growing must move the wrapped items up behind the others
+	check("Pushing past full", MxDequePushBack(&deque, Item(108)));
+	expect(deque.capacity == 16, "A full buffer should double");
+	CheckContents(&deque, 100, 9, "Grown with wrapped items");
+	
+	// And the front can wrap backwards past slot 0
+	check("Clearing", MxDequeClear(&deque));
+	for (int ctr = 3; ctr >= 0; --ctr)
+		check("Pushing front past slot 0", MxDequePushFront(&deque, Item(ctr)));
+	expect(deque.head == 12, "Pushing front should wrap the head to the end");
+	CheckContents(&deque, 0, 4, "Wrapped backwards");
+	
+	printf("Items wrapped round the buffer both ways and kept their order through growth\n");
+	
+	check("Wiping", MxDequeWipe(&deque));
+}
+
+
+static void test_wipe_and_free(void)
+{
+	MxStatus status = MxStatusOK;
+	MxDeque deque;
+	
+	check("Initialising", MxDequeInitWithFunctions(&deque, CountFree));
+	
+	for (int ctr = 0; ctr < 5; ++ctr)
+		check("Pushing", MxDequePushBack(&deque, malloc(1)));
+	
+	itemsFreed = 0;
+	check("Replacing", MxDequeReplaceAt(&deque, malloc(1), 2));
+	expect(itemsFreed == 1, "Replace should free the item it replaces");
+	
+	check("Wiping", MxDequeWipe(&deque));
+	expect(itemsFreed == 6 && MxDequeGetCount(&deque) == 0, "Wipe should free the items left");
+	
+	// A wiped deque has no buffer, and must grow one on the next push
+	check("Reinitialising", MxDequeInit(&deque));
+	check("Wiping", MxDequeWipe(&deque));
+	check("Pushing after Wipe", MxDequePushBack(&deque, Item(1)));
+	check("Pushing front after Wipe", MxDequePushFront(&deque, Item(0)));
+	for (int ctr = 2; ctr < MxDequeDefaultCapacity * 2; ++ctr)
+		check("Pushing after Wipe", MxDequePushBack(&deque, Item(ctr)));
+	CheckContents(&deque, 0, MxDequeDefaultCapacity * 2, "Pushed after Wipe");
+	
+	printf("Items freed by Replace and Wipe, wiped deque usable again\n");
+	
+	check("Wiping", MxDequeWipe(&deque));
+}
+
+
+// The deque holds first, first + 1, ... forwards by index and by both iterations
+static void CheckContents(MxDequeRef deque, int first, size_t count, const char *message)
+{
+	MxStatus status = MxStatusOK;
+	void *item = NULL;
+	
+	expect(MxDequeGetCount(deque) == count, message);
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		check("Item at", MxDequeItemAt(deque, (int)ctr, &item));
+		expect(Value(item) == first + (int)ctr, message);
+	}
+	
+	int next = first;
+	check("Iterating", MxDequeIterate(deque, CheckForward, &next));
+	expect(next == first + (int)count, message);
+	
+	next = first + (int)count - 1;
+	check("Iterating backward", MxDequeIterateBackward(deque, CheckBackward, &next));
+	expect(next == first - 1, message);
+}
+
+
+static MxStatus CheckForward(const void *item, void *state)
+{
+	int *next = (int *)state;
+	expect(Value(item) == (*next)++, "Iterate visited the wrong item");
+	
+	return MxStatusOK;
+}
+
+static MxStatus CheckBackward(const void *item, void *state)
+{
+	int *next = (int *)state;
+	expect(Value(item) == (*next)--, "IterateBackward visited the wrong item");
+	
+	return MxStatusOK;
+}
+
+
+static void CountFree(void *item)
+{
+	free(item);
+	itemsFreed++;
+}
@@ -0,0 +1,11 @@
+//
+//  test_deque.h
+//  core_ds
+//
+
+#ifndef core_ds_test_deque_h
+#define core_ds_test_deque_h
+
+void test_deque(void);
+
+#endif
@@ -7,6 +7,8 @@
 //
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
 
 #include "utils.h"
 #include "test_hashtable.h"
@@ -14,10 +16,33 @@
 #include "MxList.h"
 #include "MxHashtable.h"
 
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+// Integer keys, stored as the pointer itself (never 0)
+#define Key(n) ((void *)(uintptr_t)(n))
+
 static void PrintTable(const char *title, MxHashtableRef table);
 static MxStatus PrintPair(const void *key, const void *value, void *state);
 static int PrintCallback(const void *value, void *state);
 
+static void test_compact_table(void);
+static void test_shrink_and_ownership(void);
+static void CheckOwnership(const char *title, MxHashtableRef table, int entries);
+static void test_small_table(void);
+static void CheckPromotion(MxHashtableRef table);
+static MxStatus SumPair(const void *key, const void *value, void *state);
+
+static unsigned long CollidingHash(const void *key);
+static unsigned long CountingHash(const void *key);
+static void CountKeyFree(void *key);
+static void CountValueFree(void *value);
+static int *NewValue(int value);
+
+static int keysFreed;
+static int valuesFreed;
+static int hashCalls;
+
 void test_hashtable(void)
 {
 	static char *tableContents[] = {
@@ -112,6 +137,385 @@ void test_hashtable(void)
 	printf("Contains \"foo\": (%d) %s\n", status, MxStatusMsg(status));
 	
 	MxHashtableDelete(table);
+	
+	test_compact_table();
+	test_shrink_and_ownership();
+	test_small_table();
+}
+
+
+// Compact tables: a dense entry array chained by index, grown by doubling
+static void test_compact_table(void)
+{
+	MxStatus status = MxStatusOK;
+	MxHashtable table;
+	MxHashtableMemory memory;
+	int *value;
+	
+	printf("\n-- Compact table ------\n");
+	
+	check("Initialising compact table", MxHashtableInitCompactWithAllFunctions(&table, CollidingHash, NULL, CountKeyFree, CountValueFree));
+	
+	check("Memory while small", MxHashtableMemoryUsage(&table, &memory));
+	expect(memory.allocationCount == 0 && memory.payloadBytes == 0, "An empty small table allocates nothing");
+	expect(memory.structureBytes == MxHashtableSmallCapacity * 2 * sizeof(void *), "Small table structure should be its inline arrays");
+	
+	// The 9th entry promotes it, then the entry array doubles from its default capacity
+	uint32_t lastCapacity = 0;
+	for (int ctr = 1; ctr <= 2000; ++ctr)
+	{
+		check("Compact put", MxHashtablePut(&table, Key(ctr), NewValue(ctr)));
+		
+		if (ctr == MxHashtableSmallCapacity)
+			expect(table.small, "Should still be small at capacity");
+		
+		if (ctr == MxHashtableSmallCapacity + 1)
+			expect(!table.small && table.compact && table.compactCapacity == MxHashtableCompactDefaultCapacity, "9th entry should promote to compact storage");
+		
+		if (table.compactCapacity != lastCapacity)
+		{
+			expect(lastCapacity == 0 || table.compactCapacity == lastCapacity * 2, "Entry array should double");
+			printf("%d entries: capacity %u, %u buckets\n", ctr, table.compactCapacity, table.bucketCount);
+			lastCapacity = table.compactCapacity;
+		}
+		
+		expect(table.small || table.bucketCount >= (unsigned int)table.count, "Buckets should keep up with the entries");
+	}
+	
+	expect(MxHashtableGetCount(&table) == 2000 && table.compactCapacity == 2048, "Wrong count or capacity after 2000 puts");
+	
+	for (int ctr = 1; ctr <= 2000; ++ctr)
+	{
+		check("Compact get", MxHashtableGet(&table, Key(ctr), (void **)&value));
+		expect(*value == ctr, "Compact get returned the wrong value");
+	}
+	
+	// Replacing a value frees the old one
+	valuesFreed = 0;
+	check("Compact replace", MxHashtablePut(&table, Key(7), NewValue(-7)));
+	check("Compact get replaced", MxHashtableGet(&table, Key(7), (void **)&value));
+	expect(*value == -7 && valuesFreed == 1 && MxHashtableGetCount(&table) == 2000, "Replace should swap the value and free the old one");
+	
+	check("Memory while compact", MxHashtableMemoryUsage(&table, &memory));
+	printf("Memory: %zu structure + %zu payload bytes in %zu allocations\n", memory.structureBytes, memory.payloadBytes, memory.allocationCount);
+	expect(memory.allocationCount == 2, "Compact tables use two allocations");
+	expect(memory.payloadBytes == 2000 * 2 * sizeof(void *), "Payload should be a key and value pointer per entry");
+	expect(memory.structureBytes + memory.payloadBytes == table.bucketCount * sizeof(uint32_t) + table.compactCapacity * sizeof(MxHashtableCompactEntry),
+	       "Compact memory should be the bucket and entry arrays");
+	
+	// Removing entry 0 moves the last entry into its slot, which must be relinked
+	// into its (long, colliding) chain
+	check("Turning auto shrink off", MxHashtableSetAutoShrink(&table, 0));
+	
+	void *firstKey = table.compactEntries[0].key;
+	void *lastKey = table.compactEntries[table.count - 1].key;
+	keysFreed = valuesFreed = 0;
+	
+	check("Removing first entry", MxHashtableRemove(&table, firstKey));
+	expect(keysFreed == 1 && valuesFreed == 1, "Remove should free the key and value");
+	expect(table.compactEntries[0].key == lastKey, "The last entry should fill the gap");
+	expect(MxHashtableContainsKey(&table, firstKey) == MxStatusFalse, "Removed key still found");
+	check("Getting moved entry", MxHashtableGet(&table, lastKey, (void **)&value));
+	expect(*value == (int)(uintptr_t)lastKey, "Moved entry has the wrong value");
+	
+	// Then every third key, from all over the chains
+	for (int ctr = 3; ctr <= 2000; ctr += 3)
+	{
+		if (Key(ctr) == firstKey)
+			continue;
+		check("Compact remove", MxHashtableRemove(&table, Key(ctr)));
+	}
+	
+	status = MxHashtableRemove(&table, Key(3));
+	expect(status == MxStatusNotFound, "Removing twice should not find the key");
+	
+	for (int ctr = 1; ctr <= 2000; ++ctr)
+	{
+		int expected = (ctr % 3 != 0 && Key(ctr) != firstKey);
+		expect((MxHashtableContainsKey(&table, Key(ctr)) == MxStatusTrue) == expected, "Wrong keys left after removals");
+	}
+	
+	check("Wiping compact table", MxHashtableWipe(&table));
+}
+
+
+// Giving memory back, and who frees what on the way out
+static void test_shrink_and_ownership(void)
+{
+	MxStatus status = MxStatusOK;
+	MxHashtable table;
+	
+	printf("\n-- Shrinking and ownership ------\n");
+	
+	// Auto shrink halves the arrays as removals empty them, back down to the defaults
+	check("Initialising shrinking table", MxHashtableInitCompactWithAllFunctions(&table, CollidingHash, NULL, CountKeyFree, CountValueFree));
+	
+	for (int ctr = 1; ctr <= 4000; ++ctr)
+		check("Shrink put", MxHashtablePut(&table, Key(ctr), NewValue(ctr)));
+	
+	printf("4000 entries: capacity %u, %u buckets\n", table.compactCapacity, table.bucketCount);
+	expect(table.compactCapacity == 4096, "Wrong capacity before removals");
+	
+	uint32_t lastCapacity = table.compactCapacity;
+	for (int ctr = 4000; ctr > 10; --ctr)
+	{
+		check("Shrink remove", MxHashtableRemove(&table, Key(ctr)));
+		
+		if (table.compactCapacity != lastCapacity)
+		{
+			expect(table.compactCapacity == lastCapacity / 2, "Entry array should halve");
+			expect((uint32_t)table.count < lastCapacity / MxHashtableShrinkDivisor, "Shrank before the array was a quarter full");
+			lastCapacity = table.compactCapacity;
+		}
+	}
+	
+	printf("10 entries: capacity %u, %u buckets\n", table.compactCapacity, table.bucketCount);
+	expect(table.compactCapacity == MxHashtableCompactDefaultCapacity, "Auto shrink should stop at the default capacity");
+	expect(table.bucketCount < 2 * MxHashtableDefaultBucketCount, "Buckets should have shrunk");
+	
+	for (int ctr = 1; ctr <= 10; ++ctr)
+		expect(MxHashtableContainsKey(&table, Key(ctr)) == MxStatusTrue, "Lost an entry while shrinking");
+	
+	check("Wiping shrinking table", MxHashtableWipe(&table));
+	
+	// With auto shrink off removals leave the arrays alone until MxHashtableCompact
+	check("Initialising table to compact", MxHashtableInitCompactWithAllFunctions(&table, CollidingHash, NULL, CountKeyFree, CountValueFree));
+	check("Turning auto shrink off", MxHashtableSetAutoShrink(&table, 0));
+	
+	for (int ctr = 1; ctr <= 3000; ++ctr)
+		check("Compact put", MxHashtablePut(&table, Key(ctr), NewValue(ctr)));
+	
+	for (int ctr = 1; ctr <= 3000; ctr += 2)
+		check("Compact remove", MxHashtableRemove(&table, Key(ctr)));
+	
+	expect(table.compactCapacity == 4096 && table.bucketCount == 5759, "Removals shouldn't shrink with auto shrink off");
+	
+	check("Compacting", MxHashtableCompact(&table));
+	printf("Compacted 1500 entries: capacity %u, %u buckets\n", table.compactCapacity, table.bucketCount);
+	expect(table.compactCapacity == 1500 && table.bucketCount == 1501, "Compact should fit the arrays to the count");
+	
+	for (int ctr = 1; ctr <= 3000; ++ctr)
+		expect((MxHashtableContainsKey(&table, Key(ctr)) == MxStatusTrue) == (ctr % 2 == 0), "Wrong keys after compacting");
+	
+	// ...and never below the defaults
+	for (int ctr = 2; ctr <= 2980; ctr += 2)
+		check("Compact remove", MxHashtableRemove(&table, Key(ctr)));
+	
+	check("Compacting again", MxHashtableCompact(&table));
+	expect(table.compactCapacity == MxHashtableCompactDefaultCapacity && table.bucketCount == MxHashtableDefaultBucketCount, "Compact shouldn't go below the defaults");
+	expect(MxHashtableGetCount(&table) == 10, "Wrong count after compacting");
+	
+	check("Wiping compacted table", MxHashtableWipe(&table));
+	
+	// Compacting a small or chained table is a no-op
+	check("Initialising chained table", MxHashtableInitWithAllFunctions(&table, CollidingHash, NULL, CountKeyFree, CountValueFree));
+	check("Compacting small table", MxHashtableCompact(&table));
+	for (int ctr = 1; ctr <= 100; ++ctr)
+		check("Chained put", MxHashtablePut(&table, Key(ctr), NewValue(ctr)));
+	check("Compacting chained table", MxHashtableCompact(&table));
+	expect(!table.compact && table.bucketCount == MxHashtableDefaultBucketCount && MxHashtableGetCount(&table) == 100, "Compact shouldn't touch a chained table");
+	check("Wiping chained table", MxHashtableWipe(&table));
+	
+	// Take frees the key but hands the value back, Remove frees both - the same in every mode
+	check("Initialising small table", MxHashtableInitWithAllFunctions(&table, CollidingHash, NULL, CountKeyFree, CountValueFree));
+	CheckOwnership("small", &table, 5);
+	
+	check("Initialising chained table", MxHashtableInitWithAllFunctions(&table, CollidingHash, NULL, CountKeyFree, CountValueFree));
+	CheckOwnership("chained", &table, 500);
+	
+	check("Initialising compact table", MxHashtableInitCompactWithAllFunctions(&table, CollidingHash, NULL, CountKeyFree, CountValueFree));
+	CheckOwnership("compact", &table, 500);
+}
+
+
+// Fill 'table' with 'entries' entries, take and remove one each, then wipe it
+static void CheckOwnership(const char *title, MxHashtableRef table, int entries)
+{
+	MxStatus status = MxStatusOK;
+	int *value = NULL;
+	
+	for (int ctr = 1; ctr <= entries; ++ctr)
+		check("Ownership put", MxHashtablePut(table, Key(ctr), NewValue(ctr)));
+	
+	keysFreed = valuesFreed = 0;
+	
+	check("Take", MxHashtableTake(table, Key(1), (void **)&value));
+	expect(keysFreed == 1 && valuesFreed == 0, "Take should free the key only");
+	expect(*value == 1, "Take returned the wrong value");
+	free(value);
+	
+	status = MxHashtableTake(table, Key(1), (void **)&value);
+	expect(status == MxStatusNotFound, "Taking twice should not find the key");
+	
+	check("Remove", MxHashtableRemove(table, Key(2)));
+	expect(keysFreed == 2 && valuesFreed == 1, "Remove should free the key and value");
+	
+	expect(MxHashtableGetCount(table) == entries - 2, "Wrong count after take and remove");
+	
+	// Wipe frees everything left
+	check("Wiping ownership table", MxHashtableWipe(table));
+	expect(keysFreed == entries && valuesFreed == entries - 1, "Wipe should free every remaining key and value");
+	
+	printf("%s: take frees the key, remove frees both\n", title);
+}
+
+
+// Small tables keep up to MxHashtableSmallCapacity entries inline and never hash them
+static void test_small_table(void)
+{
+	MxStatus status = MxStatusOK;
+	MxHashtable table;
+	int *value;
+	
+	printf("\n-- Small table ------\n");
+	
+	// Identity keys take the branchless path, which scans all 8 slots
+	check("Initialising small table", MxHashtableInitWithAllFunctions(&table, CountingHash, NULL, CountKeyFree, CountValueFree));
+	hashCalls = 0;
+	
+	for (int ctr = 1; ctr <= MxHashtableSmallCapacity; ++ctr)
+		check("Small put", MxHashtablePut(&table, Key(ctr * 10), NewValue(ctr * 10)));
+	
+	expect(table.small && table.buckets == NULL && MxHashtableGetCount(&table) == MxHashtableSmallCapacity, "8 entries should still be small");
+	
+	for (int ctr = 1; ctr <= MxHashtableSmallCapacity; ++ctr)
+	{
+		check("Small get", MxHashtableGet(&table, Key(ctr * 10), (void **)&value));
+		expect(*value == ctr * 10, "Small get returned the wrong value");
+	}
+	
+	expect(MxHashtableContainsKey(&table, Key(5)) == MxStatusFalse, "Found a key that was never put");
+	status = MxHashtableGet(&table, Key(5), (void **)&value);
+	expect(status == MxStatusNotFound, "Get of a missing key should not find it");
+	
+	// Replacing in a full small table doesn't promote it
+	valuesFreed = 0;
+	check("Small replace", MxHashtablePut(&table, Key(80), NewValue(-80)));
+	expect(table.small && valuesFreed == 1, "Replace should stay small and free the old value");
+	
+	expect(hashCalls == 0, "Small tables shouldn't hash their keys");
+	
+	// Iterate, then remove from the middle - the last entry fills the gap
+	int sum = 0;
+	check("Small iterate", MxHashtableIteratePairs(&table, SumPair, &sum));
+	expect(sum == 2 * (10 + 20 + 30 + 40 + 50 + 60 + 70) + (80 - 80), "Iteration missed an entry");
+	
+	keysFreed = valuesFreed = 0;
+	check("Small remove", MxHashtableRemove(&table, Key(30)));
+	expect(keysFreed == 1 && valuesFreed == 1, "Small remove should free the key and value");
+	expect(table.smallKeys[2] == Key(80) && table.smallKeys[MxHashtableSmallCapacity - 1] == NULL, "The last entry should fill the gap");
+	expect(MxHashtableContainsKey(&table, Key(30)) == MxStatusFalse && MxHashtableContainsKey(&table, Key(80)) == MxStatusTrue, "Wrong keys after small remove");
+	
+	sum = 0;
+	check("Small iterate after remove", MxHashtableIteratePairs(&table, SumPair, &sum));
+	expect(sum == 2 * (10 + 20 + 40 + 50 + 60 + 70), "Iteration after remove saw the wrong entries");
+	
+	// Back to 8, then the 9th promotes to buckets
+	check("Small refill", MxHashtablePut(&table, Key(30), NewValue(30)));
+	check("Small restore", MxHashtablePut(&table, Key(80), NewValue(80)));
+	expect(table.small, "Refilling to 8 should stay small");
+	CheckPromotion(&table);
+	check("Wiping small table", MxHashtableWipe(&table));
+	
+	// A custom equals function takes the linear path; the keys are equal but not identical
+	static char keyText[MxHashtableSmallCapacity][16];
+	check("Initialising string table", MxHashtableInitWithAllFunctions(&table, MxDefaultStringHashFunction, MxDefaultCStrEqualsFunction, CountKeyFree, CountValueFree));
+	
+	for (int ctr = 0; ctr < MxHashtableSmallCapacity; ++ctr)
+	{
+		snprintf(keyText[ctr], sizeof(keyText[ctr]), "key%d", ctr);
+		check("String put", MxHashtablePut(&table, keyText[ctr], NewValue(ctr)));
+	}
+	
+	char probe[16];
+	for (int ctr = 0; ctr < MxHashtableSmallCapacity; ++ctr)
+	{
+		snprintf(probe, sizeof(probe), "key%d", ctr);
+		check("String get", MxHashtableGet(&table, probe, (void **)&value));
+		expect(*value == ctr, "String get returned the wrong value");
+	}
+	
+	expect(MxHashtableContainsKey(&table, "key9") == MxStatusFalse, "Found a string key that was never put");
+	check("String remove", MxHashtableRemove(&table, "key3"));
+	expect(table.small && MxHashtableGetCount(&table) == MxHashtableSmallCapacity - 1, "Wrong count after string remove");
+	check("Wiping string table", MxHashtableWipe(&table));
+	
+	// A compact table promotes to its dense entry array instead
+	check("Initialising small compact table", MxHashtableInitCompactWithAllFunctions(&table, CountingHash, NULL, CountKeyFree, CountValueFree));
+	for (int ctr = 1; ctr <= MxHashtableSmallCapacity; ++ctr)
+		check("Small compact put", MxHashtablePut(&table, Key(ctr * 10), NewValue(ctr * 10)));
+	expect(table.small && table.compactEntries == NULL, "8 entries should still be small");
+	CheckPromotion(&table);
+	check("Wiping small compact table", MxHashtableWipe(&table));
+}
+
+
+// Put a 9th entry into a full small table and check every entry survives the move
+static void CheckPromotion(MxHashtableRef table)
+{
+	MxStatus status = MxStatusOK;
+	int *value;
+	
+	check("Promoting put", MxHashtablePut(table, Key(90), NewValue(90)));
+	expect(!table->small && MxHashtableGetCount(table) == MxHashtableSmallCapacity + 1, "The 9th entry should promote the table");
+	expect(table->bucketCount == MxHashtableDefaultBucketCount, "Promotion should set up the default buckets");
+	
+	if (table->compact)
+		expect(table->compactEntries != NULL && table->compactCapacity == MxHashtableCompactDefaultCapacity, "Compact promotion should allocate the entry array")
+	else
+		expect(table->buckets != NULL, "Chained promotion should allocate the bucket lists");
+	
+	for (int ctr = 1; ctr <= MxHashtableSmallCapacity + 1; ++ctr)
+	{
+		check("Get after promotion", MxHashtableGet(table, Key(ctr * 10), (void **)&value));
+		expect(*value == ctr * 10, "Lost a value in promotion");
+	}
+	
+	printf("Promoted to %s on entry %d\n", table->compact ? "compact" : "chained", MxHashtableSmallCapacity + 1);
+}
+
+
+// Adds key + value (as integers) to the int at *state
+static MxStatus SumPair(const void *key, const void *value, void *state)
+{
+	*(int *)state += (int)(uintptr_t)key + *(const int *)value;
+	return MxStatusOK;
+}
+
+
+// Only a few dozen distinct hashes, so chains are long whatever the bucket count
+static unsigned long CollidingHash(const void *key)
+{
+	return (unsigned long)((uintptr_t)key % 61);
+}
+
+static unsigned long CountingHash(const void *key)
+{
+	hashCalls += 1;
+	return (unsigned long)(uintptr_t)key;
+}
+
+// Keys are integers - count them but there's nothing to free
+static void CountKeyFree(void *key)
+{
+	(void)key;
+	keysFreed += 1;
+}
+
+static void CountValueFree(void *value)
+{
+	valuesFreed += 1;
+	free(value);
+}
+
+static int *NewValue(int value)
+{
+	int *result = (int *)malloc(sizeof(int));
+	if (result == NULL)
+		die("Allocating value");
+	
+	*result = value;
+	return result;
 }
 
 static MxStatus PrintCallback(const void *data, void *state)
@@ -133,10 +537,17 @@ static void PrintTable(const char *title, MxHashtableRef table)
 	printf("\n-- %s ------\n", title);
 	MxHashtableIteratePairs(table, PrintPair, NULL);
 	printf("---------------\n");
-	printf("Bucket counts (%d items): ", MxHashtableGetCount(table));
-	for (unsigned int ctr = 0; ctr < table->bucketCount; ctr++)
+	if (table->small)
+	{
+		printf("Small table (%d items)", MxHashtableGetCount(table));
+	}
+	else
 	{
-		printf("%d ", MxListGetCount((MxListRef)(table->buckets+ctr)));
+		printf("Bucket counts (%d items): ", MxHashtableGetCount(table));
+		for (unsigned int ctr = 0; ctr < table->bucketCount; ctr++)
+		{
+			printf("%d ", MxListGetCount((MxListRef)(table->buckets+ctr)));
+		}
 	}
 	printf("\n---------------\n");
 }
\ No newline at end of file
@@ -0,0 +1,235 @@
+//
+//  test_ilist.c
+//  core_ds
+//
+
+#include "test_ilist.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "MxIList.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+#define ItemCount (10)
+
+// Two links, so neither is at the start of the struct and the item can be in two lists
+typedef struct {
+	int value;
+	MxIListLink link;
+	MxIListLink evenLink;
+} Item;
+
+static void test_linking(void);
+static void test_safe_removal(void);
+static void test_clear(void);
+static void CheckOrder(MxIListRef list, const int *expected, size_t count, const char *message);
+static MxStatus RemoveOdd(const void *value, void *state);
+
+
+void test_ilist(void)
+{
+	printf("\n-- Intrusive list ------\n");
+	
+	test_linking();
+	test_safe_removal();
+	test_clear();
+}
+
+
+static void test_linking(void)
+{
+	MxStatus status = MxStatusOK;
+	MxIList list, evens;
+	Item items[ItemCount];
+	
+	check("Initialising", MxIListInit(&list));
+	check("Initialising", MxIListInit(&evens));
+	
+	for (int ctr = 0; ctr < ItemCount; ++ctr)
+	{
+		items[ctr].value = ctr;
+		MxIListLinkInit(&items[ctr].link);
+		MxIListLinkInit(&items[ctr].evenLink);
+	}
+	
+	// 0 pushed in front of 1 to 8, then 9 put before 8
+	for (int ctr = 1; ctr < ItemCount - 1; ++ctr)
+		check("Appending", MxIListAppend(&list, &items[ctr].link));
+	check("Pushing", MxIListPush(&list, &items[0].link));
+	check("Inserting", MxIListInsertBefore(&list, &items[8].link, &items[9].link));
+	
+	static const int order[ItemCount] = { 0, 1, 2, 3, 4, 5, 6, 7, 9, 8 };
+	CheckOrder(&list, order, ItemCount, "Appended, pushed and inserted");
+	
+	// Backwards too, getting each item back from its link
+	size_t position = ItemCount;
+	for (MxIListLinkRef link = MxIListLast(&list); link != NULL; link = MxIListPrev(&list, link))
+		expect(MxIListEntry(link, Item, link)->value == order[--position], "Wrong order backwards");
+	expect(position == 0, "Walking backwards missed items");
+	
+	// The same items in a second list through their other link
+	for (int ctr = 0; ctr < ItemCount; ctr += 2)
+		check("Appending evens", MxIListAppend(&evens, &items[ctr].evenLink));
+	MX_ILIST_FOREACH(&evens, link)
+		expect(MxIListEntry(link, Item, evenLink)->value % 2 == 0, "Recovered the wrong item from its second link");
+	expect(MxIListGetCount(&evens) == ItemCount / 2 && MxIListGetCount(&list) == ItemCount, "Lists interfered with each other");
+	
+	printf("Items linked in order and recovered from either link\n");
+	
+	// A link can only be in one list at once...
+	status = MxIListAppend(&list, &items[3].link);
+	expect(status == MxStatusIllegalArgument, "Appending a linked item should be rejected");
+	status = MxIListPush(&evens, &items[3].link);
+	expect(status == MxStatusIllegalArgument, "Adding a link to a second list should be rejected");
+	status = MxIListInsertAfter(&list, &items[5].link, &items[2].link);
+	expect(status == MxStatusIllegalArgument, "Inserting a linked item should be rejected");
+	expect(MxIListGetCount(&list) == ItemCount && MxIListGetCount(&evens) == ItemCount / 2, "Rejected links changed the counts");
+	CheckOrder(&list, order, ItemCount, "Rejected links changed the order");
+	
+	// ...and has to be in one to come out
+	check("Removing", MxIListRemove(&list, &items[3].link));
+	expect(!MxIListIsLinked(&items[3].link), "Removed link still marked as linked");
+	status = MxIListRemove(&list, &items[3].link);
+	expect(status == MxStatusNotFound, "Removing an unlinked item should be NotFound");
+	status = MxIListRemove(&evens, &items[3].evenLink);
+	expect(status == MxStatusNotFound, "Removing a never linked item should be NotFound");
+	expect(MxIListGetCount(&list) == ItemCount - 1, "Failed removals changed the count");
+	
+	printf("Linked links rejected, unlinked links not found\n");
+	
+	// Pop takes from the front, Dequeue from the back, and both give NULL once empty
+	MxIListLinkRef link = NULL;
+	check("Popping", MxIListPop(&list, &link));
+	expect(link == &items[0].link && !MxIListIsLinked(link), "Pop should take the first item");
+	check("Dequeueing", MxIListDequeue(&list, &link));
+	expect(link == &items[8].link && !MxIListIsLinked(link), "Dequeue should take the last item");
+	
+	while (MxIListGetCount(&list) > 0)
+		check("Emptying", MxIListPop(&list, &link));
+	check("Popping empty", MxIListPop(&list, &link));
+	expect(link == NULL && MxIListFirst(&list) == NULL && MxIListLast(&list) == NULL, "Empty list should have no links");
+	check("Dequeueing empty", MxIListDequeue(&list, &link));
+	expect(link == NULL, "Empty list should have no links");
+	
+	check("Clearing evens", MxIListClear(&evens));
+}
+
+
+// Removing - and freeing - the current item inside the loop
+static void test_safe_removal(void)
+{
+	MxStatus status = MxStatusOK;
+	MxIList list;
+	
+	check("Initialising", MxIListInit(&list));
+	
+	for (int ctr = 0; ctr < ItemCount; ++ctr)
+	{
+		Item *item = (Item *)malloc(sizeof(Item));
+		expect(item != NULL, "Allocating an item");
+		item->value = ctr;
+		MxIListLinkInit(&item->link);
+		check("Appending", MxIListAppend(&list, &item->link));
+	}
+	
+	// Freed straight after removal, so a loop that read the link afterwards would be caught
+	MX_ILIST_FOREACH_SAFE(&list, link)
+	{
+		Item *item = MxIListEntry(link, Item, link);
+		if (item->value % 3 == 0)
+		{
+			check("Removing in the loop", MxIListRemove(&list, link));
+			free(item);
+		}
+	}
+	
+	static const int afterThrees[] = { 1, 2, 4, 5, 7, 8 };
+	CheckOrder(&list, afterThrees, sizeof(afterThrees) / sizeof(afterThrees[0]), "Removed multiples of 3");
+	
+	// An iterate callback may remove the link it's given
+	check("Iterating", MxIListIterate(&list, RemoveOdd, &list));
+	static const int afterOdds[] = { 2, 4, 8 };
+	CheckOrder(&list, afterOdds, sizeof(afterOdds) / sizeof(afterOdds[0]), "Removed odd values");
+	
+	// Everything, last of all
+	MX_ILIST_FOREACH_SAFE(&list, link)
+	{
+		check("Emptying in the loop", MxIListRemove(&list, link));
+		free(MxIListEntry(link, Item, link));
+	}
+	expect(MxIListGetCount(&list) == 0 && MxIListFirst(&list) == NULL, "List should be empty");
+	
+	printf("Items removed and freed inside MX_ILIST_FOREACH_SAFE and Iterate\n");
+}
+
+
+static void test_clear(void)
+{
+	MxStatus status = MxStatusOK;
+	MxIList list, other;
+	Item items[ItemCount];
+	
+	check("Initialising", MxIListInit(&list));
+	check("Initialising", MxIListInit(&other));
+	
+	for (int ctr = 0; ctr < ItemCount; ++ctr)
+	{
+		items[ctr].value = ctr;
+		MxIListLinkInit(&items[ctr].link);
+		check("Appending", MxIListAppend(&list, &items[ctr].link));
+	}
+	
+	check("Clearing", MxIListClear(&list));
+	expect(MxIListGetCount(&list) == 0 && MxIListFirst(&list) == NULL, "Cleared list should be empty");
+	for (int ctr = 0; ctr < ItemCount; ++ctr)
+		expect(!MxIListIsLinked(&items[ctr].link), "Clear left a link marked as linked");
+	
+	// Cleared links can go straight into another list, in any order
+	for (int ctr = ItemCount - 1; ctr >= 0; --ctr)
+		check("Relinking", MxIListAppend(&other, &items[ctr].link));
+	
+	static const int reversed[ItemCount] = { 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+	CheckOrder(&other, reversed, ItemCount, "Relinked after Clear");
+	expect(MxIListGetCount(&list) == 0, "Relinking touched the cleared list");
+	
+	printf("Clear unlinks every item\n");
+	
+	check("Clearing", MxIListClear(&other));
+}
+
+
+// The list holds exactly 'expected', in order, front to back
+static void CheckOrder(MxIListRef list, const int *expected, size_t count, const char *message)
+{
+	size_t position = 0;
+	
+	MX_ILIST_FOREACH(list, link)
+	{
+		expect(position < count && MxIListEntry(link, Item, link)->value == expected[position], message);
+		++position;
+	}
+	
+	expect(position == count && MxIListGetCount(list) == count, message);
+}
+
+
+static MxStatus RemoveOdd(const void *value, void *state)
+{
+	MxIListLinkRef link = (MxIListLinkRef)value;
+	Item *item = MxIListEntry(link, Item, link);
+	
+	if (item->value % 2 == 0)
+		return MxStatusOK;
+	
+	MxStatus status = MxIListRemove((MxIListRef)state, link);
+	if (status == MxStatusOK)
+		free(item);
+	
+	return status;
+}
@@ -0,0 +1,11 @@
+//
+//  test_ilist.h
+//  core_ds
+//
+
+#ifndef core_ds_test_ilist_h
+#define core_ds_test_ilist_h
+
+void test_ilist(void);
+
+#endif
@@ -11,15 +11,34 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "MxStatus.h"
 #include "MxList.h"
 
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
 static int PrintStringIterator(const void *string, void *state);
 static void PrintList(const char *title, MxListRef list);
 static int FilterCallback(const void *entry, void *state);
 static int MapCallback(const void *entry, void *state);
 
+static void test_private_pool(void);
+static void test_pool_reuse(void);
+static void test_clear_without_free(void);
+static size_t CountFreeNodes(MxListNodePoolRef pool);
+static void CheckItems(MxListRef list, int count, const char *message);
+static int CheckItemIterator(const void *item, void *state);
+static void LogFree(void *item);
+
+// Small integers stored in the item pointer itself, offset so that 0 isn't NULL
+#define Item(n) ((void *)(uintptr_t)((n) + 1))
+#define ItemValue(item) ((int)(uintptr_t)(item) - 1)
+
+// How many times LogFree has been passed each item
+static int freeCounts[64];
+
 
 void test_list(void)
 {
@@ -141,6 +160,212 @@ void test_list(void)
     
 	if ((status = MxListDelete(list)) != MxStatusOK)
 		dieWithStatus("Deleting list", status);
+	
+	
+	printf("\nPooled nodes...\n");
+	MxListNodePool pool;
+	MxList pooled;
+	
+	// A tiny slab size so a few pushes need more than one slab
+	if ((status = MxListNodePoolInit(&pool, 2)) != MxStatusOK)
+		dieWithStatus("Initing node pool", status);
+	
+	if ((status = MxListInitWithPool(&pooled, &pool, NULL, NULL)) != MxStatusOK)
+		dieWithStatus("Initing pooled list", status);
+	
+	for (int ctr = 0; listItems[ctr] != NULL; ++ctr)
+		if ((status = MxListAppend(&pooled, listItems[ctr])) != MxStatusOK)
+			dieWithStatus("Appending to pooled list", status);
+	
+	if ((status = MxListPop(&pooled, (void **)&result)) != MxStatusOK)
+		dieWithStatus("Popping pooled list", status);
+	
+	// Reuses the node just popped
+	if ((status = MxListAppend(&pooled, result)) != MxStatusOK)
+		dieWithStatus("Re-appending to pooled list", status);
+	
+	PrintList("Pooled list", &pooled);
+	printf("Slabs in pool: %zu\n", pool.slabCount);
+	
+	MxListWipe(&pooled);
+	MxListNodePoolWipe(&pool);
+	
+	test_private_pool();
+	test_pool_reuse();
+	test_clear_without_free();
+	printf("Pooled lists OK\n");
+}
+
+
+// A private pool is freed with the list, after itemFree has seen every item once
+static void test_private_pool(void)
+{
+	MxStatus status = MxStatusOK;
+	void *item = NULL;
+	
+	for (int ctr = 0; ctr < 64; ++ctr)
+		freeCounts[ctr] = 0;
+	
+	MxListRef list = MxListCreateWithPrivatePool(2, LogFree, NULL);
+	expect(list != NULL, "Could not create a list with a private pool");
+	expect(list->ownsPool && list->pool != NULL, "The list should own its pool");
+	expect(list->pool->nodesPerSlab == 2, "The pool should use the slab size given");
+	
+	for (int ctr = 0; ctr < 7; ++ctr)
+		check("Appending to private pool list", MxListAppend(list, Item(ctr)));
+	
+	// The sentinel and seven items, two to a slab
+	expect(list->pool->slabCount == 4, "Eight nodes should need four slabs");
+	CheckItems(list, 7, "Appending to a private pool list");
+	
+	check("Popping private pool list", MxListPop(list, &item));
+	expect(ItemValue(item) == 0, "Pop should return the first item");
+	expect(CountFreeNodes(list->pool) == 1, "The popped node should go back to the pool");
+	
+	check("Pushing back to private pool list", MxListPush(list, item));
+	expect(list->pool->slabCount == 4, "Pushing back should reuse the popped node, not add a slab");
+	expect(CountFreeNodes(list->pool) == 0, "The popped node should have been taken again");
+	CheckItems(list, 7, "Pushing back to a private pool list");
+	
+	for (int ctr = 0; ctr < 64; ++ctr)
+		expect(freeCounts[ctr] == 0, "Pop and push should not free items");
+	
+	check("Deleting private pool list", MxListDelete(list));
+	for (int ctr = 0; ctr < 64; ++ctr)
+		expect(freeCounts[ctr] == (ctr < 7), "Deleting should free every item exactly once");
+	
+	// On the stack with the default slab size
+	MxList stackList;
+	check("Initing private pool list", MxListInitWithPrivatePool(&stackList, 0, LogFree, NULL));
+	expect(stackList.pool->nodesPerSlab == MxListNodePoolDefaultSlabNodes, "A slab size of 0 should use the default");
+	
+	for (int ctr = 0; ctr < 2000; ++ctr)
+		check("Appending to private pool list", MxListAppend(&stackList, Item(ctr % 50)));
+	
+	expect(stackList.pool->slabCount == 2, "2001 nodes should fill two default slabs");
+	
+	check("Wiping private pool list", MxListWipe(&stackList));
+	expect(stackList.pool == NULL && stackList.sentinel == NULL, "Wiping should reset the list");
+	for (int ctr = 0; ctr < 50; ++ctr)
+		expect(freeCounts[ctr] == (ctr < 7) + 40, "Wiping should free every item exactly once");
+}
+
+
+// Once the pool has enough nodes, churn never adds a slab
+static void test_pool_reuse(void)
+{
+	MxStatus status = MxStatusOK;
+	MxListNodePool pool;
+	MxList list;
+	void *item = NULL;
+	
+	check("Initing node pool", MxListNodePoolInit(&pool, 4));
+	check("Initing pooled list", MxListInitWithPool(&list, &pool, NULL, NULL));
+	
+	for (int ctr = 0; ctr < 10; ++ctr)
+		check("Appending to pooled list", MxListAppend(&list, Item(ctr)));
+	
+	size_t slabs = pool.slabCount;
+	expect(slabs == 3, "Eleven nodes should need three slabs of four");
+	
+	for (int round = 0; round < 100; ++round)
+	{
+		for (int ctr = 0; ctr < 10; ++ctr)
+		{
+			check("Popping pooled list", MxListPop(&list, &item));
+			expect(ItemValue(item) == ctr, "Pop should return the items in order");
+		}
+		
+		expect(MxListGetCount(&list) == 0, "Every item should have been popped");
+		expect(CountFreeNodes(&pool) == 10, "Every popped node should be back in the pool");
+		
+		for (int ctr = 0; ctr < 10; ++ctr)
+			check("Appending to pooled list", MxListAppend(&list, Item(ctr)));
+		
+		expect(pool.slabCount == slabs, "Appending after popping should reuse nodes, not add slabs");
+	}
+	
+	CheckItems(&list, 10, "Churning a pooled list");
+	
+	check("Wiping pooled list", MxListWipe(&list));
+	check("Wiping node pool", MxListNodePoolWipe(&pool));
+}
+
+
+// Clear and Wipe once skipped the first node when there was no itemFree
+static void test_clear_without_free(void)
+{
+	MxStatus status = MxStatusOK;
+	MxListNodePool pool;
+	MxList list;
+	
+	check("Initing node pool", MxListNodePoolInit(&pool, 0));
+	check("Initing pooled list", MxListInitWithPool(&list, &pool, NULL, NULL));
+	
+	for (int ctr = 0; ctr < 5; ++ctr)
+		check("Appending to pooled list", MxListAppend(&list, Item(ctr)));
+	
+	check("Clearing pooled list", MxListClear(&list));
+	expect(MxListGetCount(&list) == 0, "Clearing should empty the list");
+	expect(CountFreeNodes(&pool) == 5, "Clearing should release every node");
+	
+	for (int ctr = 0; ctr < 3; ++ctr)
+		check("Appending to cleared list", MxListAppend(&list, Item(ctr)));
+	CheckItems(&list, 3, "Appending after clearing");
+	
+	// The three item nodes and the sentinel
+	check("Wiping pooled list", MxListWipe(&list));
+	expect(CountFreeNodes(&pool) == 6, "Wiping should release every node and the sentinel");
+	check("Wiping node pool", MxListNodePoolWipe(&pool));
+	
+	// With malloc'd nodes a missed node shows up as a leak
+	MxListRef heapList = MxListCreateWithFunctions(NULL, NULL);
+	expect(heapList != NULL, "Could not create list");
+	
+	for (int ctr = 0; ctr < 5; ++ctr)
+		check("Appending to list", MxListAppend(heapList, Item(ctr)));
+	check("Clearing list", MxListClear(heapList));
+	
+	for (int ctr = 0; ctr < 5; ++ctr)
+		check("Appending to cleared list", MxListAppend(heapList, Item(ctr)));
+	check("Deleting list", MxListDelete(heapList));
+}
+
+
+static size_t CountFreeNodes(MxListNodePoolRef pool)
+{
+	size_t count = 0;
+	for (MxListNodeRef node = pool->freeNodes; node != NULL; node = node->next)
+		count += 1;
+	
+	return count;
+}
+
+
+// The list should hold Item(0) ... Item(count - 1) in order
+static void CheckItems(MxListRef list, int count, const char *message)
+{
+	int next = 0;
+	
+	expect(MxListGetCount(list) == count, message);
+	if (MxListIterateForward(list, CheckItemIterator, &next) != MxStatusOK || next != count)
+		die(message);
+}
+
+static int CheckItemIterator(const void *item, void *state)
+{
+	int *next = (int *)state;
+	
+	if (ItemValue(item) != *next)
+		return MxStatusIllegalArgument;
+	
+	*next += 1;
+	return MxStatusOK;
+}
+
+static void LogFree(void *item)
+{
+	freeCounts[ItemValue(item)] += 1;
 }
 
 
@@ -0,0 +1,269 @@
+//
+//  test_multimap.c
+//  core_ds
+//
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "utils.h"
+#include "test_multimap.h"
+
+#include "MxStatus.h"
+#include "MxMultiMap.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+static void PrintMap(const char *title, MxMultiMapRef map);
+static MxStatus PrintPair(const void *key, const void *value, void *state);
+static void CheckStrings(MxMultiMapRef map, const char *key, const char **expected, size_t count, const char *message);
+static MxStatus CheckStringIterator(const void *value, void *state);
+static MxStatus CountPair(const void *key, const void *value, void *state);
+
+static void test_many_values(void);
+static void CheckNumbers(MxMultiMapRef map, int key, const int *expected, size_t count, const char *message);
+static void LogKeyFree(void *key);
+static void LogValueFree(void *value);
+
+// Small integers stored in the pointer itself, offset so that 0 isn't NULL
+#define Number(n) ((void *)(uintptr_t)((n) + 1))
+#define NumberValue(item) ((int)(uintptr_t)(item) - 1)
+
+// How many times each key and value has been freed
+static int keyFrees[16];
+static int valueFrees[64];
+
+// The expected values, walked by CheckStringIterator
+typedef struct _StringCursor {
+	const char **expected;
+	size_t count;
+	size_t next;
+} StringCursor;
+
+
+void test_multimap(void)
+{
+	static char *mapContents[] = {
+		"colours", "red",
+		"colours", "green",
+		"shapes", "square",
+		"colours", "blue",
+		"colours", "cyan",
+		"colours", "magenta",
+		"shapes", "circle",
+		NULL
+	};
+	
+	MxMultiMap map;
+	MxStatus status = MxStatusOK;
+	check("Initialising", MxMultiMapInitAsPropertyMap(&map));
+	
+	int idx = 0;
+	while (mapContents[idx]) {
+		check("Appending", MxMultiMapAppend(&map, mapContents[idx], mapContents[idx+1]));
+		idx += 2;
+	}
+	
+	PrintMap("Initial", &map);
+	
+	// Five colours is one more than fits inline
+	const char *colours[] = { "red", "green", "blue", "cyan", "magenta" };
+	const char *shapes[] = { "square", "circle" };
+	CheckStrings(&map, "colours", colours, 5, "The colours should be in insertion order");
+	CheckStrings(&map, "shapes", shapes, 2, "The shapes should be in insertion order");
+	expect(MxMultiMapGetKeyCount(&map) == 2 && MxMultiMapGetCount(&map) == 7, "Appending should count keys and values");
+	
+	int pairs = 0;
+	check("Iterating pairs", MxMultiMapIteratePairs(&map, CountPair, &pairs));
+	expect(pairs == 7, "Every pair should be visited once");
+	
+	check("Removing 'green'", MxMultiMapRemoveValue(&map, "colours", mapContents[3]));
+	
+	const char *withoutGreen[] = { "red", "blue", "cyan", "magenta" };
+	CheckStrings(&map, "colours", withoutGreen, 4, "Removing a value should keep the others in order");
+	
+	status = MxMultiMapRemoveValue(&map, "colours", "green");
+	expect(status == MxStatusNotFound, "Removing a value twice should not find it");
+	
+	status = MxMultiMapRemoveValue(&map, "sizes", "large");
+	expect(status == MxStatusNotFound, "Removing from a missing key should not find it");
+	
+	// The last value for a key takes the key with it
+	check("Removing 'square'", MxMultiMapRemoveValue(&map, "shapes", mapContents[5]));
+	CheckStrings(&map, "shapes", shapes + 1, 1, "Removing 'square' should leave 'circle'");
+	check("Removing 'circle'", MxMultiMapRemoveValue(&map, "shapes", mapContents[13]));
+	
+	expect(MxMultiMapContainsKey(&map, "shapes") == MxStatusFalse, "Removing every value should remove the key");
+	expect(MxMultiMapGetValueCount(&map, "shapes") == 0, "A removed key should have no values");
+	
+	void **values = (void **)&map;
+	size_t count = 99;
+	status = MxMultiMapGetValues(&map, "shapes", &values, &count);
+	expect(status == MxStatusNotFound && values == NULL && count == 0, "Getting a removed key should find nothing");
+	
+	expect(MxMultiMapGetKeyCount(&map) == 1 && MxMultiMapGetCount(&map) == 4, "Removals should update the counts");
+	
+	PrintMap("After removals", &map);
+	
+	check("Removing 'colours'", MxMultiMapRemoveKey(&map, "colours"));
+	expect(MxMultiMapGetKeyCount(&map) == 0 && MxMultiMapGetCount(&map) == 0, "Removing the key should empty the map");
+	
+	status = MxMultiMapRemoveKey(&map, "colours");
+	expect(status == MxStatusNotFound, "Removing a key twice should not find it");
+	
+	PrintMap("After removing 'colours'", &map);
+	
+	check("Wiping", MxMultiMapWipe(&map));
+	
+	test_many_values();
+	printf("Multimap OK\n");
+}
+
+
+// Keys and values owned by the map, with enough values to spill out of the entry
+static void test_many_values(void)
+{
+	MxStatus status = MxStatusOK;
+	memset(keyFrees, 0, sizeof(keyFrees));
+	memset(valueFrees, 0, sizeof(valueFrees));
+	
+	MxMultiMapRef map = MxMultiMapCreateWithAllFunctions(MxDefaultHashFunction, MxDefaultEqualsFunction, LogKeyFree, LogValueFree);
+	expect(map != NULL, "Could not create multimap");
+	
+	// Key k gets the values k * 10 ... k * 10 + 9, interleaved with the other keys
+	for (int value = 0; value < 10; ++value)
+		for (int key = 0; key < 3; ++key)
+			check("Appending", MxMultiMapAppend(map, Number(key), Number(key * 10 + value)));
+	
+	expect(MxMultiMapGetKeyCount(map) == 3 && MxMultiMapGetCount(map) == 30, "Appending should count keys and values");
+	
+	const int tens[] = { 10, 11, 12, 13, 14, 15, 16, 17, 18, 19 };
+	for (int key = 0; key < 3; ++key)
+	{
+		int expected[10];
+		for (int ctr = 0; ctr < 10; ++ctr)
+			expected[ctr] = key * 10 + ctr;
+		CheckNumbers(map, key, expected, 10, "Ten values should stay in insertion order");
+	}
+	
+	for (size_t ctr = 0; ctr < 16; ++ctr)
+		expect(keyFrees[ctr] == 0, "A repeated key should not be freed while it is in use");
+	
+	// From the inline part, the spilled part and the end
+	check("Removing a value", MxMultiMapRemoveValue(map, Number(1), Number(11)));
+	check("Removing a value", MxMultiMapRemoveValue(map, Number(1), Number(16)));
+	check("Removing a value", MxMultiMapRemoveValue(map, Number(1), Number(19)));
+	
+	const int remaining[] = { 10, 12, 13, 14, 15, 17, 18 };
+	CheckNumbers(map, 1, remaining, 7, "Removing values should keep the others in order");
+	expect(valueFrees[11] == 1 && valueFrees[16] == 1 && valueFrees[19] == 1, "Removed values should be freed");
+	expect(MxMultiMapGetCount(map) == 27, "Removing values should update the count");
+	
+	// Appending after removing at the end goes after the last remaining value
+	check("Appending", MxMultiMapAppend(map, Number(1), Number(19)));
+	const int reappended[] = { 10, 12, 13, 14, 15, 17, 18, 19 };
+	CheckNumbers(map, 1, reappended, 8, "Appending should go after the remaining values");
+	
+	// Down to nothing, last value first
+	for (int ctr = 7; ctr >= 0; --ctr)
+		check("Emptying a key", MxMultiMapRemoveValue(map, Number(1), Number(reappended[ctr])));
+	
+	expect(MxMultiMapContainsKey(map, Number(1)) == MxStatusFalse, "Removing every value should remove the key");
+	expect(keyFrees[1] == 1, "Removing the last value should free the key once");
+	for (size_t ctr = 0; ctr < 10; ++ctr)
+		expect(valueFrees[tens[ctr]] == 1 + (tens[ctr] == 19), "Every removed value should be freed once");
+	
+	check("Removing a key", MxMultiMapRemoveKey(map, Number(2)));
+	expect(keyFrees[2] == 1, "Removing a key should free it");
+	for (int ctr = 20; ctr < 30; ++ctr)
+		expect(valueFrees[ctr] == 1, "Removing a key should free its values");
+	
+	expect(MxMultiMapGetKeyCount(map) == 1 && MxMultiMapGetCount(map) == 10, "Removing keys should update the counts");
+	
+	check("Deleting", MxMultiMapDelete(map));
+	expect(keyFrees[0] == 1, "Deleting should free the remaining key");
+	for (int ctr = 0; ctr < 10; ++ctr)
+		expect(valueFrees[ctr] == 1, "Deleting should free the remaining values");
+}
+
+
+// GetValues and IterateValuesForKey should both give 'expected', in order
+static void CheckStrings(MxMultiMapRef map, const char *key, const char **expected, size_t count, const char *message)
+{
+	MxStatus status = MxStatusOK;
+	void **values = NULL;
+	size_t valueCount = 0;
+	
+	check("Getting values", MxMultiMapGetValues(map, key, &values, &valueCount));
+	expect(valueCount == count && MxMultiMapGetValueCount(map, key) == count, message);
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		expect(strcmp((const char *)values[ctr], expected[ctr]) == 0, message);
+	
+	StringCursor cursor = { expected, count, 0 };
+	status = MxMultiMapIterateValuesForKey(map, key, CheckStringIterator, &cursor);
+	expect(status == MxStatusOK && cursor.next == count, message);
+}
+
+static MxStatus CheckStringIterator(const void *value, void *state)
+{
+	StringCursor *cursor = (StringCursor *)state;
+	
+	if (cursor->next >= cursor->count || strcmp((const char *)value, cursor->expected[cursor->next]) != 0)
+		return MxStatusIllegalArgument;
+	
+	cursor->next += 1;
+	return MxStatusOK;
+}
+
+
+static void CheckNumbers(MxMultiMapRef map, int key, const int *expected, size_t count, const char *message)
+{
+	MxStatus status = MxStatusOK;
+	void **values = NULL;
+	size_t valueCount = 0;
+	
+	check("Getting values", MxMultiMapGetValues(map, Number(key), &values, &valueCount));
+	expect(valueCount == count && MxMultiMapGetValueCount(map, Number(key)) == count, message);
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		expect(NumberValue(values[ctr]) == expected[ctr], message);
+}
+
+
+static void LogKeyFree(void *key)
+{
+	keyFrees[NumberValue(key)] += 1;
+}
+
+static void LogValueFree(void *value)
+{
+	valueFrees[NumberValue(value)] += 1;
+}
+
+
+static MxStatus CountPair(const void *key, const void *value, void *state)
+{
+	(void)key;
+	(void)value;
+	
+	*(int *)state += 1;
+	return MxStatusOK;
+}
+
+
+static MxStatus PrintPair(const void *key, const void *value, void *state)
+{
+	printf("%s => %s\n", (const char *)key, (const char *)value);
+	return MxStatusOK;
+}
+
+
+static void PrintMap(const char *title, MxMultiMapRef map)
+{
+	printf("\n-- %s ------\n", title);
+	MxMultiMapIteratePairs(map, PrintPair, NULL);
+	printf("---------------\n");
+	printf("%d keys, %d values\n", MxMultiMapGetKeyCount(map), MxMultiMapGetCount(map));
+	printf("---------------\n");
+}
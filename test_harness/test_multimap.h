@@ -0,0 +1,11 @@
+//
+//  test_multimap.h
+//  core_ds
+//
+
+#ifndef core_ds_test_multimap_h
+#define core_ds_test_multimap_h
+
+void test_multimap(void);
+
+#endif
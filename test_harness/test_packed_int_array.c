@@ -0,0 +1,289 @@
+//
+//  test_packed_int_array.c
+//  core_ds
+//
+
+#include "test_packed_int_array.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "MxPackedIntArray.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+#define BlockSize MxPackedIntArrayBlockSize
+// A full block and a partial tail
+#define WidthTestCount (BlockSize + 37)
+
+static void test_widths(void);
+static void test_duplicates(void);
+static void test_intersection(void);
+static void Fill(MxPackedIntArrayRef array, const uint32_t *values, size_t count);
+static void CheckContents(MxPackedIntArrayRef array, const uint32_t *expected, size_t count);
+static void CheckIntersection(const char *title, const uint32_t *a, size_t aCount, const uint32_t *b, size_t bCount);
+static MxStatus CompareValue(const void *value, void *state);
+
+// Where CompareValue is up to, and what it should see
+typedef struct {
+	const uint32_t *expected;
+	size_t position;
+} IterateState;
+
+
+void test_packed_int_array(void)
+{
+	printf("\n-- Packed int array ------\n");
+	
+	test_widths();
+	test_duplicates();
+	test_intersection();
+}
+
+
+// A block whose widest gap needs exactly 'bits' bits, for every width from 0 to 32
+static void test_widths(void)
+{
+	MxStatus status = MxStatusOK;
+	MxPackedIntArray array;
+	uint32_t values[WidthTestCount];
+	
+	srand(3);
+	check("Initialising", MxPackedIntArrayInit(&array));
+	
+	for (uint32_t bits = 0; bits <= 32; ++bits)
+	{
+		uint32_t mask = (bits == 32) ? UINT32_MAX : ((1u << bits) - 1);
+		// Keep the other gaps small enough that the values can't wrap
+		uint32_t smallMask = (bits == 32) ? 0 : (mask >> 7);
+		size_t widest = (size_t)rand() % (BlockSize - 1) + 1;
+		
+		values[0] = (bits == 32) ? 0 : (uint32_t)rand() % 1000;
+		for (size_t ctr = 1; ctr < WidthTestCount; ++ctr)
+		{
+			uint32_t gap = (ctr == widest) ? mask : ((uint32_t)rand() & smallMask);
+			values[ctr] = values[ctr - 1] + gap;
+		}
+		
+		check("Clearing", MxPackedIntArrayClear(&array));
+		Fill(&array, values, WidthTestCount);
+		
+		expect(array.blockCount == 1 && array.tailCount == WidthTestCount - BlockSize, "Expected one block and a partial tail");
+		expect(array.blocks[0].bits == bits, "Block packed at the wrong width");
+		
+		CheckContents(&array, values, WidthTestCount);
+	}
+	
+	printf("Blocks packed and unpacked at every width from 0 to 32\n");
+	
+	// Wiped arrays have no block or data space, and must grow it again
+	check("Wiping", MxPackedIntArrayWipe(&array));
+	for (size_t ctr = 0; ctr < WidthTestCount; ++ctr)
+		values[ctr] = (uint32_t)(ctr * 3);
+	Fill(&array, values, WidthTestCount);
+	CheckContents(&array, values, WidthTestCount);
+	
+	check("Final wipe", MxPackedIntArrayWipe(&array));
+}
+
+
+// Runs of equal values, including runs that straddle blocks
+static void test_duplicates(void)
+{
+	MxStatus status = MxStatusOK;
+	MxPackedIntArray array;
+	size_t count = BlockSize * 4 + 50;
+	uint32_t *values = (uint32_t *)malloc(count * sizeof(uint32_t));
+	expect(values != NULL, "Allocating values");
+	
+	// Runs of 7 step by 5, so run ends fall everywhere relative to the blocks
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		values[ctr] = (uint32_t)(ctr / 7) * 5;
+	
+	check("Initialising duplicates", MxPackedIntArrayInit(&array));
+	Fill(&array, values, count);
+	CheckContents(&array, values, count);
+	
+	// Appends must not go below the last value, whether that's in the tail...
+	status = MxPackedIntArrayAppend(&array, values[count - 1] - 1);
+	expect(status == MxStatusIllegalArgument && MxPackedIntArrayGetCount(&array) == count, "Append below the tail should be rejected");
+	
+	// ...or the last packed block, just after the tail was packed
+	check("Clearing", MxPackedIntArrayClear(&array));
+	Fill(&array, values, BlockSize);
+	expect(array.tailCount == 0, "Tail should have just been packed");
+	status = MxPackedIntArrayAppend(&array, values[BlockSize - 1] - 1);
+	expect(status == MxStatusIllegalArgument && MxPackedIntArrayGetCount(&array) == BlockSize, "Append below the last block should be rejected");
+	check("Equal append", MxPackedIntArrayAppend(&array, values[BlockSize - 1]));
+	
+	printf("Duplicates kept, decreasing appends rejected\n");
+	
+	check("Wiping duplicates", MxPackedIntArrayWipe(&array));
+	free(values);
+}
+
+
+static void test_intersection(void)
+{
+	size_t count = BlockSize * 20 + 17;
+	uint32_t *a = (uint32_t *)malloc(count * sizeof(uint32_t));
+	uint32_t *b = (uint32_t *)malloc(count * sizeof(uint32_t));
+	expect(a != NULL && b != NULL, "Allocating values");
+	
+	// Disjoint ranges, either way round
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		a[ctr] = (uint32_t)ctr;
+		b[ctr] = (uint32_t)(ctr + count + 1000);
+	}
+	CheckIntersection("Disjoint", a, count, b, count);
+	CheckIntersection("Disjoint reversed", b, count, a, count);
+	
+	// Interleaved: multiples of 2 and of 3 meet at multiples of 6
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		a[ctr] = (uint32_t)(ctr * 2);
+		b[ctr] = (uint32_t)(ctr * 3);
+	}
+	CheckIntersection("Interleaved", a, count, b, count);
+	
+	// Sparse against dense skips most of the dense blocks undecoded
+	for (size_t ctr = 0; ctr < 40; ++ctr)
+		b[ctr] = (uint32_t)(ctr * 301);
+	CheckIntersection("Sparse", a, count, b, 40);
+	CheckIntersection("Sparse reversed", b, 40, a, count);
+	
+	// Overlapping only at the ends, tail against tail, and with duplicates on both sides
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		b[ctr] = (uint32_t)(ctr + count * 2 - 5);
+	CheckIntersection("Touching", a, count, b, count);
+	CheckIntersection("Tails only", a, 10, a + 5, 10);
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		a[ctr] = (uint32_t)(ctr / 3);
+		b[ctr] = (uint32_t)(ctr / 2);
+	}
+	CheckIntersection("Duplicates", a, count, b, count);
+	CheckIntersection("Empty", a, count, b, 0);
+	
+	free(a);
+	free(b);
+}
+
+
+static void Fill(MxPackedIntArrayRef array, const uint32_t *values, size_t count)
+{
+	MxStatus status = MxStatusOK;
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		check("Appending", MxPackedIntArrayAppend(array, values[ctr]));
+}
+
+
+// Get, Decode, Iterate and LowerBound should all agree with 'expected'
+static void CheckContents(MxPackedIntArrayRef array, const uint32_t *expected, size_t count)
+{
+	MxStatus status = MxStatusOK;
+	uint32_t value;
+	size_t index;
+	
+	expect(MxPackedIntArrayGetCount(array) == count, "Wrong count");
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		check("Get", MxPackedIntArrayGet(array, ctr, &value));
+		expect(value == expected[ctr], "Get returned the wrong value");
+	}
+	
+	status = MxPackedIntArrayGet(array, count, &value);
+	expect(status == MxStatusIndexOutOfRange, "Get(count) should be out of range");
+	
+	uint32_t *decoded = (uint32_t *)malloc((count + 1) * sizeof(uint32_t));
+	expect(decoded != NULL, "Allocating decode buffer");
+	check("Decode", MxPackedIntArrayDecode(array, decoded));
+	expect(memcmp(decoded, expected, count * sizeof(uint32_t)) == 0, "Decode returned the wrong values");
+	free(decoded);
+	
+	IterateState state = { expected, 0 };
+	check("Iterate", MxPackedIntArrayIterate(array, CompareValue, &state));
+	expect(state.position == count, "Iterate missed values");
+	
+	// Each value's first occurrence, and one past it when that's not in the array
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		if (ctr > 0 && expected[ctr] == expected[ctr - 1])
+			continue;
+		
+		check("Lower bound", MxPackedIntArrayLowerBound(array, expected[ctr], &index));
+		expect(index == ctr, "Lower bound should find the first equal value");
+		
+		if (expected[ctr] < UINT32_MAX && (ctr + 1 == count || expected[ctr + 1] > expected[ctr] + 1))
+		{
+			check("Lower bound between", MxPackedIntArrayLowerBound(array, expected[ctr] + 1, &index));
+			expect(index == ctr + 1, "Lower bound between values is wrong");
+		}
+	}
+}
+
+
+// Intersect a and b as packed arrays and compare with a merge of the plain ones
+static void CheckIntersection(const char *title, const uint32_t *a, size_t aCount, const uint32_t *b, size_t bCount)
+{
+	MxStatus status = MxStatusOK;
+	MxPackedIntArray packedA, packedB, result;
+	
+	check("Initialising a", MxPackedIntArrayInit(&packedA));
+	check("Initialising b", MxPackedIntArrayInit(&packedB));
+	check("Initialising result", MxPackedIntArrayInit(&result));
+	Fill(&packedA, a, aCount);
+	Fill(&packedB, b, bCount);
+	
+	uint32_t *expected = (uint32_t *)malloc((aCount + 1) * sizeof(uint32_t));
+	expect(expected != NULL, "Allocating expected values");
+	
+	size_t ia = 0, ib = 0, count = 0;
+	while (ia < aCount && ib < bCount)
+	{
+		if (a[ia] == b[ib])
+		{
+			expected[count++] = a[ia];
+			ia++;
+			ib++;
+		}
+		else if (a[ia] < b[ib])
+			ia++;
+		else
+			ib++;
+	}
+	
+	check("Intersecting", MxPackedIntArrayIntersect(&packedA, &packedB, &result));
+	CheckContents(&result, expected, count);
+	
+	status = MxPackedIntArrayIntersect(&packedA, &packedB, &packedA);
+	expect(status == MxStatusIllegalArgument, "Intersecting into an input should be rejected");
+	
+	printf("%s: %zu values in common\n", title, count);
+	
+	free(expected);
+	MxPackedIntArrayWipe(&packedA);
+	MxPackedIntArrayWipe(&packedB);
+	MxPackedIntArrayWipe(&result);
+}
+
+
+static MxStatus CompareValue(const void *value, void *vstate)
+{
+	IterateState *state = (IterateState *)vstate;
+	
+	if (*(const uint32_t *)value != state->expected[state->position])
+		return MxStatusInvalidStructure;
+	
+	state->position += 1;
+	return MxStatusOK;
+}
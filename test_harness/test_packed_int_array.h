@@ -0,0 +1,11 @@
+//
+//  test_packed_int_array.h
+//  core_ds
+//
+
+#ifndef core_ds_test_packed_int_array_h
+#define core_ds_test_packed_int_array_h
+
+void test_packed_int_array(void);
+
+#endif
@@ -0,0 +1,485 @@
+//
+//  test_roaring.c
+//  core_ds
+//
+
+#include "test_roaring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "MxRoaringBitmap.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+#define ContainerValues (65536)
+// Operands use containers 0 to 2 - every reference covers them all
+#define ReferenceValues (3 * ContainerValues)
+
+// The ways a container is filled
+typedef enum {
+	SparseArray,	// every 37th value
+	FullArray,		// every 16th value - exactly MxRoaringArrayMaxCardinality
+	DenseBitmap,	// a third of the values at random
+	Runs,			// long runs, stored as runs
+	KindCount
+} ContainerKind;
+
+static const char *kindNames[KindCount] = { "array", "full array", "bitmap", "runs" };
+
+static void test_conversions(void);
+static void test_run_changes(void);
+static void test_operations(void);
+static void test_malformed(void);
+static void Fill(MxRoaringBitmapRef bitmap, char *reference, ContainerKind kind, uint16_t key, int seed);
+static void CheckContents(MxRoaringBitmapRef bitmap, const char *reference, const char *message);
+static void CheckRanks(MxRoaringBitmapRef bitmap, const char *reference);
+static void CheckRoundTrip(MxRoaringBitmapRef bitmap, const char *reference);
+static unsigned char *SerializeCopy(MxRoaringBitmapRef bitmap, size_t extra, size_t *size);
+static void ExpectRejected(const unsigned char *buffer, size_t size, const char *message);
+static MxStatus CompareValue(const void *value, void *state);
+
+static inline void Put16(unsigned char *p, uint16_t value) { p[0] = (unsigned char)value; p[1] = (unsigned char)(value >> 8); }
+static inline uint16_t Get16(const unsigned char *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static inline void Put32(unsigned char *p, uint32_t value) { Put16(p, (uint16_t)value); Put16(p + 2, (uint16_t)(value >> 16)); }
+static inline uint32_t Get32(const unsigned char *p) { return Get16(p) | ((uint32_t)Get16(p + 2) << 16); }
+
+// Where CompareValue is up to, and the values it should see
+typedef struct {
+	const char *reference;
+	uint32_t position;
+} IterateState;
+
+// Too big for the stack
+static char referenceA[ReferenceValues], referenceB[ReferenceValues], expected[ReferenceValues];
+
+
+void test_roaring(void)
+{
+	printf("\n-- Roaring bitmap ------\n");
+	
+	test_conversions();
+	test_run_changes();
+	test_operations();
+	test_malformed();
+}
+
+
+// Array containers hold up to MxRoaringArrayMaxCardinality values, bitmaps anything more
+static void test_conversions(void)
+{
+	MxStatus status = MxStatusOK;
+	MxRoaringBitmap bitmap;
+	
+	memset(referenceA, 0, sizeof(referenceA));
+	check("Initialising", MxRoaringBitmapInit(&bitmap));
+	
+	for (uint32_t value = 0; value < MxRoaringArrayMaxCardinality * 2; value += 2)
+	{
+		check("Adding", MxRoaringBitmapAdd(&bitmap, value));
+		referenceA[value] = 1;
+	}
+	expect(bitmap.count == 1 && bitmap.containers[0].type == MxRoaringArrayContainer, "A full container should still be an array");
+	CheckContents(&bitmap, referenceA, "Full array");
+	
+	check("Adding", MxRoaringBitmapAdd(&bitmap, 1));
+	referenceA[1] = 1;
+	expect(bitmap.containers[0].type == MxRoaringBitmapContainer, "One past a full array should be a bitmap");
+	CheckContents(&bitmap, referenceA, "Array grown into a bitmap");
+	
+	// Adding what's there already changes nothing
+	check("Adding again", MxRoaringBitmapAdd(&bitmap, 1));
+	expect(MxRoaringBitmapGetCardinality(&bitmap) == MxRoaringArrayMaxCardinality + 1, "Adding a value twice counted it twice");
+	
+	check("Removing", MxRoaringBitmapRemove(&bitmap, 4));
+	referenceA[4] = 0;
+	expect(bitmap.containers[0].type == MxRoaringArrayContainer, "A bitmap back down to a full array's worth should be an array");
+	CheckContents(&bitmap, referenceA, "Bitmap shrunk into an array");
+	
+	status = MxRoaringBitmapRemove(&bitmap, 4);
+	expect(status == MxStatusNotFound, "Removing a missing value should be NotFound");
+	
+	// Emptied containers go
+	for (uint32_t value = 0; value < MxRoaringArrayMaxCardinality * 2; ++value)
+		if (referenceA[value])
+			check("Emptying", MxRoaringBitmapRemove(&bitmap, value));
+	expect(bitmap.count == 0 && MxRoaringBitmapGetCardinality(&bitmap) == 0, "Emptied container left behind");
+	
+	printf("Containers switch between array and bitmap at %d values\n", MxRoaringArrayMaxCardinality);
+	
+	check("Wiping", MxRoaringBitmapWipe(&bitmap));
+}
+
+
+// Run containers turn back into arrays or bitmaps when they change
+static void test_run_changes(void)
+{
+	MxStatus status = MxStatusOK;
+	MxRoaringBitmap bitmap;
+	
+	memset(referenceA, 0, sizeof(referenceA));
+	check("Initialising", MxRoaringBitmapInit(&bitmap));
+	
+	// A long run, from a bitmap...
+	for (uint32_t value = 0; value < 10000; ++value)
+	{
+		check("Adding", MxRoaringBitmapAdd(&bitmap, value));
+		referenceA[value] = 1;
+	}
+	check("Optimizing", MxRoaringBitmapRunOptimize(&bitmap));
+	expect(bitmap.containers[0].type == MxRoaringRunContainer && bitmap.containers[0].count == 1, "Expected a single run");
+	CheckContents(&bitmap, referenceA, "Long run");
+	
+	check("Adding to a run", MxRoaringBitmapAdd(&bitmap, 20000));
+	referenceA[20000] = 1;
+	expect(bitmap.containers[0].type == MxRoaringBitmapContainer, "A long run should be added to as a bitmap");
+	CheckContents(&bitmap, referenceA, "Added to a long run");
+	
+	check("Optimizing", MxRoaringBitmapRunOptimize(&bitmap));
+	expect(bitmap.containers[0].type == MxRoaringRunContainer && bitmap.containers[0].count == 2, "Expected two runs");
+	
+	status = MxRoaringBitmapRemove(&bitmap, 15000);
+	expect(status == MxStatusNotFound && bitmap.containers[0].type == MxRoaringRunContainer, "Removing a missing value changed the runs");
+	
+	check("Removing from a run", MxRoaringBitmapRemove(&bitmap, 5000));
+	referenceA[5000] = 0;
+	expect(bitmap.containers[0].type == MxRoaringBitmapContainer, "A long run should be removed from as a bitmap");
+	CheckContents(&bitmap, referenceA, "Removed from a long run");
+	
+	// ...and a short one, from an array
+	check("Clearing", MxRoaringBitmapClear(&bitmap));
+	memset(referenceA, 0, sizeof(referenceA));
+	for (uint32_t value = ContainerValues + 100; value < ContainerValues + 200; ++value)
+	{
+		check("Adding", MxRoaringBitmapAdd(&bitmap, value));
+		referenceA[value] = 1;
+	}
+	check("Optimizing", MxRoaringBitmapRunOptimize(&bitmap));
+	expect(bitmap.containers[0].type == MxRoaringRunContainer, "Expected a short run");
+	
+	check("Removing from a run", MxRoaringBitmapRemove(&bitmap, ContainerValues + 150));
+	referenceA[ContainerValues + 150] = 0;
+	expect(bitmap.containers[0].type == MxRoaringArrayContainer, "A short run should be removed from as an array");
+	CheckContents(&bitmap, referenceA, "Removed from a short run");
+	
+	check("Optimizing", MxRoaringBitmapRunOptimize(&bitmap));
+	check("Adding to a run", MxRoaringBitmapAdd(&bitmap, ContainerValues + 300));
+	referenceA[ContainerValues + 300] = 1;
+	expect(bitmap.containers[0].type == MxRoaringArrayContainer, "A short run should be added to as an array");
+	CheckContents(&bitmap, referenceA, "Added to a short run");
+	
+	printf("Run containers changed by Add and Remove\n");
+	
+	check("Wiping", MxRoaringBitmapWipe(&bitmap));
+}
+
+
+// Or and And for every pair of container kinds, with ranks and serialization on the way
+static void test_operations(void)
+{
+	MxStatus status = MxStatusOK;
+	MxRoaringBitmap a, b;
+	
+	srand(17);
+	for (int aKind = 0; aKind < KindCount; ++aKind)
+	{
+		for (int bKind = 0; bKind < KindCount; ++bKind)
+		{
+			// Both have container 0, only one has container 1 and only the other container 2
+			memset(referenceA, 0, sizeof(referenceA));
+			memset(referenceB, 0, sizeof(referenceB));
+			check("Initialising", MxRoaringBitmapInit(&a));
+			check("Initialising", MxRoaringBitmapInit(&b));
+			Fill(&a, referenceA, (ContainerKind)aKind, 0, 1);
+			Fill(&a, referenceA, (ContainerKind)aKind, 1, 2);
+			Fill(&b, referenceB, (ContainerKind)bKind, 0, 3);
+			Fill(&b, referenceB, (ContainerKind)bKind, 2, 4);
+			
+			CheckRanks(&a, referenceA);
+			if (bKind == 0)
+				CheckRoundTrip(&a, referenceA);
+			
+			for (uint32_t value = 0; value < ReferenceValues; ++value)
+				expected[value] = referenceA[value] || referenceB[value];
+			
+			check("Or", MxRoaringBitmapOr(&a, &b));
+			CheckContents(&a, expected, kindNames[aKind]);
+			CheckContents(&b, referenceB, "Or changed its operand");
+			CheckRanks(&a, expected);
+			
+			// And against the operands afresh
+			check("Clearing", MxRoaringBitmapClear(&a));
+			memset(referenceA, 0, sizeof(referenceA));
+			Fill(&a, referenceA, (ContainerKind)aKind, 0, 1);
+			Fill(&a, referenceA, (ContainerKind)aKind, 1, 2);
+			
+			for (uint32_t value = 0; value < ReferenceValues; ++value)
+				expected[value] = referenceA[value] && referenceB[value];
+			
+			check("And", MxRoaringBitmapAnd(&a, &b));
+			CheckContents(&a, expected, kindNames[aKind]);
+			CheckContents(&b, referenceB, "And changed its operand");
+			CheckRanks(&a, expected);
+			
+			check("Wiping", MxRoaringBitmapWipe(&a));
+			check("Wiping", MxRoaringBitmapWipe(&b));
+		}
+	}
+	
+	// Nothing at all round trips too
+	memset(referenceA, 0, sizeof(referenceA));
+	check("Initialising", MxRoaringBitmapInit(&a));
+	CheckRoundTrip(&a, referenceA);
+	check("Wiping", MxRoaringBitmapWipe(&a));
+	
+	printf("Or, And, Rank and serialization correct for every pair of container types\n");
+}
+
+
+// Damage a good buffer one way at a time
+static void test_malformed(void)
+{
+	MxStatus status = MxStatusOK;
+	MxRoaringBitmap bitmap;
+	MxRoaringBitmapView view;
+	size_t size = 0;
+	
+	memset(referenceA, 0, sizeof(referenceA));
+	check("Initialising", MxRoaringBitmapInit(&bitmap));
+	Fill(&bitmap, referenceA, SparseArray, 0, 1);
+	Fill(&bitmap, referenceA, DenseBitmap, 1, 2);
+	for (uint32_t low = 10; low < 40; ++low)
+		if (low < 20 || low >= 30)
+			check("Adding runs", MxRoaringBitmapAdd(&bitmap, 2 * ContainerValues + low));
+	check("Optimizing", MxRoaringBitmapRunOptimize(&bitmap));
+	expect(bitmap.containers[0].type == MxRoaringArrayContainer && bitmap.containers[1].type == MxRoaringBitmapContainer &&
+	       bitmap.containers[2].type == MxRoaringRunContainer && bitmap.containers[2].count == 2, "Expected an array, a bitmap and two runs");
+	
+	unsigned char *good = SerializeCopy(&bitmap, 0, &size);
+	unsigned char *bad = (unsigned char *)malloc(size);
+	expect(bad != NULL, "Allocating a buffer");
+	check("Viewing the good buffer", MxRoaringBitmapViewInit(&view, good, size));
+	
+	// Descriptor 'n' and its data
+	#define Descriptor(n) (bad + 16 + (n) * 16)
+	#define Data(n) (bad + Get32(Descriptor(n) + 12))
+	#define Damage(change, message) { memcpy(bad, good, size); change; ExpectRejected(bad, size, message); }
+	
+	Damage(bad[0] = 'X', "Bad magic accepted");
+	Damage(Put32(bad + 4, 2), "Unknown version accepted");
+	ExpectRejected(good, size - 1, "Truncated buffer accepted");
+	ExpectRejected(good, 16 + 16, "Missing descriptors accepted");
+	Damage(Put16(Descriptor(1), 0), "Out of order keys accepted");
+	Damage(Descriptor(1)[2] = 4, "Unknown container type accepted");
+	Damage(Put32(Descriptor(0) + 12, (uint32_t)size), "Data past the end accepted");
+	Damage(Put16(Data(0) + 2, Get16(Data(0))), "Repeated array value accepted");
+	Damage(Put16(Data(0), Get16(Data(0) + 2) + 1), "Unsorted array accepted");
+	Damage(Put32(Descriptor(0) + 4, Get32(Descriptor(0) + 4) + 1), "Wrong array cardinality accepted");
+	Damage(Put32(Descriptor(1) + 4, Get32(Descriptor(1) + 4) - 1), "Wrong bitmap cardinality accepted");
+	Damage(Put32(Descriptor(2) + 4, Get32(Descriptor(2) + 4) + 1), "Wrong run cardinality accepted");
+	// Starting the second run inside the first, or running the last off the end, keeps the cardinality
+	Damage(Put16(Data(2) + 4, Get16(Data(2)) + 1), "Overlapping runs accepted");
+	Damage(Put16(Data(2) + 4, Get16(Data(2)) - 1), "Unsorted runs accepted");
+	Damage(Put16(Data(2) + 4, Get16(Data(2)) + Get16(Data(2) + 2)), "Runs overlapping by one accepted");
+	Damage(Put16(Data(2) + 4, 0xffff), "Run past the end of the container accepted");
+	
+	#undef Descriptor
+	#undef Data
+	#undef Damage
+	
+	free(good);
+	free(bad);
+	
+	// An array one over the limit - the last container, so there's room to grow it
+	check("Clearing", MxRoaringBitmapClear(&bitmap));
+	for (uint32_t value = 0; value < MxRoaringArrayMaxCardinality; ++value)
+		check("Adding", MxRoaringBitmapAdd(&bitmap, value * 2));
+	
+	good = SerializeCopy(&bitmap, 2, &size);
+	check("Viewing the full array", MxRoaringBitmapViewInit(&view, good, size));
+	Put32(good + 16 + 4, MxRoaringArrayMaxCardinality + 1);
+	Put32(good + 16 + 8, MxRoaringArrayMaxCardinality + 1);
+	Put16(good + size - 2, 0xffff);
+	ExpectRejected(good, size, "Oversized array accepted");
+	free(good);
+	
+	printf("Malformed buffers rejected\n");
+	
+	check("Wiping", MxRoaringBitmapWipe(&bitmap));
+}
+
+
+// Fill container 'key' with 'kind' of values, different for each seed, and note them in 'reference'
+static void Fill(MxRoaringBitmapRef bitmap, char *reference, ContainerKind kind, uint16_t key, int seed)
+{
+	MxStatus status = MxStatusOK;
+	uint32_t base = (uint32_t)key << 16;
+	MxRoaringBitmap runs;
+	MxRoaringBitmapRef target = bitmap;
+	
+	// Runs are built apart so optimizing them leaves the other containers alone
+	if (kind == Runs)
+	{
+		check("Initialising runs", MxRoaringBitmapInit(&runs));
+		target = &runs;
+	}
+	
+	for (uint32_t low = 0; low < ContainerValues; ++low)
+	{
+		int set;
+		switch (kind)
+		{
+			case SparseArray: set = ((low + (uint32_t)seed) % 37 == 0) || low == 0xffff; break;
+			case FullArray: set = (low % 16 == 15); break;
+			case DenseBitmap: set = (rand() % 3 == 0) || low == 0 || low == 0xffff; break;
+			default: set = ((low + (uint32_t)seed * 50) % 300 < 120) || low == 0xffff; break;
+		}
+		
+		if (set)
+		{
+			check("Filling", MxRoaringBitmapAdd(target, base | low));
+			reference[base | low] = 1;
+		}
+	}
+	
+	if (kind == Runs)
+	{
+		check("Optimizing runs", MxRoaringBitmapRunOptimize(&runs));
+		check("Adding runs", MxRoaringBitmapOr(bitmap, &runs));
+		check("Wiping runs", MxRoaringBitmapWipe(&runs));
+	}
+	
+	size_t index;
+	for (index = 0; index < bitmap->count && bitmap->containers[index].key != key; ++index)
+		;
+	
+	static const uint8_t types[KindCount] = { MxRoaringArrayContainer, MxRoaringArrayContainer, MxRoaringBitmapContainer, MxRoaringRunContainer };
+	expect(index < bitmap->count && bitmap->containers[index].type == types[kind], "Container filled as the wrong type");
+}
+
+
+static void CheckContents(MxRoaringBitmapRef bitmap, const char *reference, const char *message)
+{
+	uint64_t count = 0;
+	for (uint32_t value = 0; value < ReferenceValues; ++value)
+		count += (reference[value] != 0);
+	
+	if (MxRoaringBitmapGetCardinality(bitmap) != count)
+	{
+		fprintf(stderr, "%s: ", message);
+		die("Cardinality doesn't match the values");
+	}
+	
+	IterateState state = { reference, 0 };
+	MxStatus status = MxRoaringBitmapIterate(bitmap, CompareValue, &state);
+	dieIfBad(message, status);
+	
+	for (size_t ctr = 0; ctr < bitmap->count; ++ctr)
+	{
+		MxRoaringContainerRef container = bitmap->containers + ctr;
+		expect(container->cardinality > 0, "Empty container kept");
+		expect(container->type != MxRoaringArrayContainer || container->cardinality <= MxRoaringArrayMaxCardinality, "Oversized array container");
+		expect(container->type != MxRoaringBitmapContainer || container->cardinality > MxRoaringArrayMaxCardinality, "Undersized bitmap container");
+	}
+}
+
+
+// Ranks either side of each container boundary, and the extremes
+static void CheckRanks(MxRoaringBitmapRef bitmap, const char *reference)
+{
+	static const uint32_t probes[] = { 0, 1, 63, 64, 0xfffe, 0xffff, 0x10000, 0x10001, 0x1ffff, 0x20000, 0x2ffff, 0x30000, UINT32_MAX };
+	uint64_t rank = 0;
+	size_t next = 0;
+	
+	for (uint32_t value = 0; value < ReferenceValues && next < sizeof(probes) / sizeof(probes[0]); ++value)
+	{
+		rank += (reference[value] != 0);
+		if (value == probes[next])
+		{
+			expect(MxRoaringBitmapRank(bitmap, value) == rank, "Wrong rank at a container boundary");
+			++next;
+		}
+	}
+	
+	expect(MxRoaringBitmapRank(bitmap, UINT32_MAX) == rank, "Rank of the largest value should be the cardinality");
+}
+
+
+// Serialize, then check a view of the buffer and a bitmap loaded from it
+static void CheckRoundTrip(MxRoaringBitmapRef bitmap, const char *reference)
+{
+	MxStatus status = MxStatusOK;
+	MxRoaringBitmapView view;
+	MxRoaringBitmap loaded;
+	size_t size = 0;
+	
+	unsigned char *buffer = SerializeCopy(bitmap, 0, &size);
+	
+	check("Viewing", MxRoaringBitmapViewInit(&view, buffer, size));
+	expect(MxRoaringBitmapViewGetCardinality(&view) == MxRoaringBitmapGetCardinality(bitmap), "View has the wrong cardinality");
+	for (uint32_t value = 0; value < ReferenceValues; ++value)
+		expect((MxRoaringBitmapViewContains(&view, value) == MxStatusTrue) == (reference[value] != 0), "View has the wrong values");
+	
+	check("Initialising", MxRoaringBitmapInit(&loaded));
+	check("Deserializing", MxRoaringBitmapDeserialize(&loaded, buffer, size));
+	CheckContents(&loaded, reference, "Deserialized");
+	
+	// The same bitmap serializes the same way
+	unsigned char *again = SerializeCopy(&loaded, 0, &size);
+	expect(memcmp(buffer, again, size) == 0, "Round trip changed the serialized form");
+	
+	check("Wiping", MxRoaringBitmapWipe(&loaded));
+	free(buffer);
+	free(again);
+}
+
+
+// A fresh serialization of 'bitmap' with 'extra' zero bytes after it
+static unsigned char *SerializeCopy(MxRoaringBitmapRef bitmap, size_t extra, size_t *size)
+{
+	*size = MxRoaringBitmapGetSerializedSize(bitmap) + extra;
+	unsigned char *buffer = (unsigned char *)calloc(*size, 1);
+	expect(buffer != NULL, "Allocating a buffer");
+	
+	MxStatus status = MxRoaringBitmapSerialize(bitmap, buffer, *size);
+	dieIfBad("Serializing", status);
+	
+	return buffer;
+}
+
+
+static void ExpectRejected(const unsigned char *buffer, size_t size, const char *message)
+{
+	MxRoaringBitmapView view;
+	MxRoaringBitmap bitmap;
+	MxStatus status = MxStatusOK;
+	
+	status = MxRoaringBitmapViewInit(&view, buffer, size);
+	expect(status == MxStatusIllegalArgument, message);
+	
+	check("Initialising", MxRoaringBitmapInit(&bitmap));
+	status = MxRoaringBitmapDeserialize(&bitmap, buffer, size);
+	expect(status == MxStatusIllegalArgument && bitmap.count == 0, message);
+	check("Wiping", MxRoaringBitmapWipe(&bitmap));
+}
+
+
+// Each value passed must be the next one set in the reference, in order
+static MxStatus CompareValue(const void *value, void *vstate)
+{
+	IterateState *state = (IterateState *)vstate;
+	uint32_t got = *(const uint32_t *)value;
+	
+	while (state->position < ReferenceValues && !state->reference[state->position])
+		++state->position;
+	
+	expect(got == state->position, "Iterate visited the wrong value");
+	++state->position;
+	
+	return MxStatusOK;
+}
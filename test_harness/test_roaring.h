@@ -0,0 +1,11 @@
+//
+//  test_roaring.h
+//  core_ds
+//
+
+#ifndef core_ds_test_roaring_h
+#define core_ds_test_roaring_h
+
+void test_roaring(void);
+
+#endif
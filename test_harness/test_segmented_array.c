@@ -0,0 +1,137 @@
+//
+//  test_segmented_array.c
+//  core_ds
+//
+
+#include "test_segmented_array.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "MxSegmentedArray.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+// Enough segments to double the directory a few times
+#define ItemCount (MxSegmentedArraySegmentSize * MxSegmentedArrayDefaultDirectoryCapacity * 5 + 3)
+
+// Items are integers stored in the pointer itself
+#define Item(n) ((void *)(uintptr_t)(n))
+
+static MxStatus SumItem(const void *item, void *state);
+
+
+void test_segmented_array(void)
+{
+	MxStatus status = MxStatusOK;
+	MxSegmentedArray array;
+	void *item;
+	void **slot;
+	
+	printf("\n-- Segmented array ------\n");
+	
+	check("Initialising", MxSegmentedArrayInit(&array));
+	
+	// Slot addresses taken at the start must survive every later segment and directory growth
+	void **firstSlot, **lastInFirstSegment;
+	check("Append 0", MxSegmentedArrayAppend(&array, Item(0)));
+	check("Slot 0", MxSegmentedArraySlotAt(&array, 0, &firstSlot));
+	
+	for (size_t ctr = 1; ctr < MxSegmentedArraySegmentSize; ++ctr)
+		check("Append", MxSegmentedArrayAppend(&array, Item(ctr)));
+	check("Last slot of first segment", MxSegmentedArraySlotAt(&array, MxSegmentedArraySegmentSize - 1, &lastInFirstSegment));
+	
+	size_t directoryCapacity = array.directoryCapacity;
+	int directoryGrowths = 0;
+	
+	for (size_t ctr = MxSegmentedArraySegmentSize; ctr < ItemCount; ++ctr)
+	{
+		check("Append", MxSegmentedArrayAppend(&array, Item(ctr)));
+		
+		if (array.directoryCapacity != directoryCapacity)
+		{
+			directoryGrowths++;
+			directoryCapacity = array.directoryCapacity;
+		}
+	}
+	
+	printf("%zu items in %zu segments, directory grew %d times\n", MxSegmentedArrayGetCount(&array), array.segmentCount, directoryGrowths);
+	expect(directoryGrowths >= 2, "Directory should have grown");
+	
+	check("Slot 0 after growth", MxSegmentedArraySlotAt(&array, 0, &slot));
+	expect(slot == firstSlot && *firstSlot == Item(0), "First slot moved");
+	check("Slot after growth", MxSegmentedArraySlotAt(&array, MxSegmentedArraySegmentSize - 1, &slot));
+	expect(slot == lastInFirstSegment, "Slot at the end of the first segment moved");
+	
+	// Writes through an old slot pointer are seen by ItemAt
+	*firstSlot = Item(12345);
+	check("Item at 0", MxSegmentedArrayItemAt(&array, 0, &item));
+	expect(item == Item(12345), "Write through a slot wasn't seen");
+	*firstSlot = Item(0);
+	
+	// Indexed access either side of every segment boundary, and consecutive slots within a
+	// segment are adjacent
+	for (size_t boundary = MxSegmentedArraySegmentSize; boundary < ItemCount; boundary += MxSegmentedArraySegmentSize)
+	{
+		for (size_t idx = boundary - 2; idx <= boundary + 1 && idx < ItemCount; ++idx)
+		{
+			check("Item at boundary", MxSegmentedArrayItemAt(&array, idx, &item));
+			expect(item == Item(idx), "Wrong item at a segment boundary");
+		}
+		
+		void **before, **after;
+		check("Slot before boundary", MxSegmentedArraySlotAt(&array, boundary - 2, &before));
+		check("Slot at boundary end", MxSegmentedArraySlotAt(&array, boundary - 1, &after));
+		expect(after == before + 1, "Slots within a segment should be adjacent");
+	}
+	
+	status = MxSegmentedArrayItemAt(&array, ItemCount, &item);
+	expect(status == MxStatusIndexOutOfRange, "ItemAt(count) should be out of range");
+	
+	check("Replace across boundary", MxSegmentedArrayReplaceAt(&array, Item(7), MxSegmentedArraySegmentSize));
+	check("Item after replace", MxSegmentedArrayItemAt(&array, MxSegmentedArraySegmentSize, &item));
+	expect(item == Item(7), "Replace didn't stick");
+	check("Restore", MxSegmentedArrayReplaceAt(&array, Item(MxSegmentedArraySegmentSize), MxSegmentedArraySegmentSize));
+	
+	uint64_t sum = 0;
+	check("Iterate", MxSegmentedArrayIterate(&array, SumItem, &sum));
+	expect(sum == (uint64_t)ItemCount * (ItemCount - 1) / 2, "Iterate missed items");
+	
+	// Pop back over a boundary, then clear and refill into the same segments
+	for (size_t ctr = ItemCount; ctr > ItemCount - 10; --ctr)
+	{
+		check("Pop", MxSegmentedArrayPop(&array, &item));
+		expect(item == Item(ctr - 1), "Pop returned the wrong item");
+	}
+	
+	size_t segments = array.segmentCount;
+	check("Clear", MxSegmentedArrayClear(&array));
+	status = MxSegmentedArrayPop(&array, &item);
+	expect(status == MxStatusNotFound && item == NULL, "Pop of an empty array should fail");
+	
+	for (size_t ctr = 0; ctr < ItemCount; ++ctr)
+		check("Refill", MxSegmentedArrayAppend(&array, Item(ctr)));
+	expect(array.segmentCount == segments, "Refilling should reuse the segments");
+	check("Slot 0 after refill", MxSegmentedArraySlotAt(&array, 0, &slot));
+	expect(slot == firstSlot, "Clear shouldn't move the segments");
+	
+	// A wiped array has no directory, and must grow one again
+	check("Wipe", MxSegmentedArrayWipe(&array));
+	for (size_t ctr = 0; ctr < MxSegmentedArraySegmentSize * 2 + 1; ++ctr)
+		check("Append after wipe", MxSegmentedArrayAppend(&array, Item(ctr)));
+	check("Item after wipe", MxSegmentedArrayItemAt(&array, MxSegmentedArraySegmentSize * 2, &item));
+	expect(item == Item(MxSegmentedArraySegmentSize * 2), "Wrong item after wipe and refill");
+	
+	check("Final wipe", MxSegmentedArrayWipe(&array));
+}
+
+
+static MxStatus SumItem(const void *item, void *state)
+{
+	*(uint64_t *)state += (uintptr_t)item;
+	return MxStatusOK;
+}
@@ -0,0 +1,11 @@
+//
+//  test_segmented_array.h
+//  core_ds
+//
+
+#ifndef core_ds_test_segmented_array_h
+#define core_ds_test_segmented_array_h
+
+void test_segmented_array(void);
+
+#endif
@@ -0,0 +1,113 @@
+//
+//  test_small_array_list.c
+//  core_ds
+//
+
+#include "test_small_array_list.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "MxSmallArrayList.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+#define InlineCount (4)
+
+MX_DEFINE_SMALL_ARRAY_LIST(MxArrayList4, InlineCount)
+
+// Items are integers stored in the pointer itself
+#define Item(n) ((void *)(uintptr_t)(n))
+
+static void CheckItems(MxArrayList4Ref list, size_t count);
+
+
+void test_small_array_list(void)
+{
+	MxStatus status = MxStatusOK;
+	MxArrayList4 list;
+	void *item = NULL;
+	
+	printf("\n-- Small array list ------\n");
+	
+	check("Initialising", MxArrayList4Init(&list));
+	
+	// Up to N items stay inline
+	for (size_t ctr = 0; ctr < InlineCount; ++ctr)
+		check("Inline append", MxArrayList4Append(&list, Item(ctr)));
+	
+	expect(list.heapItems == NULL && list.capacity == InlineCount, "N items should stay inline");
+	expect(MxArrayList4Items(&list) == list.inlineItems, "Items should be the inline slots");
+	CheckItems(&list, InlineCount);
+	
+	// The next one spills everything to the heap, which then doubles
+	check("Spilling append", MxArrayList4Append(&list, Item(InlineCount)));
+	expect(list.heapItems != NULL && list.capacity == InlineCount * 2, "Item N+1 should spill to the heap");
+	expect(MxArrayList4Items(&list) == list.heapItems, "Items should be the heap array");
+	CheckItems(&list, InlineCount + 1);
+	
+	for (size_t ctr = InlineCount + 1; ctr < 100; ++ctr)
+		check("Heap append", MxArrayList4Append(&list, Item(ctr)));
+	expect(list.capacity == 128, "Heap array should double");
+	CheckItems(&list, 100);
+	
+	// Insert and remove across the old inline/heap boundary
+	check("Insert", MxArrayList4InsertAt(&list, Item(1000), InlineCount));
+	check("Remove", MxArrayList4RemoveAt(&list, InlineCount, &item));
+	expect(item == Item(1000), "Removed the wrong item");
+	CheckItems(&list, 100);
+	
+	// Shrinking to fit trims the heap array while it still can't fit inline...
+	check("Shrink while large", MxArrayList4ShrinkToFit(&list));
+	expect(list.heapItems != NULL && list.capacity == 100, "Shrink should fit the heap array to the count");
+	CheckItems(&list, 100);
+	
+	// ...and moves back inline once it can
+	while (MxArrayList4GetCount(&list) > InlineCount - 1)
+		check("Pop", MxArrayList4Pop(&list, &item));
+	
+	check("Shrink back inline", MxArrayList4ShrinkToFit(&list));
+	expect(list.heapItems == NULL && list.capacity == InlineCount, "Shrink should move back to the inline slots");
+	CheckItems(&list, InlineCount - 1);
+	
+	check("Shrink inline", MxArrayList4ShrinkToFit(&list));
+	expect(list.heapItems == NULL && list.capacity == InlineCount, "Shrinking an inline list should do nothing");
+	
+	// It can spill again after coming back
+	for (size_t ctr = InlineCount - 1; ctr < InlineCount * 3; ++ctr)
+		check("Append after shrink", MxArrayList4Append(&list, Item(ctr)));
+	expect(list.heapItems != NULL, "Should spill again");
+	CheckItems(&list, InlineCount * 3);
+	
+	printf("Spilled to the heap at %d items and moved back inline\n", InlineCount + 1);
+	
+	// Wipe also goes back to the inline slots
+	check("Wiping", MxArrayList4Wipe(&list));
+	expect(list.heapItems == NULL && list.capacity == InlineCount && MxArrayList4GetCount(&list) == 0, "Wipe should go back inline");
+	
+	check("Append after wipe", MxArrayList4Append(&list, Item(0)));
+	CheckItems(&list, 1);
+	check("Final wipe", MxArrayList4Wipe(&list));
+}
+
+
+// The list should hold 0 .. count-1 in order
+static void CheckItems(MxArrayList4Ref list, size_t count)
+{
+	MxStatus status = MxStatusOK;
+	void *item = NULL;
+	
+	expect(MxArrayList4GetCount(list) == count, "Wrong item count");
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+	{
+		check("Item at", MxArrayList4ItemAt(list, (int)ctr, &item));
+		expect(item == Item(ctr), "Wrong item");
+	}
+	
+	expect(MxArrayList4IndexOf(list, Item(count)) == -1, "Found an item past the end");
+}
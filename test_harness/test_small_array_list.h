@@ -0,0 +1,11 @@
+//
+//  test_small_array_list.h
+//  core_ds
+//
+
+#ifndef core_ds_test_small_array_list_h
+#define core_ds_test_small_array_list_h
+
+void test_small_array_list(void);
+
+#endif
@@ -0,0 +1,155 @@
+//
+//  test_sorted_array_list.c
+//  core_ds
+//
+
+#include "test_sorted_array_list.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MxSortedArrayList.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+#define ItemCount (500)
+#define KeyRange (20)
+
+// Items compare on 'key' only; 'seq' records insertion order
+typedef struct {
+	int key;
+	int seq;
+} Item;
+
+static void CheckBounds(MxSortedArrayListRef list, int probeKey);
+static int CompareItems(const void *first, const void *second);
+
+
+void test_sorted_array_list(void)
+{
+	MxStatus status = MxStatusOK;
+	MxSortedArrayList list;
+	static Item items[ItemCount];
+	Item probe = { 0, -1 };
+	size_t index, first, last;
+	void *found;
+	
+	printf("\n-- Sorted array list ------\n");
+	
+	check("Initialising", MxSortedArrayListInit(&list, CompareItems));
+	
+	// Bounds on an empty list are 0
+	check("Empty lower bound", MxSortedArrayListLowerBound(&list, &probe, &index));
+	expect(index == 0, "Lower bound of an empty list should be 0");
+	check("Empty upper bound", MxSortedArrayListUpperBound(&list, &probe, &index));
+	expect(index == 0, "Upper bound of an empty list should be 0");
+	status = MxSortedArrayListFind(&list, &probe, &found);
+	expect(status == MxStatusNotFound && found == NULL, "Find in an empty list should fail");
+	
+	// Insert with plenty of duplicates, checking every bound at every size - odd sizes,
+	// powers of two and one either side exercise the ends of the branchless search
+	srand(7);
+	for (int ctr = 0; ctr < ItemCount; ++ctr)
+	{
+		items[ctr].key = rand() % KeyRange;
+		items[ctr].seq = ctr;
+		
+		check("Inserting", MxSortedArrayListInsert(&list, items + ctr, &index));
+		
+		// Equal items go after the ones already there
+		expect(list.list.items[index] == items + ctr, "Insert reported the wrong index");
+		expect(index + 1 == MxSortedArrayListGetCount(&list) || CompareItems(list.list.items[index + 1], items + ctr) > 0,
+		       "Insert should go after equal items");
+		
+		if (ctr < 70 || ctr == ItemCount - 1)
+		{
+			for (int key = -1; key <= KeyRange; ++key)
+				CheckBounds(&list, key);
+		}
+	}
+	
+	// In key order, and equal keys in the order they were inserted
+	for (size_t ctr = 1; ctr < MxSortedArrayListGetCount(&list); ++ctr)
+	{
+		const Item *previous = list.list.items[ctr - 1], *item = list.list.items[ctr];
+		expect(previous->key < item->key || (previous->key == item->key && previous->seq < item->seq), "List out of order");
+	}
+	
+	// Below every key the bounds are 0, above every key they are the count
+	probe.key = -1;
+	check("Equal range below", MxSortedArrayListEqualRange(&list, &probe, &first, &last));
+	expect(first == 0 && last == 0, "Range below every key should be empty at 0");
+	probe.key = KeyRange;
+	check("Equal range above", MxSortedArrayListEqualRange(&list, &probe, &first, &last));
+	expect(first == ItemCount && last == ItemCount, "Range above every key should be empty at the count");
+	
+	// Find and Remove take the first of the equal items
+	probe.key = KeyRange / 2;
+	check("Equal range", MxSortedArrayListEqualRange(&list, &probe, &first, &last));
+	expect(last > first + 1, "Expected duplicates of the middle key");
+	void *firstEqual = list.list.items[first];
+	void *secondEqual = list.list.items[first + 1];
+	
+	check("Find", MxSortedArrayListFind(&list, &probe, &found));
+	expect(found == firstEqual, "Find should return the first equal item");
+	
+	check("Remove", MxSortedArrayListRemove(&list, &probe));
+	check("Find after remove", MxSortedArrayListFind(&list, &probe, &found));
+	expect(found == secondEqual, "Remove should take the first equal item");
+	expect(MxSortedArrayListGetCount(&list) == ItemCount - 1, "Wrong count after remove");
+	
+	// RemoveAt checks both ends
+	status = MxSortedArrayListRemoveAt(&list, -1, &found);
+	expect(status == MxStatusIllegalArgument, "RemoveAt(-1) should be an illegal argument");
+	status = MxSortedArrayListRemoveAt(&list, (int)MxSortedArrayListGetCount(&list), &found);
+	expect(status == MxStatusIndexOutOfRange, "RemoveAt(count) should be out of range");
+	
+	void *lastItem = list.list.items[MxSortedArrayListGetCount(&list) - 1];
+	check("RemoveAt last", MxSortedArrayListRemoveAt(&list, (int)MxSortedArrayListGetCount(&list) - 1, &found));
+	expect(found == lastItem, "RemoveAt returned the wrong item");
+	check("RemoveAt first", MxSortedArrayListRemoveAt(&list, 0, &found));
+	expect(((Item *)found)->key <= ((Item *)list.list.items[0])->key, "RemoveAt(0) should take the smallest item");
+	
+	for (int key = -1; key <= KeyRange; ++key)
+		CheckBounds(&list, key);
+	
+	printf("%zu items in order, bounds match a linear scan\n", MxSortedArrayListGetCount(&list));
+	
+	check("Wiping", MxSortedArrayListWipe(&list));
+}
+
+
+// Compare the binary searches for 'probeKey' with a linear scan
+static void CheckBounds(MxSortedArrayListRef list, int probeKey)
+{
+	MxStatus status = MxStatusOK;
+	Item probe = { probeKey, -1 };
+	size_t count = MxSortedArrayListGetCount(list);
+	size_t lower = 0, upper, index, first, last;
+	
+	while (lower < count && ((Item *)list->list.items[lower])->key < probeKey)
+		lower++;
+	
+	upper = lower;
+	while (upper < count && ((Item *)list->list.items[upper])->key == probeKey)
+		upper++;
+	
+	check("Lower bound", MxSortedArrayListLowerBound(list, &probe, &index));
+	expect(index == lower, "Lower bound doesn't match a linear scan");
+	
+	check("Upper bound", MxSortedArrayListUpperBound(list, &probe, &index));
+	expect(index == upper, "Upper bound doesn't match a linear scan");
+	
+	check("Equal range", MxSortedArrayListEqualRange(list, &probe, &first, &last));
+	expect(first == lower && last == upper, "Equal range doesn't match a linear scan");
+}
+
+
+static int CompareItems(const void *first, const void *second)
+{
+	int a = ((const Item *)first)->key, b = ((const Item *)second)->key;
+	return (a > b) - (a < b);
+}
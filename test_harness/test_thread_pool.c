@@ -0,0 +1,236 @@
+//
+//  test_thread_pool.c
+//  core_ds
+//
+
+#include "test_thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "MxThreadPool.h"
+#include "MxArrayList.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+#define WorkerCount (3)
+#define TaskCount (64)
+#define ItemCount (100000)
+
+// Items are integers stored in the pointer itself
+#define Item(n) ((void *)(uintptr_t)(n))
+
+typedef struct {
+	int runs[TaskCount];
+	size_t failAt;
+	size_t started;
+	MxThreadPoolRef pool;
+} PoolJob;
+
+static MxStatus CountTask(size_t index, void *vjob);
+static MxStatus FailingTask(size_t index, void *vjob);
+static MxStatus NestingTask(size_t index, void *vjob);
+static MxStatus NestedForEach(const void *item, void *state);
+static MxStatus AddItem(const void *item, void *state);
+static MxStatus MapToInt(const void *item, void **result, void *state);
+static int IsMultipleOfThree(const void *item, void *state);
+static void FreeMapped(void *item);
+
+static size_t mappedLive;
+
+
+void test_thread_pool(void)
+{
+	MxStatus status = MxStatusOK;
+	MxThreadPool pool;
+	PoolJob job;
+	
+	printf("\n-- Thread pool ------\n");
+	
+	// Jobs submitted straight after Init, before the workers have reached their first
+	// wait, and back to back after that: each generation runs every task exactly once
+	for (int round = 0; round < 50; ++round)
+	{
+		check("Initialising pool", MxThreadPoolInit(&pool, WorkerCount));
+		expect(MxThreadPoolGetConcurrency(&pool) == WorkerCount + 1, "Concurrency should count the submitter");
+		
+		for (int jobCount = 0; jobCount < 20; ++jobCount)
+		{
+			memset(&job, 0, sizeof(job));
+			check("Running job", MxThreadPoolRun(&pool, TaskCount, CountTask, &job));
+			
+			for (size_t ctr = 0; ctr < TaskCount; ++ctr)
+				expect(job.runs[ctr] == 1, "Every task should run exactly once per job");
+		}
+		
+		check("Wiping pool", MxThreadPoolWipe(&pool));
+	}
+	
+	printf("1000 jobs ran every task once\n");
+	
+	// Without workers the tasks run in order, so the first failure stops everything after it
+	check("Initialising serial pool", MxThreadPoolInit(&pool, 0));
+	memset(&job, 0, sizeof(job));
+	job.failAt = 10;
+	status = MxThreadPoolRun(&pool, TaskCount, FailingTask, &job);
+	expect(status == MxStatusNotFound, "Should return the first failure");
+	expect(job.started == 11, "Tasks after a failure shouldn't start");
+	check("Wiping serial pool", MxThreadPoolWipe(&pool));
+	
+	// With workers, a failing first task leaves at most one more task per thread started
+	check("Initialising pool", MxThreadPoolInit(&pool, WorkerCount));
+	memset(&job, 0, sizeof(job));
+	job.failAt = 0;
+	status = MxThreadPoolRun(&pool, TaskCount, FailingTask, &job);
+	expect(status == MxStatusNotFound || status == MxStatusIllegalArgument, "Should return a task's failure");
+	expect(job.started <= WorkerCount + 1 + WorkerCount, "Tasks kept starting after a failure");
+	printf("Failing job stopped after %zu of %d tasks\n", job.started, TaskCount);
+	
+	// A task running a job of its own runs it inline rather than deadlocking
+	memset(&job, 0, sizeof(job));
+	job.pool = &pool;
+	check("Nested run", MxThreadPoolRun(&pool, TaskCount, NestingTask, &job));
+	for (size_t ctr = 0; ctr < TaskCount; ++ctr)
+		expect(job.runs[ctr] == TaskCount + 1, "Nested jobs should run every task");
+	
+	// The pool still works normally afterwards
+	memset(&job, 0, sizeof(job));
+	check("Job after nesting", MxThreadPoolRun(&pool, TaskCount, CountTask, &job));
+	for (size_t ctr = 0; ctr < TaskCount; ++ctr)
+		expect(job.runs[ctr] == 1, "Every task should run exactly once after nesting");
+	
+	printf("Nested jobs ran inline\n");
+	
+	// Parallel list operations
+	MxArrayList list, dest;
+	check("Initialising list", MxArrayListInit(&list));
+	for (size_t ctr = 1; ctr <= ItemCount; ++ctr)
+		check("Appending", MxArrayListAppend(&list, Item(ctr)));
+	
+	uint64_t sum = 0;
+	check("For each", MxArrayListParallelForEach(&pool, &list, AddItem, &sum));
+	expect(sum == (uint64_t)ItemCount * (ItemCount + 1) / 2, "ForEach missed items");
+	
+	// Parallel operations inside a parallel callback
+	sum = 0;
+	MxArrayList small;
+	check("Initialising inner list", MxArrayListInit(&small));
+	for (size_t ctr = 1; ctr <= 3; ++ctr)
+		check("Appending inner", MxArrayListAppend(&small, Item(ctr)));
+	void *nestedState[] = { &pool, &small, &sum };
+	check("Nested for each", MxArrayListParallelForEach(&pool, &list, NestedForEach, nestedState));
+	expect(sum == (uint64_t)ItemCount * 6, "Nested ForEach missed items");
+	MxArrayListWipe(&small);
+	
+	// Filter keeps the matches in list order, after anything already in dest
+	check("Initialising filter dest", MxArrayListInit(&dest));
+	check("Pre-filled dest", MxArrayListAppend(&dest, Item(0)));
+	check("Filter", MxArrayListParallelFilter(&pool, &list, &dest, IsMultipleOfThree, NULL));
+	expect(MxArrayListGetCount(&dest) == 1 + ItemCount / 3, "Filter kept the wrong number of items");
+	for (size_t ctr = 0; ctr < MxArrayListGetCount(&dest); ++ctr)
+		expect(dest.items[ctr] == Item(ctr * 3), "Filter changed the order");
+	MxArrayListWipe(&dest);
+	
+	// A failing map leaves dest as it was, with the results already made freed
+	check("Initialising map dest", MxArrayListInitWithFunctions(&dest, FreeMapped, NULL));
+	mappedLive = 0;
+	check("Pre-filled map", MxArrayListAppend(&dest, malloc(sizeof(int))));
+	mappedLive = 1;
+	
+	size_t failAt = ItemCount - 5;
+	status = MxArrayListParallelMap(&pool, &list, &dest, MapToInt, &failAt);
+	expect(status == MxStatusIllegalArgument, "Map should return the failure");
+	expect(MxArrayListGetCount(&dest) == 1, "A failed map should leave dest as it was");
+	expect(__atomic_load_n(&mappedLive, __ATOMIC_RELAXED) == 1, "A failed map should free its results");
+	
+	failAt = 0;
+	check("Map", MxArrayListParallelMap(&pool, &list, &dest, MapToInt, &failAt));
+	expect(MxArrayListGetCount(&dest) == 1 + ItemCount, "Map should append every result");
+	for (size_t ctr = 1; ctr <= ItemCount; ++ctr)
+		expect(*(int *)dest.items[ctr] == (int)ctr * 2, "Map results out of order");
+	
+	MxArrayListWipe(&dest);
+	expect(mappedLive == 0, "Wipe should free the mapped results");
+	
+	printf("ForEach, Filter and Map ran across %d threads\n", WorkerCount + 1);
+	
+	MxArrayListWipe(&list);
+	check("Wiping pool", MxThreadPoolWipe(&pool));
+}
+
+
+static MxStatus CountTask(size_t index, void *vjob)
+{
+	PoolJob *job = (PoolJob *)vjob;
+	__atomic_fetch_add(job->runs + index, 1, __ATOMIC_RELAXED);
+	
+	return MxStatusOK;
+}
+
+// Task 'failAt' fails with MxStatusNotFound, any later one with MxStatusIllegalArgument
+static MxStatus FailingTask(size_t index, void *vjob)
+{
+	PoolJob *job = (PoolJob *)vjob;
+	__atomic_fetch_add(&job->started, 1, __ATOMIC_RELAXED);
+	
+	if (index == job->failAt)
+		return MxStatusNotFound;
+	
+	return (index > job->failAt) ? MxStatusIllegalArgument : MxStatusOK;
+}
+
+// Every task runs a whole job of CountTask on the same pool
+static MxStatus NestingTask(size_t index, void *vjob)
+{
+	PoolJob *job = (PoolJob *)vjob;
+	CountTask(index, job);
+	
+	return MxThreadPoolRun(job->pool, TaskCount, CountTask, job);
+}
+
+static MxStatus NestedForEach(const void *item, void *state)
+{
+	(void)item;
+	void **nestedState = (void **)state;
+	return MxArrayListParallelForEach((MxThreadPoolRef)nestedState[0], (MxArrayListRef)nestedState[1], AddItem, nestedState[2]);
+}
+
+static MxStatus AddItem(const void *item, void *state)
+{
+	__atomic_fetch_add((uint64_t *)state, (uint64_t)(uintptr_t)item, __ATOMIC_RELAXED);
+	return MxStatusOK;
+}
+
+// Doubles the item into a new int, failing on item *state
+static MxStatus MapToInt(const void *item, void **result, void *state)
+{
+	if ((uintptr_t)item == *(size_t *)state)
+		return MxStatusIllegalArgument;
+	
+	int *value = (int *)malloc(sizeof(int));
+	if (value == NULL)
+		return MxStatusNoMemory;
+	
+	*value = (int)(uintptr_t)item * 2;
+	*result = value;
+	__atomic_fetch_add(&mappedLive, 1, __ATOMIC_RELAXED);
+	
+	return MxStatusOK;
+}
+
+static int IsMultipleOfThree(const void *item, void *state)
+{
+	(void)state;
+	return (uintptr_t)item % 3 == 0;
+}
+
+static void FreeMapped(void *item)
+{
+	__atomic_fetch_sub(&mappedLive, 1, __ATOMIC_RELAXED);
+	free(item);
+}
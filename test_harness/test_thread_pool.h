@@ -0,0 +1,11 @@
+//
+//  test_thread_pool.h
+//  core_ds
+//
+
+#ifndef core_ds_test_thread_pool_h
+#define core_ds_test_thread_pool_h
+
+void test_thread_pool(void);
+
+#endif
@@ -0,0 +1,128 @@
+//
+//  test_typed_array.c
+//  core_ds
+//
+
+#include "test_typed_array.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "MxTypedArray.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+typedef struct _Point {
+	int x;
+	int y;
+} Point;
+
+MX_DEFINE_ARRAY(IntArray, int)
+MX_DEFINE_ARRAY(PointArray, Point)
+
+static void CheckInts(IntArrayRef array, const int *expected, size_t count, const char *message);
+static MxStatus CheckPoint(const void *item, void *state);
+
+
+void test_typed_array(void)
+{
+	MxStatus status = MxStatusOK;
+	IntArray numbers;
+	
+	printf("\n-- Typed array ------\n");
+	
+	// Small enough that the appends grow it 2, 4, 8, 16
+	check("Initialising ints", IntArrayInitWithCapacity(&numbers, 2));
+	
+	for (int ctr = 0; ctr < 10; ++ctr)
+		check("Appending", IntArrayAppend(&numbers, ctr * ctr));
+	
+	static const int squares[] = { 0, 1, 4, 9, 16, 25, 36, 49, 64, 81 };
+	CheckInts(&numbers, squares, 10, "Appended squares");
+	expect(numbers.capacity == 16, "Expected 2 to double to 16");
+	
+	check("Insert at front", IntArrayInsertAt(&numbers, -1, 0));
+	check("Insert in middle", IntArrayInsertAt(&numbers, -2, 5));
+	check("Insert at end", IntArrayInsertAt(&numbers, -3, (int)IntArrayGetCount(&numbers)));
+	
+	static const int inserted[] = { -1, 0, 1, 4, 9, -2, 16, 25, 36, 49, 64, 81, -3 };
+	CheckInts(&numbers, inserted, 13, "Inserted at front, middle and end");
+	
+	status = IntArrayInsertAt(&numbers, 0, 14);
+	expect(status == MxStatusIndexOutOfRange, "Inserting past the end should be out of range");
+	status = IntArrayInsertAt(&numbers, 0, -1);
+	expect(status == MxStatusIllegalArgument, "Inserting at a negative index should be rejected");
+	
+	int removed = 0;
+	check("Removing", IntArrayRemoveAt(&numbers, 5, &removed));
+	expect(removed == -2, "RemoveAt returned the wrong item");
+	check("Popping", IntArrayPop(&numbers, &removed));
+	expect(removed == -3, "Pop returned the wrong item");
+	check("Removing the first", IntArrayRemoveAt(&numbers, 0, NULL));
+	
+	CheckInts(&numbers, squares, 10, "Removed the inserts");
+	
+	check("Replacing", IntArrayReplaceAt(&numbers, 100, 9));
+	check("Item at", IntArrayItemAt(&numbers, 9, &removed));
+	expect(removed == 100, "ReplaceAt didn't replace");
+	
+	status = IntArrayItemAt(&numbers, 100, &removed);
+	expect(status == MxStatusIndexOutOfRange && removed == 100, "Item past the end should be out of range");
+	
+	check("Clearing", IntArrayClear(&numbers));
+	status = IntArrayPop(&numbers, &removed);
+	expect(status == MxStatusNotFound && removed == 100, "Popping an empty array should be NotFound");
+	
+	// A wiped array grows again from nothing
+	check("Wiping ints", IntArrayWipe(&numbers));
+	for (int ctr = 0; ctr < 10; ++ctr)
+		check("Appending after Wipe", IntArrayAppend(&numbers, ctr * ctr));
+	CheckInts(&numbers, squares, 10, "Appended after Wipe");
+	
+	check("Wiping ints", IntArrayWipe(&numbers));
+	
+	printf("Ints appended, inserted, removed and grown\n");
+	
+	
+	PointArrayRef points = PointArrayCreate();
+	if (points == NULL)
+		die("Could not create point array - probably out of memory.");
+	
+	for (int ctr = 0; ctr < 5; ++ctr)
+	{
+		Point p = { ctr, -ctr };
+		check("Appending point", PointArrayAppend(points, p));
+	}
+	
+	int next = 0;
+	check("Iterating points", PointArrayIterate(points, CheckPoint, &next));
+	expect(next == 5 && PointArrayGetCount(points) == 5, "Iterate missed points");
+	
+	printf("Points stored by value\n");
+	
+	check("Deleting points", PointArrayDelete(points));
+}
+
+
+static void CheckInts(IntArrayRef array, const int *expected, size_t count, const char *message)
+{
+	expect(IntArrayGetCount(array) == count, message);
+	
+	for (size_t ctr = 0; ctr < count; ++ctr)
+		expect(array->items[ctr] == expected[ctr], message);
+}
+
+// Point n is (n, -n)
+static MxStatus CheckPoint(const void *item, void *state)
+{
+	const Point *p = (const Point *)item;
+	int *next = (int *)state;
+	
+	expect(p->x == *next && p->y == -*next, "Iterate visited the wrong point");
+	*next += 1;
+	
+	return MxStatusOK;
+}
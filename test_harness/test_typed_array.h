@@ -0,0 +1,11 @@
+//
+//  test_typed_array.h
+//  core_ds
+//
+
+#ifndef core_ds_test_typed_array_h
+#define core_ds_test_typed_array_h
+
+void test_typed_array(void);
+
+#endif
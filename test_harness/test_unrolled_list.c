@@ -0,0 +1,372 @@
+//
+//  test_unrolled_list.c
+//  core_ds
+//
+
+#include "test_unrolled_list.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "MxUnrolledList.h"
+
+#include "utils.h"
+
+#define check(preamble, call) { status = call; dieIfBad(preamble, status);}
+#define expect(condition, message) { if (!(condition)) die(message); }
+
+#define NodeCapacity MxUnrolledListNodeCapacity
+// Largest list the random test builds
+#define MaxItems (2000)
+#define RandomOps (20000)
+
+// Items are integers stored in the pointer itself, offset so that 0 isn't NULL
+#define Item(n) ((void *)(uintptr_t)((n) + 1))
+#define Value(item) ((int)(uintptr_t)(item) - 1)
+
+static void test_node_boundaries(void);
+static void test_splits_and_merges(void);
+static void test_filter(void);
+static void test_random_ops(void);
+static void CheckList(MxUnrolledListRef list, const int *expected, int count, const char *message);
+static MxStatus CheckBackward(const void *item, void *state);
+static int IsEven(const void *item, void *state);
+static int InRange(const void *item, void *state);
+static void CountFree(void *item);
+
+// Where CheckBackward is up to, and what it should see
+typedef struct {
+	const int *expected;
+	int position;
+} BackwardState;
+
+static int itemsFreed = 0;
+// The reference the list is compared against
+static int reference[MaxItems];
+
+
+void test_unrolled_list(void)
+{
+	printf("\n-- Unrolled list ------\n");
+	
+	test_node_boundaries();
+	test_splits_and_merges();
+	test_filter();
+	test_random_ops();
+}
+
+
+// Appends and pushes either side of a full node
+static void test_node_boundaries(void)
+{
+	MxStatus status = MxStatusOK;
+	MxUnrolledList list;
+	
+	static const int sizes[] = { 1, NodeCapacity - 1, NodeCapacity, NodeCapacity + 1, 2 * NodeCapacity, 2 * NodeCapacity + 1 };
+	for (size_t size = 0; size < sizeof(sizes) / sizeof(sizes[0]); ++size)
+	{
+		int count = sizes[size];
+		int nodes = (count + NodeCapacity - 1) / NodeCapacity;
+		
+		check("Initialising", MxUnrolledListInitWithFunctions(&list, NULL, NULL));
+		for (int ctr = 0; ctr < count; ++ctr)
+		{
+			check("Appending", MxUnrolledListAppend(&list, Item(ctr)));
+			reference[ctr] = ctr;
+		}
+		CheckList(&list, reference, count, "Appended");
+		expect(list.nodeCount == nodes, "Appends should fill each node before starting another");
+		check("Wiping", MxUnrolledListWipe(&list));
+		
+		// Pushes fill the front node the same way, backwards
+		check("Initialising", MxUnrolledListInitWithFunctions(&list, NULL, NULL));
+		for (int ctr = count - 1; ctr >= 0; --ctr)
+			check("Pushing", MxUnrolledListPush(&list, Item(ctr)));
+		CheckList(&list, reference, count, "Pushed");
+		expect(list.nodeCount == nodes, "Pushes should fill each node before starting another");
+		check("Wiping", MxUnrolledListWipe(&list));
+	}
+	
+	check("Initialising", MxUnrolledListInitWithFunctions(&list, NULL, NULL));
+	void *item = Item(0);
+	check("Popping empty", MxUnrolledListPop(&list, &item));
+	expect(item == NULL, "Popping an empty list should give NULL");
+	check("Dequeueing empty", MxUnrolledListDequeue(&list, &item));
+	expect(item == NULL, "Dequeueing an empty list should give NULL");
+	status = MxUnrolledListItemAt(&list, 0, &item);
+	expect(status == MxStatusIndexOutOfRange, "Item in an empty list should be out of range");
+	status = MxUnrolledListInsertAtIndex(&list, 1, Item(0));
+	expect(status == MxStatusIndexOutOfRange, "Inserting past the end should be out of range");
+	check("Wiping", MxUnrolledListWipe(&list));
+	
+	printf("Nodes filled to %d either side of each boundary\n", NodeCapacity);
+}
+
+
+static void test_splits_and_merges(void)
+{
+	MxStatus status = MxStatusOK;
+	MxUnrolledList list;
+	void *item = NULL;
+	int count = 2 * NodeCapacity;
+	
+	check("Initialising", MxUnrolledListInitWithFunctions(&list, NULL, NULL));
+	for (int ctr = 0; ctr < count; ++ctr)
+	{
+		check("Appending", MxUnrolledListAppend(&list, Item(ctr * 10)));
+		reference[ctr] = ctr * 10;
+	}
+	
+	// Into the middle of a full first node: it splits in half and the new item joins the lower half
+	check("Inserting", MxUnrolledListInsertAtIndex(&list, 5, Item(55)));
+	memmove(reference + 6, reference + 5, (size_t)(count - 5) * sizeof(int));
+	reference[5] = 55;
+	count++;
+	CheckList(&list, reference, count, "Inserted into a full node");
+	expect(list.nodeCount == 3 && list.head->count == NodeCapacity / 2 + 1 && list.head->next->count == NodeCapacity / 2, "Full node should split in half");
+	
+	// Into the upper half of the full last node
+	check("Inserting", MxUnrolledListInsertAtIndex(&list, count - 3, Item(77)));
+	memmove(reference + count - 2, reference + count - 3, 3 * sizeof(int));
+	reference[count - 3] = 77;
+	count++;
+	CheckList(&list, reference, count, "Inserted into the upper half of a full node");
+	expect(list.nodeCount == 4 && list.tail->count == NodeCapacity / 2 + 1, "Item should have gone into the upper half");
+	
+	// Take the second node below half full - it merges into the first, which has room
+	int nodes = list.nodeCount;
+	check("Removing", MxUnrolledListRemoveAtIndex(&list, NodeCapacity / 2 + 1, &item));
+	expect(Value(item) == reference[NodeCapacity / 2 + 1], "Removed the wrong item");
+	memmove(reference + NodeCapacity / 2 + 1, reference + NodeCapacity / 2 + 2, (size_t)(count - NodeCapacity / 2 - 2) * sizeof(int));
+	count--;
+	CheckList(&list, reference, count, "Removed from a half full node");
+	expect(list.nodeCount == nodes - 1, "A node under half full should merge with a neighbour");
+	
+	// Emptying the list from both ends drops every node
+	while (count > 0)
+	{
+		check("Dequeueing", MxUnrolledListDequeue(&list, &item));
+		expect(Value(item) == reference[--count], "Dequeued the wrong item");
+		if (count == 0)
+			break;
+		
+		check("Popping", MxUnrolledListPop(&list, &item));
+		expect(Value(item) == reference[0], "Popped the wrong item");
+		memmove(reference, reference + 1, (size_t)(--count) * sizeof(int));
+		CheckList(&list, reference, count, "Popped and dequeued");
+	}
+	expect(list.nodeCount == 0 && list.head == NULL && list.tail == NULL, "Emptied list should have no nodes");
+	
+	printf("Full nodes split, sparse nodes merge\n");
+	
+	check("Wiping", MxUnrolledListWipe(&list));
+}
+
+
+static void test_filter(void)
+{
+	MxStatus status = MxStatusOK;
+	MxUnrolledList list;
+	int count = 0;
+	
+	check("Initialising", MxUnrolledListInitWithFunctions(&list, CountFree, NULL));
+	for (int ctr = 0; ctr < 10 * NodeCapacity + 7; ++ctr)
+		check("Appending", MxUnrolledListAppend(&list, Item(ctr)));
+	
+	// Halving every node leaves them all at the merge threshold
+	itemsFreed = 0;
+	check("Filtering evens", MxUnrolledListFilter(&list, IsEven, NULL));
+	for (int ctr = 1; ctr < 10 * NodeCapacity + 7; ctr += 2)
+		reference[count++] = ctr;
+	CheckList(&list, reference, count, "Filtered evens");
+	expect(itemsFreed == 10 * NodeCapacity / 2 + 4, "Filter should free each removed item");
+	
+	// Emptying whole nodes and leaving slivers either side, which merge
+	int range[2] = { 20, 250 };
+	int kept = 0;
+	for (int ctr = 0; ctr < count; ++ctr)
+		if (reference[ctr] < range[0] || reference[ctr] >= range[1])
+			reference[kept++] = reference[ctr];
+	itemsFreed = 0;
+	check("Filtering a range", MxUnrolledListFilter(&list, InRange, range));
+	expect(itemsFreed == count - kept, "Filter should free each removed item");
+	count = kept;
+	CheckList(&list, reference, count, "Filtered a range");
+	
+	for (MxUnrolledListNodeRef node = list.head; node != NULL && node->next != NULL; node = node->next)
+		expect(node->count >= NodeCapacity / 2 || node->count + node->next->count > NodeCapacity, "Filter left two nodes that should have merged");
+	
+	// And everything
+	range[0] = 0;
+	range[1] = MaxItems;
+	check("Filtering everything", MxUnrolledListFilter(&list, InRange, range));
+	CheckList(&list, reference, 0, "Filtered everything");
+	expect(list.nodeCount == 0, "Filtering everything should drop every node");
+	
+	printf("Filter removes, frees and merges\n");
+	
+	check("Wiping", MxUnrolledListWipe(&list));
+}
+
+
+// Random edits everywhere, against a plain array
+static void test_random_ops(void)
+{
+	MxStatus status = MxStatusOK;
+	MxUnrolledList list;
+	void *item = NULL;
+	int count = 0, next = 0, index = 0;
+	
+	srand(49);
+	check("Initialising", MxUnrolledListInitWithFunctions(&list, NULL, NULL));
+	
+	for (int op = 0; op < RandomOps; ++op)
+	{
+		// Lean towards growing until the list is big, then hover
+		int choice = rand() % 10;
+		int grow = (count < 50) || (count < MaxItems - 1 && choice < 6);
+		
+		if (grow)
+		{
+			index = rand() % (count + 1);
+			if (choice == 0)
+				index = count;
+			else if (choice == 1)
+				index = 0;
+			
+			if (index == count && choice == 0)
+				check("Appending", MxUnrolledListAppend(&list, Item(next)))
+			else if (index == 0 && choice == 1)
+				check("Pushing", MxUnrolledListPush(&list, Item(next)))
+			else
+				check("Inserting", MxUnrolledListInsertAtIndex(&list, index, Item(next)))
+			
+			memmove(reference + index + 1, reference + index, (size_t)(count - index) * sizeof(int));
+			reference[index] = next++;
+			count++;
+		}
+		else if (count > 0)
+		{
+			index = rand() % count;
+			if (choice == 6)
+			{
+				check("Popping", MxUnrolledListPop(&list, &item));
+				index = 0;
+			}
+			else if (choice == 7)
+			{
+				check("Dequeueing", MxUnrolledListDequeue(&list, &item));
+				index = count - 1;
+			}
+			else if (choice == 8)
+			{
+				check("Removing", MxUnrolledListRemove(&list, Item(reference[index])));
+				item = Item(reference[index]);
+			}
+			else
+			{
+				check("Removing at", MxUnrolledListRemoveAtIndex(&list, index, &item));
+			}
+			
+			expect(Value(item) == reference[index], "Removed the wrong item");
+			memmove(reference + index, reference + index + 1, (size_t)(count - index - 1) * sizeof(int));
+			count--;
+		}
+		
+		if (count > 0)
+		{
+			index = rand() % count;
+			check("Item at", MxUnrolledListItemAt(&list, index, &item));
+			expect(Value(item) == reference[index], "ItemAt found the wrong item");
+		}
+		
+		if (op % 500 == 0)
+			CheckList(&list, reference, count, "Random edits");
+	}
+	
+	CheckList(&list, reference, count, "Random edits");
+	
+	status = MxUnrolledListRemove(&list, Item(next));
+	expect(status == MxStatusNotFound, "Removing an absent item should be NotFound");
+	status = MxUnrolledListFindIndex(&list, Item(next), NULL, &index);
+	expect(status == MxStatusNotFound && index == -1, "Finding an absent item should be NotFound");
+	
+	printf("%d random edits matched a plain array (%d items in %d nodes at the end)\n", RandomOps, count, list.nodeCount);
+	
+	check("Wiping", MxUnrolledListWipe(&list));
+}
+
+
+// The list holds 'expected', its nodes are linked and counted properly, and every
+// lookup agrees - ItemAt for every index walks from both ends
+static void CheckList(MxUnrolledListRef list, const int *expected, int count, const char *message)
+{
+	MxStatus status = MxStatusOK;
+	void *item = NULL;
+	int nodes = 0, items = 0;
+	
+	expect(MxUnrolledListGetCount(list) == count, message);
+	expect(list->head == NULL || list->head->prev == NULL, "Head node has a previous node");
+	
+	for (MxUnrolledListNodeRef node = list->head; node != NULL; node = node->next)
+	{
+		expect(node->count > 0 && node->count <= NodeCapacity, "Node empty or over full");
+		expect(node->next != NULL ? node->next->prev == node : list->tail == node, "Node links broken");
+		
+		for (int ctr = 0; ctr < node->count; ++ctr)
+			expect(Value(node->items[ctr]) == expected[items + ctr], message);
+		
+		items += node->count;
+		nodes++;
+	}
+	
+	expect(items == count && nodes == list->nodeCount, "Node counts don't add up");
+	
+	for (int ctr = 0; ctr < count; ++ctr)
+	{
+		check("Item at", MxUnrolledListItemAt(list, ctr, &item));
+		expect(Value(item) == expected[ctr], "ItemAt found the wrong item");
+	}
+	
+	if (count > 0)
+	{
+		int index = 0;
+		check("Finding", MxUnrolledListFindIndex(list, Item(expected[count - 1]), NULL, &index));
+		expect(expected[index] == expected[count - 1], "FindIndex found the wrong item");
+	}
+	
+	BackwardState state = { expected, count };
+	check("Iterating backward", MxUnrolledListIterateBackward(list, CheckBackward, &state));
+	expect(state.position == 0, "Iterating backward missed items");
+}
+
+
+static MxStatus CheckBackward(const void *item, void *vstate)
+{
+	BackwardState *state = (BackwardState *)vstate;
+	
+	expect(state->position > 0 && Value(item) == state->expected[--state->position], "Iterated backward in the wrong order");
+	
+	return MxStatusOK;
+}
+
+static int IsEven(const void *item, void *state)
+{
+	(void)state;
+	return Value(item) % 2 == 0;
+}
+
+// Matches values from range[0] up to but not including range[1]
+static int InRange(const void *item, void *state)
+{
+	const int *range = (const int *)state;
+	return Value(item) >= range[0] && Value(item) < range[1];
+}
+
+static void CountFree(void *item)
+{
+	(void)item;
+	itemsFreed++;
+}
@@ -0,0 +1,11 @@
+//
+//  test_unrolled_list.h
+//  core_ds
+//
+
+#ifndef core_ds_test_unrolled_list_h
+#define core_ds_test_unrolled_list_h
+
+void test_unrolled_list(void);
+
+#endif